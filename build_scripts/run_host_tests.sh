@@ -0,0 +1,7 @@
+#! /bin/bash
+set -eux
+
+#build and run the tests of the firmware modules on the host
+cmake -B $workdir/build/host_tests -S $workdir/test/host
+cmake --build $workdir/build/host_tests
+ctest --test-dir $workdir/build/host_tests --output-on-failure
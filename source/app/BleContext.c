@@ -39,10 +39,12 @@
 
 #include "app_service/item_store/ItemStore.h"
 #include "app_service/networking/HciTransport.h"
+#include "app_service/networking/ble/BleBulkChannel.h"
 #include "app_service/networking/ble/BleGap.h"
 #include "app_service/networking/ble/BleGatt.h"
 #include "app_service/networking/ble/BleHelper.h"
 #include "app_service/networking/ble/BleInterface.h"
+#include "app_service/networking/ble/DownloadTelemetry.h"
 #include "app_service/networking/ble/gatt_service/BatteryService.h"
 #include "app_service/networking/ble/gatt_service/DataLoggerService.h"
 #include "app_service/networking/ble/gatt_service/DeviceSettingsService.h"
@@ -52,6 +54,7 @@
 #include "app_service/nvm/ProductionParameters.h"
 #include "app_service/power_manager/BatteryMonitor.h"
 #include "app_service/sensor/Sht4x.h"
+#include "app_service/timer_server/TimerServer.h"
 #include "app_service/user_button/Button.h"
 #include "hal/Clock.h"
 #include "shci.h"
@@ -70,6 +73,35 @@
 /// value of the magic keyword that is looked up by the OTA loader
 #define MAGIC_OTA_KEYWORD 0x94448A29
 
+/// Maximal payload of a link layer packet with data length extension
+#define MAX_TX_OCTETS 251
+/// Maximal air time of a link layer packet with 251 bytes payload (us)
+#define MAX_TX_TIME 2120
+
+/// Connection interval during a download of samples (6 * 1.25ms)
+#define DOWNLOAD_CONNECTION_INTERVAL 0x6
+/// Minimal connection interval when no download is ongoing (40 * 1.25ms)
+#define IDLE_CONNECTION_INTERVAL_MIN 0x28
+/// Maximal connection interval when no download is ongoing (80 * 1.25ms)
+#define IDLE_CONNECTION_INTERVAL_MAX 0x50
+/// Time without any sent frame after which a download is considered stalled
+#define DOWNLOAD_STALL_TIMEOUT_MS 3000
+
+/// Number of frame buffers; one is drained by the radio while the
+/// application fills the other one.
+#define NR_OF_FRAME_BUFFERS 2
+
+/// Connection handle of a client slot that is not in use
+#define NO_CONNECTION 0xFFFF
+
+/// Transports of the sample frames
+typedef enum {
+  /// Every frame is sent as notification of the sample data characteristic
+  SAMPLE_TRANSPORT_GATT,
+  /// Every frame buffer is sent as one SDU on the bulk channel
+  SAMPLE_TRANSPORT_BULK,
+} SampleTransport_t;
+
 /// Defines the state that is required to complete
 /// the sample data notifications
 typedef struct {
@@ -79,14 +111,62 @@ typedef struct {
   uint16_t samplesTransmitted;
   /// Index of the frame that needs to be transmitted
   uint16_t currentFrameIndex;
-  /// Index of the data that needs to be transmitted
-  uint16_t currentDataIndex;
-  /// handle to the sample data
-  BleGatt_RequestResponseData_t sampleData;
-  /// buffer to be transmitted
-  uint8_t txFrameBuffer[TX_FRAME_SIZE];
+  /// Index of the first frame of the next requested frame buffer
+  uint16_t requestedFrameIndex;
+  /// Size of the data frames; it is fixed for the whole download
+  uint8_t frameSize;
+  /// Encoding of the samples; it is fixed for the whole download
+  DataLoggerService_Encoding_t encoding;
+  /// Transport of the download that is sent
+  SampleTransport_t transport;
+  /// Transport of the download that is requested from the application
+  SampleTransport_t requestedTransport;
+  /// Flag to indicate that the frames of a download are being sent
+  bool isSending;
+  /// Flag to indicate that the header frame still needs to be sent
+  bool isHeaderPending;
+  /// Index of the frame buffer that is drained
+  uint8_t drainedBuffer;
+  /// Position of the next frame to be sent within the drained buffer
+  uint8_t drainedFrame;
+  /// Flags to indicate that a frame buffer was filled by the application
+  bool isBufferFilled[NR_OF_FRAME_BUFFERS];
+  /// Data frames that are filled by the application
+  DataLoggerService_FrameBuffer_t frameBuffers[NR_OF_FRAME_BUFFERS];
+  /// buffer of the header frame
+  uint8_t txFrameBuffer[TX_LEGACY_FRAME_SIZE];
 } SampleDataNotificationState_t;
 
+/// Defines the state of a download session.
+///
+/// While a client downloads samples, the link is switched to the 2M PHY
+/// and the shortest connection interval. When the download completes or
+/// stalls, the link falls back to the low power parameters.
+typedef struct {
+  /// Flag to indicate that the download parameters are requested
+  bool isActive;
+  /// Frame index at the last progress check
+  uint16_t checkedFrameIndex;
+  /// Peripheral latency of the connection
+  uint16_t connectionLatency;
+} DownloadSession_t;
+
+/// Defines the state of a connected client.
+///
+/// The index of a client is the one that the data logger service assigned
+/// to its connection. Every client downloads its samples independently of
+/// the others.
+typedef struct {
+  /// Handle of the client connection; NO_CONNECTION if the slot is free
+  uint16_t connectionHandle;
+  /// Flag to indicate that the download is measured by the telemetry
+  bool isMeasured;
+  /// status information about sample notification
+  SampleDataNotificationState_t notification;
+  /// state of the download session
+  DownloadSession_t session;
+} Client_t;
+
 /// Variable holding the MAGIC_OTA_KEYWORD
 PLACE_IN_SECTION("TAG_OTA_END")
 const uint32_t MagicKeywordValue = MAGIC_OTA_KEYWORD;
@@ -132,8 +212,21 @@ static BleTypes_CompleteAdvertisementData_t gCompleteAdvData = {
 /// sample type when advertisement is disabled
 #define NO_ADV_SAMPLES_TYPE 0x0
 
-/// status information about sample notification
-static SampleDataNotificationState_t _sampleNotification;
+/// The connected clients
+static Client_t _clients[BLE_TYPES_MAX_CLIENTS];
+
+/// Client that gets the first turn when frames may be sent again
+static uint8_t _firstServedClient;
+
+/// Generation of the last frame buffer request; it tells the response to a
+/// request of an ended download from the one of the running download.
+static uint8_t _frameBufferGeneration;
+
+/// Timer to check the progress of the download sessions
+static uint8_t _progressTimer;
+
+/// Connection that asks the user to confirm the pairing
+static uint16_t _pairingConnectionHandle;
 
 /// Ble subsystem state handler
 ///
@@ -168,16 +261,123 @@ static bool HandleServiceRequestResponse(Message_Message_t* message);
 /// @param message Message with a pointer to the settings
 static void UpdateDeviceSettingCharacteristics(Message_Message_t* message);
 
+/// Take a client slot for a new connection
+/// @param connectionHandle Handle of the new connection
+/// @param connectionLatency Peripheral latency of the new connection
+static void OpenClient(uint16_t connectionHandle, uint16_t connectionLatency);
+
+/// Release the slot of a closed connection and stop its download
+/// @param client Index of the client
+static void CloseClient(uint8_t client);
+
+/// Count the connected clients
+/// @return Number of connected clients
+static uint8_t NumberOfClients();
+
+/// Get the client that opened the bulk channel.
+///
+/// The device has a single bulk channel; while one client keeps it open, the
+/// channel requests of the other clients are rejected and they download
+/// their samples through the sample data characteristic.
+/// @return Index of the client; BLE_TYPES_NO_CLIENT if the channel is closed
+static uint8_t BulkChannelClient();
+
+/// Send the frames of all clients that download samples.
+///
+/// The clients take turns; a client sends at most one frame buffer per
+/// turn such that concurrent downloads share the TX pool fairly.
+static void ServeClients();
+
+/// Give a client its turn to send frames
+/// @param client Index of the client
+/// @return true if the client may continue in the next turn; false if it
+///         waits for the TX pool or for a frame buffer
+static bool ServeClient(uint8_t client);
+
 /// Try to send the first notification frame
 /// The frame is already prepared but we may lack tx buffer space
-static void TrySendFirstFrame();
-
-/// Send sample notification frames until all tx buffer space is used up
-/// or no more samples are available
-static void TrySendSampleFrames();
+/// @param client Index of the client
+/// @return true if the frame was sent; false otherwise
+static bool TrySendFirstFrame(uint8_t client);
+
+/// Send the sample notification frames of one frame buffer until the tx
+/// buffer space is used up or no more samples are available
+/// @param client Index of the client
+/// @return true if the frame buffer was sent and the next one is requested;
+///         false otherwise
+static bool TrySendSampleFrames(uint8_t client);
+
+/// Request the application to fill a frame buffer with the next samples
+/// @param client Index of the client
+/// @param bufferIndex Index of the frame buffer to be filled
+static void RequestFrameBuffer(uint8_t client, uint8_t bufferIndex);
 
 /// Stop sending samples
-static void StopSendSamples();
+/// @param client Index of the client
+static void StopSendSamples(uint8_t client);
+
+/// Request a download of the samples selected by the data logger service
+/// @param client Index of the client
+/// @param transport Transport of the sample frames
+static void RequestDownload(uint8_t client, SampleTransport_t transport);
+
+/// Stop a download that is sent on a transport
+/// @param client Index of the client
+/// @param transport Transport of the stopped download
+static void AbortDownload(uint8_t client, SampleTransport_t transport);
+
+/// Tell the application that a client does not read samples anymore
+/// @param client Index of the client
+static void PublishEndSampleDownload(uint8_t client);
+
+/// Send the header frame of a download
+/// @param client Index of the client
+/// @return true if the frame is sent; false if it needs to be retried
+static bool SendHeaderFrame(uint8_t client);
+
+/// Send the next frames of a frame buffer
+///
+/// A notification carries one frame; an SDU of the bulk channel carries all
+/// frames of the buffer.
+/// @param client Index of the client
+/// @param buffer The frame buffer that is drained
+/// @return true if frames are sent; false if they need to be retried
+static bool SendFrames(uint8_t client,
+                       DataLoggerService_FrameBuffer_t* buffer);
+
+/// Tell the BLE context that frames may be sent again
+static void PublishTxPoolAvailable();
+
+/// End the telemetry of a download and publish its statistics
+/// @param client Index of the client
+static void EndDownloadTelemetry(uint8_t client);
+
+/// Request the link parameters that give the highest throughput
+/// @param client Index of the client
+static void BeginDownloadSession(uint8_t client);
+
+/// Request the low power link parameters
+/// @param client Index of the client
+static void EndDownloadSession(uint8_t client);
+
+/// Count the clients whose link has the download parameters
+/// @return Number of active download sessions
+static uint8_t NumberOfDownloadSessions();
+
+/// Request new connection parameters from the central
+/// @param client Index of the client
+/// @param intervalMin Minimal connection interval (1.25ms)
+/// @param intervalMax Maximal connection interval (1.25ms)
+static void RequestConnectionParameters(uint8_t client,
+                                        uint16_t intervalMin,
+                                        uint16_t intervalMax);
+
+/// End the download sessions in which no frame was sent since the last
+/// check
+static void CheckDownloadProgress();
+
+/// Timer callback to trigger the check of the download progress
+static void DownloadProgressTimerCb();
 
 /// Stop the BLE subsystem
 ///
@@ -239,6 +439,11 @@ void BleContext_StartBluetoothApp() {
   gBleApplicationContext.localName =
       (uint8_t*)ProductionParameters_GetDeviceName();
   BleInterface_Start(&gBleApplicationContext);
+  for (uint8_t i = 0; i < BLE_TYPES_MAX_CLIENTS; i++) {
+    _clients[i].connectionHandle = NO_CONNECTION;
+  }
+  _progressTimer = TimerServer_CreateTimer(TIMER_SERVER_MODE_REPEATED,
+                                           DownloadProgressTimerCb);
   gBleApplicationContext.deviceConnectionStatus = BLE_INTERFACE_IDLE;
   gBleApplicationContext.bleApplicationContextLegacy.connectionHandle = 0xFFFF;
   _bleAppListener.currentMessageHandlerCb = BleDefaultStateCb;
@@ -286,14 +491,24 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification(
       disconnectedCompleteEvent =
           (hci_disconnection_complete_event_rp0*)eventPckt->data;
 
-      if (disconnectedCompleteEvent->Connection_Handle ==
-          gBleApplicationContext.bleApplicationContextLegacy.connectionHandle) {
+      uint8_t client = DataLoggerService_FindClient(
+          disconnectedCompleteEvent->Connection_Handle);
+      if (client != BLE_TYPES_NO_CLIENT) {
         gBleApplicationContext.deviceConnectionStatus = BLE_INTERFACE_IDLE;
-        gBleApplicationContext.bleApplicationContextLegacy.connectionHandle = 0;
-        Message_Message_t msg = {
-            .header.category = MESSAGE_BROKER_CATEGORY_BLE_EVENT,
-            .header.id = BLE_INTERFACE_MSG_ID_DISCONNECT};
-        Message_PublishAppMessage(&msg);
+        if (disconnectedCompleteEvent->Connection_Handle ==
+            gBleApplicationContext.bleApplicationContextLegacy
+                .connectionHandle) {
+          gBleApplicationContext.bleApplicationContextLegacy.connectionHandle =
+              0;
+        }
+        CloseClient(client);
+        // the application is told once the last client is gone
+        if (NumberOfClients() == 0) {
+          Message_Message_t msg = {
+              .header.category = MESSAGE_BROKER_CATEGORY_BLE_EVENT,
+              .header.id = BLE_INTERFACE_MSG_ID_DISCONNECT};
+          Message_PublishAppMessage(&msg);
+        }
       }
       // stop advertisement
       BleGap_AdvertiseCancel(&gBleApplicationContext);
@@ -344,17 +559,47 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification(
           gBleApplicationContext.bleApplicationContextLegacy.connectionHandle =
               connectionCompleteEvent->Connection_Handle;
 
-          aci_l2cap_connection_parameter_update_req(
-              connectionCompleteEvent->Connection_Handle,
-              0x6,  // 6 * 1.2 ms
-              0x6,  // 6 * 1.2 ms,
-              connectionCompleteEvent
-                  ->Conn_Latency,  // don't change the latency
-              L2CAP_TIMEOUT_MULTIPLIER);
+          // bigger link layer packets allow bigger data logger frames
+          ret = hci_le_set_data_length(
+              connectionCompleteEvent->Connection_Handle, MAX_TX_OCTETS,
+              MAX_TX_TIME);
+          LOG_DEBUG_CALLSTATUS("hci_le_set_data_length()", ret);
+
+          // don't change the latency
+          OpenClient(connectionCompleteEvent->Connection_Handle,
+                     connectionCompleteEvent->Conn_Latency);
+
+          // further clients may connect as long as a slot is free
+          if (gBleApplicationContext.deviceConnectionStatus ==
+                  BLE_INTERFACE_CONNECTED_SERVER &&
+              NumberOfClients() < BLE_TYPES_MAX_CLIENTS) {
+            gBleApplicationContext.deviceConnectionStatus = BLE_INTERFACE_IDLE;
+            BleGap_AdvertiseRequest(
+                &gBleApplicationContext,
+                gBleApplicationContext.currentAdvertisementMode);
+          }
 
           break;  // HCI_LE_CONNECTION_COMPLETE_SUBEVT_CODE
         }
 
+        case HCI_LE_PHY_UPDATE_COMPLETE_SUBEVT_CODE: {
+          hci_le_phy_update_complete_event_rp0* phyUpdateCompleteEvent =
+              (hci_le_phy_update_complete_event_rp0*)metaEvent->data;
+          UNUSED(phyUpdateCompleteEvent);
+          LOG_DEBUG_CALLSTATUS("phy update complete tx phy: ",
+                               phyUpdateCompleteEvent->TX_PHY);
+          break;
+        }
+
+        case HCI_LE_DATA_LENGTH_CHANGE_SUBEVT_CODE: {
+          hci_le_data_length_change_event_rp0* dataLengthChangeEvent =
+              (hci_le_data_length_change_event_rp0*)metaEvent->data;
+          DataLoggerService_SetMaxTxOctets(
+              dataLengthChangeEvent->Connection_Handle,
+              dataLengthChangeEvent->MaxTxOctets);
+          break;
+        }
+
         default:
           break;
       }
@@ -373,6 +618,14 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification(
           LOG_DEBUG_CASE(ACI_GAP_PROC_COMPLETE_VSEVT_CODE);
           break;  // ACI_GAP_PROC_COMPLETE_VSEVT_CODE
 
+        case ACI_ATT_EXCHANGE_MTU_RESP_VSEVT_CODE: {
+          aci_att_exchange_mtu_resp_event_rp0* exchangeMtuEvent =
+              (aci_att_exchange_mtu_resp_event_rp0*)bleCoreEvent->data;
+          DataLoggerService_SetAttMtu(exchangeMtuEvent->Connection_Handle,
+                                      exchangeMtuEvent->Server_RX_MTU);
+          break;
+        }
+
         case ACI_HAL_END_OF_RADIO_ACTIVITY_VSEVT_CODE:
           LOG_DEBUG_CASE(ACI_L2CAP_CONNECTION_UPDATE_RESP_VSEVT_CODE);
           break;  // ACI_HAL_END_OF_RADIO_ACTIVITY_VSEVT_CODE
@@ -386,8 +639,8 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification(
           LOG_DEBUG_CASE(ACI_GAP_PASS_KEY_REQ_VSEVT_CODE);
 
           ret = aci_gap_pass_key_resp(
-              gBleApplicationContext.bleApplicationContextLegacy
-                  .connectionHandle,
+              ((aci_gap_pass_key_req_event_rp0*)bleCoreEvent->data)
+                  ->Connection_Handle,
               CFG_FIXED_PIN);
           LOG_DEBUG_CALLSTATUS("aci_gap_pass_key_resp()", ret);
 
@@ -396,6 +649,9 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification(
         case ACI_GAP_NUMERIC_COMPARISON_VALUE_VSEVT_CODE:
           LOG_DEBUG_CASE(ACI_GAP_NUMERIC_COMPARISON_VALUE_VSEVT_CODE);
 
+          _pairingConnectionHandle =
+              ((aci_gap_numeric_comparison_value_event_rp0*)bleCoreEvent->data)
+                  ->Connection_Handle;
           uint32_t pairingCode = 0;
           // read the received pairing code
           memccpy(&pairingCode, &bleCoreEvent->data[2], 4, sizeof(pairingCode));
@@ -417,31 +673,53 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification(
           LOG_DEBUG_CALLSTATUS("pairing()", pairingComplete->Status);
           break;
           // PAIRING
-        case ACI_GATT_TX_POOL_AVAILABLE_VSEVT_CODE: {
-          BleInterface_Message_t msg = {
-              .head.category = MESSAGE_BROKER_CATEGORY_BLE_EVENT,
-              .head.id = BLE_INTERFACE_MSG_ID_SVC_REQ_RESPONSE,
-              .head.parameter1 = SERVICE_REQUEST_MESSAGE_ID_TX_POOL_AVAILABLE};
-          BleInterface_PublishBleMessage((Message_Message_t*)&msg);
+        case ACI_GATT_TX_POOL_AVAILABLE_VSEVT_CODE:
+        case ACI_L2CAP_COC_TX_POOL_AVAILABLE_VSEVT_CODE:
+          PublishTxPoolAvailable();
+          break;
+        case ACI_L2CAP_COC_CONNECT_VSEVT_CODE:
+          BleBulkChannel_HandleConnectRequest(
+              (aci_l2cap_coc_connect_event_rp0*)bleCoreEvent->data);
+          break;
+        case ACI_L2CAP_COC_DISCONNECT_VSEVT_CODE: {
+          aci_l2cap_coc_disconnect_event_rp0* disconnect =
+              (aci_l2cap_coc_disconnect_event_rp0*)bleCoreEvent->data;
+          uint8_t client = BulkChannelClient();
+          if (BleBulkChannel_HandleDisconnect(disconnect->Channel_Index)) {
+            AbortDownload(client, SAMPLE_TRANSPORT_BULK);
+          }
+          break;
+        }
+        case ACI_L2CAP_COC_FLOW_CONTROL_VSEVT_CODE:
+          if (BleBulkChannel_HandleCredits(
+                  (aci_l2cap_coc_flow_control_event_rp0*)bleCoreEvent->data)) {
+            PublishTxPoolAvailable();
+          }
+          break;
+        case ACI_L2CAP_COC_RX_DATA_VSEVT_CODE: {
+          BleBulkChannel_Command_t command = BleBulkChannel_HandleRxData(
+              (aci_l2cap_coc_rx_data_event_rp0*)bleCoreEvent->data);
+          if (command == BLE_BULK_CHANNEL_COMMAND_START_DOWNLOAD) {
+            RequestDownload(BulkChannelClient(), SAMPLE_TRANSPORT_BULK);
+          } else if (command == BLE_BULK_CHANNEL_COMMAND_STOP_DOWNLOAD) {
+            AbortDownload(BulkChannelClient(), SAMPLE_TRANSPORT_BULK);
+          }
           break;
         }
         case ACI_GATT_ATTRIBUTE_MODIFIED_VSEVT_CODE: {
           aci_gatt_attribute_modified_event_rp0* attribute_modified =
               (aci_gatt_attribute_modified_event_rp0*)bleCoreEvent->data;
 
-          if (DataLoggerService_IsSampleDataCharacteristic(
+          uint8_t client = DataLoggerService_FindClient(
+              attribute_modified->Connection_Handle);
+          if (client != BLE_TYPES_NO_CLIENT &&
+              DataLoggerService_IsSampleDataCharacteristic(
                   attribute_modified->Attr_Handle)) {
             // Trigger the download of samples if a client has subscribed
             if (attribute_modified->Attr_Data[0] & 1) {
-              Message_Message_t msg = {
-                  .header.category =
-                      MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
-                  .header.id = SERVICE_REQUEST_MESSAGE_ID_SET_REQUESTED_SAMPLES,
-                  .parameter2 =
-                      DataLoggerService_GetNumberOfRequestedSamples()};
-              Message_PublishAppMessage(&msg);
+              RequestDownload(client, SAMPLE_TRANSPORT_GATT);
             } else {
-              StopSendSamples();
+              AbortDownload(client, SAMPLE_TRANSPORT_GATT);
             }
           }
           break;
@@ -506,15 +784,13 @@ static bool BleDefaultStateCb(Message_Message_t* message) {
     }
 
     if (message->header.id == BLE_INTERFACE_MSG_ID_USER_ACCEPTED_PAIRING) {
-      aci_gap_numeric_comparison_value_confirm_yesno(
-          gBleApplicationContext.bleApplicationContextLegacy.connectionHandle,
-          YES);
+      aci_gap_numeric_comparison_value_confirm_yesno(_pairingConnectionHandle,
+                                                     YES);
       return true;
     }
     if (message->header.id == BLE_INTERFACE_MSG_ID_PAIRING_TIMEOUT) {
-      aci_gap_numeric_comparison_value_confirm_yesno(
-          gBleApplicationContext.bleApplicationContextLegacy.connectionHandle,
-          NO);
+      aci_gap_numeric_comparison_value_confirm_yesno(_pairingConnectionHandle,
+                                                     NO);
       return true;
     }
 
@@ -522,6 +798,10 @@ static bool BleDefaultStateCb(Message_Message_t* message) {
       SwitchBleOff();
       return true;
     }
+    if (message->header.id == BLE_INTERFACE_MSG_ID_CHECK_DOWNLOAD_PROGRESS) {
+      CheckDownloadProgress();
+      return true;
+    }
   }
 
   // react on ble events (start stop advertizing)
@@ -697,27 +977,68 @@ static bool HandleServiceRequestResponse(Message_Message_t* message) {
   }
   if (bleMsg->head.parameter1 ==
       SERVICE_REQUEST_MESSAGE_ID_SET_REQUESTED_SAMPLES) {
-    BleTypes_SamplesMetaData_t* metadata =
-        (BleTypes_SamplesMetaData_t*)bleMsg->parameter.responsePtr;
-    _sampleNotification.currentFrameIndex = 0;
-    _sampleNotification.samplesTransmitted = 0;
-
-    _sampleNotification.nrOfSamplesToTransmit = metadata->numberOfSamples;
-    DataLoggerService_BuildHeaderFrame(_sampleNotification.txFrameBuffer,
-                                       metadata);
-    TrySendFirstFrame();
+    BleTypes_SampleDownload_t* download =
+        (BleTypes_SampleDownload_t*)bleMsg->parameter.responsePtr;
+    BleTypes_SamplesMetaData_t* metadata = &download->metadata;
+    uint8_t client = download->client;
+    if (_clients[client].connectionHandle == NO_CONNECTION) {
+      // the client disconnected before the download started
+      PublishEndSampleDownload(client);
+      return true;
+    }
+    SampleDataNotificationState_t* notification =
+        &_clients[client].notification;
+    DataLoggerService_UpdateSampleSequenceCharacteristic(
+        client, download->firstSequenceNumber);
+    notification->currentFrameIndex = 0;
+    notification->requestedFrameIndex = 1;
+    notification->samplesTransmitted = 0;
+    notification->isHeaderPending = true;
+    notification->drainedBuffer = 0;
+    notification->drainedFrame = 0;
+
+    notification->nrOfSamplesToTransmit = metadata->numberOfSamples;
+    notification->transport = notification->requestedTransport;
+    // the frames of the bulk channel are not limited by the ATT MTU
+    notification->frameSize = notification->transport == SAMPLE_TRANSPORT_BULK
+                                  ? TX_FRAME_SIZE
+                                  : DataLoggerService_GetFrameSize(client);
+    if (notification->transport == SAMPLE_TRANSPORT_BULK &&
+        BulkChannelClient() != client) {
+      // the client closed the channel before the download started
+      notification->isHeaderPending = false;
+      notification->nrOfSamplesToTransmit = 0;
+      PublishEndSampleDownload(client);
+      EndDownloadSession(client);
+      return true;
+    }
+    notification->encoding = DataLoggerService_GetRequestedEncoding(client);
+    DataLoggerService_BuildHeaderFrame(notification->txFrameBuffer, download,
+                                       notification->frameSize,
+                                       notification->encoding);
+    notification->isSending = true;
+    ServeClients();
     return true;
   }
   if (bleMsg->head.parameter1 == SERVICE_REQUEST_MESSAGE_ID_GET_NEXT_SAMPLES) {
-    _sampleNotification.sampleData =
-        *((BleGatt_RequestResponseData_t*)bleMsg->parameter.responsePtr);
-    _sampleNotification.currentDataIndex = 0;
-    TrySendSampleFrames();
+    DataLoggerService_FrameBuffer_t* buffer =
+        (DataLoggerService_FrameBuffer_t*)bleMsg->parameter.responsePtr;
+    Client_t* owner = &_clients[buffer->client];
+    // the client disconnected while the buffer was filled or the buffer was
+    // requested again for a newer download
+    if (owner->connectionHandle == NO_CONNECTION ||
+        buffer->filledGeneration != buffer->generation) {
+      return true;
+    }
+    owner->notification
+        .isBufferFilled[buffer - owner->notification.frameBuffers] = true;
+    DownloadTelemetry_AddBrokerDelay(buffer->publishedStamp);
+    ServeClients();
 
     return true;
   }
   if (bleMsg->head.parameter1 == SERVICE_REQUEST_MESSAGE_ID_TX_POOL_AVAILABLE) {
-    TrySendSampleFrames();
+    ServeClients();
     return true;
   }
   if (bleMsg->head.parameter1 ==
@@ -740,62 +1061,359 @@ static bool HandleServiceRequestResponse(Message_Message_t* message) {
   return false;
 }
 
-static void TrySendFirstFrame() {
-  if (!DataLoggerService_UpdateSampleDataCharacteristic(
-          _sampleNotification.txFrameBuffer)) {
-    return;
+static void OpenClient(uint16_t connectionHandle, uint16_t connectionLatency) {
+  uint8_t client = DataLoggerService_OpenClient(connectionHandle);
+  ASSERT(client != BLE_TYPES_NO_CLIENT);
+  _clients[client] =
+      (Client_t){.connectionHandle = connectionHandle,
+                 .session.connectionLatency = connectionLatency};
+  RequestConnectionParameters(client, IDLE_CONNECTION_INTERVAL_MIN,
+                              IDLE_CONNECTION_INTERVAL_MAX);
+}
+
+static void CloseClient(uint8_t client) {
+  Client_t* owner = &_clients[client];
+  owner->notification.isSending = false;
+  owner->notification.nrOfSamplesToTransmit = 0;
+  // the link parameters of a closed connection can't be changed anymore
+  owner->session.isActive = false;
+  if (NumberOfDownloadSessions() == 0) {
+    TimerServer_Stop(_progressTimer);
+  }
+  if (BulkChannelClient() == client) {
+    BleBulkChannel_Reset();
+  }
+  EndDownloadTelemetry(client);
+  // release the enumerator of the application
+  PublishEndSampleDownload(client);
+  owner->connectionHandle = NO_CONNECTION;
+  DataLoggerService_CloseClient(client);
+}
+
+static uint8_t NumberOfClients() {
+  uint8_t nrOfClients = 0;
+  for (uint8_t i = 0; i < BLE_TYPES_MAX_CLIENTS; i++) {
+    if (_clients[i].connectionHandle != NO_CONNECTION) {
+      nrOfClients++;
+    }
+  }
+  return nrOfClients;
+}
+
+static uint8_t BulkChannelClient() {
+  if (!BleBulkChannel_IsOpen()) {
+    return BLE_TYPES_NO_CLIENT;
+  }
+  return DataLoggerService_FindClient(BleBulkChannel_GetConnectionHandle());
+}
+
+static void ServeClients() {
+  bool isProgressing = true;
+  while (isProgressing) {
+    isProgressing = false;
+    for (uint8_t i = 0; i < BLE_TYPES_MAX_CLIENTS; i++) {
+      uint8_t client = (_firstServedClient + i) % BLE_TYPES_MAX_CLIENTS;
+      isProgressing |= ServeClient(client);
+    }
+  }
+  // the next client is the first one when frames may be sent again
+  _firstServedClient = (_firstServedClient + 1) % BLE_TYPES_MAX_CLIENTS;
+}
+
+static bool ServeClient(uint8_t client) {
+  SampleDataNotificationState_t* notification = &_clients[client].notification;
+  if (!notification->isSending) {
+    return false;
+  }
+  if (notification->isHeaderPending) {
+    return TrySendFirstFrame(client);
+  }
+  return TrySendSampleFrames(client);
+}
+
+static bool TrySendFirstFrame(uint8_t client) {
+  SampleDataNotificationState_t* notification = &_clients[client].notification;
+  if (!SendHeaderFrame(client)) {
+    return false;
   }
-  _sampleNotification.currentFrameIndex++;
+  if (!_clients[client].isMeasured) {
+    DownloadTelemetry_Begin(TX_LEGACY_FRAME_SIZE);
+    _clients[client].isMeasured = true;
+  }
+  notification->isHeaderPending = false;
+  notification->currentFrameIndex++;
+  // both buffers are filled while the first one is drained
+  for (uint8_t i = 0;
+       i < NR_OF_FRAME_BUFFERS && notification->nrOfSamplesToTransmit > 0;
+       i++) {
+    RequestFrameBuffer(client, i);
+  }
+  return true;
+}
+
+static void RequestFrameBuffer(uint8_t client, uint8_t bufferIndex) {
+  SampleDataNotificationState_t* notification = &_clients[client].notification;
+  DataLoggerService_FrameBuffer_t* buffer =
+      &notification->frameBuffers[bufferIndex];
+  notification->isBufferFilled[bufferIndex] = false;
+  buffer->client = client;
+  // the buffers of a new client start with the generation 0
+  _frameBufferGeneration = _frameBufferGeneration % UINT8_MAX + 1;
+  buffer->generation = _frameBufferGeneration;
+  buffer->frameSize = notification->frameSize;
+  buffer->encoding = notification->encoding;
+  buffer->firstFrameIndex = notification->requestedFrameIndex;
+  notification->requestedFrameIndex += TX_FRAMES_PER_BUFFER;
+  buffer->publishedStamp = DownloadTelemetry_Stamp();
   Message_Message_t msg = {
       .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
       .header.id = SERVICE_REQUEST_MESSAGE_ID_GET_NEXT_SAMPLES,
-      .parameter2 = 0};
+      .header.parameter1 = buffer->generation,
+      .parameter2 = (uint32_t)buffer};
   Message_PublishAppMessage(&msg);
 }
 
-static void StopSendSamples() {
+static void StopSendSamples(uint8_t client) {
+  SampleDataNotificationState_t* notification = &_clients[client].notification;
   // don't clear a pending request if the download is not yet started
-  if (_sampleNotification.samplesTransmitted > 0 &&
-      _sampleNotification.nrOfSamplesToTransmit > 0) {
-    _sampleNotification.sampleData.dataLength = 0;
-    _sampleNotification.nrOfSamplesToTransmit = 0;
-  }
-}
-
-static void TrySendSampleFrames() {
-  uint16_t index = _sampleNotification.currentDataIndex;
-  while ((index < _sampleNotification.sampleData.dataLength) &&
-         (_sampleNotification.nrOfSamplesToTransmit >
-          _sampleNotification.samplesTransmitted)) {
-    uint8_t length = MIN(16, 4 * (_sampleNotification.nrOfSamplesToTransmit -
-                                  _sampleNotification.samplesTransmitted));
-
-    DataLoggerService_BuildDataFrame(
-        _sampleNotification.txFrameBuffer,
-        _sampleNotification.currentFrameIndex,
-        &_sampleNotification.sampleData.data[index], length);
-    bool success = DataLoggerService_UpdateSampleDataCharacteristic(
-        _sampleNotification.txFrameBuffer);
-    if (!success) {
-      return;
-    }
-    index += length;
-    _sampleNotification.currentDataIndex = index;
-    _sampleNotification.currentFrameIndex++;
-    _sampleNotification.samplesTransmitted += (length / 4);
-  }
-  // we are not yet done
-  if (_sampleNotification.nrOfSamplesToTransmit >
-      _sampleNotification.samplesTransmitted) {
-    Message_Message_t msg = {
-        .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
-        .header.id = SERVICE_REQUEST_MESSAGE_ID_GET_NEXT_SAMPLES,
-        .parameter2 = 0};
-    Message_PublishAppMessage(&msg);
-    return;
+  if (notification->samplesTransmitted > 0 &&
+      notification->nrOfSamplesToTransmit > 0) {
+    notification->isSending = false;
+    notification->nrOfSamplesToTransmit = 0;
+    notification->isBufferFilled[0] = false;
+    notification->isBufferFilled[1] = false;
+    // release the enumerator of the application
+    PublishEndSampleDownload(client);
+  }
+}
+
+static bool TrySendSampleFrames(uint8_t client) {
+  SampleDataNotificationState_t* notification = &_clients[client].notification;
+  while (notification->nrOfSamplesToTransmit >
+         notification->samplesTransmitted) {
+    uint8_t bufferIndex = notification->drainedBuffer;
+    DataLoggerService_FrameBuffer_t* buffer =
+        &notification->frameBuffers[bufferIndex];
+    // wait until the application has filled the buffer
+    if (!notification->isBufferFilled[bufferIndex]) {
+      DownloadTelemetry_WaitForBuffer();
+      return false;
+    }
+    // no more samples are available; the unread items were erased
+    if (buffer->nrOfFrames == 0) {
+      notification->nrOfSamplesToTransmit = notification->samplesTransmitted;
+      break;
+    }
+    if (notification->drainedFrame == buffer->nrOfFrames) {
+      // the SDU refers to the frames until it is passed to the stack
+      if (notification->transport == SAMPLE_TRANSPORT_BULK &&
+          !BleBulkChannel_Flush()) {
+        DownloadTelemetry_TxPoolFull();
+        return false;
+      }
+      RequestFrameBuffer(client, bufferIndex);
+      notification->drainedBuffer = (bufferIndex + 1) % NR_OF_FRAME_BUFFERS;
+      notification->drainedFrame = 0;
+      // the other clients get their turn before the next buffer is sent
+      return true;
+    }
+    if (!SendFrames(client, buffer)) {
+      DownloadTelemetry_TxPoolFull();
+      return false;
+    }
+  }
+  // the last SDU is passed to the stack before the download ends
+  if (notification->transport == SAMPLE_TRANSPORT_BULK &&
+      !BleBulkChannel_Flush()) {
+    return false;
   }
   // reset the data to make sure that nothing is sent anymore
-  StopSendSamples();
+  StopSendSamples(client);
+  notification->isSending = false;
+  EndDownloadSession(client);
+  EndDownloadTelemetry(client);
+  return false;
+}
+
+static void RequestDownload(uint8_t client, SampleTransport_t transport) {
+  if (client == BLE_TYPES_NO_CLIENT) {
+    return;
+  }
+  _clients[client].notification.requestedTransport = transport;
+  DownloadTelemetry_Subscribed();
+  BeginDownloadSession(client);
+  Message_Message_t msg = {
+      .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
+      .header.id = SERVICE_REQUEST_MESSAGE_ID_SET_REQUESTED_SAMPLES,
+      .header.parameter1 = client,
+      .parameter2 = DataLoggerService_GetNumberOfRequestedSamples(client)};
+  Message_PublishAppMessage(&msg);
+}
+
+static void AbortDownload(uint8_t client, SampleTransport_t transport) {
+  if (client == BLE_TYPES_NO_CLIENT ||
+      _clients[client].notification.transport != transport) {
+    return;
+  }
+  StopSendSamples(client);
+  EndDownloadSession(client);
+  EndDownloadTelemetry(client);
+}
+
+static void PublishEndSampleDownload(uint8_t client) {
+  Message_Message_t msg = {
+      .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
+      .header.id = SERVICE_REQUEST_MESSAGE_ID_END_SAMPLE_DOWNLOAD,
+      .header.parameter1 = client};
+  Message_PublishAppMessage(&msg);
+}
+
+static bool SendHeaderFrame(uint8_t client) {
+  SampleDataNotificationState_t* notification = &_clients[client].notification;
+  if (notification->transport == SAMPLE_TRANSPORT_GATT) {
+    return DataLoggerService_UpdateSampleDataCharacteristic(
+        client, notification->txFrameBuffer, TX_LEGACY_FRAME_SIZE);
+  }
+  // an SDU starts with the number of frames and the length of each frame
+  static const uint8_t headerSduPrefix[] = {1, TX_LEGACY_FRAME_SIZE};
+  BleBulkChannel_Segment_t segments[] = {
+      {headerSduPrefix, sizeof headerSduPrefix},
+      {notification->txFrameBuffer, TX_LEGACY_FRAME_SIZE}};
+  return BleBulkChannel_Flush() &&
+         BleBulkChannel_Send(segments, COUNT_OF(segments));
+}
+
+static bool SendFrames(uint8_t client,
+                       DataLoggerService_FrameBuffer_t* buffer) {
+  SampleDataNotificationState_t* notification = &_clients[client].notification;
+  uint8_t firstFrame = notification->drainedFrame;
+  uint8_t endFrame = firstFrame + 1;
+  if (notification->transport == SAMPLE_TRANSPORT_GATT) {
+    if (!DataLoggerService_UpdateSampleDataCharacteristic(
+            client, buffer->frames[firstFrame],
+            buffer->frameLength[firstFrame])) {
+      return false;
+    }
+  } else {
+    // a frame buffer is sent completely
+    BleBulkChannel_Segment_t segments[2 + TX_FRAMES_PER_BUFFER] = {
+        {&buffer->nrOfFrames, 1}, {buffer->frameLength, buffer->nrOfFrames}};
+    for (uint8_t i = 0; i < buffer->nrOfFrames; i++) {
+      segments[2 + i] = (BleBulkChannel_Segment_t){buffer->frames[i],
+                                                   buffer->frameLength[i]};
+    }
+    if (!BleBulkChannel_Send(segments, 2 + buffer->nrOfFrames)) {
+      return false;
+    }
+    endFrame = buffer->nrOfFrames;
+  }
+  for (uint8_t frame = firstFrame; frame < endFrame; frame++) {
+    DownloadTelemetry_FrameSent(buffer->frameLength[frame]);
+    notification->currentFrameIndex++;
+    notification->samplesTransmitted += buffer->frameSamples[frame];
+  }
+  notification->drainedFrame = endFrame;
+  return true;
+}
+
+static void PublishTxPoolAvailable() {
+  BleInterface_Message_t msg = {
+      .head.category = MESSAGE_BROKER_CATEGORY_BLE_EVENT,
+      .head.id = BLE_INTERFACE_MSG_ID_SVC_REQ_RESPONSE,
+      .head.parameter1 = SERVICE_REQUEST_MESSAGE_ID_TX_POOL_AVAILABLE};
+  BleInterface_PublishBleMessage((Message_Message_t*)&msg);
+}
+
+static void EndDownloadTelemetry(uint8_t client) {
+  if (!_clients[client].isMeasured) {
+    return;
+  }
+  _clients[client].isMeasured = false;
+  if (DownloadTelemetry_End()) {
+    DataLoggerService_UpdateDownloadStatisticsCharacteristic(
+        client, DownloadTelemetry_GetStats());
+  }
+}
+
+static void BeginDownloadSession(uint8_t client) {
+  DownloadSession_t* session = &_clients[client].session;
+  if (session->isActive) {
+    return;
+  }
+  // one timer checks the progress of all sessions
+  if (NumberOfDownloadSessions() == 0) {
+    TimerServer_Start(_progressTimer, DOWNLOAD_STALL_TIMEOUT_MS);
+  }
+  session->isActive = true;
+  session->checkedFrameIndex = _clients[client].notification.currentFrameIndex;
+  tBleStatus ret =
+      hci_le_set_phy(_clients[client].connectionHandle, 0,
+                     HCI_TX_PHYS_LE_2M_PREF, HCI_RX_PHYS_LE_2M_PREF, 0);
+  LOG_DEBUG_CALLSTATUS("hci_le_set_phy()", ret);
+  UNUSED(ret);
+  RequestConnectionParameters(client, DOWNLOAD_CONNECTION_INTERVAL,
+                              DOWNLOAD_CONNECTION_INTERVAL);
+}
+
+static void EndDownloadSession(uint8_t client) {
+  DownloadSession_t* session = &_clients[client].session;
+  if (!session->isActive) {
+    return;
+  }
+  session->isActive = false;
+  if (NumberOfDownloadSessions() == 0) {
+    TimerServer_Stop(_progressTimer);
+  }
+  // the 1M PHY needs less power on the receiver side
+  tBleStatus ret =
+      hci_le_set_phy(_clients[client].connectionHandle, 0,
+                     HCI_TX_PHYS_LE_1M_PREF, HCI_RX_PHYS_LE_1M_PREF, 0);
+  LOG_DEBUG_CALLSTATUS("hci_le_set_phy()", ret);
+  UNUSED(ret);
+  RequestConnectionParameters(client, IDLE_CONNECTION_INTERVAL_MIN,
+                              IDLE_CONNECTION_INTERVAL_MAX);
+}
+
+static uint8_t NumberOfDownloadSessions() {
+  uint8_t nrOfSessions = 0;
+  for (uint8_t i = 0; i < BLE_TYPES_MAX_CLIENTS; i++) {
+    if (_clients[i].session.isActive) {
+      nrOfSessions++;
+    }
+  }
+  return nrOfSessions;
+}
+
+static void RequestConnectionParameters(uint8_t client,
+                                        uint16_t intervalMin,
+                                        uint16_t intervalMax) {
+  tBleStatus ret = aci_l2cap_connection_parameter_update_req(
+      _clients[client].connectionHandle, intervalMin, intervalMax,
+      _clients[client].session.connectionLatency, L2CAP_TIMEOUT_MULTIPLIER);
+  LOG_DEBUG_CALLSTATUS("aci_l2cap_connection_parameter_update_req()", ret);
+  UNUSED(ret);
+}
+
+static void CheckDownloadProgress() {
+  for (uint8_t i = 0; i < BLE_TYPES_MAX_CLIENTS; i++) {
+    Client_t* owner = &_clients[i];
+    if (!owner->session.isActive) {
+      continue;
+    }
+    if (owner->session.checkedFrameIndex ==
+        owner->notification.currentFrameIndex) {
+      EndDownloadSession(i);
+      continue;
+    }
+    owner->session.checkedFrameIndex = owner->notification.currentFrameIndex;
+  }
+}
+
+static void DownloadProgressTimerCb() {
+  BleInterface_Message_t msg = {
+      .head.category = MESSAGE_BROKER_CATEGORY_BLE_EVENT,
+      .head.id = BLE_INTERFACE_MSG_ID_CHECK_DOWNLOAD_PROGRESS};
+  BleInterface_PublishBleMessage((Message_Message_t*)&msg);
 }
 
 static void UpdateAdvertiseSamplesEnable(bool isAdvertiseSamplesEnabled) {
@@ -823,6 +1441,10 @@ static void UpdateDeviceSettingCharacteristics(Message_Message_t* message) {
 }
 
 static void SwitchBleOff() {
+  // the radio stays on while a client is connected
+  if (NumberOfClients() > 0) {
+    return;
+  }
   BleGap_AdvertiseCancel(&gBleApplicationContext);
   // in case the cancel request was successful we change the
   // application state
@@ -40,6 +40,7 @@
 #include "test/CyclicBufferTest.h"
 #include "test/FlashTest.h"
 #include "test/ItemStoreTest.h"
+#include "test/MessageBrokerTest.h"
 #include "test/ListTest.h"
 #include "test/PresentationTest.h"
 #include "test/QspiTest.h"
@@ -101,14 +102,26 @@ static SysTest_TestFunctionCb_t _flashTestFunctions[] = {
 /// Test functions to test the LCD screen
 static SysTest_TestFunctionCb_t _itemStoreTestFunctions[] = {
     ItemStoreTest_AddItem, ItemStoreTest_TimerAddItem,
-    ItemStoreTest_EnumerateItems, ItemStoreTest_DeleteAllItems};
+    ItemStoreTest_EnumerateItems, ItemStoreTest_DeleteAllItems,
+    ItemStoreTest_AddItemBatch, ItemStoreTest_BenchmarkEnumerate};
+
+/// Test functions to inspect the message brokers
+static SysTest_TestFunctionCb_t _messageBrokerTestFunctions[] = {
+    MessageBrokerTest_LogStats, MessageBrokerTest_ResetStats};
+
+/// Test functions to test the collections
+static SysTest_TestFunctionCb_t _collectionTestFunctions[] = {
+    CyclicBufferTest_InsertRemoveElements, CyclicBufferTest_FillAndDrain,
+    ListTest_InsertRemoveElements};
 
 /// Array with test function pointers
 static SysTest_TestFunctionCb_t* _allTests[] = {
     [SYS_TEST_TEST_GROUP_FLASH] = _flashTestFunctions,
     [SYS_TEST_TEST_GROUP_ITEM_STORE] = _itemStoreTestFunctions,
     [SYS_TEST_TEST_GROUP_SCREEN] = _screenTestFunctions,
-    [SYS_TEST_TEST_GROUP_PRESENTATION] = _presentationTestFunctions};
+    [SYS_TEST_TEST_GROUP_PRESENTATION] = _presentationTestFunctions,
+    [SYS_TEST_TEST_GROUP_MESSAGE_BROKER] = _messageBrokerTestFunctions,
+    [SYS_TEST_TEST_GROUP_COLLECTION] = _collectionTestFunctions};
 
 /// Have a list with the sizes of all test tables in order to check
 /// the access to the test functions
@@ -117,6 +130,9 @@ static uint8_t _allTestsSizes[] = {
     [SYS_TEST_TEST_GROUP_ITEM_STORE] = COUNT_OF(_itemStoreTestFunctions),
     [SYS_TEST_TEST_GROUP_SCREEN] = COUNT_OF(_screenTestFunctions),
     [SYS_TEST_TEST_GROUP_PRESENTATION] = COUNT_OF(_presentationTestFunctions),
+    [SYS_TEST_TEST_GROUP_MESSAGE_BROKER] =
+        COUNT_OF(_messageBrokerTestFunctions),
+    [SYS_TEST_TEST_GROUP_COLLECTION] = COUNT_OF(_collectionTestFunctions),
 };
 
 MessageListener_Listener_t* SysTest_TestControllerInstance() {
@@ -49,7 +49,9 @@ typedef enum {
   SYS_TEST_TEST_GROUP_FLASH = 0,
   SYS_TEST_TEST_GROUP_ITEM_STORE,
   SYS_TEST_TEST_GROUP_SCREEN,
-  SYS_TEST_TEST_GROUP_PRESENTATION
+  SYS_TEST_TEST_GROUP_PRESENTATION,
+  SYS_TEST_TEST_GROUP_MESSAGE_BROKER,
+  SYS_TEST_TEST_GROUP_COLLECTION
 } SysTest_TestGroups;
 
 /// Generic data structure that is given to test functions as argument
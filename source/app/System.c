@@ -96,6 +96,14 @@ static void RunSystem(void);
 /// @param ... listeners that will register
 static void InitMessageBroker(MessageBus_t* config, int nrOfObservers, ...);
 
+/// Coalesce a time tick with a time tick that is still waiting
+///
+/// The elapsed time of the ticks adds up such that no time gets lost.
+/// @param waitingMessage The waiting time tick
+/// @param message The time tick that was published
+static void CoalesceTimeTick(Message_Message_t* waitingMessage,
+                             const Message_Message_t* message);
+
 /// Task function to run the message broker in the scheduler
 static void RunAppMessageDispatch();
 
@@ -109,6 +117,16 @@ static MessageBus_t _appMessageBroker = {
     .taskId = SCHEDULER_TASK_HANDLE_APP_MESSAGES,
     .priority = SCHEDULER_PRIO_1};
 
+/// Storage for the high priority lane of the application message broker
+static uint64_t _appPriorityMessages[8];
+
+/// Categories that bypass the normal lane of the application message broker
+#define APP_PRIORITY_CATEGORIES MESSAGE_BROKER_CATEGORY_BUTTON_EVENT
+
+/// Number of button events that may be dispatched in a row before a waiting
+/// message of the normal lane gets its turn
+#define APP_PRIORITY_WEIGHT 4
+
 /// instance of ble message broker
 static MessageBus_t _bleMessageBroker = {
     .taskFunction = RunBleMessageDispatch,
@@ -125,8 +143,23 @@ void System_Init(void) {
       BleContext_BridgeInstance(), Presentation_ControllerInstance(),
       ItemStore_ListenerInstance(), MeasurementItemController_Instance(),
       SettingsController_Instance());
+  // button events must not wait behind a burst of other messages
+  MessageBroker_AddPriorityLane(
+      &_appMessageBroker.broker, _appPriorityMessages,
+      COUNT_OF(_appPriorityMessages), APP_PRIORITY_CATEGORIES,
+      APP_PRIORITY_WEIGHT);
+  // only the latest time tick is of interest
+  MessageBroker_CoalesceCategory(&_appMessageBroker.broker,
+                                 MESSAGE_BROKER_CATEGORY_TIME_INFORMATION,
+                                 CoalesceTimeTick);
 
   InitMessageBroker(&_bleMessageBroker, 1, BleContext_Instance());
+  // measure the execution time of the message handlers in core cycles
+  Clock_EnableCycleCounter();
+  MessageBroker_SetProfilingClock(&_appMessageBroker.broker,
+                                  Clock_GetCycleCount);
+  MessageBroker_SetProfilingClock(&_bleMessageBroker.broker,
+                                  Clock_GetCycleCount);
 
   // accesses the flash to read production parameters
   ProductionParameters_Init();
@@ -194,6 +227,16 @@ static void RunSystem(void) {
   }
 }
 
+void System_LogMessageBrokerStats() {
+  MessageBroker_LogStats(&_appMessageBroker.broker, "app");
+  MessageBroker_LogStats(&_bleMessageBroker.broker, "ble");
+}
+
+void System_ResetMessageBrokerStats() {
+  MessageBroker_ResetStats(&_appMessageBroker.broker);
+  MessageBroker_ResetStats(&_bleMessageBroker.broker);
+}
+
 static void InitMessageBroker(MessageBus_t* config, int nrOfObservers, ...) {
   MessageBroker_Create(&config->broker, config->messages,
                        COUNT_OF(config->messages), config->taskId,
@@ -210,6 +253,16 @@ static void InitMessageBroker(MessageBus_t* config, int nrOfObservers, ...) {
                    config->taskFunction);
 }
 
+static void CoalesceTimeTick(Message_Message_t* waitingMessage,
+                             const Message_Message_t* message) {
+  uint16_t deltaSeconds =
+      waitingMessage->header.parameter1 + message->header.parameter1;
+  waitingMessage->header.parameter1 = deltaSeconds > UINT8_MAX
+                                          ? UINT8_MAX
+                                          : (uint8_t)deltaSeconds;
+  waitingMessage->parameter2 = message->parameter2;
+}
+
 // override ble interface
 void BleInterface_PublishBleMessage(Message_Message_t* msg) {
   MessageBroker_PublishMessage(&_bleMessageBroker.broker, msg);
@@ -234,7 +287,7 @@ void ErrorHandler_UnrecoverableError(ErrorHandler_ErrorCode_t code) {
       .header.category = MESSAGE_BROKER_CATEGORY_SYSTEM_STATE_CHANGE,
       .parameter2 = code};
   // make sure that the message queue is empty
-  CyclicBuffer_Empty(&_appMessageBroker.broker.messageQueue);
+  MessageBroker_DiscardMessages(&_appMessageBroker.broker);
   MessageBroker_PublishMessage(&_appMessageBroker.broker, &message);
   // immediately dispatch the message
   MessageBroker_Run(&_appMessageBroker.broker);
@@ -41,4 +41,10 @@
 /// Initialize peripherals used in this application
 void System_Init();
 
+/// Write the statistics of the message brokers to the log
+void System_LogMessageBrokerStats();
+
+/// Reset the statistics of the message brokers
+void System_ResetMessageBrokerStats();
+
 #endif  // SYSTEM_H
@@ -46,7 +46,8 @@ static CyclicBuffer_Buffer_t gTestQueue;
 /// buffer held by test queue
 static uint64_t gBufferStorage[8];
 
-void CyclicBufferTest_InsertRemoveElements() {
+void CyclicBufferTest_InsertRemoveElements(
+    SysTest_TestMessageParameter_t param) {
   CyclicBuffer_Create(&gTestQueue, gBufferStorage, 8);
   for (uint8_t i = 0; i < 32; i++) {
     uint64_t value = i;
@@ -57,3 +58,29 @@ void CyclicBufferTest_InsertRemoveElements() {
     ASSERT(CyclicBuffer_IsEmpty(&gTestQueue));
   }
 }
+
+void CyclicBufferTest_FillAndDrain(SysTest_TestMessageParameter_t param) {
+  for (uint8_t flavour = 0; flavour < 2; flavour++) {
+    if (flavour == 0) {
+      CyclicBuffer_Create(&gTestQueue, gBufferStorage, 8);
+    } else {
+      CyclicBuffer_CreateSingleProducer(&gTestQueue, gBufferStorage, 8);
+    }
+    // the queue holds one element less than its capacity
+    for (uint64_t value = 0; value < 7; value++) {
+      ASSERT(CyclicBuffer_Enqueue(&gTestQueue, &value));
+      ASSERT(CyclicBuffer_Count(&gTestQueue) == value + 1);
+    }
+    ASSERT(CyclicBuffer_IsFull(&gTestQueue));
+    uint64_t value = 7;
+    ASSERT(!CyclicBuffer_Enqueue(&gTestQueue, &value));
+    for (uint64_t expected = 0; expected < 7; expected++) {
+      ASSERT(CyclicBuffer_Dequeue(&gTestQueue, &value));
+      ASSERT(value == expected);
+      ASSERT(CyclicBuffer_Count(&gTestQueue) == 6 - expected);
+    }
+    ASSERT(CyclicBuffer_IsEmpty(&gTestQueue));
+    ASSERT(!CyclicBuffer_Dequeue(&gTestQueue, &value));
+    LOG_INFO("fill and drain of flavour %i done", flavour);
+  }
+}
@@ -37,7 +37,16 @@
 #ifndef CYCLIC_BUFFER_TEST_H
 #define CYCLIC_BUFFER_TEST_H
 
+#include "app/SysTest.h"
+
 /// Test insertion and removal in cyclic buffer
-void CyclicBufferTest_InsertRemoveElements();
+/// @param param unused
+void CyclicBufferTest_InsertRemoveElements(
+    SysTest_TestMessageParameter_t param);
+
+/// Test that both flavours of the cyclic buffer keep the order of the
+/// elements, count them and report a full queue
+/// @param param unused
+void CyclicBufferTest_FillAndDrain(SysTest_TestMessageParameter_t param);
 
 #endif
@@ -37,8 +37,16 @@
 #include "app/Presentation.h"
 #include "app_service/item_store/ItemStore.h"
 #include "app_service/timer_server/TimerServer.h"
+#include "utility/AppDefines.h"
 #include "utility/log/Log.h"
 
+/// Number of pseudo random start positions of the enumerate benchmark
+#define BENCHMARK_NR_OF_RANDOM_STARTS 32
+
+/// Number of items that the enumerate benchmark reads after each random
+/// start position
+#define BENCHMARK_ITEMS_PER_RANDOM_START 16
+
 /// Parameter of the timerAddItem test
 static SysTest_TestMessageParameter_t _timerAddItemParameter;
 
@@ -48,16 +56,42 @@ static uint8_t _timerAddItemId;
 /// parameter for test enumerator function
 static uint16_t _numberOfItemsToRead;
 
+/// Number of items that are still to be inserted by the batch test
+static uint16_t _batchItemsToAdd;
+
 /// Called when the add-item timer is elapsed
 static void OnTimerElapsed();
 
+/// Callback to notify the completion of a batch
+/// @param success true if the batch was written successfully
+static void OnBatchDone(bool success);
+
+/// Start the next batch of the add-item-batch test
+static void AddNextBatch();
+
 /// Default item values for testing
 ItemStore_ItemStruct_t _testItemData[] = {
     [0] = {.configuration.isLogEnabled = true,
            .configuration.isAdvertiseDataEnabled = true,
            .configuration.deviceName = "test demo board name",
            .configuration.loggingInterval = 5000},
-    [1] = {.measurement.sample = {{0xABCD, 0x0123}, {0x4567, 0x89AB}}}};
+    // single sample item (see MeasurementCodec.h)
+    [1] = {.measurement.data = {(0xABCDUL << 6) | (0x0123UL << 22), 0}},
+    [2] = {.summary = {.minimum = {0x6000, 0x4000},
+                       .maximum = {0x6100, 0x4200},
+                       .mean = {0x6080, 0x4100},
+                       .nrOfSamples = 360}},
+    [3] = {.summary = {.minimum = {0x5800, 0x3800},
+                       .maximum = {0x6800, 0x4800},
+                       .mean = {0x6000, 0x4000},
+                       .nrOfSamples = 8640}}};
+
+/// Measurement items that are added with one batch
+static ItemStore_MeasurementSample_t _testBatchItems[32];
+
+/// Batch that is used to add the test batch items
+static ItemStore_ItemBatch_t _testBatch = {.items = _testBatchItems,
+                                           .onDoneCb = OnBatchDone};
 
 /// Memory buffer to receive the data from the enumerator
 ItemStore_ItemStruct_t _testItemBuffer;
@@ -69,12 +103,32 @@ ItemStore_Enumerator_t _enumerator;
 static ItemStore_ItemDef_t _itemStoreItem;
 
 /// Callback function used as parameter for ItemStoreTest_BeginEnumerate
+/// @param enumerator The enumerator that was initialized
 /// @param status of the operation BeginEnumerate
-static void EnumeratorReadToEnd(bool status);
+static void EnumeratorReadToEnd(ItemStore_Enumerator_t* enumerator,
+                                bool status);
 
 /// Callback function used as parameter for ItemStoreTest_BeginEnumerate
+/// @param enumerator The enumerator that was initialized
 /// @param status of the operation BeginEnumerate
-static void EnumeratorReadCount(bool status);
+static void EnumeratorReadCount(ItemStore_Enumerator_t* enumerator,
+                                bool status);
+
+/// Callback function used as parameter for ItemStoreTest_BenchmarkEnumerate
+/// @param enumerator The enumerator that was initialized
+/// @param status of the operation BeginEnumerate
+static void EnumeratorBenchmark(ItemStore_Enumerator_t* enumerator,
+                                bool status);
+
+/// Log the throughput and the read-ahead hit rate of a benchmark run
+/// @param name Name of the run
+/// @param readItems Number of items that were read
+/// @param startTicks Tick counter at the begin of the run
+/// @param startStats Read-ahead statistics at the begin of the run
+static void LogBenchmarkResult(const char* name,
+                               uint32_t readItems,
+                               uint16_t startTicks,
+                               const ItemStore_ReadAheadStats_t* startStats);
 
 void ItemStoreTest_AddItem(SysTest_TestMessageParameter_t param) {
   // avoid overflow of message queue
@@ -105,10 +159,24 @@ void ItemStoreTest_EnumerateItems(SysTest_TestMessageParameter_t param) {
   ItemStore_BeginEnumerate(_itemStoreItem, &_enumerator, callback);
 }
 
+void ItemStoreTest_AddItemBatch(SysTest_TestMessageParameter_t param) {
+  for (uint8_t i = 0; i < COUNT_OF(_testBatchItems); i++) {
+    _testBatchItems[i] = _testItemData[ITEM_DEF_MEASUREMENT_SAMPLE].measurement;
+  }
+  _batchItemsToAdd = param.shortParameter[1];
+  AddNextBatch();
+}
+
 void ItemStoreTest_DeleteAllItems(SysTest_TestMessageParameter_t param) {
   ItemStore_DeleteAllItems(param.byteParameter[0]);
 }
 
+void ItemStoreTest_BenchmarkEnumerate(SysTest_TestMessageParameter_t param) {
+  _enumerator.startIndex = 0;
+  _itemStoreItem = param.byteParameter[0];
+  ItemStore_BeginEnumerate(_itemStoreItem, &_enumerator, EnumeratorBenchmark);
+}
+
 static void OnTimerElapsed() {
   if (_timerAddItemParameter.shortParameter[1] == 0) {
     TimerServer_Stop(_timerAddItemId);
@@ -120,7 +188,29 @@ static void OnTimerElapsed() {
   _timerAddItemParameter.shortParameter[1]--;
 }
 
-static void EnumeratorReadToEnd(bool status) {
+static void OnBatchDone(bool success) {
+  if (!success) {
+    LOG_INFO("Add item batch failed!");
+    return;
+  }
+  AddNextBatch();
+}
+
+static void AddNextBatch() {
+  if (_batchItemsToAdd == 0) {
+    LOG_INFO("\n=>add item batch done");
+    return;
+  }
+  _testBatch.nrOfItems = COUNT_OF(_testBatchItems);
+  if (_batchItemsToAdd < _testBatch.nrOfItems) {
+    _testBatch.nrOfItems = _batchItemsToAdd;
+  }
+  _batchItemsToAdd -= _testBatch.nrOfItems;
+  ItemStore_AddItems(ITEM_DEF_MEASUREMENT_SAMPLE, &_testBatch);
+}
+
+static void EnumeratorReadToEnd(ItemStore_Enumerator_t* enumerator,
+                                bool status) {
   if (!status) {
     LOG_INFO("Enumerator was not initialized properly!");
     ItemStore_EndEnumerate(&_enumerator, _itemStoreItem);
@@ -135,7 +225,8 @@ static void EnumeratorReadToEnd(bool status) {
   ItemStore_EndEnumerate(&_enumerator, _itemStoreItem);
 }
 
-static void EnumeratorReadCount(bool status) {
+static void EnumeratorReadCount(ItemStore_Enumerator_t* enumerator,
+                                bool status) {
   if (!status) {
     LOG_INFO("Enumerator was not initialized properly!");
     ItemStore_EndEnumerate(&_enumerator, _itemStoreItem);
@@ -150,3 +241,62 @@ static void EnumeratorReadCount(bool status) {
   LOG_INFO("\n=>read count from 0 done: read items = %i", _numberOfItemsToRead);
   ItemStore_EndEnumerate(&_enumerator, _itemStoreItem);
 }
+
+static void EnumeratorBenchmark(ItemStore_Enumerator_t* enumerator,
+                                bool status) {
+  if (!status) {
+    LOG_INFO("Enumerator was not initialized properly!");
+    ItemStore_EndEnumerate(&_enumerator, _itemStoreItem);
+    return;
+  }
+  int32_t nrOfItems = ItemStore_Count(enumerator);
+  ItemStore_ReadAheadStats_t startStats;
+  ItemStore_GetReadAheadStats(&startStats);
+  uint16_t startTicks = TimerServer_GetTicks();
+  uint32_t readItems = 0;
+  while (ItemStore_GetNext(enumerator, &_testItemBuffer)) {
+    readItems++;
+  }
+  LogBenchmarkResult("sequential", readItems, startTicks, &startStats);
+
+  ItemStore_GetReadAheadStats(&startStats);
+  startTicks = TimerServer_GetTicks();
+  readItems = 0;
+  uint32_t seed = 1;
+  for (uint8_t i = 0; i < BENCHMARK_NR_OF_RANDOM_STARTS && nrOfItems > 0;
+       i++) {
+    // linear congruential generator; the sequence is the same in every run
+    seed = seed * 1664525UL + 1013904223UL;
+    if (!ItemStore_Seek(enumerator, seed % nrOfItems)) {
+      break;
+    }
+    for (uint8_t j = 0; j < BENCHMARK_ITEMS_PER_RANDOM_START &&
+                        ItemStore_GetNext(enumerator, &_testItemBuffer);
+         j++) {
+      readItems++;
+    }
+  }
+  LogBenchmarkResult("random start", readItems, startTicks, &startStats);
+  ItemStore_EndEnumerate(&_enumerator, _itemStoreItem);
+}
+
+static void LogBenchmarkResult(const char* name,
+                               uint32_t readItems,
+                               uint16_t startTicks,
+                               const ItemStore_ReadAheadStats_t* startStats) {
+  // a run must not take longer than the wrap of the tick counter (16s)
+  uint32_t ticks = (TimerServer_GetTicks() + TIMER_SERVER_TICKS_WRAP -
+                    startTicks) %
+                   TIMER_SERVER_TICKS_WRAP;
+  ItemStore_ReadAheadStats_t stats;
+  ItemStore_GetReadAheadStats(&stats);
+  uint32_t hits = stats.nrOfHits - startStats->nrOfHits;
+  uint32_t misses = stats.nrOfMisses - startStats->nrOfMisses;
+  uint32_t itemsPerSecond =
+      ticks > 0 ? readItems * TIMER_SERVER_TICKS_PER_SECOND / ticks : 0;
+  uint32_t hitRatePercent =
+      hits + misses > 0 ? hits * 100 / (hits + misses) : 0;
+  LOG_INFO("\n=>benchmark %s: %lu items in %lu ticks, %lu items/s", name,
+           readItems, ticks, itemsPerSecond);
+  LOG_INFO("\n=>benchmark %s: hit rate %lu%%", name, hitRatePercent);
+}
@@ -43,7 +43,9 @@ typedef enum {
   FUNCTION_ID_ADD_ITEM = 0,
   FUNCTION_ID_ADD_ITEMS_FROM_TIMER = 1,
   FUNCTION_ID_ENUMERATE_ITEMS = 2,
-  FUNCTION_ID_DELETE_ALL_ITEMS = 3
+  FUNCTION_ID_DELETE_ALL_ITEMS = 3,
+  FUNCTION_ID_ADD_ITEM_BATCH = 4,
+  FUNCTION_ID_BENCHMARK_ENUMERATE = 5
 } ItemStore_FunctionId_t;
 
 /// Add an item to the item store
@@ -74,4 +76,20 @@ void ItemStoreTest_EnumerateItems(SysTest_TestMessageParameter_t param);
 ///              byteParameter[0] is the item store id to be emptied;
 void ItemStoreTest_DeleteAllItems(SysTest_TestMessageParameter_t param);
 
+/// Add a batch of measurement items to the item store
+/// @param param parameters of the AddItemBatch function
+///              the added data are hard coded
+///              shortParameter[1] is the number of items that shall be
+///              inserted; the batch is repeated until all items are inserted
+void ItemStoreTest_AddItemBatch(SysTest_TestMessageParameter_t param);
+
+/// Measure the read throughput of an enumerator and the hit rate of the
+/// read-ahead cache.
+/// The item store is read once from the oldest to the newest item and then
+/// from pseudo random start positions; the results are logged. The reads
+/// run back to back, so the chunks are read on demand and not while idle.
+/// @param param parameters of the BenchmarkEnumerate function
+///              byteParameter[0] is the item store to be read
+void ItemStoreTest_BenchmarkEnumerate(SysTest_TestMessageParameter_t param);
+
 #endif  // ITEM_STORE_TEST_H
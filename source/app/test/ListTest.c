@@ -57,7 +57,7 @@ static ListTest_TestNode_t gNode[16];
 /// @return returns always true
 static bool PrintNodeValue(LinkedList_Node_t* node);
 
-void ListTest_InsertRemoveElements() {
+void ListTest_InsertRemoveElements(SysTest_TestMessageParameter_t param) {
   LinkedList_Create(&gList);
   for (uint8_t i = 0; i < 8; i++) {
     gNode[i].value = i;
@@ -30,14 +30,17 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 ////////////////////////////////////////////////////////////////////////////////
-/// @file CyclicBufferTest.h
+/// @file ListTest.h
 ///
-/// Test cases for cyclic buffer.
+/// Test cases for linked list.
 
 #ifndef LIST_TEST_H
 #define LIST_TEST_H
 
+#include "app/SysTest.h"
+
 /// Test insertion and removal in linked list
-void ListTest_InsertRemoveElements();
+/// @param param unused
+void ListTest_InsertRemoveElements(SysTest_TestMessageParameter_t param);
 
 #endif  // LIST_TEST_H
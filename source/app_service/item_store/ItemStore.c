@@ -34,35 +34,151 @@
 /// @file ItemStore.c
 #include "ItemStore.h"
 
+#include "app_service/nvm/ExternalFlash.h"
+#include "app_service/nvm/StorageBackend.h"
 #include "hal/Flash.h"
 #include "stm32wbxx_hal.h"
 #include "stm32wbxx_hal_flash.h"
 #include "utility/AppDefines.h"
 #include "utility/ErrorHandler.h"
+#include "stm32_seq.h"
 #include "utility/scheduler/Message.h"
 #include "utility/scheduler/MessageListener.h"
+#include "utility/scheduler/Scheduler.h"
 
 #include <string.h>
 /// First page of the system settings item
 #define SYSTEM_CONFIG_FIRST_PAGE FIRST_WRITABLE_FLASH_PAGE
 
+/// Wear leveling mode: number of pages the system settings item borrows from
+/// the measurement item. The erases caused by frequent settings changes are
+/// spread over more pages, at the cost of a shorter measurement log.
+/// Pages that still hold items of the other item store are erased during
+/// the initialization.
+#ifndef ITEM_STORE_CONFIG_SPARE_PAGES
+#define ITEM_STORE_CONFIG_SPARE_PAGES 0
+#endif
+
 /// Last page of the system settings item
-#define SYSTEM_CONFIG_LAST_PAGE (SYSTEM_CONFIG_FIRST_PAGE + 1)
+#define SYSTEM_CONFIG_LAST_PAGE \
+  (SYSTEM_CONFIG_FIRST_PAGE + 1 + ITEM_STORE_CONFIG_SPARE_PAGES)
 
+/// Number of pages of the hourly summary item. A page holds 255 summaries
+/// and the oldest page is erased when the newest page is full, hence three
+/// full pages keep the summaries of at least the last 31 days.
+///
+/// The six summary pages are taken from the internal measurement item. A
+/// page of the measurement item holds 510 items with one to seven samples
+/// each; at the default logging interval of 10 minutes, the summary pages
+/// cost between three weeks and five months of samples. In exchange, a
+/// month of hourly and more than eight months of daily summaries survive
+/// the wrap around of the measurement item.
+#define HOURLY_SUMMARY_NR_OF_PAGES 4
+
+/// First page of the hourly summary item
+#define HOURLY_SUMMARY_FIRST_PAGE (SYSTEM_CONFIG_LAST_PAGE + 1)
+
+/// Last page of the hourly summary item
+#define HOURLY_SUMMARY_LAST_PAGE \
+  (HOURLY_SUMMARY_FIRST_PAGE + HOURLY_SUMMARY_NR_OF_PAGES - 1)
+
+/// Number of pages of the daily summary item; the summaries of at least
+/// the last 255 days are kept.
+#define DAILY_SUMMARY_NR_OF_PAGES 2
+
+/// First page of the daily summary item
+#define DAILY_SUMMARY_FIRST_PAGE (HOURLY_SUMMARY_LAST_PAGE + 1)
+
+/// Last page of the daily summary item
+#define DAILY_SUMMARY_LAST_PAGE \
+  (DAILY_SUMMARY_FIRST_PAGE + DAILY_SUMMARY_NR_OF_PAGES - 1)
+
+/// Keep the measurement item on the external QSPI flash instead of the
+/// internal flash. The external flash is not shared with CPU2 and its
+/// EXTERNAL_FLASH_NR_OF_PAGES pages of EXTERNAL_FLASH_PAGE_SIZE hold about ten
+/// times more items than the internal pages that remain after the settings
+/// and the summaries (26 pages of FLASH_PAGE_SIZE without spare pages).
+#ifndef ITEM_STORE_CONFIG_EXTERNAL_MEASUREMENT
+#define ITEM_STORE_CONFIG_EXTERNAL_MEASUREMENT 0
+#endif
+
+#if ITEM_STORE_CONFIG_EXTERNAL_MEASUREMENT
 /// First page of the measurement item
-#define MEASUREMENT_VALUES_FIRST_PAGE (SYSTEM_CONFIG_LAST_PAGE + 1)
+#define MEASUREMENT_VALUES_FIRST_PAGE 0
 
 /// Last page of the measurement item
-#define MEASUREMENT_VALUES_LAST_PAGE (MEASUREMENT_VALUES_FIRST_PAGE + 31)
+#define MEASUREMENT_VALUES_LAST_PAGE (EXTERNAL_FLASH_NR_OF_PAGES - 1)
+
+/// Storage backend of the measurement item
+#define MEASUREMENT_VALUES_BACKEND StorageBackend_ExternalFlashInstance
+#else
+/// First page of the measurement item
+#define MEASUREMENT_VALUES_FIRST_PAGE (DAILY_SUMMARY_LAST_PAGE + 1)
+
+/// Last page of the measurement item
+#define MEASUREMENT_VALUES_LAST_PAGE LAST_WRITABLE_FLASH_PAGE
+
+/// Storage backend of the measurement item
+#define MEASUREMENT_VALUES_BACKEND StorageBackend_InternalFlashInstance
+#endif
 
 /// Maximal value for PAGE_ID
 /// This value must be bigger than the number of valid pages in order to
 /// always being able to locate the oldest and newest page!
 #define MAX_BLOCK_INDEX 64
 
+/// Block id of a page index entry whose page is released for an erase
+#define INVALID_BLOCK_ID 0xFF
+
+/// Maximal number of erase requests that are waiting for execution
+#define ERASE_QUEUE_SIZE 4
+
+/// Maximal number of requests that wait for the end of an erase; each open
+/// enumerator and a few items may wait.
+#define DEFERRED_QUEUE_SIZE (ITEM_STORE_MAX_NR_OF_ENUMERATORS + 3)
+
+/// Maximal number of items of a batch that are written within one flash write
+/// session. CPU2 can only access the flash between two sessions; eight
+/// measurement items are written in less than 1ms.
+#define WRITE_SESSION_NR_OF_ITEMS 8
+
+/// Size of a read-ahead chunk in bytes. The items of a chunk are read with
+/// one access to the storage backend.
+#define READ_AHEAD_CHUNK_SIZE 128
+
+/// Number of read-ahead chunks per enumerator; one chunk serves
+/// `ItemStore_GetNext()` while the other one is filled in the background.
+#define NR_OF_READ_AHEAD_CHUNKS 2
+
 /// A tag to identify the header of a page;
 #define PAGE_MAGIC 0xA53CC35A
 
+/// A tag to identify the begin tag of a page; it is the lower half of
+/// PAGE_MAGIC, the upper half holds the erase count of the page.
+#define PAGE_BEGIN_MAGIC 0xC35A
+
+/// Erase count of pages that were written by a firmware without erase
+/// counters; it is the upper half of PAGE_MAGIC.
+#define LEGACY_ERASE_COUNT 0xA53C
+
+/// Number of pages of the measurement item of firmware 1.0.0
+#define LEGACY_LOG_NR_OF_PAGES 32
+
+/// Highest erase count that is stored; the count saturates below
+/// LEGACY_ERASE_COUNT, far beyond the endurance of the flash.
+#define MAX_ERASE_COUNT (LEGACY_ERASE_COUNT - 1)
+
+/// Number of items that fit on a page of the specified item store.
+#define ITEMS_PER_PAGE(store) \
+  (((store)->backend->pageSize - sizeof(PageHeader_t)) / (store)->itemSize)
+
+/// Compute the address of a page in the specified item store.
+#define PAGE_ADDRESS(store, page_nr) ((store)->backend->pageAddress(page_nr))
+
+/// Access the page index entry of a page in the specified item store.
+#define PAGE_INDEX_ENTRY(item_store, page_nr) \
+  (&(item_store)->pageIndex[(page_nr) - (item_store)->firstPage])
+
 /// Compute the following page number in the specified item_store.
 #define NEXT_PAGE_NR(item_store, page_nr)                             \
   ((((page_nr) + 1) > (item_store->lastPage)) ? item_store->firstPage \
@@ -70,22 +186,28 @@
 
 /// Check the consistency of the page begin tag
 #define BEGIN_TAG_IS_CONSISTENT(store, header, actual_page) \
-  ((header.beginTag.magic == PAGE_MAGIC) &&                 \
+  ((header.beginTag.magic == PAGE_BEGIN_MAGIC) &&           \
    (header.beginTag.pageId == actual_page) &&               \
    (header.beginTag.itemSize == store->itemSize))
 
 /// Check the consistency of the page end tag
-#define COMPLETE_TAG_IS_CONSISTENT(store, header, actual_page)     \
-  ((header.completeTag.magic == PAGE_MAGIC) &&                     \
-   (header.completeTag.nrOfItems ==                                \
-    ((FLASH_PAGE_SIZE - sizeof(header)) / ((store)->itemSize))) && \
+#define COMPLETE_TAG_IS_CONSISTENT(store, header, actual_page) \
+  ((header.completeTag.magic == PAGE_MAGIC) &&                 \
+   (header.completeTag.nrOfItems == ITEMS_PER_PAGE(store)) &&  \
    (header.completeTag.nextPage == NEXT_PAGE_NR(store, actual_page)))
 
+/// Number of bytes at the beginning of an item that are written last.
+///
+/// The flash programs a double word at a time. An item whose write was cut by
+/// a power loss still has an erased head.
+#define ITEM_HEAD_SIZE sizeof(uint64_t)
+
 /// Marker that page is in use
 typedef struct {
-  uint32_t magic;   ///< tag to flag a page that contains valid data
-  uint8_t pageId;   ///< id of the page; simplifies the address computation
-  uint8_t blockId;  ///< id of the block; required to find the most recent page
+  uint16_t magic;       ///< tag to flag a page that contains valid data
+  uint16_t eraseCount;  ///< number of erases of this page
+  uint8_t pageId;       ///< id of the page; simplifies address computation
+  uint8_t blockId;      ///< id of the block; to find the most recent page
   ItemStore_ItemDef_t itemId;  ///< id of the item that is written in that page
   uint8_t itemSize;            ///< size of an item on this page
 } PageBeginTag_t;
@@ -106,16 +228,58 @@ typedef struct {
   PageCompleteTag_t completeTag;  ///< Marks the completeness of the page
 } PageHeader_t;
 
+/// Entry of the in-RAM page index of an item store.
+///
+/// The index mirrors the page headers on the flash. It allows to count
+/// items and to locate the start position of an enumerator without
+/// reading the flash.
+typedef struct {
+  uint8_t pageId;      ///< number of the indexed page
+  uint8_t blockId;     ///< block id of the page; same as in the page header
+  uint16_t nrOfItems;  ///< number of items that are stored on this page
+  /// Number of erases of this page; persisted in the begin tag when the page
+  /// is opened for writing.
+  uint16_t eraseCount;
+  /// Ordinal of the first item on this page. The ordinals are counted up
+  /// from the initialization of the item store and are never reused.
+  uint32_t firstItem;
+} PageIndexEntry_t;
+
+/// Consecutive items of one page that are held in RAM
+typedef struct {
+  uint8_t pageId;       ///< Page of the cached items
+  uint8_t blockId;      ///< Block id of the page when the items were read
+  uint16_t firstIndex;  ///< Item index of the first cached item on the page
+  uint16_t nrOfItems;   ///< Number of cached items; 0 if the chunk is empty
+  uint8_t items[READ_AHEAD_CHUNK_SIZE];  ///< The cached items
+} ReadAheadChunk_t;
+
 /// Metadata to efficiently enumerate items from a specific item store.
+/// Each open enumerator owns one of these cursors.
 typedef struct {
+  /// Enumerator that owns this cursor; 0 if the cursor is free
+  ItemStore_Enumerator_t* owner;
+  /// Callback to notify the status of `ItemStore_BeginEnumerate()`
+  ItemStore_EnumeratorStatusCb_t statusCb;
+  /// Generation of the item store when the enumeration started
+  uint8_t generation;
+  /// Ordinal of the oldest item when the enumeration started; item indices
+  /// of this enumeration are relative to this item.
+  uint32_t firstItem;
   PageHeader_t enumeratingPage;  ///< Page header of the current page
   uint16_t currentIndex;         ///< Item index on the current page
 
   uint16_t itemsOnPage;  ///< Number of items on this page
-  uint16_t itemsRead;    ///< Count of already read items
+  uint32_t itemsRead;    ///< Count of already read items
   /// Number of items to skip (starting with the `oldest` item on the flash)
-  uint16_t itemsToSkip;
-  uint16_t totalNrOfItems;  ///< total number of items in this item store
+  uint32_t itemsToSkip;
+  uint32_t totalNrOfItems;  ///< total number of items in this item store
+  /// Chunks that cache the items at and after the cursor
+  ReadAheadChunk_t chunks[NR_OF_READ_AHEAD_CHUNKS];
+  uint8_t servingChunk;  ///< Chunk that holds the item at the cursor
+  /// Flag to indicate that the chunk after the serving chunk shall be read
+  /// as soon as the sequencer is idle
+  bool isReadAheadPending;
 } EnumeratorStatus_t;
 
 /// Describe the data that are used to
@@ -124,6 +288,8 @@ typedef struct {
   uint8_t firstPage;  ///< Number of the first page of this item store.
   uint8_t lastPage;   ///< Number of the last page of this item store.
   uint8_t itemSize;   ///< Size of the items in this info store.
+  /// Memory that holds the pages of this item store.
+  const StorageBackend_t* backend;
   /// Number of pages this item store may use.
   /// For items that do not need history and very frequent update this value is 2
   uint8_t nrOfPages;
@@ -137,16 +303,55 @@ typedef struct {
   PageBeginTag_t nextWritePageInfo;
   /// Tag of the oldest page
   PageBeginTag_t oldestPageInfo;
-  /// The state of the item store; the item store may be in the state
-  /// enumerating or idle
+  /// In-RAM index with one entry per page; the entries are ordered by page
+  /// number.
+  PageIndexEntry_t* pageIndex;
+  /// Ordinal that is assigned to the next item that is added.
+  uint32_t nextItemOrdinal;
+  /// Number of flash reads that were needed to recover the item store
+  /// during the last initialization.
+  uint16_t nrOfRecoveryReads;
+  /// Incremented whenever all items are removed; open enumerators of an
+  /// older generation are overtaken.
+  uint8_t generation;
+  /// Queued erase requests of item stores with a higher priority are
+  /// executed first.
+  uint8_t erasePriority;
+  /// Erase the oldest page as soon as the page before it is opened for
+  /// writing. A page rollover then never waits for an erase, at the cost of
+  /// one page of history.
+  bool isPreEraseEnabled;
+  /// The items of pages that were written by a firmware without erase
+  /// counters have another format; such pages are kept as legacy log that is
+  /// not part of the item store.
+  bool isLegacyLogKept;
+  /// Bit mask of the pages of the legacy log; bit 0 stands for the first
+  /// page of the item store. The page index entry of a legacy page tells
+  /// its block id and its number of items.
+  uint64_t legacyLogPages;
+  /// Newest page of the legacy log
+  uint8_t newestLegacyLogPage;
+  /// Flag to indicate that a page of an older firmware with another item size
+  /// is kept; its items are not part of the item store.
+  bool hasLegacyPage;
+  /// Number of the kept page of an older firmware
+  uint8_t legacyPage;
+  /// Block id of the kept page of an older firmware
+  uint8_t legacyBlockId;
+  /// Size of the items on the kept page of an older firmware
+  uint8_t legacyItemSize;
+  /// The state of the item store
   MessageListener_HandleReceivedMessageCb_t currentState;
-  /// Callback to notify about the status of the function
-  /// `ItemStore_BeginEnumerate()`
-  ItemStore_EnumeratorStatusCb_t enumeratorStatusCb;
-  /// Internal status of the current enumerator.
-  EnumeratorStatus_t enumeratorStatus;
 } ItemStoreInfo_t;
 
+/// Entry of the erase queue
+typedef struct {
+  ItemStore_EraseParameters_t parameters;  ///< Pages to be erased
+  /// Number of erase messages that are served by this entry; requests for
+  /// the same pages are coalesced into one entry.
+  uint8_t nrOfRequests;
+} EraseRequest_t;
+
 /// Parameter of the AddItem message
 typedef struct {
   ItemStore_ItemStruct_t* data;  ///< Content to be written to the item store
@@ -158,6 +363,7 @@ typedef struct {
   /// Message data
   union {
     const ItemStore_ItemStruct_t* addParameter;  ///< Parameter for add item
+    ItemStore_ItemBatch_t* addItemsParameter;    ///< Parameter for add items
     ItemStore_EraseParameters_t eraseParameter;  ///< Parameter for erase page
     ItemStore_Enumerator_t* enumerateParameter;  ///< Parameter for begin
                                                  ///< enumerate.
@@ -179,11 +385,6 @@ static bool ListenerErasingState(Message_Message_t* message);
 /// @return true if the message was handled; false otherwise
 static bool IdleState(Message_Message_t* message);
 
-/// State of the item store while a client enumerates over its items.
-/// @param message The message to be dispatched
-/// @return true if the message was handled; false otherwise
-static bool EnumeratingState(Message_Message_t* message);
-
 /// Synchronously write an item to the flash
 /// @param item Selects the item store to write the data
 /// @param data The data that is written
@@ -191,6 +392,32 @@ static bool EnumeratingState(Message_Message_t* message);
 static bool AddItem(ItemStore_ItemDef_t item,
                     const ItemStore_ItemStruct_t* data);
 
+/// Synchronously write a batch of items to the flash
+///
+/// The items are written in flash write sessions of at most
+/// WRITE_SESSION_NR_OF_ITEMS items. At most the items that fit into the
+/// current write page are written with one message; the rest of the batch is
+/// queued again, such that other requests are handled in between. If a page
+/// erase is started, the writing stops and the batch is deferred until the
+/// erase is done.
+/// @param item Selects the item store to write the data
+/// @param batch The batch of items that is written
+static void AddItems(ItemStore_ItemDef_t item, ItemStore_ItemBatch_t* batch);
+
+/// Defer a request that needs the flash until the running erase is done.
+/// The request is rejected if too many requests are waiting.
+/// @param message The request to be deferred
+/// @param isFirst Flag to handle the request before the waiting requests
+static void DeferRequest(const ItemStoreMessage_t* message, bool isFirst);
+
+/// Reject a request that cannot be deferred; the requester is informed
+/// like for a failed request.
+/// @param message The rejected request
+static void RejectRequest(const ItemStoreMessage_t* message);
+
+/// Handle the deferred requests in order until an erase is started again.
+static void HandleDeferredRequests();
+
 /// Begin to enumerate the items in an item store
 ///
 /// @param item Selects the item store to read from
@@ -202,23 +429,94 @@ static void BeginEnumerate(ItemStore_ItemDef_t item,
 ///
 /// @param page_nr Page number to read information from it
 /// @param itemStore Item store that is enumerated.
+/// @param status Cursor of the enumerator
 /// @param currentIndex Index on page where the read will start
 /// @return true if the enumerator was successfully initialized; false otherwise
 ///         In case the flash page was not read the enumerator will not be
 ///         initialized!
 static bool InitEnumeratorStatus(uint8_t page_nr,
                                  ItemStoreInfo_t* itemStore,
+                                 EnumeratorStatus_t* status,
                                  uint16_t currentIndex);
 
+/// Check if the page at the cursor of an enumerator was removed.
+/// @param itemStore Item store that is enumerated.
+/// @param status Cursor of the enumerator
+/// @return true if the items at the cursor are no longer available
+static bool IsOvertaken(ItemStoreInfo_t* itemStore,
+                        const EnumeratorStatus_t* status);
+
+/// Read the item at the cursor.
+///
+/// The item is served from the read-ahead chunks; a chunk is read
+/// synchronously if it does not hold the item. Reading the chunk after it is
+/// deferred to the next idle slot of the sequencer.
+/// @param itemStore Pointer to item store
+/// @param status The cursor of the enumerator
+/// @param [out] data Receives the item
+/// @return true if the item was read; false otherwise
+static bool ReadItem(ItemStoreInfo_t* itemStore,
+                     EnumeratorStatus_t* status,
+                     uint8_t* data);
+
+/// Find the read-ahead chunk that holds the item at the cursor
+/// @param status The cursor of the enumerator
+/// @return Pointer to the chunk; 0 if the item is not cached
+static ReadAheadChunk_t* FindChunk(EnumeratorStatus_t* status);
+
+/// Read consecutive items of a page into a read-ahead chunk
+/// @param itemStore Pointer to item store
+/// @param chunk The chunk to be filled
+/// @param entry Page index entry of the page to be read
+/// @param firstIndex Item index on the page of the first item to be read
+/// @return true if the items were read; false otherwise
+static bool FillChunk(ItemStoreInfo_t* itemStore,
+                      ReadAheadChunk_t* chunk,
+                      const PageIndexEntry_t* entry,
+                      uint16_t firstIndex);
+
+/// Drop all read-ahead chunks of a cursor
+/// @param status The cursor of the enumerator
+static void InvalidateReadAhead(EnumeratorStatus_t* status);
+
+/// Sequencer task that fills the pending read-ahead chunks
+static void ReadAheadTask();
+
+/// Get a free cursor for an enumerator.
+///
+/// An enumerator that already owns a cursor keeps it.
+/// @param enumerator The enumerator that needs a cursor
+/// @return Pointer to the cursor; 0 if no cursor is available.
+static EnumeratorStatus_t* AllocateCursor(ItemStore_Enumerator_t* enumerator);
+
+/// Find the first keyed item at or after an item index.
+/// @param enumerator A ready enumerator
+/// @param index Index of the item where the search begins
+/// @param keyOfItem Callback that gets the key of an item
+/// @param maxGap Maximal number of consecutive items without a key
+/// @param [out] keyedIndex Receives the index of the keyed item
+/// @param [out] key Receives the key of the item
+/// @return true if a keyed item was found; false otherwise
+static bool FindKeyedItem(ItemStore_Enumerator_t* enumerator,
+                          uint32_t index,
+                          ItemStore_KeyOfItemCb_t keyOfItem,
+                          uint16_t maxGap,
+                          uint32_t* keyedIndex,
+                          uint32_t* key);
+
 /// Compute the start page and item index within this page where
 /// the enumerator starts reading.
 ///
+/// The start position is looked up with a binary search in the page index.
+/// No flash access is required.
 /// @param itemStore Pointer to item store
+/// @param itemsToSkip Number of items to skip from the oldest item
 /// @param [out] startPage Start page number where the enumerator will start
 ///                        reading
 /// @param [out] startPosition Start item index within the selected page
 /// @return true if the operation succeeded; false otherwise.
 static bool FindEnumeratorStartPosition(ItemStoreInfo_t* itemStore,
+                                        uint32_t itemsToSkip,
                                         uint8_t* startPage,
                                         uint16_t* startPosition);
 
@@ -230,12 +528,33 @@ static bool FindEnumeratorStartPosition(ItemStoreInfo_t* itemStore,
 static void InitItemStore(ItemStoreInfo_t* itemStoreInfo,
                           ItemStore_ItemDef_t id);
 
-/// Count the number of entries on the current page
-/// This assumes that the currentPageInfo field of the itemStoreInfo is
-/// properly set.
+/// Count the number of entries on a page that is not complete.
+/// Since items are written in ascending order, the written items form a
+/// contiguous block followed by erased flash. The boundary is located by a
+/// binary search that needs at most log2(itemsPerPage) + 1 flash reads.
 /// @param itemStoreInfo Pointer to an item store instance.
+/// @param pageNr Number of the page
 /// @return The number of items on the page.
-static uint32_t CountItemsOnCurrentPage(ItemStoreInfo_t* itemStoreInfo);
+static uint32_t CountItemsOnPage(ItemStoreInfo_t* itemStoreInfo,
+                                 uint8_t pageNr);
+
+/// Clear the newest item of the current page if its write was cut by a power
+/// loss.
+///
+/// The torn item keeps its slot but all its bytes are cleared; the readers
+/// reject such an item like any other invalid item. A double word that is
+/// already programmed can still be cleared to zero.
+/// @param itemStoreInfo Pointer to an item store instance.
+static void ClearTornItem(ItemStoreInfo_t* itemStoreInfo);
+
+/// Program an item; the head of the item is programmed last.
+/// @param itemStoreInfo Pointer to an item store instance.
+/// @param address Address of the item
+/// @param data The bytes of the item
+/// @return true if the operation succeeds; false otherwise
+static bool ProgramItem(ItemStoreInfo_t* itemStoreInfo,
+                        uint32_t address,
+                        const uint8_t* data);
 
 /// Check if there is valid data in the buffer;
 /// The flash erase state is all 1.
@@ -268,6 +587,54 @@ static bool ClosePageIfFull(ItemStoreInfo_t* itemStoreInfo);
 static void UpdateNewestOldestPage(ItemStoreInfo_t* itemStoreInfo,
                                    bool initialize);
 
+/// Check if a page was opened after another page.
+/// @param itemStoreInfo The item store that holds the pages
+/// @param blockId Block id of the page to be checked
+/// @param otherBlockId Block id of the other page
+/// @return true if the page is newer than the other page; false otherwise
+static bool IsNewerBlock(const ItemStoreInfo_t* itemStoreInfo,
+                         uint8_t blockId,
+                         uint8_t otherBlockId);
+
+/// Keep the page of an older firmware if it holds the newest of its items;
+/// the older pages are reclaimed.
+/// @param itemStoreInfo The item store that is initialized
+/// @param pageNr Number of the page
+/// @param beginTag Begin tag of the page
+static void KeepLegacyPage(ItemStoreInfo_t* itemStoreInfo,
+                           uint8_t pageNr,
+                           const PageBeginTag_t* beginTag);
+
+/// Add a page of a firmware without erase counters to the legacy log.
+/// @param itemStoreInfo The item store that is initialized
+/// @param pageNr Number of the page
+/// @param header Header of the page
+static void KeepLegacyLogPage(ItemStoreInfo_t* itemStoreInfo,
+                              uint8_t pageNr,
+                              const PageHeader_t* header);
+
+/// Find the newest page of the legacy log after all pages are scanned.
+///
+/// The older firmware had LEGACY_LOG_NR_OF_PAGES pages, hence the block ids
+/// of the legacy pages lie within that many consecutive block ids.
+/// @param itemStoreInfo The item store that is initialized
+static void FindNewestLegacyLogPage(ItemStoreInfo_t* itemStoreInfo);
+
+/// Remove a page from the legacy log before it is reused by the item store.
+/// @param itemStoreInfo The item store
+/// @param pageNr Number of the page
+/// @return true if the page belonged to the legacy log; false otherwise
+static bool TakeLegacyLogPage(ItemStoreInfo_t* itemStoreInfo, uint8_t pageNr);
+
+/// Get the page of the legacy log that precedes a page.
+/// @param itemStoreInfo The item store
+/// @param pageNr Number of a page of the legacy log
+/// @param [out] olderPageNr Receives the number of the older page
+/// @return true if there is an older page; false otherwise
+static bool OlderLegacyLogPage(const ItemStoreInfo_t* itemStoreInfo,
+                               uint8_t pageNr,
+                               uint8_t* olderPageNr);
+
 /// Adjust the next page to write items
 ///
 /// In case all pages are complete, the next page to receive new items
@@ -280,11 +647,89 @@ static void UpdateNewestOldestPage(ItemStoreInfo_t* itemStoreInfo,
 static bool AdjustNextWritePage(ItemStoreInfo_t* itemStoreInfo,
                                 PageCompleteTag_t* completeTag);
 
+/// Remove the oldest page from the item store such that it can be erased.
+/// @param itemStoreInfo Pointer to the item store
+/// @param oldestHeader Page header of the oldest page
+/// @return true if the operation succeeds; false otherwise.
+static bool ReleaseOldestPage(ItemStoreInfo_t* itemStoreInfo,
+                              const PageHeader_t* oldestHeader);
+
+/// Erase the page that follows the write page if it holds the oldest items.
+/// The erase starts right after the first item of the write page is written,
+/// such that the rest of a running batch and the items and enumerations that
+/// are requested meanwhile are deferred until the erase is done. The page is
+/// therefore erased before the write page can be closed.
+/// @param itemStoreInfo Pointer to the item store
+static void PreEraseNextPage(ItemStoreInfo_t* itemStoreInfo);
+
+/// Add an erase request to the erase queue.
+///
+/// A request for pages that are covered by a queued request is merged into
+/// the queued request and vice versa.
+/// @param parameters The pages to be erased
+/// @param nrOfRequests Number of erase messages served by this request
+/// @return true if the request is queued; false if the queue is full
+static bool EnqueueErase(const ItemStore_EraseParameters_t* parameters,
+                         uint8_t nrOfRequests);
+
+/// Start the queued erase request with the highest priority.
+/// @return true if an erase was started; false if the queue is empty
+static bool StartNextErase();
+
+/// Request the erase of a page that holds items of another item store.
+/// @param itemStoreInfo Pointer to the item store that owns the page
+/// @param pageNr Number of the page
+static void ReclaimPage(ItemStoreInfo_t* itemStoreInfo, uint8_t pageNr);
+
+/// Increment the erase counts of the erased pages.
+/// @param parameters The pages that were erased
+static void CountErasedPages(const ItemStore_EraseParameters_t* parameters);
+
+/// Check if an erase request covers all pages of another request.
+/// @param outer The covering request
+/// @param inner The covered request
+/// @return true if all pages of inner are erased by outer; false otherwise
+static bool CoversErase(const ItemStore_EraseParameters_t* outer,
+                        const ItemStore_EraseParameters_t* inner);
+
+/// Get the page index entry at a position relative to the oldest page.
+/// @param itemStoreInfo Pointer to the item store
+/// @param position Position of the page; 0 is the oldest page.
+/// @return Pointer to the page index entry
+static PageIndexEntry_t* PageIndexEntryAt(ItemStoreInfo_t* itemStoreInfo,
+                                          uint8_t position);
+
+/// Initialize the page index entry of the page where the next write happens.
+/// @param itemStoreInfo Pointer to the item store
+static void InitWritePageIndexEntry(ItemStoreInfo_t* itemStoreInfo);
+
+/// Assign the item ordinals to all pages of the page index.
+///
+/// This is required after the page index was reconstructed from the flash.
+/// @param itemStoreInfo Pointer to the item store
+static void AssignPageIndexOrdinals(ItemStoreInfo_t* itemStoreInfo);
+
 /// Callback that indicates the completion of a page erase.
 /// @param pageId The page id of the erased page.
 /// @param remaining Number of pages that where not erased.
 static void FlashEraseDoneCb(uint32_t pageId, uint8_t remaining);
 
+/// Page index of the system config item store
+static PageIndexEntry_t
+    _systemConfigPageIndex[1 + SYSTEM_CONFIG_LAST_PAGE -
+                           SYSTEM_CONFIG_FIRST_PAGE];
+
+/// Page index of the measurement item store
+static PageIndexEntry_t
+    _measurementPageIndex[1 + MEASUREMENT_VALUES_LAST_PAGE -
+                          MEASUREMENT_VALUES_FIRST_PAGE];
+
+/// Page index of the hourly summary item store
+static PageIndexEntry_t _hourlySummaryPageIndex[HOURLY_SUMMARY_NR_OF_PAGES];
+
+/// Page index of the daily summary item store
+static PageIndexEntry_t _dailySummaryPageIndex[DAILY_SUMMARY_NR_OF_PAGES];
+
 /// list metadata of item stores
 ItemStoreInfo_t _itemStore[] = {
     [ITEM_DEF_SYSTEM_CONFIG] = {.firstPage = SYSTEM_CONFIG_FIRST_PAGE,
@@ -293,7 +738,11 @@ ItemStoreInfo_t _itemStore[] = {
                                                   SYSTEM_CONFIG_FIRST_PAGE),
                                 .nrOfFullPages = 0,
                                 .currentPageNrOfItems = 0,
-                                .itemSize = sizeof(ItemStore_SystemConfig_t),
+                                .itemSize = sizeof(ItemStore_SettingsRecord_t),
+                                .pageIndex = _systemConfigPageIndex,
+                                .erasePriority = 1,
+                                .isPreEraseEnabled = false,
+                                .isLegacyLogKept = false,
                                 .currentState = IdleState},
     [ITEM_DEF_MEASUREMENT_SAMPLE] = {.firstPage = MEASUREMENT_VALUES_FIRST_PAGE,
                                      .lastPage = MEASUREMENT_VALUES_LAST_PAGE,
@@ -304,7 +753,35 @@ ItemStoreInfo_t _itemStore[] = {
                                      .currentPageNrOfItems = 0,
                                      .itemSize =
                                          sizeof(ItemStore_MeasurementSample_t),
+                                     .pageIndex = _measurementPageIndex,
+                                     .erasePriority = 0,
+                                     .isPreEraseEnabled = true,
+                                     .isLegacyLogKept = true,
                                      .currentState = IdleState},
+    // a summary is added once per hour; a page rollover may wait for the
+    // erase rather than giving away a page of history.
+    [ITEM_DEF_HOURLY_SUMMARY] = {.firstPage = HOURLY_SUMMARY_FIRST_PAGE,
+                                 .lastPage = HOURLY_SUMMARY_LAST_PAGE,
+                                 .nrOfPages = HOURLY_SUMMARY_NR_OF_PAGES,
+                                 .nrOfFullPages = 0,
+                                 .currentPageNrOfItems = 0,
+                                 .itemSize = sizeof(ItemStore_SummaryRecord_t),
+                                 .pageIndex = _hourlySummaryPageIndex,
+                                 .erasePriority = 0,
+                                 .isPreEraseEnabled = false,
+                                 .isLegacyLogKept = false,
+                                 .currentState = IdleState},
+    [ITEM_DEF_DAILY_SUMMARY] = {.firstPage = DAILY_SUMMARY_FIRST_PAGE,
+                                .lastPage = DAILY_SUMMARY_LAST_PAGE,
+                                .nrOfPages = DAILY_SUMMARY_NR_OF_PAGES,
+                                .nrOfFullPages = 0,
+                                .currentPageNrOfItems = 0,
+                                .itemSize = sizeof(ItemStore_SummaryRecord_t),
+                                .pageIndex = _dailySummaryPageIndex,
+                                .erasePriority = 0,
+                                .isPreEraseEnabled = false,
+                                .isLegacyLogKept = false,
+                                .currentState = IdleState},
 };
 
 /// Message listeners to receive application message for the item store
@@ -314,11 +791,37 @@ MessageListener_Listener_t _messageListener = {
 
 /// When the erase is done, we still want to know what where the parameters
 /// When the item store was emptied we need to call the initialization again!
-ItemStore_EraseParameters_t _eraseParameters;
+static EraseRequest_t _runningErase;
+
+/// Erase requests that cannot be handled at the time they were requested.
+static EraseRequest_t _eraseQueue[ERASE_QUEUE_SIZE];
+
+/// Number of requests in the erase queue
+static uint8_t _eraseQueueDepth;
+
+/// Statistics of the erase queue
+static ItemStore_EraseStats_t _eraseStats;
+
+/// Flag to indicate that adding items waits for the erase of a page
+/// rollover
+static bool _isRolloverBlocked;
+
+/// Number of pages that were erased since adding items is blocked by a
+/// page rollover
+static uint8_t _rolloverErasedPages;
+
+/// Cursors of the open enumerators
+static EnumeratorStatus_t _cursors[ITEM_STORE_MAX_NR_OF_ENUMERATORS];
+
+/// Statistics of the read-ahead chunks of all enumerators
+static ItemStore_ReadAheadStats_t _readAheadStats;
 
-/// Reminder of an erase operation that cannot be handled at the time
-/// it was requested.
-ItemStore_EraseParameters_t _eraseReminder;
+/// Requests that arrived or were interrupted while an erase is ongoing; they
+/// are handled in order when the erase is done.
+static ItemStoreMessage_t _deferredRequests[DEFERRED_QUEUE_SIZE];
+
+/// Number of deferred requests
+static uint8_t _nrOfDeferredRequests;
 
 /// Get the ItemStore message listener
 /// @return Pointer to the ItemStore_Listener
@@ -327,9 +830,22 @@ MessageListener_Listener_t* ItemStore_ListenerInstance() {
 }
 
 void ItemStore_Init() {
+  _itemStore[ITEM_DEF_SYSTEM_CONFIG].backend =
+      StorageBackend_InternalFlashInstance();
+  _itemStore[ITEM_DEF_MEASUREMENT_SAMPLE].backend =
+      MEASUREMENT_VALUES_BACKEND();
+  _itemStore[ITEM_DEF_HOURLY_SUMMARY].backend =
+      StorageBackend_InternalFlashInstance();
+  _itemStore[ITEM_DEF_DAILY_SUMMARY].backend =
+      StorageBackend_InternalFlashInstance();
   for (uint8_t i = 0; i < COUNT_OF(_itemStore); i++) {
+    if (_itemStore[i].backend->init != 0) {
+      _itemStore[i].backend->init();
+    }
     InitItemStore(&_itemStore[i], (ItemStore_ItemDef_t)i);
   }
+  UTIL_SEQ_RegTask(1 << SCHEDULER_TASK_HANDLE_ITEM_STORE_READ_AHEAD,
+                   UTIL_SEQ_RFU, ReadAheadTask);
 }
 
 bool ItemStore_IsEmpty(ItemStore_ItemDef_t itemStoreId) {
@@ -337,6 +853,131 @@ bool ItemStore_IsEmpty(ItemStore_ItemDef_t itemStoreId) {
          _itemStore[itemStoreId].currentPageNrOfItems == 0;
 }
 
+bool ItemStore_ReadLegacyItem(ItemStore_ItemDef_t item,
+                              void* data,
+                              uint8_t size) {
+  ItemStoreInfo_t* itemStoreInfo = &_itemStore[item];
+  if (!itemStoreInfo->hasLegacyPage || itemStoreInfo->legacyItemSize != size) {
+    return false;
+  }
+  uint32_t address = PAGE_ADDRESS(itemStoreInfo, itemStoreInfo->legacyPage) +
+                     sizeof(PageHeader_t);
+  uint16_t itemsPerPage =
+      (itemStoreInfo->backend->pageSize - sizeof(PageHeader_t)) / size;
+  // the newest item precedes the first empty slot
+  uint16_t nrOfItems = 0;
+  while (nrOfItems < itemsPerPage &&
+         itemStoreInfo->backend->read(address + nrOfItems * size,
+                                      (uint8_t*)data, size) &&
+         !HasNoData((uint8_t*)data, size)) {
+    nrOfItems++;
+  }
+  return nrOfItems > 0 &&
+         itemStoreInfo->backend->read(address + (nrOfItems - 1) * size,
+                                      (uint8_t*)data, size);
+}
+
+void ItemStore_DeleteLegacyItems(ItemStore_ItemDef_t item) {
+  ItemStoreInfo_t* itemStoreInfo = &_itemStore[item];
+  if (itemStoreInfo->hasLegacyPage) {
+    itemStoreInfo->hasLegacyPage = false;
+    // the page is erased before any later item is written
+    ReclaimPage(itemStoreInfo, itemStoreInfo->legacyPage);
+  }
+  // the pages of the legacy log are erased in runs of consecutive pages
+  uint8_t first = 0;
+  while (itemStoreInfo->legacyLogPages != 0) {
+    uint8_t nrOfPages = 0;
+    while (first + nrOfPages < itemStoreInfo->nrOfPages &&
+           TakeLegacyLogPage(itemStoreInfo,
+                             itemStoreInfo->firstPage + first + nrOfPages)) {
+      nrOfPages++;
+    }
+    ItemStore_EraseParameters_t parameters = {
+        .itemStore = item,
+        .nrOfPages = nrOfPages,
+        .reinit = false,
+        .pageNumber = itemStoreInfo->firstPage + first};
+    if (nrOfPages > 0 && EnqueueErase(&parameters, 0) &&
+        _messageListener.currentMessageHandlerCb != ListenerErasingState) {
+      StartNextErase();
+    }
+    first += nrOfPages + 1;
+  }
+}
+
+uint32_t ItemStore_CountLegacyLogItems(ItemStore_ItemDef_t item) {
+  ItemStoreInfo_t* itemStoreInfo = &_itemStore[item];
+  uint8_t pageNr = itemStoreInfo->newestLegacyLogPage;
+  uint32_t nrOfItems = 0;
+  // the newest page is set when the item store is initialized
+  bool isLegacyPage = itemStoreInfo->legacyLogPages != 0 &&
+                      (itemStoreInfo->legacyLogPages &
+                       (1ULL << (pageNr - itemStoreInfo->firstPage))) != 0;
+  while (isLegacyPage) {
+    nrOfItems += PAGE_INDEX_ENTRY(itemStoreInfo, pageNr)->nrOfItems;
+    isLegacyPage = OlderLegacyLogPage(itemStoreInfo, pageNr, &pageNr);
+  }
+  return nrOfItems;
+}
+
+bool ItemStore_ReadLegacyLogItem(ItemStore_ItemDef_t item,
+                                 uint32_t nrOfNewerItems,
+                                 void* data,
+                                 uint8_t size) {
+  ItemStoreInfo_t* itemStoreInfo = &_itemStore[item];
+  uint8_t pageNr = itemStoreInfo->newestLegacyLogPage;
+  bool isLegacyPage = size == itemStoreInfo->itemSize &&
+                      itemStoreInfo->legacyLogPages != 0 &&
+                      (itemStoreInfo->legacyLogPages &
+                       (1ULL << (pageNr - itemStoreInfo->firstPage))) != 0;
+  while (isLegacyPage) {
+    uint16_t nrOfItems = PAGE_INDEX_ENTRY(itemStoreInfo, pageNr)->nrOfItems;
+    if (nrOfNewerItems < nrOfItems) {
+      return itemStoreInfo->backend->read(
+          PAGE_ADDRESS(itemStoreInfo, pageNr) + sizeof(PageHeader_t) +
+              (nrOfItems - 1 - nrOfNewerItems) * size,
+          (uint8_t*)data, size);
+    }
+    nrOfNewerItems -= nrOfItems;
+    isLegacyPage = OlderLegacyLogPage(itemStoreInfo, pageNr, &pageNr);
+  }
+  return false;
+}
+
+uint16_t ItemStore_GetRecoveryReads(ItemStore_ItemDef_t item) {
+  return _itemStore[item].nrOfRecoveryReads;
+}
+
+void ItemStore_GetWearStats(ItemStore_ItemDef_t item,
+                            ItemStore_WearStats_t* stats) {
+  ItemStoreInfo_t* itemStoreInfo = &_itemStore[item];
+  uint32_t totalEraseCount = 0;
+  stats->nrOfPages = itemStoreInfo->nrOfPages;
+  stats->minEraseCount = UINT16_MAX;
+  stats->maxEraseCount = 0;
+  for (uint8_t i = 0; i < itemStoreInfo->nrOfPages; i++) {
+    uint16_t eraseCount = itemStoreInfo->pageIndex[i].eraseCount;
+    totalEraseCount += eraseCount;
+    if (eraseCount < stats->minEraseCount) {
+      stats->minEraseCount = eraseCount;
+    }
+    if (eraseCount > stats->maxEraseCount) {
+      stats->maxEraseCount = eraseCount;
+    }
+  }
+  stats->meanEraseCount = totalEraseCount / itemStoreInfo->nrOfPages;
+}
+
+void ItemStore_GetEraseStats(ItemStore_EraseStats_t* stats) {
+  *stats = _eraseStats;
+  stats->queueDepth = _eraseQueueDepth;
+}
+
+void ItemStore_GetReadAheadStats(ItemStore_ReadAheadStats_t* stats) {
+  *stats = _readAheadStats;
+}
+
 // Add item must run asynchronously since it is only allowed to
 // add items, while no flash erase is ongoing!
 void ItemStore_AddItem(ItemStore_ItemDef_t item,
@@ -349,11 +990,25 @@ void ItemStore_AddItem(ItemStore_ItemDef_t item,
   Message_PublishAppMessage((Message_Message_t*)&msg);
 }
 
+// Add items must run asynchronously for the same reason as add item. The
+// items are written when the message is handled.
+void ItemStore_AddItems(ItemStore_ItemDef_t item,
+                        ItemStore_ItemBatch_t* batch) {
+  batch->nrOfItemsWritten = 0;
+  ItemStoreMessage_t msg = {
+      .header.category = MESSAGE_BROKER_CATEGORY_ITEM_STORE,
+      .header.id = ITEM_STORE_MESSAGE_ADD_ITEMS,
+      .header.parameter1 = item,
+      .data.addItemsParameter = batch};
+  Message_PublishAppMessage((Message_Message_t*)&msg);
+}
+
 // All pages that belong to this item store will be erased
 void ItemStore_DeleteAllItems(ItemStore_ItemDef_t item) {
-  // mark the item store as empty
+  // mark the item store as empty; open enumerators are overtaken
   _itemStore[item].nrOfFullPages = 0;
   _itemStore[item].currentPageNrOfItems = 0;
+  _itemStore[item].generation++;
   // now trigger the erase of all pages
   ItemStoreMessage_t msg = {
       .header.category = MESSAGE_BROKER_CATEGORY_ITEM_STORE,
@@ -365,9 +1020,10 @@ void ItemStore_DeleteAllItems(ItemStore_ItemDef_t item) {
   // This would be a severe programming error!
   // This would destroy the application including the OTA capability!
   // If this happens we need to be able to track this in a debugger
-  ASSERT(((msg.data.eraseParameter.pageNumber >= SYSTEM_CONFIG_FIRST_PAGE) &&
+  ASSERT(_itemStore[item].backend != StorageBackend_InternalFlashInstance() ||
+         ((msg.data.eraseParameter.pageNumber >= SYSTEM_CONFIG_FIRST_PAGE) &&
           (msg.data.eraseParameter.nrOfPages <
-           (MEASUREMENT_VALUES_LAST_PAGE - SYSTEM_CONFIG_FIRST_PAGE + 1))));
+           (LAST_WRITABLE_FLASH_PAGE - SYSTEM_CONFIG_FIRST_PAGE + 1))));
 
   Message_PublishAppMessage((Message_Message_t*)&msg);
 }
@@ -377,19 +1033,31 @@ void ItemStore_DeleteAllItems(ItemStore_ItemDef_t item) {
 void ItemStore_BeginEnumerate(ItemStore_ItemDef_t item,
                               ItemStore_Enumerator_t* enumerator,
                               ItemStore_EnumeratorStatusCb_t onDoneCb) {
+  enumerator->hasMoreItems = false;
+  enumerator->isOvertaken = false;
+  EnumeratorStatus_t* status = AllocateCursor(enumerator);
+  if (status == 0) {
+    ErrorHandler_RecoverableError(ERROR_CODE_ITEM_STORE);
+    onDoneCb(enumerator, false);
+    return;
+  }
+  status->statusCb = onDoneCb;
+  enumerator->enumeratorDetails = status;
   ItemStoreMessage_t msg = {
       .header.category = MESSAGE_BROKER_CATEGORY_ITEM_STORE,
       .header.id = ITEM_STORE_MESSAGE_BEGIN_ENUMERATE,
       .header.parameter1 = item,
       .data.enumerateParameter = enumerator};
-  _itemStore[item].enumeratorStatusCb = onDoneCb;
   Message_PublishAppMessage((Message_Message_t*)&msg);
 }
 
 void ItemStore_EndEnumerate(ItemStore_Enumerator_t* enumerator,
                             ItemStore_ItemDef_t item) {
-  ItemStoreInfo_t* itemStore = &_itemStore[item];
-  itemStore->currentState = IdleState;
+  EnumeratorStatus_t* status =
+      (EnumeratorStatus_t*)enumerator->enumeratorDetails;
+  if (status != 0 && status->owner == enumerator) {
+    status->owner = 0;
+  }
   enumerator->enumeratorDetails = 0;
   enumerator->hasMoreItems = false;
 }
@@ -397,14 +1065,20 @@ void ItemStore_EndEnumerate(ItemStore_Enumerator_t* enumerator,
 void BeginEnumerate(ItemStore_ItemDef_t item,
                     ItemStore_Enumerator_t* enumerator) {
   ItemStoreInfo_t* itemStoreInfo = &_itemStore[item];
-  EnumeratorStatus_t* enumeratorStatus = &itemStoreInfo->enumeratorStatus;
+  EnumeratorStatus_t* enumeratorStatus =
+      (EnumeratorStatus_t*)enumerator->enumeratorDetails;
+  // the enumerator was closed before the message was handled
+  if (enumeratorStatus == 0 || enumeratorStatus->owner != enumerator) {
+    return;
+  }
   enumeratorStatus->itemsRead = 0;
+  enumeratorStatus->generation = itemStoreInfo->generation;
+  InvalidateReadAhead(enumeratorStatus);
+  enumeratorStatus->firstItem = PageIndexEntryAt(itemStoreInfo, 0)->firstItem;
 
-  uint16_t itemsOnFullPage =
-      (FLASH_PAGE_SIZE - sizeof(PageHeader_t)) / itemStoreInfo->itemSize;
   enumeratorStatus->totalNrOfItems =
       (itemStoreInfo->currentPageNrOfItems +
-       itemStoreInfo->nrOfFullPages * itemsOnFullPage);
+       itemStoreInfo->nrOfFullPages * ITEMS_PER_PAGE(itemStoreInfo));
 
   enumeratorStatus->itemsToSkip = enumerator->startIndex;
   if (enumerator->startIndex < 0) {
@@ -415,96 +1089,62 @@ void BeginEnumerate(ItemStore_ItemDef_t item,
   }
   uint16_t startIndex = 0;
   uint8_t startPage = 0;
-  if (!FindEnumeratorStartPosition(itemStoreInfo, &startPage, &startIndex)) {
-    enumerator->enumeratorDetails = 0;
-    enumerator->hasMoreItems = false;
-    itemStoreInfo->enumeratorStatusCb(false);
+  if (!FindEnumeratorStartPosition(itemStoreInfo,
+                                   enumeratorStatus->itemsToSkip, &startPage,
+                                   &startIndex) ||
+      !InitEnumeratorStatus(startPage, itemStoreInfo, enumeratorStatus,
+                            startIndex)) {
+    ItemStore_EnumeratorStatusCb_t statusCb = enumeratorStatus->statusCb;
+    ItemStore_EndEnumerate(enumerator, item);
+    statusCb(enumerator, false);
     return;
   }
-
-  if (!InitEnumeratorStatus(startPage, itemStoreInfo, startIndex)) {
-    enumerator->enumeratorDetails = 0;
-    enumerator->hasMoreItems = false;
-    itemStoreInfo->enumeratorStatusCb(false);
-    return;
-  }
-  enumerator->enumeratorDetails = &itemStoreInfo->enumeratorStatus;
-  enumerator->hasMoreItems = (itemStoreInfo->enumeratorStatus.itemsOnPage >
-                              itemStoreInfo->enumeratorStatus.currentIndex);
-  itemStoreInfo->currentState = EnumeratingState;
-  itemStoreInfo->enumeratorStatusCb(true);
+  enumerator->hasMoreItems =
+      (enumeratorStatus->itemsOnPage > enumeratorStatus->currentIndex) &&
+      (enumeratorStatus->totalNrOfItems > enumeratorStatus->itemsToSkip);
+  enumeratorStatus->statusCb(enumerator, true);
 }
 
 static bool InitEnumeratorStatus(uint8_t page_nr,
                                  ItemStoreInfo_t* itemStore,
+                                 EnumeratorStatus_t* status,
                                  uint16_t startIndex) {
-  EnumeratorStatus_t* status = &itemStore->enumeratorStatus;
+  PageIndexEntry_t* entry = PAGE_INDEX_ENTRY(itemStore, page_nr);
   status->currentIndex = startIndex;  // current read index on this page
-  // read the page header to check if the page is valid and initialize
-  // the page id from it!
-  if (!Flash_Read(PAGE_ADDR(page_nr), (uint8_t*)&status->enumeratingPage,
-                  sizeof(PageHeader_t))) {
-    return false;
-  }
-  if (!BEGIN_TAG_IS_CONSISTENT(itemStore, status->enumeratingPage, page_nr)) {
-    return false;
-  }
-  // we are reading how many items are on the page that we enumerate
-  if (page_nr == itemStore->nextWritePageInfo.pageId) {
-    // this is the actual page where new items are inserted!
-    status->itemsOnPage = itemStore->currentPageNrOfItems;
-  } else {
-    // this is a full page
-    if (!COMPLETE_TAG_IS_CONSISTENT(itemStore, status->enumeratingPage,
-                                    page_nr)) {
-      return false;
-    }
-    status->itemsOnPage =
-        ((FLASH_PAGE_SIZE) - sizeof(PageHeader_t)) / itemStore->itemSize;
-  }
+  // the page header is reconstructed from the page index; the index was
+  // checked against the flash contents when the item store was initialized.
+  status->enumeratingPage.beginTag = itemStore->nextWritePageInfo;
+  status->enumeratingPage.beginTag.pageId = page_nr;
+  status->enumeratingPage.beginTag.blockId = entry->blockId;
+  status->itemsOnPage = entry->nrOfItems;
   // if this is not true, we read over the end of the item store
   return status->currentIndex < status->itemsOnPage;
 }
 
 static bool FindEnumeratorStartPosition(ItemStoreInfo_t* itemStore,
+                                        uint32_t itemsToSkip,
                                         uint8_t* startPage,
                                         uint16_t* startPosition) {
-  uint8_t page_nr = itemStore->oldestPageInfo.pageId;
-  int32_t skipping = itemStore->enumeratorStatus.itemsToSkip;
-  uint16_t itemsOnPage = 0;
-  do {
-    if (!Flash_Read(PAGE_ADDR(page_nr),
-                    (uint8_t*)&itemStore->enumeratorStatus.enumeratingPage,
-                    sizeof(PageHeader_t))) {
-      return false;
-    }
-    if (!BEGIN_TAG_IS_CONSISTENT(
-            itemStore, itemStore->enumeratorStatus.enumeratingPage, page_nr)) {
-      break;
-    }
-    // the page is complete
-    if (itemStore->enumeratorStatus.enumeratingPage.completeTag.magic ==
-        PAGE_MAGIC) {
-      itemsOnPage =
-          ((FLASH_PAGE_SIZE) - sizeof(PageHeader_t)) / itemStore->itemSize;
-      skipping -= itemsOnPage;
+  // the pages in use are the full pages and the page where the next write
+  // happens.
+  uint8_t lowPosition = 0;
+  uint8_t highPosition = itemStore->nrOfFullPages;
+  uint32_t startItem = PageIndexEntryAt(itemStore, 0)->firstItem + itemsToSkip;
+  // find the newest page whose first item is not after the start item
+  while (lowPosition < highPosition) {
+    uint8_t midPosition = (lowPosition + highPosition + 1) / 2;
+    if (PageIndexEntryAt(itemStore, midPosition)->firstItem <= startItem) {
+      lowPosition = midPosition;
     } else {
-      itemsOnPage = itemStore->currentPageNrOfItems;
-      skipping -= itemsOnPage;
-      break;
+      highPosition = midPosition - 1;
     }
-    if (skipping > 0) {
-      page_nr =
-          itemStore->enumeratorStatus.enumeratingPage.completeTag.nextPage;
-    }
-  } while (skipping >= 0);
-
-  if (skipping > 0) {
+  }
+  PageIndexEntry_t* entry = PageIndexEntryAt(itemStore, lowPosition);
+  if (startItem - entry->firstItem > entry->nrOfItems) {
     return false;
   }
-
-  *startPage = page_nr;
-  *startPosition = itemsOnPage + skipping;
+  *startPage = entry->pageId;
+  *startPosition = startItem - entry->firstItem;
   return true;
 }
 
@@ -523,20 +1163,30 @@ bool ItemStore_GetNext(ItemStore_Enumerator_t* enumerator,
 
   if (status->currentIndex == status->itemsOnPage) {
     // all items of this page are read; move on to the next page
+    uint8_t expectedBlockId =
+        (status->enumeratingPage.beginTag.blockId + 1) % MAX_BLOCK_INDEX;
     if (!InitEnumeratorStatus(
             NEXT_PAGE_NR(itemStoreInfo,
                          status->enumeratingPage.beginTag.pageId),
-            itemStoreInfo, 0)) {
+            itemStoreInfo, status, 0)) {
+      enumerator->hasMoreItems = false;
+      return false;
+    }
+    // the next page was erased and reused in the meantime
+    if (status->enumeratingPage.beginTag.blockId != expectedBlockId) {
+      enumerator->isOvertaken = true;
       enumerator->hasMoreItems = false;
       return false;
     }
   }
+  // the page at the cursor was erased while enumerating
+  if (IsOvertaken(itemStoreInfo, status)) {
+    enumerator->isOvertaken = true;
+    enumerator->hasMoreItems = false;
+    return false;
+  }
 
-  uint32_t readAddress = PAGE_ADDR(status->enumeratingPage.beginTag.pageId) +
-                         +sizeof(PageHeader_t) +
-                         status->currentIndex * itemStoreInfo->itemSize;
-  if (!Flash_Read(readAddress, (uint8_t*)data,
-                  status->enumeratingPage.beginTag.itemSize)) {
+  if (!ReadItem(itemStoreInfo, status, (uint8_t*)data)) {
     enumerator->hasMoreItems = false;
     return false;
   }
@@ -549,6 +1199,69 @@ bool ItemStore_GetNext(ItemStore_Enumerator_t* enumerator,
   return true;
 }
 
+bool ItemStore_Seek(ItemStore_Enumerator_t* enumerator, uint32_t index) {
+  EnumeratorStatus_t* status =
+      (EnumeratorStatus_t*)enumerator->enumeratorDetails;
+  if (status == 0 || status->owner != enumerator) {
+    return false;
+  }
+  ItemStoreInfo_t* itemStoreInfo =
+      &_itemStore[status->enumeratingPage.beginTag.itemId];
+  enumerator->hasMoreItems = false;
+  if (index >= status->totalNrOfItems) {
+    return false;
+  }
+  uint32_t oldestItem = PageIndexEntryAt(itemStoreInfo, 0)->firstItem;
+  uint32_t seekItem = status->firstItem + index;
+  // the requested item was erased since the enumeration started
+  if (status->generation != itemStoreInfo->generation ||
+      seekItem < oldestItem) {
+    enumerator->isOvertaken = true;
+    return false;
+  }
+  uint16_t startIndex = 0;
+  uint8_t startPage = 0;
+  if (!FindEnumeratorStartPosition(itemStoreInfo, seekItem - oldestItem,
+                                   &startPage, &startIndex) ||
+      !InitEnumeratorStatus(startPage, itemStoreInfo, status, startIndex)) {
+    return false;
+  }
+  status->itemsToSkip = index;
+  status->itemsRead = 0;
+  enumerator->hasMoreItems = true;
+  return true;
+}
+
+bool ItemStore_SeekKey(ItemStore_Enumerator_t* enumerator,
+                       uint32_t key,
+                       ItemStore_KeyOfItemCb_t keyOfItem,
+                       uint16_t maxGap,
+                       uint32_t* index) {
+  int32_t nrOfItems = ItemStore_Count(enumerator);
+  uint32_t foundKey;
+  if (nrOfItems <= 0 || !FindKeyedItem(enumerator, 0, keyOfItem, maxGap,
+                                       index, &foundKey)) {
+    return false;
+  }
+  // the found item is the newest keyed item not above the key seen so far;
+  // the answer is at or after it and at or before high.
+  uint32_t high = nrOfItems - 1;
+  while (*index < high && foundKey <= key) {
+    uint32_t middle = *index + (high - *index + 1) / 2;
+    uint32_t candidate;
+    uint32_t candidateKey;
+    if (FindKeyedItem(enumerator, middle, keyOfItem, maxGap, &candidate,
+                      &candidateKey) &&
+        candidateKey <= key) {
+      *index = candidate;
+      foundKey = candidateKey;
+    } else {
+      high = middle - 1;
+    }
+  }
+  return ItemStore_Seek(enumerator, *index);
+}
+
 int32_t ItemStore_Count(ItemStore_Enumerator_t* enumerator) {
   if (enumerator->enumeratorDetails == 0) {
     return -1;
@@ -558,6 +1271,28 @@ int32_t ItemStore_Count(ItemStore_Enumerator_t* enumerator) {
   return status->totalNrOfItems;
 }
 
+static bool FindKeyedItem(ItemStore_Enumerator_t* enumerator,
+                          uint32_t index,
+                          ItemStore_KeyOfItemCb_t keyOfItem,
+                          uint16_t maxGap,
+                          uint32_t* keyedIndex,
+                          uint32_t* key) {
+  if (!ItemStore_Seek(enumerator, index)) {
+    return false;
+  }
+  ItemStore_ItemStruct_t item;
+  for (uint32_t i = 0; i <= maxGap && enumerator->hasMoreItems; i++) {
+    if (!ItemStore_GetNext(enumerator, &item)) {
+      return false;
+    }
+    if (keyOfItem(&item, key)) {
+      *keyedIndex = index + i;
+      return true;
+    }
+  }
+  return false;
+}
+
 // Implement add item. Writing to flash is synchronous. In case a page gets full
 // an erase may be required to make another page free for next insert.
 // This is then an asynchronous operation.
@@ -565,19 +1300,31 @@ static bool AddItem(ItemStore_ItemDef_t item,
                     const ItemStore_ItemStruct_t* data) {
   ItemStoreInfo_t* itemStoreInfo = &_itemStore[item];
   PageHeader_t header;
-  uint32_t pageAddress = PAGE_ADDR(itemStoreInfo->nextWritePageInfo.pageId);
-  if (!Flash_Read(pageAddress, (uint8_t*)&header, sizeof(header))) {
+  uint32_t pageAddress =
+      PAGE_ADDRESS(itemStoreInfo, itemStoreInfo->nextWritePageInfo.pageId);
+  if (!itemStoreInfo->backend->read(pageAddress, (uint8_t*)&header,
+                                    sizeof(header))) {
     return false;
   }
   // first write to this page
   if (HasNoData((uint8_t*)&header, sizeof(header))) {
+    itemStoreInfo->nextWritePageInfo.eraseCount =
+        PAGE_INDEX_ENTRY(itemStoreInfo,
+                         itemStoreInfo->nextWritePageInfo.pageId)
+            ->eraseCount;
     // write the page header start tag
-    if (!Flash_Write(pageAddress, (uint8_t*)&itemStoreInfo->nextWritePageInfo,
-                     sizeof(PageBeginTag_t))) {
+    if (!itemStoreInfo->backend->write(
+            pageAddress, (uint8_t*)&itemStoreInfo->nextWritePageInfo,
+            sizeof(PageBeginTag_t))) {
       return false;
     }
     itemStoreInfo->currentPageNrOfItems = 0;
-    return WriteItem(itemStoreInfo, data);
+    InitWritePageIndexEntry(itemStoreInfo);
+    if (!WriteItem(itemStoreInfo, data)) {
+      return false;
+    }
+    PreEraseNextPage(itemStoreInfo);
+    return true;
   }
   // the page is already in use
   if (HasNoData((uint8_t*)&header.completeTag, sizeof(PageCompleteTag_t))) {
@@ -590,9 +1337,114 @@ static bool AddItem(ItemStore_ItemDef_t item,
   return false;
 }
 
+static void AddItems(ItemStore_ItemDef_t item, ItemStore_ItemBatch_t* batch) {
+  const uint8_t* items = batch->items;
+  const StorageBackend_t* backend = _itemStore[item].backend;
+  uint8_t itemSize = _itemStore[item].itemSize;
+  // the slice of this message ends with the current write page
+  uint16_t itemsLeftOnPage =
+      ITEMS_PER_PAGE(&_itemStore[item]) - _itemStore[item].currentPageNrOfItems;
+  bool success = true;
+  uint8_t itemsInSession = 0;
+  backend->beginWriteSession();
+  while (batch->nrOfItemsWritten < batch->nrOfItems && itemsLeftOnPage > 0) {
+    // give CPU2 the chance to access the flash
+    if (itemsInSession == WRITE_SESSION_NR_OF_ITEMS) {
+      backend->endWriteSession();
+      backend->beginWriteSession();
+      itemsInSession = 0;
+    }
+    const ItemStore_ItemStruct_t* data =
+        (const ItemStore_ItemStruct_t*)&items[batch->nrOfItemsWritten *
+                                              itemSize];
+    if (!AddItem(item, data)) {
+      success = false;
+      break;
+    }
+    batch->nrOfItemsWritten++;
+    itemsInSession++;
+    itemsLeftOnPage--;
+    // the erase has taken over the flash; no more writes are possible
+    if (_messageListener.currentMessageHandlerCb == ListenerErasingState) {
+      break;
+    }
+  }
+  backend->endWriteSession();
+  if (success && batch->nrOfItemsWritten < batch->nrOfItems) {
+    ItemStoreMessage_t msg = {
+        .header.category = MESSAGE_BROKER_CATEGORY_ITEM_STORE,
+        .header.id = ITEM_STORE_MESSAGE_ADD_ITEMS,
+        .header.parameter1 = item,
+        .data.addItemsParameter = batch};
+    if (_messageListener.currentMessageHandlerCb == ListenerErasingState) {
+      // the interrupted batch is continued before any later request
+      DeferRequest(&msg, true);
+    } else {
+      Message_PublishAppMessage((Message_Message_t*)&msg);
+    }
+    return;
+  }
+  if (!success) {
+    ErrorHandler_RecoverableError(ERROR_CODE_ITEM_STORE);
+  }
+  if (batch->onDoneCb != 0) {
+    batch->onDoneCb(success);
+  }
+}
+
+static void DeferRequest(const ItemStoreMessage_t* message, bool isFirst) {
+  if (_nrOfDeferredRequests == COUNT_OF(_deferredRequests)) {
+    RejectRequest(message);
+    return;
+  }
+  uint8_t position = isFirst ? 0 : _nrOfDeferredRequests;
+  memmove(&_deferredRequests[position + 1], &_deferredRequests[position],
+          (_nrOfDeferredRequests - position) * sizeof(ItemStoreMessage_t));
+  _deferredRequests[position] = *message;
+  _nrOfDeferredRequests++;
+}
+
+static void RejectRequest(const ItemStoreMessage_t* message) {
+  ErrorHandler_RecoverableError(ERROR_CODE_ITEM_STORE);
+  if (message->header.id == ITEM_STORE_MESSAGE_ADD_ITEMS) {
+    ItemStore_ItemBatch_t* batch = message->data.addItemsParameter;
+    if (batch->onDoneCb != 0) {
+      batch->onDoneCb(false);
+    }
+  } else if (message->header.id == ITEM_STORE_MESSAGE_BEGIN_ENUMERATE) {
+    ItemStore_Enumerator_t* enumerator = message->data.enumerateParameter;
+    EnumeratorStatus_t* status =
+        (EnumeratorStatus_t*)enumerator->enumeratorDetails;
+    // the enumerator may have been closed in the meantime
+    if (status != 0 && status->owner == enumerator) {
+      ItemStore_EnumeratorStatusCb_t statusCb = status->statusCb;
+      ItemStore_EndEnumerate(enumerator, message->header.parameter1);
+      statusCb(enumerator, false);
+    }
+  }
+}
+
+static void HandleDeferredRequests() {
+  while (_nrOfDeferredRequests > 0 &&
+         _messageListener.currentMessageHandlerCb == ListenerIdleState) {
+    ItemStoreMessage_t request = _deferredRequests[0];
+    _nrOfDeferredRequests--;
+    memmove(&_deferredRequests[0], &_deferredRequests[1],
+            _nrOfDeferredRequests * sizeof(ItemStoreMessage_t));
+    ListenerIdleState((Message_Message_t*)&request);
+  }
+}
+
 static void InitItemStore(ItemStoreInfo_t* itemStoreInfo,
                           ItemStore_ItemDef_t id) {
-  itemStoreInfo->currentPageInfo.magic = PAGE_MAGIC;
+  // the counts are rebuilt from the page headers
+  itemStoreInfo->nrOfFullPages = 0;
+  itemStoreInfo->currentPageNrOfItems = 0;
+  itemStoreInfo->hasLegacyPage = false;
+  itemStoreInfo->legacyLogPages = 0;
+  itemStoreInfo->newestLegacyLogPage = itemStoreInfo->firstPage;
+  itemStoreInfo->currentPageInfo.magic = PAGE_BEGIN_MAGIC;
+  itemStoreInfo->currentPageInfo.eraseCount = 0;
   itemStoreInfo->currentPageInfo.pageId = itemStoreInfo->firstPage;
   itemStoreInfo->currentPageInfo.blockId = 0;
   itemStoreInfo->currentPageInfo.itemId = id;
@@ -600,22 +1452,66 @@ static void InitItemStore(ItemStoreInfo_t* itemStoreInfo,
   // in case we have no valid data we still need a valid initialization
   itemStoreInfo->nextWritePageInfo = itemStoreInfo->currentPageInfo;
   itemStoreInfo->oldestPageInfo = itemStoreInfo->currentPageInfo;
+  itemStoreInfo->nrOfRecoveryReads = 0;
   PageHeader_t pageHeader = {0};
+  // the erase counts of empty pages are not persisted
+  uint64_t emptyPages = 0;
+  uint16_t maxEraseCount = 0;
+  // the newest and oldest page start at the first page of this item store
+  bool isFirstPage = true;
   for (uint8_t i = 0; i < itemStoreInfo->nrOfPages; i++) {
     uint8_t actualPageId = i + itemStoreInfo->firstPage;
-    Flash_Read(PAGE_ADDR(actualPageId), (uint8_t*)&pageHeader,
-               sizeof(pageHeader));
+    PageIndexEntry_t* entry = &itemStoreInfo->pageIndex[i];
+    entry->pageId = actualPageId;
+    entry->blockId = 0;
+    entry->nrOfItems = 0;
+    entry->firstItem = 0;
+    itemStoreInfo->backend->read(PAGE_ADDRESS(itemStoreInfo, actualPageId),
+                                 (uint8_t*)&pageHeader, sizeof(pageHeader));
+    itemStoreInfo->nrOfRecoveryReads++;
     if (HasNoData((uint8_t*)&pageHeader,
                   sizeof(pageHeader))) {  // no valid data
+      emptyPages |= 1ULL << i;
+      continue;
+    }
+    // the page was used by the other item store before the wear leveling
+    // mode was changed
+    if (pageHeader.beginTag.magic == PAGE_BEGIN_MAGIC &&
+        pageHeader.beginTag.itemId != id) {
+      ReclaimPage(itemStoreInfo, actualPageId);
+      emptyPages |= 1ULL << i;
+      continue;
+    }
+    // the items of an older firmware are not enumerated by this firmware
+    if (itemStoreInfo->isLegacyLogKept &&
+        pageHeader.beginTag.magic == PAGE_BEGIN_MAGIC &&
+        pageHeader.beginTag.eraseCount == LEGACY_ERASE_COUNT) {
+      KeepLegacyLogPage(itemStoreInfo, actualPageId, &pageHeader);
+      emptyPages |= 1ULL << i;
+      continue;
+    }
+    // the page was written by an older firmware with another item size
+    if (pageHeader.beginTag.magic == PAGE_BEGIN_MAGIC &&
+        pageHeader.beginTag.itemSize != itemStoreInfo->itemSize) {
+      KeepLegacyPage(itemStoreInfo, actualPageId, &pageHeader.beginTag);
+      emptyPages |= 1ULL << i;
       continue;
     }
     if (!BEGIN_TAG_IS_CONSISTENT(itemStoreInfo, pageHeader, actualPageId)) {
       ErrorHandler_RecoverableErrorExtended(ERROR_CODE_ITEM_STORE,
                                             actualPageId);
     }
+    if (pageHeader.beginTag.eraseCount != LEGACY_ERASE_COUNT) {
+      entry->eraseCount = pageHeader.beginTag.eraseCount;
+    }
+    if (entry->eraseCount > maxEraseCount) {
+      maxEraseCount = entry->eraseCount;
+    }
 
     itemStoreInfo->currentPageInfo = pageHeader.beginTag;
-    UpdateNewestOldestPage(itemStoreInfo, i == 0);
+    UpdateNewestOldestPage(itemStoreInfo, isFirstPage);
+    isFirstPage = false;
+    entry->blockId = pageHeader.beginTag.blockId;
 
     if (!HasNoData(
             (uint8_t*)&pageHeader.completeTag,  // page is marked complete
@@ -626,20 +1522,57 @@ static void InitItemStore(ItemStoreInfo_t* itemStoreInfo,
                                               actualPageId);
       }
       itemStoreInfo->nrOfFullPages++;
+      // the complete tag summarizes the page; no need to read its items
+      entry->nrOfItems = ITEMS_PER_PAGE(itemStoreInfo);
     } else {  // there is remaining space
       itemStoreInfo->currentPageNrOfItems =
-          CountItemsOnCurrentPage(itemStoreInfo);
+          CountItemsOnPage(itemStoreInfo, actualPageId);
+      entry->nrOfItems = itemStoreInfo->currentPageNrOfItems;
+      ClearTornItem(itemStoreInfo);
       // Add the close tag if it was not written properly
       ClosePageIfFull(itemStoreInfo);
     }
   }
+  // after a reset, empty pages are assumed to be as worn as the most worn
+  // page; after a delete the counts in RAM are still valid.
+  for (uint8_t i = 0; i < itemStoreInfo->nrOfPages; i++) {
+    PageIndexEntry_t* entry = &itemStoreInfo->pageIndex[i];
+    if ((emptyPages & (1ULL << i)) != 0 && entry->eraseCount < maxEraseCount) {
+      entry->eraseCount = maxEraseCount;
+    }
+  }
+  // the items of this firmware are written after the kept page
+  if (itemStoreInfo->hasLegacyPage &&
+      itemStoreInfo->nextWritePageInfo.pageId == itemStoreInfo->legacyPage) {
+    itemStoreInfo->nextWritePageInfo.pageId =
+        NEXT_PAGE_NR(itemStoreInfo, itemStoreInfo->legacyPage);
+    itemStoreInfo->oldestPageInfo = itemStoreInfo->nextWritePageInfo;
+  }
+  // the items of this firmware are written after the legacy log; its oldest
+  // page is given up if there is no empty page.
+  if (itemStoreInfo->legacyLogPages != 0) {
+    FindNewestLegacyLogPage(itemStoreInfo);
+    if (isFirstPage) {
+      PageCompleteTag_t legacyLogEnd = {
+          .nextPage =
+              NEXT_PAGE_NR(itemStoreInfo, itemStoreInfo->newestLegacyLogPage),
+          .nextPageId = 0};
+      itemStoreInfo->oldestPageInfo.pageId = legacyLogEnd.nextPage;
+      AdjustNextWritePage(itemStoreInfo, &legacyLogEnd);
+      AssignPageIndexOrdinals(itemStoreInfo);
+      return;
+    }
+  }
   // If the page to write the data is full we have to move it to the next
   // free page and eventually erase the oldest page
-  Flash_Read(PAGE_ADDR(itemStoreInfo->nextWritePageInfo.pageId),
-             (uint8_t*)&pageHeader, sizeof pageHeader);
+  itemStoreInfo->backend->read(
+      PAGE_ADDRESS(itemStoreInfo, itemStoreInfo->nextWritePageInfo.pageId),
+      (uint8_t*)&pageHeader, sizeof pageHeader);
+  itemStoreInfo->nrOfRecoveryReads++;
   if (pageHeader.completeTag.magic == PAGE_MAGIC) {
     AdjustNextWritePage(itemStoreInfo, &pageHeader.completeTag);
   }
+  AssignPageIndexOrdinals(itemStoreInfo);
 }
 
 static bool WriteItem(ItemStoreInfo_t* itemStoreInfo,
@@ -648,26 +1581,41 @@ static bool WriteItem(ItemStoreInfo_t* itemStoreInfo,
   ASSERT(
       (itemStoreInfo->firstPage <= itemStoreInfo->nextWritePageInfo.pageId) &&
       (itemStoreInfo->lastPage >= itemStoreInfo->nextWritePageInfo.pageId));
-  uint32_t pageAddress = PAGE_ADDR(itemStoreInfo->nextWritePageInfo.pageId);
+  uint32_t pageAddress =
+      PAGE_ADDRESS(itemStoreInfo, itemStoreInfo->nextWritePageInfo.pageId);
   uint32_t writeAddress =
       pageAddress + sizeof(PageHeader_t) +
       itemStoreInfo->currentPageNrOfItems * itemStoreInfo->itemSize;
-  if (!Flash_Write(writeAddress, (uint8_t*)data, itemStoreInfo->itemSize)) {
+  if (!ProgramItem(itemStoreInfo, writeAddress, (const uint8_t*)data)) {
     return false;
   }
   itemStoreInfo->currentPageNrOfItems += 1;
+  PAGE_INDEX_ENTRY(itemStoreInfo, itemStoreInfo->nextWritePageInfo.pageId)
+      ->nrOfItems += 1;
+  itemStoreInfo->nextItemOrdinal += 1;
   return true;
 }
 
+static bool ProgramItem(ItemStoreInfo_t* itemStoreInfo,
+                        uint32_t address,
+                        const uint8_t* data) {
+  uint8_t itemSize = itemStoreInfo->itemSize;
+  if (itemSize <= ITEM_HEAD_SIZE) {
+    return itemStoreInfo->backend->write(address, data, itemSize);
+  }
+  // the item is complete once its head is programmed
+  return itemStoreInfo->backend->write(address + ITEM_HEAD_SIZE,
+                                       data + ITEM_HEAD_SIZE,
+                                       itemSize - ITEM_HEAD_SIZE) &&
+         itemStoreInfo->backend->write(address, data, ITEM_HEAD_SIZE);
+}
+
 static bool ClosePageIfFull(ItemStoreInfo_t* itemStoreInfo) {
   uint8_t actualPage = itemStoreInfo->nextWritePageInfo.pageId;
-  uint32_t pageAddress = PAGE_ADDR(actualPage);
+  uint32_t pageAddress = PAGE_ADDRESS(itemStoreInfo, actualPage);
 
-  uint32_t writeAddress =
-      pageAddress + sizeof(PageHeader_t) +
-      itemStoreInfo->currentPageNrOfItems * itemStoreInfo->itemSize;
   // no new item fits in this page
-  if (writeAddress + itemStoreInfo->itemSize > pageAddress + FLASH_PAGE_SIZE) {
+  if (itemStoreInfo->currentPageNrOfItems >= ITEMS_PER_PAGE(itemStoreInfo)) {
     uint8_t nextPage = NEXT_PAGE_NR(itemStoreInfo, actualPage);
     // Prepare close tag and write to flash
     PageCompleteTag_t completeTag = {
@@ -677,11 +1625,14 @@ static bool ClosePageIfFull(ItemStoreInfo_t* itemStoreInfo) {
             (itemStoreInfo->nextWritePageInfo.blockId + 1) % MAX_BLOCK_INDEX,
         .nrOfItems = itemStoreInfo->currentPageNrOfItems};
 
-    if (!Flash_Write(pageAddress + sizeof(PageBeginTag_t),
-                     (uint8_t*)&completeTag, sizeof(PageCompleteTag_t))) {
+    if (!itemStoreInfo->backend->write(pageAddress + sizeof(PageBeginTag_t),
+                                       (uint8_t*)&completeTag,
+                                       sizeof(PageCompleteTag_t))) {
       return false;
     }
     itemStoreInfo->nrOfFullPages++;
+    // the items of this page are now counted as a full page
+    itemStoreInfo->currentPageNrOfItems = 0;
 
     // adjust currentPageInfo to point to the next page
     itemStoreInfo->nextWritePageInfo.blockId = completeTag.nextPageId;
@@ -703,12 +1654,9 @@ static void UpdateNewestOldestPage(ItemStoreInfo_t* itemStoreInfo,
   }
   uint8_t nrOfPages = itemStoreInfo->nrOfPages;
   uint8_t currentBlockId = itemStoreInfo->currentPageInfo.blockId;
-  uint8_t newestBlockId = itemStoreInfo->nextWritePageInfo.blockId;
   uint8_t oldestBlockId = itemStoreInfo->oldestPageInfo.blockId;
-  if (((currentBlockId > newestBlockId) &&  // no wrap around
-       ((currentBlockId - newestBlockId) < nrOfPages)) ||
-      ((currentBlockId < newestBlockId) &&  // there was a wrap around
-       ((newestBlockId - currentBlockId) > nrOfPages))) {
+  if (IsNewerBlock(itemStoreInfo, currentBlockId,
+                   itemStoreInfo->nextWritePageInfo.blockId)) {
     itemStoreInfo->nextWritePageInfo = itemStoreInfo->currentPageInfo;
   } else if (((currentBlockId < oldestBlockId) &&
               ((oldestBlockId - currentBlockId) < nrOfPages)) ||
@@ -718,20 +1666,151 @@ static void UpdateNewestOldestPage(ItemStoreInfo_t* itemStoreInfo,
   }
 }
 
-static uint32_t CountItemsOnCurrentPage(ItemStoreInfo_t* itemStoreInfo) {
-  uint32_t pageStart = PAGE_ADDR(itemStoreInfo->currentPageInfo.pageId);
-  uint32_t address = pageStart + sizeof(PageHeader_t);
-  uint16_t nrOfItems = 0;
+static bool IsNewerBlock(const ItemStoreInfo_t* itemStoreInfo,
+                         uint8_t blockId,
+                         uint8_t otherBlockId) {
+  uint8_t nrOfPages = itemStoreInfo->nrOfPages;
+  return ((blockId > otherBlockId) &&  // no wrap around
+          ((blockId - otherBlockId) < nrOfPages)) ||
+         ((blockId < otherBlockId) &&  // there was a wrap around
+          ((otherBlockId - blockId) > nrOfPages));
+}
+
+static void KeepLegacyPage(ItemStoreInfo_t* itemStoreInfo,
+                           uint8_t pageNr,
+                           const PageBeginTag_t* beginTag) {
+  // a page that was opened without its first item holds nothing to keep
+  uint8_t firstItem[sizeof(ItemStore_ItemStruct_t)];
+  uint8_t itemSize = beginTag->itemSize < sizeof firstItem
+                         ? beginTag->itemSize
+                         : sizeof firstItem;
+  if (!itemStoreInfo->backend->read(
+          PAGE_ADDRESS(itemStoreInfo, pageNr) + sizeof(PageHeader_t),
+          firstItem, itemSize) ||
+      HasNoData(firstItem, itemSize)) {
+    ReclaimPage(itemStoreInfo, pageNr);
+    return;
+  }
+  if (itemStoreInfo->hasLegacyPage &&
+      !IsNewerBlock(itemStoreInfo, beginTag->blockId,
+                    itemStoreInfo->legacyBlockId)) {
+    ReclaimPage(itemStoreInfo, pageNr);
+    return;
+  }
+  if (itemStoreInfo->hasLegacyPage) {
+    ReclaimPage(itemStoreInfo, itemStoreInfo->legacyPage);
+  }
+  itemStoreInfo->hasLegacyPage = true;
+  itemStoreInfo->legacyPage = pageNr;
+  itemStoreInfo->legacyBlockId = beginTag->blockId;
+  itemStoreInfo->legacyItemSize = beginTag->itemSize;
+}
+
+static void KeepLegacyLogPage(ItemStoreInfo_t* itemStoreInfo,
+                              uint8_t pageNr,
+                              const PageHeader_t* header) {
+  // a page that was opened without its first item holds nothing to keep
+  uint8_t firstItem[sizeof(ItemStore_ItemStruct_t)];
+  if (header->beginTag.itemSize != itemStoreInfo->itemSize ||
+      !itemStoreInfo->backend->read(
+          PAGE_ADDRESS(itemStoreInfo, pageNr) + sizeof(PageHeader_t),
+          firstItem, itemStoreInfo->itemSize) ||
+      HasNoData(firstItem, itemStoreInfo->itemSize)) {
+    ReclaimPage(itemStoreInfo, pageNr);
+    return;
+  }
+  PageIndexEntry_t* entry = PAGE_INDEX_ENTRY(itemStoreInfo, pageNr);
+  entry->blockId = header->beginTag.blockId;
+  if (header->completeTag.magic == PAGE_MAGIC) {
+    entry->nrOfItems = ITEMS_PER_PAGE(itemStoreInfo);
+  } else {
+    entry->nrOfItems = CountItemsOnPage(itemStoreInfo, pageNr);
+  }
+  itemStoreInfo->legacyLogPages |= 1ULL << (pageNr - itemStoreInfo->firstPage);
+}
+
+static void FindNewestLegacyLogPage(ItemStoreInfo_t* itemStoreInfo) {
+  for (uint8_t i = 0; i < itemStoreInfo->nrOfPages; i++) {
+    if ((itemStoreInfo->legacyLogPages & (1ULL << i)) == 0) {
+      continue;
+    }
+    // no other legacy page was opened after this page
+    uint8_t blockId = itemStoreInfo->pageIndex[i].blockId;
+    bool isNewest = true;
+    for (uint8_t j = 0; j < itemStoreInfo->nrOfPages && isNewest; j++) {
+      uint8_t distance =
+          (itemStoreInfo->pageIndex[j].blockId + MAX_BLOCK_INDEX - blockId) %
+          MAX_BLOCK_INDEX;
+      isNewest = (itemStoreInfo->legacyLogPages & (1ULL << j)) == 0 ||
+                 distance == 0 || distance >= LEGACY_LOG_NR_OF_PAGES;
+    }
+    if (isNewest) {
+      itemStoreInfo->newestLegacyLogPage = i + itemStoreInfo->firstPage;
+      return;
+    }
+  }
+}
+
+static bool TakeLegacyLogPage(ItemStoreInfo_t* itemStoreInfo, uint8_t pageNr) {
+  uint64_t pageBit = 1ULL << (pageNr - itemStoreInfo->firstPage);
+  if ((itemStoreInfo->legacyLogPages & pageBit) == 0) {
+    return false;
+  }
+  itemStoreInfo->legacyLogPages &= ~pageBit;
+  return true;
+}
+
+static bool OlderLegacyLogPage(const ItemStoreInfo_t* itemStoreInfo,
+                               uint8_t pageNr,
+                               uint8_t* olderPageNr) {
+  *olderPageNr = pageNr == itemStoreInfo->firstPage ? itemStoreInfo->lastPage
+                                                     : pageNr - 1;
+  return *olderPageNr != itemStoreInfo->newestLegacyLogPage &&
+         (itemStoreInfo->legacyLogPages &
+          (1ULL << (*olderPageNr - itemStoreInfo->firstPage))) != 0;
+}
+
+static uint32_t CountItemsOnPage(ItemStoreInfo_t* itemStoreInfo,
+                                 uint8_t pageNr) {
+  uint32_t firstItemAddress =
+      PAGE_ADDRESS(itemStoreInfo, pageNr) + sizeof(PageHeader_t);
+  uint8_t itemSize = itemStoreInfo->itemSize;
+  // items below lower are written; items at and above upper are erased
+  uint16_t lower = 0;
+  uint16_t upper = ITEMS_PER_PAGE(itemStoreInfo);
   uint8_t readBuffer[sizeof(ItemStore_ItemStruct_t)];
-  while (address < (pageStart + FLASH_PAGE_SIZE)) {
-    Flash_Read(address, readBuffer, itemStoreInfo->itemSize);
-    if (HasNoData(readBuffer, itemStoreInfo->itemSize)) {
-      return nrOfItems;
+  while (lower < upper) {
+    uint16_t probe = lower + (upper - lower) / 2;
+    itemStoreInfo->backend->read(firstItemAddress + probe * itemSize,
+                                 readBuffer, itemSize);
+    itemStoreInfo->nrOfRecoveryReads++;
+    if (HasNoData(readBuffer, itemSize)) {
+      upper = probe;
+    } else {
+      lower = probe + 1;
     }
-    nrOfItems += 1;
-    address += itemStoreInfo->itemSize;
   }
-  return nrOfItems;
+  return lower;
+}
+
+static void ClearTornItem(ItemStoreInfo_t* itemStoreInfo) {
+  // an item of a single double word is programmed completely or not at all
+  if (itemStoreInfo->itemSize <= ITEM_HEAD_SIZE ||
+      itemStoreInfo->currentPageNrOfItems == 0) {
+    return;
+  }
+  uint32_t itemAddress =
+      PAGE_ADDRESS(itemStoreInfo, itemStoreInfo->currentPageInfo.pageId) +
+      sizeof(PageHeader_t) +
+      (itemStoreInfo->currentPageNrOfItems - 1) * itemStoreInfo->itemSize;
+  uint8_t head[ITEM_HEAD_SIZE];
+  itemStoreInfo->backend->read(itemAddress, head, sizeof head);
+  itemStoreInfo->nrOfRecoveryReads++;
+  if (!HasNoData(head, sizeof head)) {
+    return;
+  }
+  const uint8_t zeros[sizeof(ItemStore_ItemStruct_t)] = {0};
+  ProgramItem(itemStoreInfo, itemAddress, zeros);
 }
 
 static bool HasNoData(const uint8_t* buffer, uint8_t nrOfBytes) {
@@ -747,8 +1826,9 @@ static bool AdjustNextWritePage(ItemStoreInfo_t* itemStoreInfo,
                                 PageCompleteTag_t* completeTag) {
   PageHeader_t header;
   // check if next page is empty
-  if (!Flash_Read(PAGE_ADDR(completeTag->nextPage), (uint8_t*)&header,
-                  sizeof header)) {
+  if (!itemStoreInfo->backend->read(
+          PAGE_ADDRESS(itemStoreInfo, completeTag->nextPage),
+          (uint8_t*)&header, sizeof header)) {
     return false;
   }
   // initialize the current item header such that it is ready to be written
@@ -758,47 +1838,360 @@ static bool AdjustNextWritePage(ItemStoreInfo_t* itemStoreInfo,
 
   // if the page is empty nothing needs to be done
   if (HasNoData((uint8_t*)&header, sizeof(header))) {
+    InitWritePageIndexEntry(itemStoreInfo);
     return true;
   }
 
-  // get the new oldest page information
-  if (!Flash_Read(PAGE_ADDR(header.completeTag.nextPage), (uint8_t*)&header,
-                  sizeof header)) {
+  if (itemStoreInfo->hasLegacyPage &&
+      itemStoreInfo->legacyPage == completeTag->nextPage) {
+    // the kept page of an older firmware is given up
+    itemStoreInfo->hasLegacyPage = false;
+  } else if (!TakeLegacyLogPage(itemStoreInfo, completeTag->nextPage)) {
+    // the oldest page is removed
+    ASSERT(itemStoreInfo->oldestPageInfo.pageId == completeTag->nextPage);
+    if (!ReleaseOldestPage(itemStoreInfo, &header)) {
+      return false;
+    }
+  }
+  // the erased page becomes the new write page
+  InitWritePageIndexEntry(itemStoreInfo);
+
+  // Erase the next page; during this time, no other request
+  // will be handled. This must not be asynchronous!
+  ItemStore_EraseParameters_t parameters = {
+      .itemStore = itemStoreInfo->currentPageInfo.itemId,
+      .nrOfPages = 1,
+      .reinit = false,
+      .pageNumber = completeTag->nextPage};
+  _eraseStats.nrOfBlockingRollovers++;
+  _isRolloverBlocked = true;
+  _rolloverErasedPages = 0;
+  if (!EnqueueErase(&parameters, 0)) {
     return false;
   }
-  // the oldest page is removed
+  // switch the state to make sure that no request is handled anymore until
+  // the erase is finished
+  if (_messageListener.currentMessageHandlerCb != ListenerErasingState) {
+    StartNextErase();
+  }
+  return true;
+}
 
-  ASSERT(itemStoreInfo->oldestPageInfo.pageId == completeTag->nextPage);
-  ASSERT(itemStoreInfo->firstPage <= completeTag->nextPage);
-  ASSERT(itemStoreInfo->lastPage >= completeTag->nextPage);
+static bool ReleaseOldestPage(ItemStoreInfo_t* itemStoreInfo,
+                              const PageHeader_t* oldestHeader) {
+  uint8_t oldestPage = itemStoreInfo->oldestPageInfo.pageId;
+  ASSERT(itemStoreInfo->firstPage <= oldestPage);
+  ASSERT(itemStoreInfo->lastPage >= oldestPage);
 
-  // the oldest entry is removed -> read next oldest page
+  // get the new oldest page information
+  PageHeader_t header;
+  if (!itemStoreInfo->backend->read(
+          PAGE_ADDRESS(itemStoreInfo, oldestHeader->completeTag.nextPage),
+          (uint8_t*)&header, sizeof header)) {
+    return false;
+  }
   itemStoreInfo->oldestPageInfo = header.beginTag;
   // this page must not be counted as full anymore
   itemStoreInfo->nrOfFullPages--;
+  // open enumerators that still read this page are overtaken
+  PageIndexEntry_t* entry = PAGE_INDEX_ENTRY(itemStoreInfo, oldestPage);
+  entry->blockId = INVALID_BLOCK_ID;
+  entry->nrOfItems = 0;
+  return true;
+}
 
-  // Erase the next page; during this time, no other request
-  // will be handled. This must not be asynchronous!
-  _eraseParameters.itemStore = itemStoreInfo->currentPageInfo.itemId;
-  _eraseParameters.nrOfPages = 1;
-  _eraseParameters.reinit = false;
-  _eraseParameters.pageNumber = completeTag->nextPage;
-  // swtitch the state to make sure that no request is handled anymore until the
-  // erase is finished
+static void PreEraseNextPage(ItemStoreInfo_t* itemStoreInfo) {
+  uint8_t nextPage =
+      NEXT_PAGE_NR(itemStoreInfo, itemStoreInfo->nextWritePageInfo.pageId);
+  if (!itemStoreInfo->isPreEraseEnabled) {
+    return;
+  }
+  // the legacy log is overwritten before the oldest items of this firmware
+  if (TakeLegacyLogPage(itemStoreInfo, nextPage)) {
+    _eraseStats.nrOfPreErasedPages++;
+    ReclaimPage(itemStoreInfo, nextPage);
+    return;
+  }
+  // the next page is free until the item store wraps around
+  if (itemStoreInfo->nrOfFullPages == 0 ||
+      itemStoreInfo->oldestPageInfo.pageId != nextPage) {
+    return;
+  }
+  PageHeader_t header;
+  if (!itemStoreInfo->backend->read(PAGE_ADDRESS(itemStoreInfo, nextPage),
+                                    (uint8_t*)&header, sizeof header) ||
+      !ReleaseOldestPage(itemStoreInfo, &header)) {
+    return;
+  }
+  _eraseStats.nrOfPreErasedPages++;
+  ReclaimPage(itemStoreInfo, nextPage);
+}
+
+static bool EnqueueErase(const ItemStore_EraseParameters_t* parameters,
+                         uint8_t nrOfRequests) {
+  EraseRequest_t request = {.parameters = *parameters,
+                            .nrOfRequests = nrOfRequests};
+  uint8_t i = 0;
+  while (i < _eraseQueueDepth) {
+    EraseRequest_t* queued = &_eraseQueue[i];
+    if (CoversErase(&queued->parameters, &request.parameters)) {
+      queued->parameters.reinit |= request.parameters.reinit;
+      queued->nrOfRequests += request.nrOfRequests;
+      _eraseStats.nrOfCoalescedRequests++;
+      return true;
+    }
+    if (CoversErase(&request.parameters, &queued->parameters)) {
+      request.parameters.reinit |= queued->parameters.reinit;
+      request.nrOfRequests += queued->nrOfRequests;
+      _eraseStats.nrOfCoalescedRequests++;
+      _eraseQueueDepth--;
+      memmove(queued, queued + 1,
+              (_eraseQueueDepth - i) * sizeof(EraseRequest_t));
+      continue;
+    }
+    i++;
+  }
+  if (_eraseQueueDepth == COUNT_OF(_eraseQueue)) {
+    ErrorHandler_RecoverableError(ERROR_CODE_ITEM_STORE);
+    return false;
+  }
+  _eraseQueue[_eraseQueueDepth++] = request;
+  if (_eraseQueueDepth > _eraseStats.maxQueueDepth) {
+    _eraseStats.maxQueueDepth = _eraseQueueDepth;
+  }
+  return true;
+}
+
+static bool StartNextErase() {
+  if (_eraseQueueDepth == 0) {
+    return false;
+  }
+  // the oldest request of the item store with the highest priority
+  uint8_t next = 0;
+  for (uint8_t i = 1; i < _eraseQueueDepth; i++) {
+    if (_itemStore[_eraseQueue[i].parameters.itemStore].erasePriority >
+        _itemStore[_eraseQueue[next].parameters.itemStore].erasePriority) {
+      next = i;
+    }
+  }
+  _runningErase = _eraseQueue[next];
+  _eraseQueueDepth--;
+  memmove(&_eraseQueue[next], &_eraseQueue[next + 1],
+          (_eraseQueueDepth - next) * sizeof(EraseRequest_t));
   _messageListener.currentMessageHandlerCb = ListenerErasingState;
+  _itemStore[_runningErase.parameters.itemStore].backend->erase(
+      _runningErase.parameters.pageNumber, _runningErase.parameters.nrOfPages,
+      FlashEraseDoneCb);
+  return true;
+}
+
+static void ReclaimPage(ItemStoreInfo_t* itemStoreInfo, uint8_t pageNr) {
+  ItemStore_EraseParameters_t parameters = {
+      .itemStore = itemStoreInfo->currentPageInfo.itemId,
+      .nrOfPages = 1,
+      .reinit = false,
+      .pageNumber = pageNr};
+  if (EnqueueErase(&parameters, 0) &&
+      _messageListener.currentMessageHandlerCb != ListenerErasingState) {
+    StartNextErase();
+  }
+}
+
+static void CountErasedPages(const ItemStore_EraseParameters_t* parameters) {
+  ItemStoreInfo_t* itemStoreInfo = &_itemStore[parameters->itemStore];
+  for (uint8_t i = 0; i < parameters->nrOfPages; i++) {
+    PageIndexEntry_t* entry =
+        PAGE_INDEX_ENTRY(itemStoreInfo, parameters->pageNumber + i);
+    if (entry->eraseCount < MAX_ERASE_COUNT) {
+      entry->eraseCount++;
+    }
+  }
+}
+
+static bool CoversErase(const ItemStore_EraseParameters_t* outer,
+                        const ItemStore_EraseParameters_t* inner) {
+  return outer->itemStore == inner->itemStore &&
+         outer->pageNumber <= inner->pageNumber &&
+         outer->pageNumber + outer->nrOfPages >=
+             inner->pageNumber + inner->nrOfPages;
+}
+
+static PageIndexEntry_t* PageIndexEntryAt(ItemStoreInfo_t* itemStoreInfo,
+                                          uint8_t position) {
+  uint8_t offset =
+      (itemStoreInfo->oldestPageInfo.pageId - itemStoreInfo->firstPage +
+       position) %
+      itemStoreInfo->nrOfPages;
+  return &itemStoreInfo->pageIndex[offset];
+}
+
+static void InitWritePageIndexEntry(ItemStoreInfo_t* itemStoreInfo) {
+  PageIndexEntry_t* entry = PAGE_INDEX_ENTRY(
+      itemStoreInfo, itemStoreInfo->nextWritePageInfo.pageId);
+  entry->pageId = itemStoreInfo->nextWritePageInfo.pageId;
+  entry->blockId = itemStoreInfo->nextWritePageInfo.blockId;
+  entry->nrOfItems = 0;
+  entry->firstItem = itemStoreInfo->nextItemOrdinal;
+}
+
+static void AssignPageIndexOrdinals(ItemStoreInfo_t* itemStoreInfo) {
+  uint32_t ordinal = 0;
+  for (uint8_t i = 0; i <= itemStoreInfo->nrOfFullPages; i++) {
+    PageIndexEntry_t* entry = PageIndexEntryAt(itemStoreInfo, i);
+    entry->firstItem = ordinal;
+    ordinal += entry->nrOfItems;
+  }
+  itemStoreInfo->nextItemOrdinal = ordinal;
+}
+
+static bool IsOvertaken(ItemStoreInfo_t* itemStore,
+                        const EnumeratorStatus_t* status) {
+  PageIndexEntry_t* entry =
+      PAGE_INDEX_ENTRY(itemStore, status->enumeratingPage.beginTag.pageId);
+  return status->generation != itemStore->generation ||
+         entry->blockId != status->enumeratingPage.beginTag.blockId;
+}
 
-  Flash_Erase(completeTag->nextPage, 1, FlashEraseDoneCb);
+static EnumeratorStatus_t* AllocateCursor(ItemStore_Enumerator_t* enumerator) {
+  EnumeratorStatus_t* status =
+      (EnumeratorStatus_t*)enumerator->enumeratorDetails;
+  if (status != 0 && status->owner == enumerator) {
+    return status;
+  }
+  for (uint8_t i = 0; i < COUNT_OF(_cursors); i++) {
+    if (_cursors[i].owner == 0) {
+      _cursors[i].owner = enumerator;
+      InvalidateReadAhead(&_cursors[i]);
+      return &_cursors[i];
+    }
+  }
+  return 0;
+}
+
+static bool ReadItem(ItemStoreInfo_t* itemStore,
+                     EnumeratorStatus_t* status,
+                     uint8_t* data) {
+  ReadAheadChunk_t* chunk = FindChunk(status);
+  bool isNewChunk =
+      chunk == 0 || chunk != &status->chunks[status->servingChunk];
+  if (chunk != 0) {
+    _readAheadStats.nrOfHits++;
+  } else {
+    _readAheadStats.nrOfMisses++;
+    chunk = &status->chunks[status->servingChunk];
+    if (!FillChunk(itemStore, chunk,
+                   PAGE_INDEX_ENTRY(itemStore,
+                                    status->enumeratingPage.beginTag.pageId),
+                   status->currentIndex)) {
+      return false;
+    }
+  }
+  if (isNewChunk) {
+    // the next chunk is read while the client processes this one
+    status->servingChunk = chunk - status->chunks;
+    status->isReadAheadPending = true;
+    UTIL_SEQ_SetTask(1 << SCHEDULER_TASK_HANDLE_ITEM_STORE_READ_AHEAD,
+                     SCHEDULER_PRIO_2);
+  }
+  memcpy(data,
+         &chunk->items[(status->currentIndex - chunk->firstIndex) *
+                       itemStore->itemSize],
+         itemStore->itemSize);
   return true;
 }
 
+static ReadAheadChunk_t* FindChunk(EnumeratorStatus_t* status) {
+  for (uint8_t i = 0; i < NR_OF_READ_AHEAD_CHUNKS; i++) {
+    ReadAheadChunk_t* chunk = &status->chunks[i];
+    if (chunk->nrOfItems > 0 &&
+        chunk->pageId == status->enumeratingPage.beginTag.pageId &&
+        chunk->blockId == status->enumeratingPage.beginTag.blockId &&
+        status->currentIndex >= chunk->firstIndex &&
+        status->currentIndex < chunk->firstIndex + chunk->nrOfItems) {
+      return chunk;
+    }
+  }
+  return 0;
+}
+
+static bool FillChunk(ItemStoreInfo_t* itemStore,
+                      ReadAheadChunk_t* chunk,
+                      const PageIndexEntry_t* entry,
+                      uint16_t firstIndex) {
+  uint16_t nrOfItems = READ_AHEAD_CHUNK_SIZE / itemStore->itemSize;
+  if (nrOfItems > entry->nrOfItems - firstIndex) {
+    nrOfItems = entry->nrOfItems - firstIndex;
+  }
+  uint32_t readAddress = PAGE_ADDRESS(itemStore, entry->pageId) +
+                         sizeof(PageHeader_t) +
+                         firstIndex * itemStore->itemSize;
+  chunk->nrOfItems = 0;
+  if (!itemStore->backend->read(readAddress, chunk->items,
+                                nrOfItems * itemStore->itemSize)) {
+    return false;
+  }
+  chunk->pageId = entry->pageId;
+  chunk->blockId = entry->blockId;
+  chunk->firstIndex = firstIndex;
+  chunk->nrOfItems = nrOfItems;
+  return true;
+}
+
+static void InvalidateReadAhead(EnumeratorStatus_t* status) {
+  for (uint8_t i = 0; i < NR_OF_READ_AHEAD_CHUNKS; i++) {
+    status->chunks[i].nrOfItems = 0;
+  }
+  status->servingChunk = 0;
+  status->isReadAheadPending = false;
+}
+
+static void ReadAheadTask() {
+  // a read of the internal flash stalls the CPU until the erase is done; the
+  // chunks are then read when they are needed
+  if (_messageListener.currentMessageHandlerCb == ListenerErasingState) {
+    return;
+  }
+  for (uint8_t i = 0; i < COUNT_OF(_cursors); i++) {
+    EnumeratorStatus_t* status = &_cursors[i];
+    if (status->owner == 0 || !status->isReadAheadPending) {
+      continue;
+    }
+    status->isReadAheadPending = false;
+    ItemStoreInfo_t* itemStore =
+        &_itemStore[status->enumeratingPage.beginTag.itemId];
+    ReadAheadChunk_t* serving = &status->chunks[status->servingChunk];
+    PageIndexEntry_t* entry = PAGE_INDEX_ENTRY(itemStore, serving->pageId);
+    // the page of the serving chunk was erased in the meantime
+    if (serving->nrOfItems == 0 ||
+        status->generation != itemStore->generation ||
+        entry->blockId != serving->blockId) {
+      continue;
+    }
+    uint16_t firstIndex = serving->firstIndex + serving->nrOfItems;
+    if (firstIndex >= entry->nrOfItems) {
+      // continue with the next page if it was written after this one
+      entry =
+          PAGE_INDEX_ENTRY(itemStore, NEXT_PAGE_NR(itemStore, serving->pageId));
+      firstIndex = 0;
+      if (entry->nrOfItems == 0 ||
+          entry->blockId != (serving->blockId + 1) % MAX_BLOCK_INDEX) {
+        continue;
+      }
+    }
+    ReadAheadChunk_t* next =
+        &status->chunks[(status->servingChunk + 1) % NR_OF_READ_AHEAD_CHUNKS];
+    if (FillChunk(itemStore, next, entry, firstIndex)) {
+      _readAheadStats.nrOfReadAheads++;
+    }
+  }
+}
+
 static bool ListenerIdleState(Message_Message_t* message) {
-  ASSERT(message->header.parameter1 < 2);
+  ASSERT(message->header.parameter1 < COUNT_OF(_itemStore));
   ItemStoreMessage_t* msg = (ItemStoreMessage_t*)message;
   if (message->header.id == ITEM_STORE_MESSAGE_ERASE) {
-    _eraseParameters = msg->data.eraseParameter;
-    Flash_Erase(_eraseParameters.pageNumber, _eraseParameters.nrOfPages,
-                FlashEraseDoneCb);
-    _messageListener.currentMessageHandlerCb = ListenerErasingState;
+    EnqueueErase(&msg->data.eraseParameter, 1);
+    StartNextErase();
     return true;
   }
   return _itemStore[message->header.parameter1].currentState(message);
@@ -812,6 +2205,10 @@ static bool IdleState(Message_Message_t* message) {
     }
     return true;
   }
+  if (message->header.id == ITEM_STORE_MESSAGE_ADD_ITEMS) {
+    AddItems(msg->header.parameter1, msg->data.addItemsParameter);
+    return true;
+  }
   if (message->header.id == ITEM_STORE_MESSAGE_BEGIN_ENUMERATE) {
     BeginEnumerate(message->header.parameter1, msg->data.enumerateParameter);
     return true;
@@ -819,36 +2216,41 @@ static bool IdleState(Message_Message_t* message) {
   return false;
 }
 
-static bool EnumeratingState(Message_Message_t* message) {
-  // in this state no messages are accepted. The item store is reserved
-  // for synchronous use with an initialized enumerator
-  return false;
-}
-
 static bool ListenerErasingState(Message_Message_t* message) {
   // only one erase can run at a time!
-  // all other requests are ignored while being in this state!
+  // further erase requests are queued; requests that need the flash wait
+  // until the erase is done.
   if (message->header.id == ITEM_STORE_MESSAGE_ERASE) {
     ItemStoreMessage_t* msg = (ItemStoreMessage_t*)message;
-    _eraseReminder = msg->data.eraseParameter;
+    EnqueueErase(&msg->data.eraseParameter, 1);
+    return true;
+  }
+  if (message->header.id == ITEM_STORE_MESSAGE_ADD_ITEM ||
+      message->header.id == ITEM_STORE_MESSAGE_ADD_ITEMS ||
+      message->header.id == ITEM_STORE_MESSAGE_BEGIN_ENUMERATE) {
+    DeferRequest((ItemStoreMessage_t*)message, false);
     return true;
   }
   if (message->header.id == ITEM_STORE_MESSAGE_ERASE_DONE) {
-    if (_eraseReminder.pageNumber < 0xFF && _eraseReminder.pageNumber > 0 &&
-        _eraseReminder.itemStore != 0xFF && _eraseReminder.nrOfPages > 0) {
-      _eraseParameters = _eraseReminder;
-      memset(&_eraseReminder, 0xFF, sizeof(_eraseReminder));
-      _eraseReminder.nrOfPages = 0;
-      _eraseReminder.reinit = false;
-      Flash_Erase(_eraseParameters.pageNumber, _eraseParameters.nrOfPages,
-                  FlashEraseDoneCb);
-    } else {
-      _messageListener.currentMessageHandlerCb = ListenerIdleState;
-      if (_eraseParameters.reinit) {
-        ItemStore_ItemDef_t id = _eraseParameters.itemStore;
-        InitItemStore(&_itemStore[id], id);
+    CountErasedPages(&_runningErase.parameters);
+    if (_runningErase.parameters.reinit) {
+      ItemStore_ItemDef_t id = _runningErase.parameters.itemStore;
+      InitItemStore(&_itemStore[id], id);
+    }
+    if (_isRolloverBlocked) {
+      _rolloverErasedPages += _runningErase.parameters.nrOfPages;
+    }
+    if (StartNextErase()) {
+      return true;
+    }
+    _messageListener.currentMessageHandlerCb = ListenerIdleState;
+    if (_isRolloverBlocked) {
+      _isRolloverBlocked = false;
+      if (_rolloverErasedPages > _eraseStats.maxRolloverLatencyPages) {
+        _eraseStats.maxRolloverLatencyPages = _rolloverErasedPages;
       }
     }
+    HandleDeferredRequests();
     return true;
   }
   return false;
@@ -857,9 +2259,11 @@ static bool ListenerErasingState(Message_Message_t* message) {
 static void FlashEraseDoneCb(uint32_t pageId, uint8_t remaining) {
   Message_Message_t message = {
       .header.category = MESSAGE_BROKER_CATEGORY_ITEM_STORE,
-      .header.id = ITEM_STORE_MESSAGE_ERASE_DONE};
+      .header.id = ITEM_STORE_MESSAGE_ERASE_DONE,
+      .header.parameter1 = _runningErase.nrOfRequests};
   // clang-tidy is wrong with its size computation for this architecture :-(
   //NOLINTNEXTLINE
-  memcpy(&message.parameter2, &_eraseParameters, sizeof(_eraseParameters));
+  memcpy(&message.parameter2, &_runningErase.parameters,
+         sizeof(_runningErase.parameters));
   Message_PublishAppMessage(&message);
 }
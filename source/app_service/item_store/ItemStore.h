@@ -36,6 +36,33 @@
 /// The item store is able to store data items of predefined size on the flash persistently in
 /// chronological order. Once the available space of an item store is exhausted, the oldest items
 /// are removed, and the new items are stored on the freshly available space.
+///
+/// The pages of an item store are kept in a storage backend. The system
+/// settings and the hourly and daily summaries of the measurements are
+/// stored in the internal flash; the measurement item may be moved to the
+/// external QSPI flash with the build option
+/// ITEM_STORE_CONFIG_EXTERNAL_MEASUREMENT.
+///
+/// The item store keeps an index of its pages in RAM. Counting the items and
+/// locating the start position of an enumerator is done on this index and
+/// does not require any flash access.
+///
+/// An item that is larger than a double word is written with its first double
+/// word last. If the write is cut by a power loss, the torn item is cleared
+/// to zero when the item store is initialized again; the readers reject it
+/// like any other invalid item.
+///
+/// Several read-only enumerators may be open at the same time, each with its
+/// own cursor. Items can still be added while enumerators are open. If the
+/// page at the cursor of an enumerator is erased to make room for new items,
+/// the enumerator stops and reports that it was overtaken.
+///
+/// Erase requests are queued and executed one after the other; item stores
+/// with a higher priority are served first. The measurement item store
+/// erases its oldest page as soon as the page before it is opened, such that
+/// a page rollover does not have to wait for an erase. Requests to add items
+/// or to begin an enumeration that arrive during an erase are handled in
+/// order when the erase is done.
 /// @startuml
 ///
 /// state POR <<choice>>
@@ -44,7 +71,6 @@
 ///
 ///
 ///   state Idle
-///   state Enumerating
 ///   state NoPageLeft <<choice>>
 ///
 ///   [*] -> Idle
@@ -52,13 +78,14 @@
 ///   NoPageLeft -> Idle: free-page-available
 ///   NoPageLeft -> FlashErasing: no-free-page
 ///
-///   Idle -d-> Enumerating: start-enumerate
-///   Enumerating -u-> Idle: enumeartion-done
+///   Idle -> Idle: start-enumerate
 /// }
 ///
 /// state FlashErasing{
 ///  [*] -> ErasePage
 ///  ErasePage -> ErasePage: erase-next
+///  ErasePage -> ErasePage: erase-queued
+///  ErasePage -> ErasePage: request-deferred
 /// }
 ///
 /// FlashIdle -d-> FlashErasing: start-erase
@@ -82,20 +109,49 @@
 /// Buffer size for the alternative device name
 #define DEVICE_NAME_BUFFER_LENGTH 32
 
+/// Maximal number of enumerators that may be open at the same time; each
+/// connected BLE client keeps one open while it downloads samples.
+#define ITEM_STORE_MAX_NR_OF_ENUMERATORS 5
+
 /// Maximal length of the alternative device name. Due to the 0 termination
 /// of c-strings this is the buffer size -1.
 #define DEVICE_NAME_MAX_LEN (DEVICE_NAME_BUFFER_LENGTH - 1)
 
+/// Forward declaration of the enumerator that is passed to its callback
+struct _tItemStore_Enumerator;
+
 /// Callback to notify the state of the enumerator as a response of a call
 /// to the function `ItemStore_BeginEnumerate`
 /// When the iterator is ready, it may be used to synchronously iterate through
 /// the elements in the item store.
-typedef void (*ItemStore_EnumeratorStatusCb_t)(bool ready);
+/// @param enumerator The enumerator that was passed to
+///                   `ItemStore_BeginEnumerate`
+/// @param ready true if the enumerator is ready to be used; false otherwise
+typedef void (*ItemStore_EnumeratorStatusCb_t)(
+    struct _tItemStore_Enumerator* enumerator,
+    bool ready);
+
+/// Callback to notify the completion of a call to `ItemStore_AddItems`
+/// @param success true if all items of the batch were written; false otherwise
+typedef void (*ItemStore_AddItemsCompleteCb_t)(bool success);
+
+/// Forward declaration of the item union that is passed to the key callback
+union _tItemStore_ItemStruct;
+
+/// Callback to get the search key of an item for `ItemStore_SeekKey()`
+/// @param item The item to be inspected
+/// @param [out] key Receives the key of the item
+/// @return true if the item holds a key; false otherwise
+typedef bool (*ItemStore_KeyOfItemCb_t)(
+    const union _tItemStore_ItemStruct* item,
+    uint32_t* key);
 
 /// Ids of the defined info items that can be stored
 typedef enum {
   ITEM_DEF_SYSTEM_CONFIG = 0,
-  ITEM_DEF_MEASUREMENT_SAMPLE
+  ITEM_DEF_MEASUREMENT_SAMPLE,
+  ITEM_DEF_HOURLY_SUMMARY,
+  ITEM_DEF_DAILY_SUMMARY
 } ItemStore_ItemDef_t;
 
 /// Defines the messages that are used by the item store.
@@ -106,21 +162,27 @@ typedef enum {
   /// Adding new items is not possible while enumerating or erasing.
   ITEM_STORE_MESSAGE_ADD_ITEM = 0,
   /// Erase a page if no space is left.
-  /// It is not possible to start an erase while another erase is ongoing or
-  /// while enumerating an item store.
+  /// Erase requests that arrive while another erase is ongoing are queued;
+  /// requests for the same pages are coalesced.
   ITEM_STORE_MESSAGE_ERASE,
   /// Notify that the erase is done.
+  /// The parameter1 holds the number of erase messages that were served by
+  /// this erase.
   ITEM_STORE_MESSAGE_ERASE_DONE,
   /// Begin to enumerate the items within an item store.
   ITEM_STORE_MESSAGE_BEGIN_ENUMERATE,
   /// Signal the end of the enumerate operation.
   /// Clients of the item store need to know when they can add items again.
-  ITEM_STORE_MESSAGE_END_ENUMERATE
+  ITEM_STORE_MESSAGE_END_ENUMERATE,
+  /// Add a batch of items to the item store.
+  ITEM_STORE_MESSAGE_ADD_ITEMS
 } ItemStore_MessageId_t;
 
-/// Structure definition of item 'Configuration'
+/// Structure definition of the system configuration
 ///
-/// This structure is not yet finalized!
+/// The configuration is kept in RAM. It is persisted as a sequence of
+/// settings records; firmware versions before 1.1 stored the whole structure
+/// as one item.
 typedef struct _tItemStore_SystemConfig {
   /// Actual version of the system configuration; the version number is meant
   /// to guarantee backwards compatibility.
@@ -133,29 +195,67 @@ typedef struct _tItemStore_SystemConfig {
   /// Name of the device that may be set via BLE
   char deviceName[DEVICE_NAME_BUFFER_LENGTH];
   uint32_t loggingInterval;  ///< logging interval in ms. smallest value 5s.
-  uint8_t reserve2[84];      ///< Overall size is 128 bytes so that we
-                             ///< can define further values in the future.
+  /// Epoch of the sequence numbers of the measurement log; it changes when
+  /// the log starts empty.
+  uint8_t logEpoch;
+  uint8_t reserve2[83];  ///< Overall size is 128 bytes so that we
+                         ///< can define further values in the future.
   uint32_t crc;              ///< Crc to check data integrity
 } ItemStore_SystemConfig_t;
 
+/// Number of value bytes of a settings record
+#define ITEM_STORE_SETTINGS_RECORD_VALUE_SIZE 28
+
+/// Structure definition of item 'Configuration'
+///
+/// A record holds a range of bytes of the system configuration. The record
+/// format is defined by the SettingsStore.
+typedef struct _tItemStore_SettingsRecord {
+  uint8_t tag;     ///< Kind of the record
+  uint8_t offset;  ///< Position of the value in the system configuration
+  uint8_t length;  ///< Number of valid bytes in value
+  uint8_t value[ITEM_STORE_SETTINGS_RECORD_VALUE_SIZE];  ///< Record value
+  uint8_t crc;  ///< Crc over all preceding bytes of the record
+} ItemStore_SettingsRecord_t;
+
+/// A single sample of the measurement log
+typedef struct _tItemStore_Sample {
+  uint16_t temperatureTicks;  ///< raw measurement value of temperature
+  uint16_t humidityTicks;     ///< raw measurement value of humidity
+} ItemStore_Sample_t;
+
 /// Structure definition of item 'Measurement'
-/// As the flash is written in double words, we put two samples in one item.
+/// As the flash is written in double words, one item holds a group of
+/// compressed samples. The format is defined by the MeasurementCodec.
 typedef struct _tItemStore_MeasurementSample {
-  struct {
-    uint16_t temperatureTicks;  ///< raw measurement value of temperature
-    uint16_t humidityTicks;     ///< raw measurement value of humidity
-  } sample[2];                  ///< samples contained in this item
+  uint32_t data[2];  ///< compressed samples contained in this item
 } ItemStore_MeasurementSample_t;
 
+/// Structure definition of the items 'HourlySummary' and 'DailySummary'
+/// A summary holds the minimum, maximum and mean of the samples that were
+/// logged during one period. The format is defined by the
+/// MeasurementSummary.
+typedef struct _tItemStore_SummaryRecord {
+  ItemStore_Sample_t minimum;  ///< Smallest ticks of the period
+  ItemStore_Sample_t maximum;  ///< Largest ticks of the period
+  ItemStore_Sample_t mean;     ///< Mean ticks of the period
+  uint16_t nrOfSamples;        ///< Number of summarized samples
+  uint16_t reserve;            ///< Pad the item to a multiple of 8 bytes
+} ItemStore_SummaryRecord_t;
+
 /// Summarize all possible item structures.
-typedef union {
-  ItemStore_SystemConfig_t configuration;     ///< SystemConfig item
+typedef union _tItemStore_ItemStruct {
+  ItemStore_SystemConfig_t configuration;     ///< Legacy SystemConfig item
+  ItemStore_SettingsRecord_t settingsRecord;  ///< SettingsRecord item
   ItemStore_MeasurementSample_t measurement;  ///< MeasurementSample item
+  ItemStore_SummaryRecord_t summary;          ///< Hourly or daily summary
 } ItemStore_ItemStruct_t;
 
 /// Define an enumerator to enumerate all items of  an item store
 typedef struct _tItemStore_Enumerator {
   bool hasMoreItems;        ///< Flag indicating if more items are available
+  bool isOvertaken;         ///< Flag indicating that unread items were
+                            ///< erased while enumerating
   int32_t startIndex;       ///< Points to the start position where the
                             ///< enumeration will start.
                             ///< A negative index will denote a start index
@@ -164,6 +264,21 @@ typedef struct _tItemStore_Enumerator {
                             ///< enumerator
 } ItemStore_Enumerator_t;
 
+/// Define a batch of items that is added with `ItemStore_AddItems`
+///
+/// The batch and the items it refers to are owned by the client. They must
+/// remain valid until the completion callback was invoked.
+typedef struct {
+  /// Items to be added; the items are packed with the item size of the
+  /// selected item store.
+  const void* items;
+  uint16_t nrOfItems;  ///< Number of items in the batch
+  /// Number of items that are already written; maintained by the item store.
+  uint16_t nrOfItemsWritten;
+  /// Called once after all items are written or an error occurred.
+  ItemStore_AddItemsCompleteCb_t onDoneCb;
+} ItemStore_ItemBatch_t;
+
 /// Get the message listener of the item store
 /// @return Message listener that handles massages for the item stores
 MessageListener_Listener_t* ItemStore_ListenerInstance();
@@ -179,6 +294,39 @@ typedef struct {
 
 ASSERT_SIZE_TYPE1_LESS_THAN_TYPE2(ItemStore_EraseParameters_t, uint32_t);
 
+/// Statistics of the erase queue that is shared by all item stores
+typedef struct {
+  uint8_t queueDepth;              ///< Number of queued erase requests
+  uint8_t maxQueueDepth;           ///< Highest number of queued requests
+  uint16_t nrOfCoalescedRequests;  ///< Requests merged into queued requests
+  uint16_t nrOfPreErasedPages;     ///< Pages erased ahead of the write page
+  /// Number of page rollovers that had to wait for an erase
+  uint16_t nrOfBlockingRollovers;
+  /// Worst-case latency of adding items during a page rollover, counted in
+  /// erased pages. There is no millisecond clock while the device is in
+  /// stop mode; a page erase takes about 22ms.
+  uint8_t maxRolloverLatencyPages;
+} ItemStore_EraseStats_t;
+
+/// Wear statistics of the pages of an item store
+typedef struct {
+  uint8_t nrOfPages;        ///< Number of pages of the item store
+  uint16_t minEraseCount;   ///< Erase count of the least worn page
+  uint16_t maxEraseCount;   ///< Erase count of the most worn page
+  uint16_t meanEraseCount;  ///< Mean erase count of all pages
+} ItemStore_WearStats_t;
+
+/// Statistics of the read-ahead cache of the enumerators
+///
+/// `ItemStore_GetNext()` serves the items from chunks of a page that are held
+/// in RAM. The chunk after the one being read is filled when the sequencer is
+/// idle.
+typedef struct {
+  uint32_t nrOfHits;        ///< Items that were served from a chunk
+  uint32_t nrOfMisses;      ///< Items whose chunk was read synchronously
+  uint32_t nrOfReadAheads;  ///< Chunks that were read while idle
+} ItemStore_ReadAheadStats_t;
+
 /// Initialize the item store upon reset.
 ///
 /// The ItemStore_listenerInstance() has to be registered prior to calling ItemStore_Init()
@@ -191,6 +339,19 @@ void ItemStore_Init();
 void ItemStore_AddItem(ItemStore_ItemDef_t item,
                        const ItemStore_ItemStruct_t* data);
 
+/// Add a batch of items to the specified item store
+///
+/// The items are programmed in short flash write sessions of a few items each,
+/// such that CPU2 is not locked out of the flash while a long batch is
+/// written. Each page of the batch is written with a message of its own, so
+/// that other requests are handled between the pages. The client is notified
+/// with a single callback. If a page needs to be erased to make room for the
+/// remaining items, the batch is continued once the erase is done.
+/// Only one batch may be pending at a time.
+/// @param item Id of the item store
+/// @param batch The batch of items to be added
+void ItemStore_AddItems(ItemStore_ItemDef_t item, ItemStore_ItemBatch_t* batch);
+
 /// Delete all items in the specified item store
 /// All pages that belong to this item store will be erased
 /// @param item Id of the item store
@@ -205,12 +366,86 @@ void ItemStore_DeleteAllItems(ItemStore_ItemDef_t item);
 /// @return true if there is no valid data in the item store
 bool ItemStore_IsEmpty(ItemStore_ItemDef_t item);
 
+/// Read the newest item that an older firmware stored with another item size.
+///
+/// The newest page of such items is kept at startup; it is not part of the
+/// item store. The page is kept until the items are deleted or until the item
+/// store wraps around onto it. The function reads the flash synchronously.
+/// @param item Id of the item store.
+/// @param data Buffer that receives the item.
+/// @param size Size of the buffer; must match the size of the older items.
+/// @return true if an item was read; false otherwise
+bool ItemStore_ReadLegacyItem(ItemStore_ItemDef_t item,
+                              void* data,
+                              uint8_t size);
+
+/// Delete the items that an older firmware stored with another item size or
+/// in the legacy log.
+///
+/// The erase of the kept pages starts immediately; items that are added
+/// afterwards are written when the erase is done.
+/// @param item Id of the item store.
+void ItemStore_DeleteLegacyItems(ItemStore_ItemDef_t item);
+
+/// Count the items of the legacy log.
+///
+/// The measurement log of firmware 1.0.0 has another item format; its pages
+/// are kept as legacy log that is not part of the item store. The items of
+/// this firmware are written after the legacy log and its oldest page is
+/// given up whenever a page is needed. The pages that are used by another
+/// item store now are lost.
+/// @param item Id of the item store.
+/// @return Number of items of the legacy log
+uint32_t ItemStore_CountLegacyLogItems(ItemStore_ItemDef_t item);
+
+/// Read an item of the legacy log.
+///
+/// The items are addressed from the newest one, such that the address of an
+/// item does not change when an older page is given up. The function reads
+/// the flash synchronously.
+/// @param item Id of the item store.
+/// @param nrOfNewerItems Number of items of the legacy log that are newer
+///                       than the item; 0 for the newest item.
+/// @param data Buffer that receives the item.
+/// @param size Size of the buffer; must match the size of the items.
+/// @return true if the item was read; false if it is not available
+bool ItemStore_ReadLegacyLogItem(ItemStore_ItemDef_t item,
+                                 uint32_t nrOfNewerItems,
+                                 void* data,
+                                 uint8_t size);
+
+/// Get the number of flash reads that were needed to recover the state of an
+/// item store during its last initialization.
+///
+/// @param item Id of the item store.
+/// @return Number of flash reads of the last recovery scan.
+uint16_t ItemStore_GetRecoveryReads(ItemStore_ItemDef_t item);
+
+/// Get the wear statistics of an item store.
+///
+/// The erase count of each page is stored in its page header. Pages that are
+/// empty after a reset are assumed to be as worn as the most worn page.
+/// @param item Id of the item store
+/// @param [out] stats Receives the statistics
+void ItemStore_GetWearStats(ItemStore_ItemDef_t item,
+                            ItemStore_WearStats_t* stats);
+
+/// Get the statistics of the erase queue.
+/// @param [out] stats Receives the statistics
+void ItemStore_GetEraseStats(ItemStore_EraseStats_t* stats);
+
+/// Get the statistics of the read-ahead cache of all enumerators.
+/// @param [out] stats Receives the statistics
+void ItemStore_GetReadAheadStats(ItemStore_ReadAheadStats_t* stats);
+
 /// Initialize an object to enumerate all items that are stored
 /// in the specified item store. This operation is called asynchronously in
 /// order to not interfere with pending erase operations.
 /// The client is notified about the state of the enumerator with the
 /// callback  `onEnumeratorReadyCb`.
-/// As long as an enumerator is active, no new items can be added.
+/// Up to ITEM_STORE_MAX_NR_OF_ENUMERATORS enumerators may be open at the same
+/// time. Items may be added while an enumerator is open; items that are
+/// added after the enumerator is ready are not enumerated.
 /// @param item Id of the item store to enumerate
 /// @param enumerator Pointer to enumerator object that shall be initialized
 /// @param onDoneCb Callback that signals that the completion of the operation.
@@ -220,9 +455,8 @@ void ItemStore_BeginEnumerate(ItemStore_ItemDef_t item,
 
 /// Close an initialized enumerator
 ///
-/// After each successful call to `ItemStore_BeginEnumerate()` this function
-/// has to be called to exit the enumerating state. Only after closing the
-/// an open enumerator, new items may be added to the item store.
+/// After each call to `ItemStore_BeginEnumerate()` this function has to be
+/// called to release the cursor of the enumerator.
 /// This operation is executed synchronously
 /// @param enumerator Pointer to enumerator object that shall be initialized
 /// @param item the item store that was enumerated
@@ -236,11 +470,47 @@ void ItemStore_EndEnumerate(ItemStore_Enumerator_t* enumerator,
 int32_t ItemStore_Count(ItemStore_Enumerator_t* enumerator);
 
 /// Access the next item in the item store.
-/// This operation is executed synchronously.
+/// This operation is executed synchronously. The items are read in chunks;
+/// the chunk that follows the one being read is filled while the sequencer
+/// is idle.
+/// If the next item was erased in the meantime, the operation fails and the
+/// flag `isOvertaken` of the enumerator is set.
 /// @param enumerator
 /// @param data Pointer to a data structure that can hold the next element
 ///             retrieved by the enumerator
 /// @return true if the operation succeeds; false otherwise
 bool ItemStore_GetNext(ItemStore_Enumerator_t* enumerator,
                        ItemStore_ItemStruct_t* data);
+
+/// Move a ready enumerator to another item.
+/// This operation is executed synchronously and uses the in-RAM page index;
+/// no flash access is needed.
+/// @param enumerator Pointer to a ready enumerator
+/// @param index Index of the item that is returned by the next call to
+///              `ItemStore_GetNext()`; the index is relative to the oldest
+///              item when the enumeration started.
+/// @return true if the enumerator points to the requested item; false if the
+///         index is out of range or the item was erased in the meantime
+bool ItemStore_Seek(ItemStore_Enumerator_t* enumerator, uint32_t index);
+
+/// Move a ready enumerator to the newest keyed item whose key is not above
+/// the searched key.
+///
+/// Only some items of an item store may hold a key, e.g. the anchors of the
+/// measurement log. The keys must not decrease with the item index and no
+/// more than maxGap items without a key may follow each other. The keyed item
+/// is located with a binary search; each step reads at most maxGap + 1 items.
+/// @param enumerator Pointer to a ready enumerator
+/// @param key The searched key
+/// @param keyOfItem Callback that gets the key of an item
+/// @param maxGap Maximal number of consecutive items without a key
+/// @param [out] index Receives the index of the found item; it is the oldest
+///                    keyed item if all keys are above the searched key.
+/// @return true if a keyed item was found and the next call to
+///         `ItemStore_GetNext()` returns it; false otherwise
+bool ItemStore_SeekKey(ItemStore_Enumerator_t* enumerator,
+                       uint32_t key,
+                       ItemStore_KeyOfItemCb_t keyOfItem,
+                       uint16_t maxGap,
+                       uint32_t* index);
 #endif  // ITEM_STORE_H
@@ -0,0 +1,303 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file MeasurementCodec.c
+#include "MeasurementCodec.h"
+
+#include "utility/AppDefines.h"
+
+/// Bit position of the width code within an item
+#define WIDTH_CODE_POSITION 0
+
+/// Bit position of the number of deltas within an item
+#define NR_OF_DELTAS_POSITION 3
+
+/// Bit position of the temperature ticks of the base sample
+#define BASE_TEMPERATURE_POSITION 6
+
+/// Bit position of the humidity ticks of the base sample
+#define BASE_HUMIDITY_POSITION 22
+
+/// Bit position of the first delta within an item
+#define FIRST_DELTA_POSITION 38
+
+/// Width code that marks an anchor item
+#define ANCHOR_WIDTH_CODE 6
+
+/// Bit position of the log time within an anchor item
+#define ANCHOR_TIME_POSITION 6
+
+/// Bit position of the sample ordinal within an anchor item
+#define ANCHOR_ORDINAL_POSITION 38
+
+/// Value of bits 3..5 that distinguishes a segment item from an anchor item
+#define SEGMENT_KIND 1
+
+/// Bit position of the logging interval within a segment item
+#define SEGMENT_INTERVAL_POSITION 6
+
+/// Bit position of the first ordinal within a segment item
+#define SEGMENT_ORDINAL_POSITION 38
+
+/// Mask of the width code and of the number of deltas
+#define THREE_BIT_MASK 0x7
+
+/// Mask of the ticks of the base sample
+#define TICKS_MASK 0xFFFF
+
+/// Bit width of the deltas for each width code.
+/// The width code 0 is used for items that hold a single sample; the
+/// ANCHOR_WIDTH_CODE follows the last entry.
+static const uint8_t _deltaWidth[] = {0, 2, 3, 4, 6, 13};
+
+/// Maximal number of deltas for each width code;
+/// the deltas share the 26 bits that remain after the base sample.
+static const uint8_t _maxNrOfDeltas[] = {6, 6, 4, 3, 2, 1};
+
+/// Get the smallest width code that is able to represent a delta.
+/// @param delta Difference between two consecutive ticks
+/// @return The width code or COUNT_OF(_deltaWidth) if the delta does not
+///         fit into any width.
+static uint8_t WidthCodeOf(int32_t delta);
+
+/// Pack the pending samples of the encoder into an item.
+/// @param encoder Encoder holding the pending samples
+/// @param [out] item Receives the packed samples
+static void EncodeItem(const MeasurementCodec_Encoder_t* encoder,
+                       ItemStore_MeasurementSample_t* item);
+
+/// Get the 64 bits of an item.
+/// @param item The item to be read
+/// @return The content of the item
+static uint64_t ItemBits(const ItemStore_MeasurementSample_t* item);
+
+/// Interpret the lowest bits of a value as signed number.
+/// @param value Value containing a two's complement number
+/// @param width Number of bits of the two's complement number
+/// @return The signed number
+static int32_t SignExtend(uint32_t value, uint8_t width);
+
+void MeasurementCodec_InitEncoder(MeasurementCodec_Encoder_t* encoder) {
+  encoder->nrOfSamples = 0;
+  encoder->widthCode = 0;
+}
+
+bool MeasurementCodec_AddSample(MeasurementCodec_Encoder_t* encoder,
+                                const ItemStore_Sample_t* sample,
+                                ItemStore_MeasurementSample_t* item) {
+  bool isItemComplete = false;
+  if (encoder->nrOfSamples > 0) {
+    const ItemStore_Sample_t* previous =
+        &encoder->samples[encoder->nrOfSamples - 1];
+    uint8_t widthCode = encoder->widthCode;
+    uint8_t temperatureWidthCode = WidthCodeOf(
+        (int32_t)sample->temperatureTicks - previous->temperatureTicks);
+    uint8_t humidityWidthCode = WidthCodeOf((int32_t)sample->humidityTicks -
+                                            previous->humidityTicks);
+    if (temperatureWidthCode > widthCode) {
+      widthCode = temperatureWidthCode;
+    }
+    if (humidityWidthCode > widthCode) {
+      widthCode = humidityWidthCode;
+    }
+    // the new sample adds one delta to the pending samples
+    if (widthCode >= COUNT_OF(_deltaWidth) ||
+        encoder->nrOfSamples > _maxNrOfDeltas[widthCode]) {
+      EncodeItem(encoder, item);
+      isItemComplete = true;
+      MeasurementCodec_InitEncoder(encoder);
+    } else {
+      encoder->widthCode = widthCode;
+    }
+  }
+  encoder->samples[encoder->nrOfSamples++] = *sample;
+
+  // no further delta fits if the item is full at the current width
+  if (!isItemComplete &&
+      encoder->nrOfSamples - 1 == _maxNrOfDeltas[encoder->widthCode]) {
+    EncodeItem(encoder, item);
+    isItemComplete = true;
+    MeasurementCodec_InitEncoder(encoder);
+  }
+  return isItemComplete;
+}
+
+uint8_t MeasurementCodec_PendingSamples(
+    const MeasurementCodec_Encoder_t* encoder) {
+  return encoder->nrOfSamples;
+}
+
+uint8_t MeasurementCodec_NrOfSamples(
+    const ItemStore_MeasurementSample_t* item) {
+  uint64_t bits = ItemBits(item);
+  uint8_t widthCode = (bits >> WIDTH_CODE_POSITION) & THREE_BIT_MASK;
+  uint8_t nrOfDeltas = (bits >> NR_OF_DELTAS_POSITION) & THREE_BIT_MASK;
+  // the item store clears an item to zero if its write was cut
+  if (bits == 0 || widthCode >= COUNT_OF(_deltaWidth) ||
+      nrOfDeltas > _maxNrOfDeltas[widthCode] ||
+      (widthCode == 0 && nrOfDeltas > 0)) {
+    return 0;
+  }
+  return nrOfDeltas + 1;
+}
+
+uint8_t MeasurementCodec_DecodeItem(const ItemStore_MeasurementSample_t* item,
+                                    ItemStore_Sample_t* samples) {
+  uint8_t nrOfSamples = MeasurementCodec_NrOfSamples(item);
+  if (nrOfSamples == 0) {
+    return 0;
+  }
+  uint64_t bits = ItemBits(item);
+  uint8_t width = _deltaWidth[(bits >> WIDTH_CODE_POSITION) & THREE_BIT_MASK];
+  uint32_t deltaMask = (1UL << width) - 1;
+  samples[0].temperatureTicks =
+      (bits >> BASE_TEMPERATURE_POSITION) & TICKS_MASK;
+  samples[0].humidityTicks = (bits >> BASE_HUMIDITY_POSITION) & TICKS_MASK;
+  uint8_t position = FIRST_DELTA_POSITION;
+  for (uint8_t i = 1; i < nrOfSamples; i++) {
+    int32_t temperatureDelta =
+        SignExtend((bits >> position) & deltaMask, width);
+    position += width;
+    int32_t humidityDelta = SignExtend((bits >> position) & deltaMask, width);
+    position += width;
+    samples[i].temperatureTicks =
+        (uint16_t)(samples[i - 1].temperatureTicks + temperatureDelta);
+    samples[i].humidityTicks =
+        (uint16_t)(samples[i - 1].humidityTicks + humidityDelta);
+  }
+  return nrOfSamples;
+}
+
+uint8_t MeasurementCodec_DecodeLegacyItem(
+    const ItemStore_MeasurementSample_t* item,
+    ItemStore_Sample_t* samples) {
+  for (uint8_t i = 0; i < MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM; i++) {
+    samples[i].temperatureTicks = item->data[i] & TICKS_MASK;
+    samples[i].humidityTicks = (item->data[i] >> 16) & TICKS_MASK;
+  }
+  return MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM;
+}
+
+void MeasurementCodec_EncodeAnchor(const MeasurementCodec_Anchor_t* anchor,
+                                   ItemStore_MeasurementSample_t* item) {
+  uint64_t bits =
+      ((uint64_t)ANCHOR_WIDTH_CODE << WIDTH_CODE_POSITION) |
+      ((uint64_t)anchor->timeS << ANCHOR_TIME_POSITION) |
+      ((uint64_t)(anchor->ordinal & MEASUREMENT_CODEC_ORDINAL_MASK)
+       << ANCHOR_ORDINAL_POSITION);
+  item->data[0] = (uint32_t)bits;
+  item->data[1] = (uint32_t)(bits >> 32);
+}
+
+bool MeasurementCodec_DecodeAnchor(const ItemStore_MeasurementSample_t* item,
+                                   MeasurementCodec_Anchor_t* anchor) {
+  uint64_t bits = ItemBits(item);
+  if (((bits >> WIDTH_CODE_POSITION) & THREE_BIT_MASK) != ANCHOR_WIDTH_CODE ||
+      ((bits >> NR_OF_DELTAS_POSITION) & THREE_BIT_MASK) != 0) {
+    return false;
+  }
+  anchor->timeS = (uint32_t)(bits >> ANCHOR_TIME_POSITION);
+  anchor->ordinal = (uint32_t)(bits >> ANCHOR_ORDINAL_POSITION) &
+                    MEASUREMENT_CODEC_ORDINAL_MASK;
+  return true;
+}
+
+void MeasurementCodec_EncodeSegment(const MeasurementCodec_Segment_t* segment,
+                                    ItemStore_MeasurementSample_t* item) {
+  uint64_t bits =
+      ((uint64_t)ANCHOR_WIDTH_CODE << WIDTH_CODE_POSITION) |
+      ((uint64_t)SEGMENT_KIND << NR_OF_DELTAS_POSITION) |
+      ((uint64_t)segment->intervalS << SEGMENT_INTERVAL_POSITION) |
+      ((uint64_t)(segment->firstOrdinal & MEASUREMENT_CODEC_ORDINAL_MASK)
+       << SEGMENT_ORDINAL_POSITION);
+  item->data[0] = (uint32_t)bits;
+  item->data[1] = (uint32_t)(bits >> 32);
+}
+
+bool MeasurementCodec_DecodeSegment(const ItemStore_MeasurementSample_t* item,
+                                    MeasurementCodec_Segment_t* segment) {
+  uint64_t bits = ItemBits(item);
+  if (((bits >> WIDTH_CODE_POSITION) & THREE_BIT_MASK) != ANCHOR_WIDTH_CODE ||
+      ((bits >> NR_OF_DELTAS_POSITION) & THREE_BIT_MASK) != SEGMENT_KIND) {
+    return false;
+  }
+  segment->intervalS = (uint32_t)(bits >> SEGMENT_INTERVAL_POSITION);
+  segment->firstOrdinal = (uint32_t)(bits >> SEGMENT_ORDINAL_POSITION) &
+                          MEASUREMENT_CODEC_ORDINAL_MASK;
+  return true;
+}
+
+static uint8_t WidthCodeOf(int32_t delta) {
+  for (uint8_t widthCode = 1; widthCode < COUNT_OF(_deltaWidth);
+       widthCode++) {
+    int32_t limit = 1L << (_deltaWidth[widthCode] - 1);
+    if (delta >= -limit && delta < limit) {
+      return widthCode;
+    }
+  }
+  return COUNT_OF(_deltaWidth);
+}
+
+static void EncodeItem(const MeasurementCodec_Encoder_t* encoder,
+                       ItemStore_MeasurementSample_t* item) {
+  uint8_t width = _deltaWidth[encoder->widthCode];
+  uint32_t deltaMask = (1UL << width) - 1;
+  const ItemStore_Sample_t* samples = encoder->samples;
+  uint64_t bits =
+      ((uint64_t)encoder->widthCode << WIDTH_CODE_POSITION) |
+      ((uint64_t)(encoder->nrOfSamples - 1) << NR_OF_DELTAS_POSITION) |
+      ((uint64_t)samples[0].temperatureTicks << BASE_TEMPERATURE_POSITION) |
+      ((uint64_t)samples[0].humidityTicks << BASE_HUMIDITY_POSITION);
+  uint8_t position = FIRST_DELTA_POSITION;
+  for (uint8_t i = 1; i < encoder->nrOfSamples; i++) {
+    uint32_t temperatureDelta = (uint32_t)(samples[i].temperatureTicks -
+                                          samples[i - 1].temperatureTicks);
+    uint32_t humidityDelta =
+        (uint32_t)(samples[i].humidityTicks - samples[i - 1].humidityTicks);
+    bits |= (uint64_t)(temperatureDelta & deltaMask) << position;
+    position += width;
+    bits |= (uint64_t)(humidityDelta & deltaMask) << position;
+    position += width;
+  }
+  item->data[0] = (uint32_t)bits;
+  item->data[1] = (uint32_t)(bits >> 32);
+}
+
+static uint64_t ItemBits(const ItemStore_MeasurementSample_t* item) {
+  return ((uint64_t)item->data[1] << 32) | item->data[0];
+}
+
+static int32_t SignExtend(uint32_t value, uint8_t width) {
+  uint32_t signBit = 1UL << (width - 1);
+  return (int32_t)(value ^ signBit) - (int32_t)signBit;
+}
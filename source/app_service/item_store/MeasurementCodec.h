@@ -0,0 +1,182 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file MeasurementCodec.h
+///
+/// Compression of measurement samples into the 8 byte items of the
+/// measurement item store.
+///
+/// Consecutive samples of the moving average differ only by a few ticks.
+/// Instead of two raw samples, an item holds a base sample followed by up to
+/// six deltas to the respective preceding sample. All deltas of an item are
+/// stored with the same bit width; the smaller the deltas, the more samples
+/// fit into one item.
+///
+/// The 64 bits of an item are laid out as follows (bit 0 is the least
+/// significant bit of data[0]):
+///
+/// | bits   | content                                         |
+/// |--------|-------------------------------------------------|
+/// | 0..2   | width code of the deltas                        |
+/// | 3..5   | number of deltas                                |
+/// | 6..21  | temperature ticks of the base sample            |
+/// | 22..37 | humidity ticks of the base sample               |
+/// | 38..63 | deltas; temperature and humidity for each delta |
+///
+/// Every item is self-contained. An item can be decoded without knowing
+/// any other item, so enumerating may start at any item. An item of zero
+/// bits is the remains of a cut write and holds no sample; a lone sample
+/// with zero ticks, which is far outside the range of the sensor, is taken
+/// for such remains.
+///
+/// Anchor items (width code 6) do not hold samples. They carry the log time
+/// in seconds (bits 6..37) and the ordinal (bits 38..63) of the sample that
+/// follows the anchor. Anchors allow to locate samples by time or ordinal
+/// without decoding the whole log.
+///
+/// Segment items use the width code of the anchors with 1 in bits 3..5. They
+/// carry the logging interval in seconds (bits 6..37) and the ordinal of the
+/// first sample logged with this interval (bits 38..63).
+///
+/// The items of firmware 1.0.0 hold two raw samples; data[0] and data[1]
+/// each carry the temperature ticks in the lower and the humidity ticks in
+/// the upper half. They are only read from the legacy log of the item store.
+#ifndef MEASUREMENT_CODEC_H
+#define MEASUREMENT_CODEC_H
+
+#include "ItemStore.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Maximal number of samples that fit into one measurement item
+#define MEASUREMENT_CODEC_MAX_SAMPLES_PER_ITEM 7
+
+/// Number of samples of an item of firmware 1.0.0
+#define MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM 2
+
+/// Mask of the sample ordinal that is stored in an anchor item
+#define MEASUREMENT_CODEC_ORDINAL_MASK 0x3FFFFFFUL
+
+/// Time and position information that is stored in an anchor item
+typedef struct _tMeasurementCodec_Anchor {
+  uint32_t timeS;    ///< Log time of the next sample in seconds
+  uint32_t ordinal;  ///< Ordinal of the next sample
+} MeasurementCodec_Anchor_t;
+
+/// Logging interval that is stored in a segment item
+typedef struct _tMeasurementCodec_Segment {
+  uint32_t intervalS;     ///< Logging interval of the samples in seconds
+  uint32_t firstOrdinal;  ///< Ordinal of the first sample of the segment
+} MeasurementCodec_Segment_t;
+
+/// Collects samples until a measurement item is complete
+typedef struct _tMeasurementCodec_Encoder {
+  /// Samples that are not yet written to an item
+  ItemStore_Sample_t samples[MEASUREMENT_CODEC_MAX_SAMPLES_PER_ITEM];
+  uint8_t nrOfSamples;  ///< Number of pending samples
+  uint8_t widthCode;    ///< Width code required by the pending samples
+} MeasurementCodec_Encoder_t;
+
+/// Reset the encoder; all pending samples are dropped.
+/// @param encoder The encoder to be reset
+void MeasurementCodec_InitEncoder(MeasurementCodec_Encoder_t* encoder);
+
+/// Add a sample to the encoder.
+///
+/// If the sample does not fit into the pending item anymore or the item is
+/// full, the item is completed and written to the output parameter.
+/// @param encoder The encoder that collects the samples
+/// @param sample The sample to be added
+/// @param [out] item Receives the completed item
+/// @return true if an item was completed; false otherwise
+bool MeasurementCodec_AddSample(MeasurementCodec_Encoder_t* encoder,
+                                const ItemStore_Sample_t* sample,
+                                ItemStore_MeasurementSample_t* item);
+
+/// Get the number of samples that are not yet written to an item.
+/// @param encoder The encoder that collects the samples
+/// @return Number of pending samples
+uint8_t MeasurementCodec_PendingSamples(
+    const MeasurementCodec_Encoder_t* encoder);
+
+/// Get the number of samples contained in an item without decoding it.
+/// @param item The item to be inspected
+/// @return Number of samples in the item; 0 if the item is an anchor, a
+///         segment or not valid
+uint8_t MeasurementCodec_NrOfSamples(const ItemStore_MeasurementSample_t* item);
+
+/// Decode all samples of an item.
+/// @param item The item to be decoded
+/// @param [out] samples Buffer to receive the samples; the buffer needs to
+///                      hold MEASUREMENT_CODEC_MAX_SAMPLES_PER_ITEM samples
+/// @return Number of decoded samples; 0 if the item is not valid
+uint8_t MeasurementCodec_DecodeItem(const ItemStore_MeasurementSample_t* item,
+                                    ItemStore_Sample_t* samples);
+
+/// Decode an item of firmware 1.0.0.
+/// @param item The item to be decoded
+/// @param [out] samples Buffer to receive the samples; the buffer needs to
+///                      hold MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM samples
+/// @return Number of decoded samples
+uint8_t MeasurementCodec_DecodeLegacyItem(
+    const ItemStore_MeasurementSample_t* item,
+    ItemStore_Sample_t* samples);
+
+/// Build an anchor item.
+/// @param anchor Time and ordinal of the sample that follows the anchor
+/// @param [out] item Receives the anchor item
+void MeasurementCodec_EncodeAnchor(const MeasurementCodec_Anchor_t* anchor,
+                                   ItemStore_MeasurementSample_t* item);
+
+/// Decode an anchor item.
+/// @param item The item to be decoded
+/// @param [out] anchor Receives the time and ordinal of the anchor
+/// @return true if the item is an anchor item; false otherwise
+bool MeasurementCodec_DecodeAnchor(const ItemStore_MeasurementSample_t* item,
+                                   MeasurementCodec_Anchor_t* anchor);
+
+/// Build a segment item.
+/// @param segment Logging interval and first ordinal of the segment
+/// @param [out] item Receives the segment item
+void MeasurementCodec_EncodeSegment(const MeasurementCodec_Segment_t* segment,
+                                    ItemStore_MeasurementSample_t* item);
+
+/// Decode a segment item.
+/// @param item The item to be decoded
+/// @param [out] segment Receives the logging interval and the first ordinal
+/// @return true if the item is a segment item; false otherwise
+bool MeasurementCodec_DecodeSegment(const ItemStore_MeasurementSample_t* item,
+                                    MeasurementCodec_Segment_t* segment);
+
+#endif  // MEASUREMENT_CODEC_H
@@ -35,8 +35,13 @@
 #include "MeasurementItemController.h"
 
 #include "ItemStore.h"
+#include "MeasurementCodec.h"
+#include "MeasurementLog.h"
+#include "MeasurementSummary.h"
 #include "app_service/networking/ble/BleGatt.h"
 #include "app_service/networking/ble/BleInterface.h"
+#include "app_service/networking/ble/DownloadTelemetry.h"
+#include "app_service/networking/ble/gatt_service/DataLoggerService.h"
 #include "app_service/sensor/Sht4x.h"
 #include "utility/AppDefines.h"
 #include "utility/ErrorHandler.h"
@@ -45,29 +50,54 @@
 
 /// Structure used while serving a data readout request.
 typedef struct _tSampleRequestData {
-  /// metadata to be sent to ble context
-  BleTypes_SamplesMetaData_t metadata;
+  /// metadata and first sequence number to be sent to ble context
+  BleTypes_SampleDownload_t download;
 
-  /// Start index of the enumerator
-  uint16_t enumeratorStartIndex;
+  /// Enumerator to read the samples of the download
+  ItemStore_Enumerator_t enumerator;
+
+  /// Index of the item where the download starts
+  uint32_t enumeratorStartIndex;
+
+  /// Number of items of the legacy log that are read before the item at the
+  /// enumerator start index
+  uint32_t legacyItemsToRead;
+
+  /// Number of samples to skip in the first read item. These are all
+  /// samples that are older than the requested ones.
+  uint32_t samplesToSkip;
+
+  /// Flag to indicate that the newest item of the legacy log was read; the
+  /// legacy log is deleted once the download is complete.
+  bool isLegacyLogRead;
 
   /// Number requested samples
   uint16_t requestedNrOfSamples;
 
+  /// Age range of the requested samples; a range of {0, 0} does not
+  /// restrict the samples by age.
+  BleTypes_SampleAgeRange_t requestedAgeRange;
+
+  /// Sequence number of the newest sample the client already has;
+  /// BLE_TYPES_NO_SEQUENCE_NUMBER if the download is not resumed.
+  uint32_t resumeSequenceNumber;
+
+  /// BleTypes_SampleTier_t of the next download
+  uint8_t tier;
+
   /// Number of already read samples
   uint16_t alreadyReadSamples;
 
-  /// Extra sample to be read because of uneven number of samples requested.
-  /// The value is 0 or 1!
-  uint8_t extraSample;
+  /// Samples of the last read item; an item may be split over two frame
+  /// buffers. A summary is decoded to MEASUREMENT_SUMMARY_SAMPLES_PER_RECORD
+  /// samples, which is less than a measurement item holds.
+  ItemStore_Sample_t decoded[MEASUREMENT_CODEC_MAX_SAMPLES_PER_ITEM];
 
-  /// A buffer to hold one page of samples;
-  /// Since we cannot add more samples while enumerating, we read page by page
-  /// and release the enumerator after each read.
-  ItemStore_MeasurementSample_t samplesCache[510];
+  /// Number of samples in decoded
+  uint8_t nrOfDecoded;
 
-  /// Data structure that is returned to the ble context
-  BleGatt_RequestResponseData_t responseData;
+  /// Position of the next sample in decoded that is not yet sent
+  uint8_t nextDecoded;
 } SampleRequestData_t;
 
 /// Defines the structure of the measurement item controller.
@@ -89,19 +119,31 @@ typedef struct _tMeasurementItemController {
   float coefficient[2];
   /// flag to indicate if items can be added to the item store
   bool isAddItemPossible;
-  /// Count number of pending erases. When we set the logging interval when
-  /// a page wrap happens, we might end up in a situation where we have two
-  /// erase done messages!
+  /// Count number of pending erases. Coalesced erase requests are
+  /// acknowledged by a single erase done message.
   int8_t nrOfPendingErase;
-  /// flag to indicate that a new sample is ready to be inserted into the item store
-  bool isSampleReady;
-  /// current sample index
-  uint8_t currentSampleIndex;
-  /// Flag to indicate that the logging interval needs to be saved in the
-  /// system settings
-  bool isLoggingIntervalChanged;
-  /// Samples that will be inserted into the item store as soon as possible
-  ItemStore_MeasurementSample_t samples ALIGN(8);
+  /// Number of items at the end of the items of the log writer that are
+  /// ready to be inserted into the item store
+  uint8_t nrOfReadyItems;
+  /// Compresses the samples into the items of the measurement log
+  MeasurementLog_Writer_t writer;
+  /// Log time in seconds; counts the elapsed time since the log was started.
+  /// There is no wall clock, hence the time that elapsed during a reset is
+  /// not accounted for.
+  uint32_t logTimeS;
+  /// Flag to indicate that the segment, the anchor and the item are being
+  /// written
+  bool isBatchPending;
+  /// Flag to indicate that the log position needs to be recovered from the
+  /// item store after a reset
+  bool isRecoveryRequired;
+  /// Aggregates the samples into hourly and daily summaries
+  MeasurementSummary_Aggregator_t aggregator;
+  /// Completed summary of each tier
+  ItemStore_SummaryRecord_t summaries[MEASUREMENT_SUMMARY_NR_OF_TIERS] ALIGN(8);
+  /// Bit mask of the tiers whose summary still needs to be added to the
+  /// item store
+  uint8_t readySummaries;
 
 } MeasurementItemController_t;
 
@@ -131,36 +173,108 @@ static bool HandleBleServiceRequest(Message_Message_t* msg);
 static void SaveReadySamples(bool canAddItem);
 
 /// Enumerator callback to count the number of available samples.
+/// @param enumerator The enumerator of the measurement log
 /// @param enumeratorReady Flag that indicates if enumerator is ready to use
-static void CountSamples(bool enumeratorReady);
+static void CountSamples(ItemStore_Enumerator_t* enumerator,
+                         bool enumeratorReady);
+
+/// Enumerator callback to recover the log time, the sample ordinal and the
+/// segment from the anchors after a reset.
+/// @param enumerator The enumerator of the measurement log
+/// @param enumeratorReady Flag that indicates if enumerator is ready to use
+static void RecoverLogPosition(ItemStore_Enumerator_t* enumerator,
+                               bool enumeratorReady);
+
+/// Add the oldest ready summary to the item store of its tier.
+static void SaveReadySummary();
+
+/// Start an empty log with the next epoch; the samples of the legacy log
+/// become the oldest samples of the log.
+static void StartLog();
+
+/// Save the epoch of the log writer in the settings; the settings are only
+/// written if the epoch changed.
+static void SaveLogEpoch();
+
+/// Callback that signals that the segment, the anchor and the data item are
+/// written
+/// @param success true if all items were written; false otherwise
+static void OnAnchoredItemAdded(bool success);
 
 /// Evaluate the number of samples and initialize the sample request structure;
-/// @param enumeratorReady
-static void BeginReadSamples(bool enumeratorReady);
+/// @param enumerator The download enumerator of a sample request
+/// @param enumeratorReady Flag that indicates if enumerator is ready to use
+static void BeginReadSamples(ItemStore_Enumerator_t* enumerator,
+                             bool enumeratorReady);
+
+/// Evaluate the number of summaries of the selected tier and initialize the
+/// sample request structure.
+/// @param enumerator The download enumerator of a sample request
+/// @param enumeratorReady Flag that indicates if enumerator is ready to use
+static void BeginReadSummaries(ItemStore_Enumerator_t* enumerator,
+                               bool enumeratorReady);
+
+/// Get the sample request of a client.
+/// @param client Index of the client
+/// @return The sample request; 0 if the index is not valid
+static SampleRequestData_t* RequestOfClient(uint8_t client);
+
+/// Get the sample request that reads with a download enumerator.
+/// @param enumerator The download enumerator of a sample request
+/// @return The sample request
+static SampleRequestData_t* RequestOfEnumerator(
+    ItemStore_Enumerator_t* enumerator);
+
+/// Decode an item of the item store that is downloaded.
+/// @param tier BleTypes_SampleTier_t of the download
+/// @param item The item to be decoded
+/// @param [out] samples Receives the samples of the item
+/// @return Number of decoded samples; 0 if the item holds no samples
+static uint8_t DecodeDownloadItem(uint8_t tier,
+                                  const ItemStore_ItemStruct_t* item,
+                                  ItemStore_Sample_t* samples);
 
 /// Compute averaging coefficients
 /// @param loggingInterval used logging interval
 static void ComputeAveragingCoefficients(uint32_t loggingInterval);
 
-/// Read a bunch of data into the sample cache and notify the data to the
-/// BLE context;
-/// @param enumeratorReady
-static void ReadMoreSamples(bool enumeratorReady);
+/// Fill a frame buffer with the next requested samples and hand it back
+/// to the BLE context.
+///
+/// The samples are read with the download enumerator of the client that
+/// stays open for the whole download.
+/// @param buffer The frame buffer to be filled
+static void FillFrameBuffer(DataLoggerService_FrameBuffer_t* buffer);
 
-/// Structure to hold the state of the sample request
-static SampleRequestData_t _sampleRequest;
+/// State of the sample request of each client; the data logger service
+/// resets the sequence number and the tier when a client connects.
+static SampleRequestData_t _sampleRequest[BLE_TYPES_MAX_CLIENTS];
 
 /// Enumerator to be used to service various requests
 static ItemStore_Enumerator_t _sampleEnumerator;
 
+/// Enumerator to recover the log position after a reset
+static ItemStore_Enumerator_t _recoveryEnumerator;
+
+/// Item store that holds the samples of each tier
+static const ItemStore_ItemDef_t _tierItemStore[] = {
+    [BLE_TYPES_SAMPLE_TIER_RAW] = ITEM_DEF_MEASUREMENT_SAMPLE,
+    [BLE_TYPES_SAMPLE_TIER_HOURLY] = ITEM_DEF_HOURLY_SUMMARY,
+    [BLE_TYPES_SAMPLE_TIER_DAILY] = ITEM_DEF_DAILY_SUMMARY};
+
+/// Item store that holds the summaries of each summary tier
+static const ItemStore_ItemDef_t
+    _summaryItemStore[MEASUREMENT_SUMMARY_NR_OF_TIERS] = {
+        [MEASUREMENT_SUMMARY_TIER_HOURLY] = ITEM_DEF_HOURLY_SUMMARY,
+        [MEASUREMENT_SUMMARY_TIER_DAILY] = ITEM_DEF_DAILY_SUMMARY};
+
 /// Definition of Measurement item controller
 static MeasurementItemController_t _measurementItemController = {
     .loggingIntervalS = 60,
     .remainingTimeS = 60,
-    .currentSampleIndex = 0,
-    .isSampleReady = false,
-    .isLoggingIntervalChanged = false,
     .isAddItemPossible = true,
+    .writer.segment.intervalS = 60,
+    .writer.itemsSinceAnchor = MEASUREMENT_LOG_ITEMS_PER_ANCHOR,
     .coefficient = {5.0f / 6.0f, 1.0f / 6.0f},
     .listener.currentMessageHandlerCb = ItemStoreIdleState,
     .listener.receiveMask = MESSAGE_BROKER_CATEGORY_ITEM_STORE |
@@ -169,6 +283,13 @@ static MeasurementItemController_t _measurementItemController = {
                             MESSAGE_BROKER_CATEGORY_TIME_INFORMATION |
                             MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST};
 
+/// Batch to write a segment and an anchor together with the item that
+/// follows them
+static ItemStore_ItemBatch_t _anchoredBatch = {
+    .items = _measurementItemController.writer.items,
+    .nrOfItems = MEASUREMENT_LOG_ITEMS_PER_BATCH,
+    .onDoneCb = OnAnchoredItemAdded};
+
 MessageListener_Listener_t* MeasurementItemController_Instance() {
   return &_measurementItemController.listener;
 }
@@ -183,11 +304,11 @@ static bool ItemStoreIdleState(Message_Message_t* msg) {
   }
   if (msg->header.category == MESSAGE_BROKER_CATEGORY_SYSTEM_STATE_CHANGE) {
     if (msg->header.id == MESSAGE_ID_BLE_SUBSYSTEM_READY) {
-      if (msg->header.parameter1 == 1 &&
-          !ItemStore_IsEmpty(ITEM_DEF_MEASUREMENT_SAMPLE)) {
-        // Only delete the items in case of a power on reset
-        ItemStore_DeleteAllItems(ITEM_DEF_MEASUREMENT_SAMPLE);
-      }
+      // continue the log as soon as the logging interval is known; the log
+      // and the summaries are kept after any reset, also after a power on
+      // reset.
+      _measurementItemController.isRecoveryRequired =
+          !ItemStore_IsEmpty(ITEM_DEF_MEASUREMENT_SAMPLE);
       return true;
     }
     if (msg->header.id == MESSAGE_ID_DEVICE_SETTINGS_READ) {
@@ -196,6 +317,16 @@ static bool ItemStoreIdleState(Message_Message_t* msg) {
       _measurementItemController.loggingIntervalS =
           settings->loggingInterval / 1000;
       ComputeAveragingCoefficients(_measurementItemController.loggingIntervalS);
+      _measurementItemController.writer.epoch =
+          settings->logEpoch % MEASUREMENT_LOG_NR_OF_EPOCHS;
+      if (_measurementItemController.isRecoveryRequired) {
+        _measurementItemController.isRecoveryRequired = false;
+        _recoveryEnumerator.startIndex = 0;
+        ItemStore_BeginEnumerate(ITEM_DEF_MEASUREMENT_SAMPLE,
+                                 &_recoveryEnumerator, RecoverLogPosition);
+      } else {
+        StartLog();
+      }
       return true;
     }
   }
@@ -211,7 +342,8 @@ static bool ItemStoreIdleState(Message_Message_t* msg) {
       return true;
     }
     if (msg->header.id == ITEM_STORE_MESSAGE_ERASE_DONE) {
-      _measurementItemController.nrOfPendingErase--;
+      // coalesced erase requests are served by the same erase
+      _measurementItemController.nrOfPendingErase -= msg->header.parameter1;
       // that should actually never happen
       if (_measurementItemController.nrOfPendingErase < 0) {
         _measurementItemController.nrOfPendingErase = 0;
@@ -220,21 +352,7 @@ static bool ItemStoreIdleState(Message_Message_t* msg) {
           (_measurementItemController.nrOfPendingErase == 0);
 
       // write unsaved changes to the item store
-      if (_measurementItemController.isAddItemPossible) {
-        // when the erase is done we have to save the logging interval if this
-        // was the reason for the erase.
-        if (_measurementItemController.isLoggingIntervalChanged) {
-          Message_Message_t saveMsg = {
-              .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
-              .header.id = SERVICE_REQUEST_MESSAGE_ID_SAVE_LOGGING_INTERVAL,
-              .parameter2 = _measurementItemController.loggingIntervalS * 1000};
-          Message_PublishAppMessage(&saveMsg);
-          _measurementItemController.isLoggingIntervalChanged = false;
-        } else {
-          // Saving the samples we may defer to the time event
-          SaveReadySamples(_measurementItemController.isAddItemPossible);
-        }
-      }
+      SaveReadySamples(_measurementItemController.isAddItemPossible);
       return true;
     }
   }
@@ -258,36 +376,113 @@ static void UpdateMovingAverage(Sht4x_SensorMessage_t* msg) {
 }
 
 static void EvalTimeEvent(Message_Message_t* msg, bool canAddItem) {
+  _measurementItemController.logTimeS += msg->header.parameter1;
   _measurementItemController.remainingTimeS -= msg->header.parameter1;
   if (_measurementItemController.remainingTimeS <= 0) {
     _measurementItemController.remainingTimeS =
         _measurementItemController.loggingIntervalS;
-    _measurementItemController.samples
-        .sample[_measurementItemController.currentSampleIndex]
+    ItemStore_Sample_t sample = {
         .temperatureTicks =
-        (uint16_t)(_measurementItemController.temperatureAverage + 0.5f);
-    _measurementItemController.samples
-        .sample[_measurementItemController.currentSampleIndex]
+            (uint16_t)(_measurementItemController.temperatureAverage + 0.5f),
         .humidityTicks =
-        (uint16_t)(_measurementItemController.humidityAverage + 0.5f);
-    _measurementItemController.currentSampleIndex =
-        (_measurementItemController.currentSampleIndex + 1) % 2;
-
-    _measurementItemController.isSampleReady =
-        // don't clear if already set (should never happen)
-        (_measurementItemController.isSampleReady ||
-         (_measurementItemController.currentSampleIndex == 0));
+            (uint16_t)(_measurementItemController.humidityAverage + 0.5f)};
+    _measurementItemController.readySummaries |= MeasurementSummary_AddSample(
+        &_measurementItemController.aggregator, &sample,
+        _measurementItemController.loggingIntervalS,
+        _measurementItemController.summaries);
+    uint8_t nrOfItems =
+        MeasurementLog_AddSample(&_measurementItemController.writer, &sample,
+                                 _measurementItemController.logTimeS);
+    // don't shrink the ready items if some are not yet written (should never
+    // happen)
+    if (nrOfItems > _measurementItemController.nrOfReadyItems) {
+      _measurementItemController.nrOfReadyItems = nrOfItems;
+    }
   }
   SaveReadySamples(canAddItem);
 }
 
 static void SaveReadySamples(bool canAddItem) {
-  if (_measurementItemController.isSampleReady && canAddItem) {
-    ItemStore_AddItem(
-        ITEM_DEF_MEASUREMENT_SAMPLE,
-        (ItemStore_ItemStruct_t*)&_measurementItemController.samples);
-    _measurementItemController.isSampleReady = false;
+  if (!canAddItem || _measurementItemController.isBatchPending) {
+    return;
   }
+  // one item is added at a time; adding an item may start an erase that
+  // needs to be done before the next item can be added.
+  if (_measurementItemController.nrOfReadyItems == 0) {
+    SaveReadySummary();
+    return;
+  }
+  if (_measurementItemController.nrOfReadyItems > 1) {
+    _measurementItemController.isBatchPending = true;
+    ItemStore_AddItems(ITEM_DEF_MEASUREMENT_SAMPLE, &_anchoredBatch);
+  } else {
+    ItemStore_AddItem(ITEM_DEF_MEASUREMENT_SAMPLE,
+                      (ItemStore_ItemStruct_t*)&_measurementItemController
+                          .writer.items[MEASUREMENT_LOG_ITEMS_PER_BATCH - 1]);
+  }
+  _measurementItemController.nrOfReadyItems = 0;
+}
+
+static void SaveReadySummary() {
+  for (uint8_t i = 0; i < MEASUREMENT_SUMMARY_NR_OF_TIERS; i++) {
+    if ((_measurementItemController.readySummaries & (1U << i)) != 0) {
+      _measurementItemController.readySummaries &= ~(1U << i);
+      ItemStore_AddItem(
+          _summaryItemStore[i],
+          (ItemStore_ItemStruct_t*)&_measurementItemController.summaries[i]);
+      return;
+    }
+  }
+}
+
+static void OnAnchoredItemAdded(bool success) {
+  _measurementItemController.isBatchPending = false;
+  if (!success) {
+    // start over with a new anchor at the next item
+    MeasurementLog_RequestAnchor(&_measurementItemController.writer);
+  }
+}
+
+static void RecoverLogPosition(ItemStore_Enumerator_t* enumerator,
+                               bool enumeratorReady) {
+  MeasurementLog_Bounds_t bounds = {0};
+  if (enumeratorReady) {
+    MeasurementLog_ScanBounds(enumerator, &bounds);
+  }
+  ItemStore_EndEnumerate(&_recoveryEnumerator, ITEM_DEF_MEASUREMENT_SAMPLE);
+  if (!bounds.isAnchored) {
+    StartLog();
+    return;
+  }
+  // the samples that were not yet written are lost with the reset and the
+  // duration of the reset is unknown; the log continues after the newest
+  // sample in the item store.
+  MeasurementLog_ContinueWriter(&_measurementItemController.writer, &bounds,
+                                _measurementItemController.loggingIntervalS);
+  SaveLogEpoch();
+  // the next sample is taken when the remaining time has elapsed
+  _measurementItemController.logTimeS =
+      bounds.endTimeS -
+      MIN((uint32_t)_measurementItemController.remainingTimeS,
+          bounds.endTimeS);
+}
+
+static void StartLog() {
+  MeasurementLog_InitWriter(&_measurementItemController.writer,
+                            _measurementItemController.loggingIntervalS);
+  SaveLogEpoch();
+  // the log time of the oldest sample of the legacy log is one interval
+  _measurementItemController.logTimeS =
+      _measurementItemController.writer.nextOrdinal *
+      _measurementItemController.loggingIntervalS;
+}
+
+static void SaveLogEpoch() {
+  Message_Message_t saveMsg = {
+      .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
+      .header.id = SERVICE_REQUEST_MESSAGE_ID_SAVE_LOG_EPOCH,
+      .parameter2 = _measurementItemController.writer.epoch};
+  Message_PublishAppMessage(&saveMsg);
 }
 
 static bool HandleBleServiceRequest(Message_Message_t* message) {
@@ -309,22 +504,17 @@ static bool HandleBleServiceRequest(Message_Message_t* message) {
     }
     if (newInterval != _measurementItemController.loggingIntervalS) {
       _measurementItemController.loggingIntervalS = newInterval;
-      _measurementItemController.currentSampleIndex = 0;
-      _measurementItemController.isSampleReady = false;
+      // the log is kept; the samples with the new interval form a new
+      // segment that is downloaded separately.
+      MeasurementLog_StartSegment(&_measurementItemController.writer,
+                                  newInterval);
       // accumulate at most over one hour
       ComputeAveragingCoefficients(newInterval);
-      // avoid unnecessary flash erase in order to save power and
-      // erase cycles!
-      if (!ItemStore_IsEmpty(ITEM_DEF_MEASUREMENT_SAMPLE)) {
-        _measurementItemController.isLoggingIntervalChanged = true;
-        ItemStore_DeleteAllItems(ITEM_DEF_MEASUREMENT_SAMPLE);
-      } else {
-        Message_Message_t saveMsg = {
-            .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
-            .header.id = SERVICE_REQUEST_MESSAGE_ID_SAVE_LOGGING_INTERVAL,
-            .parameter2 = _measurementItemController.loggingIntervalS * 1000};
-        Message_PublishAppMessage(&saveMsg);
-      }
+      Message_Message_t saveMsg = {
+          .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
+          .header.id = SERVICE_REQUEST_MESSAGE_ID_SAVE_LOGGING_INTERVAL,
+          .parameter2 = _measurementItemController.loggingIntervalS * 1000};
+      Message_PublishAppMessage(&saveMsg);
     }
     return true;
   }
@@ -335,27 +525,71 @@ static bool HandleBleServiceRequest(Message_Message_t* message) {
     return true;
   }
 
+  if (message->header.id == SERVICE_REQUEST_MESSAGE_ID_GET_NEXT_SAMPLES) {
+    DataLoggerService_FrameBuffer_t* buffer =
+        (DataLoggerService_FrameBuffer_t*)message->parameter2;
+    // a request is stale once its buffer is requested again
+    if (buffer->generation == message->header.parameter1) {
+      FillFrameBuffer(buffer);
+    }
+    return true;
+  }
+
+  // the remaining requests concern the download of one client
+  SampleRequestData_t* request = RequestOfClient(message->header.parameter1);
+  if (request == 0) {
+    return false;
+  }
+
   if (message->header.id == SERVICE_REQUEST_MESSAGE_ID_SET_REQUESTED_SAMPLES) {
-    _sampleRequest.requestedNrOfSamples = message->parameter2;
-    _sampleRequest.alreadyReadSamples = 0;
-    ItemStore_BeginEnumerate(ITEM_DEF_MEASUREMENT_SAMPLE, &_sampleEnumerator,
-                             BeginReadSamples);
+    // a new request replaces a download that was not completed
+    ItemStore_EndEnumerate(&request->enumerator,
+                           _tierItemStore[request->download.tier]);
+    request->requestedNrOfSamples = message->parameter2;
+    request->alreadyReadSamples = 0;
+    request->nrOfDecoded = 0;
+    request->nextDecoded = 0;
+    request->isLegacyLogRead = false;
+    request->download.tier = request->tier;
+    request->download.client = message->header.parameter1;
+    request->enumerator.startIndex = 0;
+    ItemStore_BeginEnumerate(
+        _tierItemStore[request->tier], &request->enumerator,
+        request->tier == BLE_TYPES_SAMPLE_TIER_RAW ? BeginReadSamples
+                                                   : BeginReadSummaries);
     return true;
   }
 
-  if (message->header.id == SERVICE_REQUEST_MESSAGE_ID_GET_NEXT_SAMPLES) {
-    // we may use the enumerator for other purposes; hence the start index
-    // is always reinitialized.
-    _sampleEnumerator.startIndex = _sampleRequest.enumeratorStartIndex;
-    ItemStore_BeginEnumerate(ITEM_DEF_MEASUREMENT_SAMPLE, &_sampleEnumerator,
-                             ReadMoreSamples);
+  if (message->header.id ==
+      SERVICE_REQUEST_MESSAGE_ID_SET_REQUESTED_AGE_RANGE) {
+    request->requestedAgeRange =
+        *((BleTypes_SampleAgeRange_t*)message->parameter2);
+    return true;
+  }
+
+  if (message->header.id == SERVICE_REQUEST_MESSAGE_ID_SET_RESUME_SEQUENCE) {
+    request->resumeSequenceNumber = message->parameter2;
+    return true;
+  }
+
+  if (message->header.id == SERVICE_REQUEST_MESSAGE_ID_SET_SAMPLE_TIER) {
+    if (message->parameter2 < BLE_TYPES_NR_OF_SAMPLE_TIERS) {
+      request->tier = message->parameter2;
+    }
+    return true;
+  }
+
+  if (message->header.id == SERVICE_REQUEST_MESSAGE_ID_END_SAMPLE_DOWNLOAD) {
+    ItemStore_EndEnumerate(&request->enumerator,
+                           _tierItemStore[request->download.tier]);
     return true;
   }
 
   return false;
 }
 
-static void CountSamples(bool enumeratorReady) {
+static void CountSamples(ItemStore_Enumerator_t* enumerator,
+                         bool enumeratorReady) {
   BleInterface_Message_t msg = {
       .head.category = MESSAGE_BROKER_CATEGORY_BLE_EVENT,
       .head.id = BLE_INTERFACE_MSG_ID_SVC_REQ_RESPONSE,
@@ -367,89 +601,208 @@ static void CountSamples(bool enumeratorReady) {
     BleInterface_PublishBleMessage((Message_Message_t*)&msg);
     return;
   }
-  msg.parameter.responseData = ItemStore_Count(&_sampleEnumerator) * 2;
+  MeasurementLog_Bounds_t bounds;
+  MeasurementLog_ScanBounds(&_sampleEnumerator, &bounds);
+  msg.parameter.responseData = bounds.endOrdinal - bounds.firstOrdinal;
   BleInterface_PublishBleMessage((Message_Message_t*)&msg);
   ItemStore_EndEnumerate(&_sampleEnumerator, ITEM_DEF_MEASUREMENT_SAMPLE);
 }
 
-static void BeginReadSamples(bool enumeratorReady) {
+static void BeginReadSamples(ItemStore_Enumerator_t* enumerator,
+                             bool enumeratorReady) {
+  SampleRequestData_t* request = RequestOfEnumerator(enumerator);
   BleInterface_Message_t msg = {
       .head.category = MESSAGE_BROKER_CATEGORY_BLE_EVENT,
       .head.id = BLE_INTERFACE_MSG_ID_SVC_REQ_RESPONSE,
       .head.parameter1 = SERVICE_REQUEST_MESSAGE_ID_SET_REQUESTED_SAMPLES,
-      .parameter.responsePtr = 0};
+      .parameter.responsePtr = &request->download};
 
   // in case of an empty log we play the same sequence but with no samples
-  uint16_t availableSamples = 0;
+  MeasurementLog_Bounds_t bounds = {0};
   if (enumeratorReady) {
-    availableSamples = ItemStore_Count(&_sampleEnumerator) * 2;
+    MeasurementLog_ScanBounds(enumerator, &bounds);
   }
-  ItemStore_EndEnumerate(&_sampleEnumerator, ITEM_DEF_MEASUREMENT_SAMPLE);
-  _sampleRequest.metadata.numberOfSamples =
-      MIN(availableSamples, _sampleRequest.requestedNrOfSamples);
-  _sampleRequest.extraSample = _sampleRequest.metadata.numberOfSamples % 2;
-
-  msg.parameter.responsePtr = &_sampleRequest.metadata;
-  _sampleRequest.metadata.loggingIntervalMs =
-      _measurementItemController.loggingIntervalS * 1000;
-
-  // compute where we need to start reading from.
-  _sampleRequest.enumeratorStartIndex = 0;
-  if (availableSamples > _sampleRequest.metadata.numberOfSamples) {
-    _sampleRequest.enumeratorStartIndex =
-        (availableSamples - _sampleRequest.metadata.numberOfSamples -
-         _sampleRequest.extraSample) /
-        2;
-  }
-  // compute the age of the last sample in flash
-  // this is a number between 0 and loggingIntervalS
-  int32_t time_until_next_log_entry =
+  MeasurementLog_Request_t selectRequest = {
+      .maxNrOfSamples = request->requestedNrOfSamples,
+      .nowS = _measurementItemController.logTimeS,
+      .minAgeS = request->requestedAgeRange.minAgeS,
+      .maxAgeS = request->requestedAgeRange.maxAgeS,
+      .isResumed =
+          request->resumeSequenceNumber != BLE_TYPES_NO_SEQUENCE_NUMBER,
+      .resumeSequenceNumber = request->resumeSequenceNumber,
+      .epoch = _measurementItemController.writer.epoch};
+  MeasurementLog_Selection_t selection;
+  MeasurementLog_Select(enumerator, &bounds, &selectRequest, &selection);
+  request->download.metadata.numberOfSamples = selection.nrOfSamples;
+  request->download.firstSequenceNumber = selection.firstSequenceNumber;
+  request->enumeratorStartIndex = selection.startIndex;
+  request->legacyItemsToRead = selection.legacyItemsToRead;
+  request->samplesToSkip = selection.samplesToSkip;
+  // the enumerator stays open until all requested samples are read
+  if (selection.nrOfSamples == 0 ||
+      !ItemStore_Seek(enumerator, selection.startIndex)) {
+    ItemStore_EndEnumerate(enumerator, ITEM_DEF_MEASUREMENT_SAMPLE);
+  }
+  // without samples, the age tells when the next sample is logged
+  uint32_t intervalS = _measurementItemController.loggingIntervalS;
+  uint32_t ageS = MAX(0, MIN(_measurementItemController.loggingIntervalS,
+                             (_measurementItemController.loggingIntervalS -
+                              _measurementItemController.remainingTimeS)));
+  if (selection.nrOfSamples > 0) {
+    intervalS = selection.intervalS;
+    ageS = _measurementItemController.logTimeS - selection.newestTimeS;
+  }
+  request->download.metadata.loggingIntervalMs = intervalS * 1000;
+  request->download.metadata.ageOfLatestSample = ageS * 1000;
+  // now that all information is assembled, send it back to the ble context
+  BleInterface_PublishBleMessage((Message_Message_t*)&msg);
+}
+
+static void BeginReadSummaries(ItemStore_Enumerator_t* enumerator,
+                               bool enumeratorReady) {
+  SampleRequestData_t* request = RequestOfEnumerator(enumerator);
+  BleInterface_Message_t msg = {
+      .head.category = MESSAGE_BROKER_CATEGORY_BLE_EVENT,
+      .head.id = BLE_INTERFACE_MSG_ID_SVC_REQ_RESPONSE,
+      .head.parameter1 = SERVICE_REQUEST_MESSAGE_ID_SET_REQUESTED_SAMPLES,
+      .parameter.responsePtr = &request->download};
+
+  MeasurementSummary_Tier_t tier = (MeasurementSummary_Tier_t)(
+      request->download.tier - BLE_TYPES_SAMPLE_TIER_HOURLY);
+  int32_t nrOfRecords = 0;
+  if (enumeratorReady) {
+    nrOfRecords = MAX(0, ItemStore_Count(enumerator));
+  }
+  // the requested number counts summaries; the newest ones are sent. Age
+  // range and sequence number apply to the logged samples only.
+  uint32_t selected =
+      MIN(MIN((uint32_t)nrOfRecords, request->requestedNrOfSamples),
+          UINT16_MAX / MEASUREMENT_SUMMARY_SAMPLES_PER_RECORD);
+  request->download.metadata.numberOfSamples =
+      selected * MEASUREMENT_SUMMARY_SAMPLES_PER_RECORD;
+  request->download.metadata.loggingIntervalMs =
+      MeasurementSummary_PeriodS(tier) * 1000;
+  request->download.firstSequenceNumber = BLE_TYPES_NO_SEQUENCE_NUMBER;
+  request->enumeratorStartIndex = nrOfRecords - selected;
+  request->legacyItemsToRead = 0;
+  request->samplesToSkip = 0;
+  if (selected == 0 || !ItemStore_Seek(enumerator,
+                                       request->enumeratorStartIndex)) {
+    ItemStore_EndEnumerate(enumerator, _summaryItemStore[tier]);
+  }
+  // the newest summary ends where the running period begins
+  int32_t sinceLastSampleS =
       MAX(0, MIN(_measurementItemController.loggingIntervalS,
                  (_measurementItemController.loggingIntervalS -
                   _measurementItemController.remainingTimeS)));
-  _sampleRequest.metadata.ageOfLatestSample =
-      (time_until_next_log_entry +
-       (_sampleRequest.extraSample +
-        _measurementItemController.currentSampleIndex) *
-           _measurementItemController.loggingIntervalS) *
+  request->download.metadata.ageOfLatestSample =
+      (MeasurementSummary_ElapsedS(&_measurementItemController.aggregator,
+                                   tier) +
+       sinceLastSampleS) *
       1000;
-  // now that all information is assembled, send it back to the ble context
   BleInterface_PublishBleMessage((Message_Message_t*)&msg);
 }
 
-static void ReadMoreSamples(bool enumeratorReady) {
+static void FillFrameBuffer(DataLoggerService_FrameBuffer_t* buffer) {
   BleInterface_Message_t msg = {
       .head.category = MESSAGE_BROKER_CATEGORY_BLE_EVENT,
       .head.id = BLE_INTERFACE_MSG_ID_SVC_REQ_RESPONSE,
       .head.parameter1 = SERVICE_REQUEST_MESSAGE_ID_GET_NEXT_SAMPLES,
-      .parameter.responsePtr = 0};
-
-  if (!enumeratorReady) {
-    ItemStore_EndEnumerate(&_sampleEnumerator, ITEM_DEF_MEASUREMENT_SAMPLE);
-    ErrorHandler_RecoverableError(ERROR_CODE_ITEM_STORE);
-    return;
+      .parameter.responsePtr = buffer};
+
+  uint16_t fillStamp = DownloadTelemetry_Stamp();
+  DownloadTelemetry_AddBrokerDelay(buffer->publishedStamp);
+  SampleRequestData_t* request = RequestOfClient(buffer->client);
+  ASSERT(request != 0);
+  DataLoggerService_ClearFrameBuffer(buffer);
+  uint16_t unreadSamples = request->download.metadata.numberOfSamples -
+                           request->alreadyReadSamples;
+  bool isBufferFull = false;
+  ItemStore_ItemStruct_t item;
+  while (buffer->nrOfSamples < unreadSamples) {
+    if (request->nextDecoded < request->nrOfDecoded) {
+      // the number of samples per buffer depends on how well they compress
+      if (!DataLoggerService_PutSample(
+              buffer, (uint8_t*)&request->decoded[request->nextDecoded])) {
+        isBufferFull = true;
+        break;
+      }
+      request->nextDecoded++;
+      continue;
+    }
+    if (request->legacyItemsToRead > 0) {
+      // the page of the item may be given up meanwhile
+      request->legacyItemsToRead--;
+      if (!ItemStore_ReadLegacyLogItem(ITEM_DEF_MEASUREMENT_SAMPLE,
+                                       request->legacyItemsToRead,
+                                       &item.measurement,
+                                       sizeof item.measurement)) {
+        break;
+      }
+      request->isLegacyLogRead = request->legacyItemsToRead == 0;
+      request->nrOfDecoded = MeasurementCodec_DecodeLegacyItem(
+          &item.measurement, request->decoded);
+    } else if (request->enumerator.hasMoreItems &&
+               ItemStore_GetNext(&request->enumerator, &item)) {
+      request->nrOfDecoded =
+          DecodeDownloadItem(request->download.tier, &item, request->decoded);
+    } else {
+      break;
+    }
+    request->nextDecoded = request->nrOfDecoded;
+    if (request->samplesToSkip >= request->nrOfDecoded) {
+      request->samplesToSkip -= request->nrOfDecoded;
+      continue;
+    }
+    request->nextDecoded = request->samplesToSkip;
+    request->samplesToSkip = 0;
   }
-  uint16_t index = 0;
-  uint16_t unreadSamples = _sampleRequest.extraSample +
-                           _sampleRequest.metadata.numberOfSamples -
-                           _sampleRequest.alreadyReadSamples * 2;
-  while (_sampleEnumerator.hasMoreItems &&
-         index < COUNT_OF(_sampleRequest.samplesCache) &&
-         index < unreadSamples) {
-    ItemStore_GetNext(
-        &_sampleEnumerator,
-        (ItemStore_ItemStruct_t*)&_sampleRequest.samplesCache[index++]);
+  request->alreadyReadSamples += buffer->nrOfSamples;
+  // all samples are read or the unread items were erased
+  if (!isBufferFull || request->alreadyReadSamples ==
+                           request->download.metadata.numberOfSamples) {
+    ItemStore_EndEnumerate(&request->enumerator,
+                           _tierItemStore[request->download.tier]);
+    // the legacy log is kept until its newest samples are downloaded
+    if (request->isLegacyLogRead &&
+        request->alreadyReadSamples ==
+            request->download.metadata.numberOfSamples) {
+      ItemStore_DeleteLegacyItems(ITEM_DEF_MEASUREMENT_SAMPLE);
+    }
   }
-  ItemStore_EndEnumerate(&_sampleEnumerator, ITEM_DEF_MEASUREMENT_SAMPLE);
-  _sampleRequest.enumeratorStartIndex += index;
-  _sampleRequest.alreadyReadSamples += index;
-  _sampleRequest.responseData.dataLength =
-      index * sizeof(ItemStore_MeasurementSample_t);
-  _sampleRequest.responseData.data = (uint8_t*)_sampleRequest.samplesCache;
-  msg.parameter.responsePtr = &_sampleRequest.responseData;
+  DownloadTelemetry_AddEnumerationTime(fillStamp);
+  buffer->publishedStamp = DownloadTelemetry_Stamp();
   BleInterface_PublishBleMessage((Message_Message_t*)&msg);
 }
 
+static SampleRequestData_t* RequestOfClient(uint8_t client) {
+  if (client >= BLE_TYPES_MAX_CLIENTS) {
+    return 0;
+  }
+  return &_sampleRequest[client];
+}
+
+static SampleRequestData_t* RequestOfEnumerator(
+    ItemStore_Enumerator_t* enumerator) {
+  for (uint8_t i = 0; i < BLE_TYPES_MAX_CLIENTS; i++) {
+    if (&_sampleRequest[i].enumerator == enumerator) {
+      return &_sampleRequest[i];
+    }
+  }
+  // the callback is only registered for the download enumerators
+  ASSERT(false);
+  return &_sampleRequest[0];
+}
+
+static uint8_t DecodeDownloadItem(uint8_t tier,
+                                  const ItemStore_ItemStruct_t* item,
+                                  ItemStore_Sample_t* samples) {
+  if (tier == BLE_TYPES_SAMPLE_TIER_RAW) {
+    return MeasurementCodec_DecodeItem(&item->measurement, samples);
+  }
+  return MeasurementSummary_DecodeRecord(&item->summary, samples);
+}
+
 static void ComputeAveragingCoefficients(uint32_t loggingInterval) {
   float divider = MIN(loggingInterval, 3600) / 5.0f;
   _measurementItemController.coefficient[1] = 1.0f / divider;
@@ -39,11 +39,17 @@
 ///   A moving average is computed over humidity ticks and temperature ticks.
 ///
 /// - When the logging interval elapses, the computed average value is
-///   added to the measurement item of the item store.
+///   added to the measurement item of the item store. The samples are
+///   compressed with the MeasurementCodec; an item holds a variable number of
+///   samples.
 ///
 /// - When the measurement item is complete it is added to the item store if
 ///   this is possible. Else a reminder is set and it will be inserted at a
 ///   later time.
+///
+/// - Each logged sample is aggregated into hourly and daily summaries with
+///   the MeasurementSummary. Completed summaries are added to the item
+///   stores of their tier; a client selects the tier it downloads.
 #ifndef MEASUREMENT_ITEM_CONTROLLER_H
 #define MEASUREMENT_ITEM_CONTROLLER_H
 
@@ -0,0 +1,490 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file MeasurementLog.c
+#include "MeasurementLog.h"
+
+#include <string.h>
+
+/// Maximal number of consecutive items without an anchor item: the data
+/// items, the segment item and the remains of a batch whose write was cut
+/// by a power loss.
+#define MAX_ITEMS_WITHOUT_ANCHOR (MEASUREMENT_LOG_ITEMS_PER_ANCHOR + 3)
+
+/// Position of the data item within the items of the writer
+#define DATA_ITEM (MEASUREMENT_LOG_ITEMS_PER_BATCH - 1)
+
+/// Key callback to locate an anchor by its log time.
+/// @param item The item to be inspected
+/// @param [out] key Receives the log time of an anchor
+/// @return true if the item is an anchor; false otherwise
+static bool KeyOfTime(const ItemStore_ItemStruct_t* item, uint32_t* key);
+
+/// Key callback to locate an anchor by its ordinal.
+/// @param item The item to be inspected
+/// @param [out] key Receives the ordinal of an anchor
+/// @return true if the item is an anchor; false otherwise
+static bool KeyOfOrdinal(const ItemStore_ItemStruct_t* item, uint32_t* key);
+
+/// Key callback to locate a segment item by the first ordinal of the
+/// segment.
+/// @param item The item to be inspected
+/// @param [out] key Receives the first ordinal of a segment
+/// @return true if the item is a segment item; false otherwise
+static bool KeyOfSegment(const ItemStore_ItemStruct_t* item, uint32_t* key);
+
+/// Read the items of an enumerator up to the next anchor item that follows
+/// a segment item.
+/// @param enumerator A ready enumerator of the measurement log
+/// @param [in,out] index Index of the next item of the enumerator; it is
+///                       advanced by the number of read items
+/// @param maxItems Maximal number of items that are read before the anchor
+/// @param [out] position Receives the anchor and its segment
+/// @param [out] nrOfSamples Receives the number of samples that were read
+///                          before the anchor
+/// @return true if an anchor was found; false otherwise
+static bool ReadToAnchor(ItemStore_Enumerator_t* enumerator,
+                         uint32_t* index,
+                         uint32_t maxItems,
+                         MeasurementLog_Anchor_t* position,
+                         uint32_t* nrOfSamples);
+
+/// Locate the newest anchor whose key is not above a key.
+/// @param enumerator A ready enumerator of the measurement log
+/// @param bounds Bounds of the log
+/// @param key Log time or ordinal to be searched
+/// @param keyOfItem KeyOfTime or KeyOfOrdinal
+/// @param [out] position Receives the found anchor or the oldest anchor if
+///                       all anchors are above the key
+static void Locate(ItemStore_Enumerator_t* enumerator,
+                   const MeasurementLog_Bounds_t* bounds,
+                   uint32_t key,
+                   ItemStore_KeyOfItemCb_t keyOfItem,
+                   MeasurementLog_Anchor_t* position);
+
+/// Count the samples that follow an anchor up to the next anchor.
+/// @param enumerator A ready enumerator of the measurement log
+/// @param position The anchor
+/// @return Number of samples of the anchor
+static uint32_t SamplesOfAnchor(ItemStore_Enumerator_t* enumerator,
+                                const MeasurementLog_Anchor_t* position);
+
+/// Get the ordinal that follows the newest sample of a segment.
+///
+/// If the newest anchor of the segment can not be found, e.g. because the
+/// write of an anchored batch was cut, the segment ends with the samples of
+/// the given anchor; a resumed download then continues from there.
+/// @param enumerator A ready enumerator of the measurement log
+/// @param bounds Bounds of the log
+/// @param position An anchor of the segment
+/// @return The ordinal following the segment
+static uint32_t SegmentEnd(ItemStore_Enumerator_t* enumerator,
+                           const MeasurementLog_Bounds_t* bounds,
+                           const MeasurementLog_Anchor_t* position);
+
+/// Get the ordinal of the oldest sample that is not older than a log time.
+/// @param enumerator A ready enumerator of the measurement log
+/// @param bounds Bounds of the log
+/// @param timeS Log time in seconds
+/// @return The sample ordinal within the bounds of the log
+static uint32_t OrdinalAtTime(ItemStore_Enumerator_t* enumerator,
+                              const MeasurementLog_Bounds_t* bounds,
+                              uint32_t timeS);
+
+/// Set the first sample of a selection.
+/// @param selection The selection
+/// @param request Selection criteria
+/// @param ordinal Ordinal of the first sample
+static void SetFirstOrdinal(MeasurementLog_Selection_t* selection,
+                            const MeasurementLog_Request_t* request,
+                            uint32_t ordinal);
+
+/// Get the log time of a sample from an anchor of its segment.
+/// @param position An anchor of the segment of the sample
+/// @param ordinal Ordinal of the sample
+/// @return Log time of the sample in seconds
+static uint32_t TimeOfOrdinal(const MeasurementLog_Anchor_t* position,
+                              uint32_t ordinal);
+
+void MeasurementLog_InitWriter(MeasurementLog_Writer_t* writer,
+                               uint32_t intervalS) {
+  writer->epoch = (writer->epoch + 1) % MEASUREMENT_LOG_NR_OF_EPOCHS;
+  MeasurementCodec_InitEncoder(&writer->encoder);
+  writer->nextOrdinal =
+      MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM *
+      ItemStore_CountLegacyLogItems(ITEM_DEF_MEASUREMENT_SAMPLE);
+  writer->segment.intervalS = intervalS;
+  writer->segment.firstOrdinal = 0;
+  writer->itemsSinceAnchor = MEASUREMENT_LOG_ITEMS_PER_ANCHOR;
+}
+
+void MeasurementLog_ContinueWriter(MeasurementLog_Writer_t* writer,
+                                   const MeasurementLog_Bounds_t* bounds,
+                                   uint32_t intervalS) {
+  if (!bounds->isAnchored) {
+    MeasurementLog_InitWriter(writer, intervalS);
+    return;
+  }
+  MeasurementCodec_InitEncoder(&writer->encoder);
+  writer->nextOrdinal = bounds->endOrdinal & MEASUREMENT_CODEC_ORDINAL_MASK;
+  writer->segment = bounds->last.segment;
+  if (writer->segment.intervalS != intervalS) {
+    writer->segment.intervalS = intervalS;
+    writer->segment.firstOrdinal = writer->nextOrdinal;
+  }
+  writer->itemsSinceAnchor = MEASUREMENT_LOG_ITEMS_PER_ANCHOR;
+}
+
+void MeasurementLog_StartSegment(MeasurementLog_Writer_t* writer,
+                                 uint32_t intervalS) {
+  writer->nextOrdinal =
+      (writer->nextOrdinal -
+       MeasurementCodec_PendingSamples(&writer->encoder)) &
+      MEASUREMENT_CODEC_ORDINAL_MASK;
+  MeasurementCodec_InitEncoder(&writer->encoder);
+  writer->segment.intervalS = intervalS;
+  writer->segment.firstOrdinal = writer->nextOrdinal;
+  writer->itemsSinceAnchor = MEASUREMENT_LOG_ITEMS_PER_ANCHOR;
+}
+
+void MeasurementLog_RequestAnchor(MeasurementLog_Writer_t* writer) {
+  writer->itemsSinceAnchor = MEASUREMENT_LOG_ITEMS_PER_ANCHOR;
+}
+
+uint8_t MeasurementLog_AddSample(MeasurementLog_Writer_t* writer,
+                                 const ItemStore_Sample_t* sample,
+                                 uint32_t timeS) {
+  uint32_t ordinal = writer->nextOrdinal;
+  writer->nextOrdinal = (ordinal + 1) & MEASUREMENT_CODEC_ORDINAL_MASK;
+  if (!MeasurementCodec_AddSample(&writer->encoder, sample,
+                                  &writer->items[DATA_ITEM])) {
+    return 0;
+  }
+  if (writer->itemsSinceAnchor < MEASUREMENT_LOG_ITEMS_PER_ANCHOR) {
+    writer->itemsSinceAnchor++;
+    return 1;
+  }
+  // the anchor refers to the first sample of the completed item
+  uint32_t samplesSinceItemStart =
+      MeasurementCodec_NrOfSamples(&writer->items[DATA_ITEM]) +
+      MeasurementCodec_PendingSamples(&writer->encoder) - 1;
+  MeasurementCodec_Anchor_t anchor = {
+      .timeS = timeS - samplesSinceItemStart * writer->segment.intervalS,
+      .ordinal = ordinal - samplesSinceItemStart};
+  MeasurementCodec_EncodeSegment(&writer->segment, &writer->items[0]);
+  MeasurementCodec_EncodeAnchor(&anchor, &writer->items[1]);
+  writer->itemsSinceAnchor = 1;
+  return MEASUREMENT_LOG_ITEMS_PER_BATCH;
+}
+
+void MeasurementLog_ScanBounds(ItemStore_Enumerator_t* enumerator,
+                               MeasurementLog_Bounds_t* bounds) {
+  memset(bounds, 0, sizeof *bounds);
+  int32_t nrOfItems = ItemStore_Count(enumerator);
+  uint32_t index = 0;
+  if (nrOfItems <= 0 || !ItemStore_Seek(enumerator, 0) ||
+      !ReadToAnchor(enumerator, &index, MAX_ITEMS_WITHOUT_ANCHOR,
+                    &bounds->first, &bounds->unanchoredSamples)) {
+    return;
+  }
+  // the legacy log precedes the oldest item
+  bounds->legacySamples =
+      MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM *
+      ItemStore_CountLegacyLogItems(ITEM_DEF_MEASUREMENT_SAMPLE);
+  bounds->unanchoredSamples += bounds->legacySamples;
+  // the segment item and the newest anchor are among the last items
+  bounds->last = bounds->first;
+  int32_t tailIndex = nrOfItems - MAX_ITEMS_WITHOUT_ANCHOR - 2;
+  if (tailIndex > (int32_t)index) {
+    index = tailIndex;
+    if (!ItemStore_Seek(enumerator, index)) {
+      return;
+    }
+  }
+  uint32_t samplesAfterLast = 0;
+  MeasurementLog_Anchor_t anchor;
+  while (ReadToAnchor(enumerator, &index, nrOfItems, &anchor,
+                      &samplesAfterLast)) {
+    bounds->last = anchor;
+  }
+  bounds->isAnchored = true;
+  // the samples before the oldest anchor are available as far as they
+  // belong to its segment; the interval of an older segment is unknown.
+  bounds->firstOrdinal =
+      bounds->first.anchor.ordinal -
+      MIN(bounds->unanchoredSamples,
+          bounds->first.anchor.ordinal - bounds->first.segment.firstOrdinal);
+  bounds->endOrdinal = bounds->last.anchor.ordinal + samplesAfterLast;
+  bounds->endTimeS = bounds->last.anchor.timeS +
+                     samplesAfterLast * bounds->last.segment.intervalS;
+}
+
+uint32_t MeasurementLog_SequenceNumber(uint8_t epoch, uint32_t ordinal) {
+  return ((uint32_t)epoch << MEASUREMENT_LOG_EPOCH_POSITION) |
+         (ordinal & MEASUREMENT_CODEC_ORDINAL_MASK);
+}
+
+void MeasurementLog_Select(ItemStore_Enumerator_t* enumerator,
+                           const MeasurementLog_Bounds_t* bounds,
+                           const MeasurementLog_Request_t* request,
+                           MeasurementLog_Selection_t* selection) {
+  memset(selection, 0, sizeof *selection);
+  SetFirstOrdinal(selection, request, bounds->endOrdinal);
+  if (!bounds->isAnchored) {
+    return;
+  }
+  uint32_t first = bounds->firstOrdinal;
+  uint32_t end = bounds->endOrdinal;
+  uint32_t nowS = request->nowS;
+  if (request->maxAgeS != 0) {
+    first = OrdinalAtTime(enumerator, bounds,
+                          nowS - MIN(request->maxAgeS, nowS));
+  }
+  if (request->minAgeS != 0) {
+    end = OrdinalAtTime(enumerator, bounds,
+                        nowS - MIN(request->minAgeS, nowS) + 1);
+  }
+  // a resumed download starts after the newest sample of the client; if
+  // the sequence number belongs to another epoch or is beyond the log, the
+  // client has the samples of another log and gets the newest samples.
+  uint32_t resumeOrdinal =
+      request->resumeSequenceNumber & MEASUREMENT_CODEC_ORDINAL_MASK;
+  bool isResumed = request->isResumed &&
+                   request->resumeSequenceNumber ==
+                       MeasurementLog_SequenceNumber(request->epoch,
+                                                     resumeOrdinal) &&
+                   resumeOrdinal < bounds->endOrdinal;
+  if (isResumed && resumeOrdinal >= first) {
+    first = resumeOrdinal + 1;
+  }
+  MeasurementLog_Anchor_t start;
+  MeasurementLog_Anchor_t newest;
+  if (first >= end) {
+    SetFirstOrdinal(selection, request, end);
+    return;
+  }
+  if (isResumed) {
+    // the oldest missing samples are sent first such that the client can
+    // resume again after an interrupted download.
+    Locate(enumerator, bounds, first, KeyOfOrdinal, &start);
+    uint32_t segmentEnd = SegmentEnd(enumerator, bounds, &start);
+    end = MIN(end, segmentEnd);
+    end = MIN(end, first + request->maxNrOfSamples);
+  } else {
+    Locate(enumerator, bounds, end - 1, KeyOfOrdinal, &newest);
+    first = MAX(first, newest.segment.firstOrdinal);
+    if (end - first > request->maxNrOfSamples) {
+      first = end - request->maxNrOfSamples;
+    }
+  }
+  SetFirstOrdinal(selection, request, first);
+  if (first >= end) {
+    return;
+  }
+  if (isResumed) {
+    Locate(enumerator, bounds, end - 1, KeyOfOrdinal, &newest);
+  } else {
+    Locate(enumerator, bounds, first, KeyOfOrdinal, &start);
+  }
+  selection->nrOfSamples = end - first;
+  selection->intervalS = newest.segment.intervalS;
+  selection->newestTimeS = TimeOfOrdinal(&newest, end - 1);
+  // the number of samples per item varies; the older samples of the start
+  // item are skipped while reading.
+  if (first >= start.anchor.ordinal) {
+    selection->startIndex = start.index + 1;
+    selection->samplesToSkip = first - start.anchor.ordinal;
+    return;
+  }
+  // the first samples are stored before the oldest anchor; the samples of
+  // the legacy log come first.
+  uint32_t offset =
+      first - (bounds->first.anchor.ordinal - bounds->unanchoredSamples);
+  if (offset >= bounds->legacySamples) {
+    selection->samplesToSkip = offset - bounds->legacySamples;
+    return;
+  }
+  selection->legacyItemsToRead =
+      (bounds->legacySamples - offset +
+       MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM - 1) /
+      MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM;
+  selection->samplesToSkip = offset % MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM;
+}
+
+static bool KeyOfTime(const ItemStore_ItemStruct_t* item, uint32_t* key) {
+  MeasurementCodec_Anchor_t anchor;
+  if (!MeasurementCodec_DecodeAnchor(&item->measurement, &anchor)) {
+    return false;
+  }
+  *key = anchor.timeS;
+  return true;
+}
+
+static bool KeyOfOrdinal(const ItemStore_ItemStruct_t* item, uint32_t* key) {
+  MeasurementCodec_Anchor_t anchor;
+  if (!MeasurementCodec_DecodeAnchor(&item->measurement, &anchor)) {
+    return false;
+  }
+  *key = anchor.ordinal;
+  return true;
+}
+
+static bool KeyOfSegment(const ItemStore_ItemStruct_t* item, uint32_t* key) {
+  MeasurementCodec_Segment_t segment;
+  if (!MeasurementCodec_DecodeSegment(&item->measurement, &segment)) {
+    return false;
+  }
+  *key = segment.firstOrdinal;
+  return true;
+}
+
+static bool ReadToAnchor(ItemStore_Enumerator_t* enumerator,
+                         uint32_t* index,
+                         uint32_t maxItems,
+                         MeasurementLog_Anchor_t* position,
+                         uint32_t* nrOfSamples) {
+  *nrOfSamples = 0;
+  bool isSegmentRead = false;
+  ItemStore_MeasurementSample_t item;
+  for (uint32_t i = 0; i <= maxItems && enumerator->hasMoreItems; i++) {
+    if (!ItemStore_GetNext(enumerator, (ItemStore_ItemStruct_t*)&item)) {
+      return false;
+    }
+    (*index)++;
+    // an anchor without its segment item is the remains of a torn batch
+    if (isSegmentRead &&
+        MeasurementCodec_DecodeAnchor(&item, &position->anchor)) {
+      position->index = *index - 1;
+      return true;
+    }
+    isSegmentRead = MeasurementCodec_DecodeSegment(&item, &position->segment) &&
+                    position->segment.intervalS > 0;
+    *nrOfSamples += MeasurementCodec_NrOfSamples(&item);
+  }
+  return false;
+}
+
+static void Locate(ItemStore_Enumerator_t* enumerator,
+                   const MeasurementLog_Bounds_t* bounds,
+                   uint32_t key,
+                   ItemStore_KeyOfItemCb_t keyOfItem,
+                   MeasurementLog_Anchor_t* position) {
+  *position = bounds->first;
+  uint32_t index;
+  // an older anchor lost its segment item with the erased page before it
+  if (!ItemStore_SeekKey(enumerator, key, keyOfItem, MAX_ITEMS_WITHOUT_ANCHOR,
+                         &index) ||
+      index <= bounds->first.index) {
+    return;
+  }
+  // the segment item precedes the anchor item
+  index--;
+  uint32_t nrOfSamples;
+  MeasurementLog_Anchor_t found;
+  if (ItemStore_Seek(enumerator, index) &&
+      ReadToAnchor(enumerator, &index, 1, &found, &nrOfSamples)) {
+    *position = found;
+  }
+}
+
+static uint32_t SamplesOfAnchor(ItemStore_Enumerator_t* enumerator,
+                                const MeasurementLog_Anchor_t* position) {
+  uint32_t index = position->index + 1;
+  uint32_t nrOfSamples = 0;
+  MeasurementLog_Anchor_t next;
+  if (ItemStore_Seek(enumerator, index)) {
+    ReadToAnchor(enumerator, &index, MAX_ITEMS_WITHOUT_ANCHOR, &next,
+                 &nrOfSamples);
+  }
+  return nrOfSamples;
+}
+
+static uint32_t SegmentEnd(ItemStore_Enumerator_t* enumerator,
+                           const MeasurementLog_Bounds_t* bounds,
+                           const MeasurementLog_Anchor_t* position) {
+  uint32_t segmentKey = position->segment.firstOrdinal;
+  if (bounds->last.segment.firstOrdinal == segmentKey) {
+    return bounds->endOrdinal;
+  }
+  // the newest segment item of the segment precedes its newest anchor
+  MeasurementLog_Anchor_t newest = *position;
+  MeasurementLog_Anchor_t found;
+  uint32_t index;
+  uint32_t nrOfSamples;
+  if (ItemStore_SeekKey(enumerator, segmentKey, KeyOfSegment,
+                        MAX_ITEMS_WITHOUT_ANCHOR, &index) &&
+      index >= position->index &&
+      ReadToAnchor(enumerator, &index, 1, &found, &nrOfSamples) &&
+      found.segment.firstOrdinal == segmentKey) {
+    newest = found;
+  }
+  return newest.anchor.ordinal + SamplesOfAnchor(enumerator, &newest);
+}
+
+static uint32_t OrdinalAtTime(ItemStore_Enumerator_t* enumerator,
+                              const MeasurementLog_Bounds_t* bounds,
+                              uint32_t timeS) {
+  MeasurementLog_Anchor_t position;
+  Locate(enumerator, bounds, timeS, KeyOfTime, &position);
+  uint32_t intervalS = position.segment.intervalS;
+  uint32_t ordinal = position.anchor.ordinal;
+  if (timeS < position.anchor.timeS) {
+    // the time is before the oldest anchor
+    return ordinal - MIN((position.anchor.timeS - timeS) / intervalS,
+                         ordinal - bounds->firstOrdinal);
+  }
+  ordinal += (timeS - position.anchor.timeS + intervalS - 1) / intervalS;
+  // the samples of an anchor may end before the time, e.g. when the
+  // logging interval was changed
+  uint32_t endOfAnchor =
+      position.anchor.ordinal + SamplesOfAnchor(enumerator, &position);
+  return MIN(ordinal, endOfAnchor);
+}
+
+static void SetFirstOrdinal(MeasurementLog_Selection_t* selection,
+                            const MeasurementLog_Request_t* request,
+                            uint32_t ordinal) {
+  selection->firstOrdinal = ordinal;
+  selection->firstSequenceNumber =
+      MeasurementLog_SequenceNumber(request->epoch, ordinal);
+}
+
+static uint32_t TimeOfOrdinal(const MeasurementLog_Anchor_t* position,
+                              uint32_t ordinal) {
+  if (ordinal < position->anchor.ordinal) {
+    return position->anchor.timeS -
+           (position->anchor.ordinal - ordinal) * position->segment.intervalS;
+  }
+  return position->anchor.timeS +
+         (ordinal - position->anchor.ordinal) * position->segment.intervalS;
+}
@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file MeasurementLog.h
+///
+/// Layout of the measurement log and lookup of samples by log time and
+/// sample ordinal.
+///
+/// The samples are numbered by their ordinal. Ordinal and log time continue
+/// over resets and changes of the logging interval; the time that elapsed
+/// during a reset is not accounted for. The samples that were logged with
+/// the same interval form a segment.
+///
+/// At most MEASUREMENT_LOG_ITEMS_PER_ANCHOR data items follow each other.
+/// The next data item is written in a batch after a segment item and an
+/// anchor item. The segment item tells the logging interval and the first
+/// ordinal of the segment; the anchor tells the log time and the ordinal of
+/// the sample that follows it. The anchors are located with
+/// `ItemStore_SeekKey()`, such that a lookup reads a few hundred items at
+/// most.
+///
+/// The samples of a download share one logging interval; a selection never
+/// spans more than one segment.
+///
+/// The samples of the legacy log of firmware 1.0.0 take the first ordinals
+/// of the log; they belong to the first segment and precede the samples that
+/// are stored before the oldest anchor.
+///
+/// A client identifies the samples by their sequence number that combines
+/// the ordinal with the epoch of the log. The epoch changes whenever the log
+/// starts empty and the ordinals start over; a client that resumes with the
+/// sequence number of an older log gets the newest samples instead of
+/// skipping the samples up to the stale ordinal.
+#ifndef MEASUREMENT_LOG_H
+#define MEASUREMENT_LOG_H
+
+#include "ItemStore.h"
+#include "MeasurementCodec.h"
+#include "app_common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Maximal number of data items between two anchor items.
+#define MEASUREMENT_LOG_ITEMS_PER_ANCHOR 64
+
+/// Number of items of an anchored batch: segment, anchor and data item
+#define MEASUREMENT_LOG_ITEMS_PER_BATCH 3
+
+/// Position of the epoch within a sequence number; the ordinal takes the
+/// bits below.
+#define MEASUREMENT_LOG_EPOCH_POSITION 26
+
+/// Number of epochs; the sequence numbers of the last epoch stay below
+/// 0xFFFFFFFF, which stands for no sequence number.
+#define MEASUREMENT_LOG_NR_OF_EPOCHS 63
+
+/// Anchor item together with the segment it belongs to
+typedef struct _tMeasurementLog_Anchor {
+  MeasurementCodec_Anchor_t anchor;    ///< Content of the anchor item
+  MeasurementCodec_Segment_t segment;  ///< Content of the segment item
+  uint32_t index;                      ///< Item index of the anchor item
+} MeasurementLog_Anchor_t;
+
+/// Describes the samples that are available in the measurement log
+typedef struct _tMeasurementLog_Bounds {
+  /// Flag to indicate that the log contains anchors; the samples of a log
+  /// without anchors can not be located and are not available.
+  bool isAnchored;
+  MeasurementLog_Anchor_t first;  ///< Oldest anchor of the log
+  MeasurementLog_Anchor_t last;   ///< Newest anchor of the log
+  /// Number of samples that are stored before the oldest anchor; their
+  /// anchor was erased with an older page or they belong to the legacy log.
+  uint32_t unanchoredSamples;
+  /// Number of samples of the legacy log; they are counted as unanchored
+  /// samples.
+  uint32_t legacySamples;
+  uint32_t firstOrdinal;  ///< Ordinal of the oldest sample
+  uint32_t endOrdinal;    ///< Ordinal following the newest sample
+  /// Log time of the sample that follows the newest sample
+  uint32_t endTimeS;
+} MeasurementLog_Bounds_t;
+
+/// Selection criteria of a download
+typedef struct _tMeasurementLog_Request {
+  uint32_t maxNrOfSamples;  ///< Maximal number of selected samples
+  uint32_t nowS;            ///< Actual log time in seconds
+  uint32_t minAgeS;         ///< Minimal age of the samples; 0 for no limit
+  uint32_t maxAgeS;         ///< Maximal age of the samples; 0 for no limit
+  /// Flag to indicate that the client has the samples up to
+  /// resumeSequenceNumber. A resumed download sends the oldest missing
+  /// samples first.
+  bool isResumed;
+  /// Sequence number of the newest sample of the client
+  uint32_t resumeSequenceNumber;
+  uint8_t epoch;  ///< Epoch of the log
+} MeasurementLog_Request_t;
+
+/// Samples that are selected for a download
+typedef struct _tMeasurementLog_Selection {
+  uint32_t firstOrdinal;  ///< Ordinal of the oldest selected sample
+  /// Sequence number of the oldest selected sample
+  uint32_t firstSequenceNumber;
+  uint32_t nrOfSamples;  ///< Number of selected samples
+  uint32_t intervalS;     ///< Logging interval of the selected samples
+  uint32_t newestTimeS;   ///< Log time of the newest selected sample
+  uint32_t startIndex;    ///< Index of the item with the first sample
+  /// Number of items of the legacy log that are read before the item at
+  /// startIndex; the newest of them is read last.
+  uint32_t legacyItemsToRead;
+  /// Number of samples of the first read item that precede the first sample
+  uint32_t samplesToSkip;
+} MeasurementLog_Selection_t;
+
+/// Compresses the samples into the items of the measurement log
+typedef struct _tMeasurementLog_Writer {
+  MeasurementCodec_Encoder_t encoder;  ///< Collects the next data item
+  MeasurementCodec_Segment_t segment;  ///< Segment of the next sample
+  uint32_t nextOrdinal;                ///< Ordinal of the next sample
+  uint8_t epoch;                       ///< Epoch of the log
+  /// Number of data items since the last anchor item
+  uint8_t itemsSinceAnchor;
+  /// Segment, anchor and data item of the next batch; the segment and the
+  /// anchor are only written if an anchor is due.
+  ItemStore_MeasurementSample_t items[MEASUREMENT_LOG_ITEMS_PER_BATCH] ALIGN(8);
+} MeasurementLog_Writer_t;
+
+/// Start an empty log; the log gets the epoch that follows the epoch of the
+/// writer. The samples of the legacy log take the first ordinals.
+/// @param writer The writer of the log
+/// @param intervalS Logging interval in seconds
+void MeasurementLog_InitWriter(MeasurementLog_Writer_t* writer,
+                               uint32_t intervalS);
+
+/// Continue the log after a reset.
+///
+/// The ordinal continues after the newest sample of the log; the segment
+/// continues if the logging interval did not change. A log without anchors
+/// is started over with the next epoch.
+/// @param writer The writer of the log
+/// @param bounds Bounds of the log
+/// @param intervalS Logging interval in seconds
+void MeasurementLog_ContinueWriter(MeasurementLog_Writer_t* writer,
+                                   const MeasurementLog_Bounds_t* bounds,
+                                   uint32_t intervalS);
+
+/// Start a new segment after a change of the logging interval.
+///
+/// The samples that are not yet written to an item are dropped; their
+/// ordinals are given to the next samples.
+/// @param writer The writer of the log
+/// @param intervalS New logging interval in seconds
+void MeasurementLog_StartSegment(MeasurementLog_Writer_t* writer,
+                                 uint32_t intervalS);
+
+/// Precede the next data item with an anchor; used if an anchored batch
+/// could not be written.
+/// @param writer The writer of the log
+void MeasurementLog_RequestAnchor(MeasurementLog_Writer_t* writer);
+
+/// Add a sample to the log.
+/// @param writer The writer of the log
+/// @param sample The sample to be added
+/// @param timeS Log time of the sample in seconds
+/// @return Number of items at the end of writer->items that are ready to be
+///         written: 0, 1 for a data item or MEASUREMENT_LOG_ITEMS_PER_BATCH
+///         for an anchored batch
+uint8_t MeasurementLog_AddSample(MeasurementLog_Writer_t* writer,
+                                 const ItemStore_Sample_t* sample,
+                                 uint32_t timeS);
+
+/// Evaluate the anchors and the number of samples of the measurement log.
+/// @param enumerator A ready enumerator of the measurement log
+/// @param [out] bounds Receives the bounds of the log
+void MeasurementLog_ScanBounds(ItemStore_Enumerator_t* enumerator,
+                               MeasurementLog_Bounds_t* bounds);
+
+/// Get the sequence number of a sample.
+/// @param epoch Epoch of the log
+/// @param ordinal Ordinal of the sample
+/// @return The sequence number
+uint32_t MeasurementLog_SequenceNumber(uint8_t epoch, uint32_t ordinal);
+
+/// Select the samples of a download.
+/// @param enumerator A ready enumerator of the measurement log
+/// @param bounds Bounds of the log
+/// @param request Selection criteria
+/// @param [out] selection Receives the selected samples; a selection without
+///                        samples starts at the end of the log.
+void MeasurementLog_Select(ItemStore_Enumerator_t* enumerator,
+                           const MeasurementLog_Bounds_t* bounds,
+                           const MeasurementLog_Request_t* request,
+                           MeasurementLog_Selection_t* selection);
+
+#endif  // MEASUREMENT_LOG_H
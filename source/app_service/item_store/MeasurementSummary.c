@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file MeasurementSummary.c
+#include "MeasurementSummary.h"
+
+#include <string.h>
+
+/// Start a new period of a tier.
+/// @param accumulator The accumulator of the tier
+static void ClearAccumulator(MeasurementSummary_Accumulator_t* accumulator);
+
+/// Merge samples into the running period of a tier.
+/// @param accumulator The accumulator of the tier
+/// @param minimum Smallest ticks of the merged samples
+/// @param maximum Largest ticks of the merged samples
+/// @param temperatureSum Sum of the temperature ticks of the merged samples
+/// @param humiditySum Sum of the humidity ticks of the merged samples
+/// @param nrOfSamples Number of merged samples
+static void Accumulate(MeasurementSummary_Accumulator_t* accumulator,
+                       const ItemStore_Sample_t* minimum,
+                       const ItemStore_Sample_t* maximum,
+                       uint32_t temperatureSum,
+                       uint32_t humiditySum,
+                       uint16_t nrOfSamples);
+
+/// Build the summary of the running period of a tier.
+/// @param accumulator The accumulator of the tier
+/// @param [out] record Receives the summary
+static void BuildRecord(const MeasurementSummary_Accumulator_t* accumulator,
+                        ItemStore_SummaryRecord_t* record);
+
+void MeasurementSummary_InitAggregator(
+    MeasurementSummary_Aggregator_t* aggregator) {
+  for (uint8_t i = 0; i < MEASUREMENT_SUMMARY_NR_OF_TIERS; i++) {
+    ClearAccumulator(&aggregator->tier[i]);
+  }
+  aggregator->hourElapsedS = 0;
+  aggregator->dayElapsedHours = 0;
+}
+
+uint8_t MeasurementSummary_AddSample(
+    MeasurementSummary_Aggregator_t* aggregator,
+    const ItemStore_Sample_t* sample,
+    uint32_t durationS,
+    ItemStore_SummaryRecord_t records[MEASUREMENT_SUMMARY_NR_OF_TIERS]) {
+  MeasurementSummary_Accumulator_t* hour =
+      &aggregator->tier[MEASUREMENT_SUMMARY_TIER_HOURLY];
+  MeasurementSummary_Accumulator_t* day =
+      &aggregator->tier[MEASUREMENT_SUMMARY_TIER_DAILY];
+  Accumulate(hour, sample, sample, sample->temperatureTicks,
+             sample->humidityTicks, 1);
+  aggregator->hourElapsedS += durationS;
+  if (aggregator->hourElapsedS < MEASUREMENT_SUMMARY_HOUR_S) {
+    return 0;
+  }
+  // a sample of a logging interval above one hour completes several hours
+  uint8_t completedTiers = 1U << MEASUREMENT_SUMMARY_TIER_HOURLY;
+  uint32_t completedHours =
+      aggregator->hourElapsedS / MEASUREMENT_SUMMARY_HOUR_S;
+  aggregator->hourElapsedS %= MEASUREMENT_SUMMARY_HOUR_S;
+  BuildRecord(hour, &records[MEASUREMENT_SUMMARY_TIER_HOURLY]);
+  Accumulate(day, &hour->minimum, &hour->maximum, hour->temperatureSum,
+             hour->humiditySum, hour->nrOfSamples);
+  ClearAccumulator(hour);
+  aggregator->dayElapsedHours += completedHours;
+  if (aggregator->dayElapsedHours >= MEASUREMENT_SUMMARY_HOURS_PER_DAY) {
+    completedTiers |= 1U << MEASUREMENT_SUMMARY_TIER_DAILY;
+    aggregator->dayElapsedHours %= MEASUREMENT_SUMMARY_HOURS_PER_DAY;
+    BuildRecord(day, &records[MEASUREMENT_SUMMARY_TIER_DAILY]);
+    ClearAccumulator(day);
+  }
+  return completedTiers;
+}
+
+uint32_t MeasurementSummary_ElapsedS(
+    const MeasurementSummary_Aggregator_t* aggregator,
+    MeasurementSummary_Tier_t tier) {
+  if (tier == MEASUREMENT_SUMMARY_TIER_HOURLY) {
+    return aggregator->hourElapsedS;
+  }
+  return aggregator->dayElapsedHours * MEASUREMENT_SUMMARY_HOUR_S +
+         aggregator->hourElapsedS;
+}
+
+uint32_t MeasurementSummary_PeriodS(MeasurementSummary_Tier_t tier) {
+  if (tier == MEASUREMENT_SUMMARY_TIER_HOURLY) {
+    return MEASUREMENT_SUMMARY_HOUR_S;
+  }
+  return MEASUREMENT_SUMMARY_HOURS_PER_DAY * MEASUREMENT_SUMMARY_HOUR_S;
+}
+
+uint8_t MeasurementSummary_DecodeRecord(const ItemStore_SummaryRecord_t* record,
+                                        ItemStore_Sample_t* samples) {
+  // an erased or partially written item does not summarize any sample
+  if (record->nrOfSamples == 0 || record->nrOfSamples == UINT16_MAX) {
+    return 0;
+  }
+  samples[0] = record->minimum;
+  samples[1] = record->maximum;
+  samples[2] = record->mean;
+  return MEASUREMENT_SUMMARY_SAMPLES_PER_RECORD;
+}
+
+static void ClearAccumulator(MeasurementSummary_Accumulator_t* accumulator) {
+  memset(accumulator, 0, sizeof(*accumulator));
+}
+
+static void Accumulate(MeasurementSummary_Accumulator_t* accumulator,
+                       const ItemStore_Sample_t* minimum,
+                       const ItemStore_Sample_t* maximum,
+                       uint32_t temperatureSum,
+                       uint32_t humiditySum,
+                       uint16_t nrOfSamples) {
+  if (accumulator->nrOfSamples == 0) {
+    accumulator->minimum = *minimum;
+    accumulator->maximum = *maximum;
+  }
+  if (minimum->temperatureTicks < accumulator->minimum.temperatureTicks) {
+    accumulator->minimum.temperatureTicks = minimum->temperatureTicks;
+  }
+  if (minimum->humidityTicks < accumulator->minimum.humidityTicks) {
+    accumulator->minimum.humidityTicks = minimum->humidityTicks;
+  }
+  if (maximum->temperatureTicks > accumulator->maximum.temperatureTicks) {
+    accumulator->maximum.temperatureTicks = maximum->temperatureTicks;
+  }
+  if (maximum->humidityTicks > accumulator->maximum.humidityTicks) {
+    accumulator->maximum.humidityTicks = maximum->humidityTicks;
+  }
+  accumulator->temperatureSum += temperatureSum;
+  accumulator->humiditySum += humiditySum;
+  accumulator->nrOfSamples += nrOfSamples;
+}
+
+static void BuildRecord(const MeasurementSummary_Accumulator_t* accumulator,
+                        ItemStore_SummaryRecord_t* record) {
+  memset(record, 0, sizeof(*record));
+  record->minimum = accumulator->minimum;
+  record->maximum = accumulator->maximum;
+  // the mean is rounded to the nearest tick
+  uint32_t half = accumulator->nrOfSamples / 2;
+  record->mean.temperatureTicks =
+      (accumulator->temperatureSum + half) / accumulator->nrOfSamples;
+  record->mean.humidityTicks =
+      (accumulator->humiditySum + half) / accumulator->nrOfSamples;
+  record->nrOfSamples = accumulator->nrOfSamples;
+}
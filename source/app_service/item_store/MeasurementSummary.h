@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file MeasurementSummary.h
+///
+/// Aggregation of the logged samples into hourly and daily summaries.
+///
+/// A summary holds the minimum, the maximum and the mean of the temperature
+/// and humidity ticks of all samples that were logged within its period.
+/// The hourly summaries are built from the samples; the daily summaries are
+/// built from the hourly summaries. A client that only needs an overview of
+/// the last weeks downloads a few hundred summaries instead of all samples.
+///
+/// Each sample accounts for the logging interval it was taken with. A
+/// period is complete as soon as the logged samples cover its duration; the
+/// periods are aligned to the start of the aggregation. There is no wall
+/// clock, hence the samples of an incomplete period are lost with a reset.
+/// The stored summaries are kept over any reset like the measurement log;
+/// the aggregation starts over with the first sample after the reset.
+#ifndef MEASUREMENT_SUMMARY_H
+#define MEASUREMENT_SUMMARY_H
+
+#include "ItemStore.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Duration of the period of an hourly summary in seconds
+#define MEASUREMENT_SUMMARY_HOUR_S 3600
+
+/// Number of hourly summaries that make up a daily summary
+#define MEASUREMENT_SUMMARY_HOURS_PER_DAY 24
+
+/// Number of samples a summary is decoded to; minimum, maximum and mean
+#define MEASUREMENT_SUMMARY_SAMPLES_PER_RECORD 3
+
+/// Tiers of summaries
+typedef enum {
+  MEASUREMENT_SUMMARY_TIER_HOURLY = 0,  ///< One summary per hour
+  MEASUREMENT_SUMMARY_TIER_DAILY,       ///< One summary per day
+  MEASUREMENT_SUMMARY_NR_OF_TIERS,
+} MeasurementSummary_Tier_t;
+
+/// Collects the samples of the running period of a tier
+typedef struct _tMeasurementSummary_Accumulator {
+  ItemStore_Sample_t minimum;  ///< Smallest ticks so far
+  ItemStore_Sample_t maximum;  ///< Largest ticks so far
+  uint32_t temperatureSum;     ///< Sum of the temperature ticks
+  uint32_t humiditySum;        ///< Sum of the humidity ticks
+  uint16_t nrOfSamples;        ///< Number of accumulated samples
+} MeasurementSummary_Accumulator_t;
+
+/// Aggregates the samples into the summaries of all tiers
+typedef struct _tMeasurementSummary_Aggregator {
+  /// Running period of each tier
+  MeasurementSummary_Accumulator_t tier[MEASUREMENT_SUMMARY_NR_OF_TIERS];
+  /// Seconds of the running hour that are covered by samples
+  uint32_t hourElapsedS;
+  /// Number of hours of the running day that are complete
+  uint8_t dayElapsedHours;
+} MeasurementSummary_Aggregator_t;
+
+/// Reset the aggregator; the running periods are dropped.
+///
+/// A zero initialized aggregator is in the reset state as well.
+/// @param aggregator The aggregator to be reset
+void MeasurementSummary_InitAggregator(
+    MeasurementSummary_Aggregator_t* aggregator);
+
+/// Add a logged sample to the running periods.
+/// @param aggregator The aggregator that collects the samples
+/// @param sample The logged sample
+/// @param durationS The logging interval the sample was taken with
+/// @param [out] records Receives the summary of each tier whose period was
+///                      completed by this sample
+/// @return Bit mask of the tiers whose summary was completed; bit n is set
+///         for MeasurementSummary_Tier_t n
+uint8_t MeasurementSummary_AddSample(
+    MeasurementSummary_Aggregator_t* aggregator,
+    const ItemStore_Sample_t* sample,
+    uint32_t durationS,
+    ItemStore_SummaryRecord_t records[MEASUREMENT_SUMMARY_NR_OF_TIERS]);
+
+/// Get the number of seconds of the running period of a tier that are
+/// covered by samples.
+/// @param aggregator The aggregator that collects the samples
+/// @param tier The tier of interest
+/// @return The elapsed seconds of the running period
+uint32_t MeasurementSummary_ElapsedS(
+    const MeasurementSummary_Aggregator_t* aggregator,
+    MeasurementSummary_Tier_t tier);
+
+/// Get the duration of the period of a tier.
+/// @param tier The tier of interest
+/// @return The duration of one period in seconds
+uint32_t MeasurementSummary_PeriodS(MeasurementSummary_Tier_t tier);
+
+/// Decode a summary into the samples that are sent to a client.
+/// @param record The summary to be decoded
+/// @param [out] samples Receives minimum, maximum and mean in this order;
+///                      the buffer needs to hold
+///                      MEASUREMENT_SUMMARY_SAMPLES_PER_RECORD samples
+/// @return Number of decoded samples; 0 if the summary is not valid
+uint8_t MeasurementSummary_DecodeRecord(const ItemStore_SummaryRecord_t* record,
+                                        ItemStore_Sample_t* samples);
+
+#endif  // MEASUREMENT_SUMMARY_H
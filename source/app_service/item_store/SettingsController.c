@@ -35,13 +35,14 @@
 #include "SettingsController.h"
 
 #include "app_service/item_store/ItemStore.h"
+#include "app_service/item_store/SettingsStore.h"
 #include "app_service/networking/ble/BleGatt.h"
 #include "app_service/networking/ble/BleInterface.h"
 #include "app_service/nvm/ProductionParameters.h"
-#include "hal/Crc.h"
 #include "utility/scheduler/Message.h"
 #include "utility/scheduler/MessageId.h"
 
+#include <stddef.h>
 #include <string.h>
 
 /// Actual version of the settings
@@ -64,10 +65,6 @@ static ItemStore_SystemConfig_t _defaultSettings = {
     .isAdvertiseDataEnabled = true,
     .loggingInterval = 600000};
 
-/// Actual settings;
-/// The structure needs to be 8 byte aligned!
-static ItemStore_SystemConfig_t _actualSettings ALIGN(8);
-
 /// Default message handler of the settings controller
 /// @param message Message to be processed
 /// @return true if the message was handled; false otherwise
@@ -78,21 +75,16 @@ static bool DefaultStateCB(Message_Message_t* message);
 /// @return true if the message was about handling device settings
 static bool HandleBleServiceRequestCB(Message_Message_t* message);
 
-/// Initializes the settings with the values from flash or the default if
-/// no data is available on the flash
-/// @param ready Flag to indicate if the enumerator is valid and can be used.
-static void InitializeSettings(bool ready);
-
-/// Update the settings and notify the change
+/// Update a field of the settings and notify the change
 /// @param msg parameter2 and the id of this message are forwarded.
+/// @param offset Position of the field within the settings
+/// @param value The new value of the field
+/// @param length Size of the field in bytes
 /// @return always returns true
-static bool UpdateAndNotify(Message_Message_t* msg);
-
-/// Compute the CRC on the actual setting.
-/// This function is used to add the crc when a field was changed and to
-/// check if a setting read from flash is not corrupted.
-/// @return The computed CRC
-static uint32_t ComputeCrcOnActualSetting();
+static bool UpdateAndNotify(Message_Message_t* msg,
+                            uint8_t offset,
+                            const void* value,
+                            uint8_t length);
 
 /// Instance of the settings controller
 static SettingsController_t _controller = {
@@ -100,9 +92,6 @@ static SettingsController_t _controller = {
     .listener.receiveMask = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST |
                             MESSAGE_BROKER_CATEGORY_SYSTEM_STATE_CHANGE};
 
-/// Enumerator to retrieve the most recent setting
-static ItemStore_Enumerator_t _settingsEnumerator = {.startIndex = -1};
-
 MessageListener_Listener_t* SettingsController_Instance() {
   return &_controller.listener;
 }
@@ -115,15 +104,15 @@ static bool DefaultStateCB(Message_Message_t* message) {
       snprintf(_defaultSettings.deviceName, DEVICE_NAME_BUFFER_LENGTH,
                "%s %02lx%c%02lx", ProductionParameters_GetDeviceName(),
                (deviceId >> 8), ':', (deviceId & 0xFF));  // NOLINT
-      ItemStore_BeginEnumerate(ITEM_DEF_SYSTEM_CONFIG, &_settingsEnumerator,
-                               InitializeSettings);
+      // the settings are published when the ble subsystem is ready
+      SettingsStore_Load(&_defaultSettings, 0);
       return true;
     }
     if (message->header.id == MESSAGE_ID_BLE_SUBSYSTEM_READY) {
       Message_Message_t msg = {
           .header.category = MESSAGE_BROKER_CATEGORY_SYSTEM_STATE_CHANGE,
           .header.id = MESSAGE_ID_DEVICE_SETTINGS_READ,
-          .parameter2 = (uint32_t)&_actualSettings};
+          .parameter2 = (uint32_t)SettingsStore_Settings()};
       Message_PublishAppMessage(&msg);
       return true;
     }
@@ -134,64 +123,65 @@ static bool DefaultStateCB(Message_Message_t* message) {
   return false;
 }
 
-static void InitializeSettings(bool ready) {
-  if (!ready || !_settingsEnumerator.hasMoreItems) {
-    _actualSettings = _defaultSettings;
-    return;
-  }
-  ItemStore_GetNext(&_settingsEnumerator,
-                    (ItemStore_ItemStruct_t*)&_actualSettings);
-
-  ItemStore_EndEnumerate(&_settingsEnumerator, ITEM_DEF_SYSTEM_CONFIG);
-  if (ComputeCrcOnActualSetting() != _actualSettings.crc) {
-    _actualSettings = _defaultSettings;
-  }
-}
-
 static bool HandleBleServiceRequestCB(Message_Message_t* message) {
+  const ItemStore_SystemConfig_t* settings = SettingsStore_Settings();
   if (message->header.id == SERVICE_REQUEST_MESSAGE_ID_SAVE_LOGGING_INTERVAL) {
     uint32_t loggingInterval = message->parameter2;
-    if (_actualSettings.loggingInterval == loggingInterval) {
+    if (settings->loggingInterval == loggingInterval) {
       return true;
     }
-    _actualSettings.loggingInterval = loggingInterval;
-    return UpdateAndNotify(message);
+    return UpdateAndNotify(message,
+                           offsetof(ItemStore_SystemConfig_t, loggingInterval),
+                           &loggingInterval, sizeof loggingInterval);
+  }
+  if (message->header.id == SERVICE_REQUEST_MESSAGE_ID_SAVE_LOG_EPOCH) {
+    uint8_t logEpoch = message->parameter2;
+    if (settings->logEpoch == logEpoch) {
+      return true;
+    }
+    return UpdateAndNotify(message,
+                           offsetof(ItemStore_SystemConfig_t, logEpoch),
+                           &logEpoch, sizeof logEpoch);
   }
   if (message->header.id ==
       SERVICE_REQUEST_MESSAGE_ID_SET_ALTERNATIVE_DEVICE_NAME) {
     const char* deviceName = (const char*)message->parameter2;
-    if (strncmp(deviceName, _actualSettings.deviceName, DEVICE_NAME_MAX_LEN) ==
-        0) {
+    if (strncmp(deviceName, settings->deviceName, DEVICE_NAME_MAX_LEN) == 0) {
       return true;
     }
-    strncpy(_actualSettings.deviceName, deviceName, DEVICE_NAME_MAX_LEN);
-    return UpdateAndNotify(message);
+    char newName[DEVICE_NAME_BUFFER_LENGTH] = {0};
+    strncpy(newName, deviceName, DEVICE_NAME_MAX_LEN);
+    return UpdateAndNotify(message,
+                           offsetof(ItemStore_SystemConfig_t, deviceName),
+                           newName, sizeof newName);
   }
   if (message->header.id ==
       SERVICE_REQUEST_MESSAGE_ID_SET_ADVERTISE_DATA_ENABLE) {
     bool isAdvertiseDataEnabled = (bool)message->parameter2;
-    if (isAdvertiseDataEnabled == _actualSettings.isAdvertiseDataEnabled) {
+    if (isAdvertiseDataEnabled == settings->isAdvertiseDataEnabled) {
       return true;
     }
-    _actualSettings.isAdvertiseDataEnabled = isAdvertiseDataEnabled;
-    return UpdateAndNotify(message);
+    return UpdateAndNotify(
+        message, offsetof(ItemStore_SystemConfig_t, isAdvertiseDataEnabled),
+        &isAdvertiseDataEnabled, sizeof isAdvertiseDataEnabled);
   }
   if (message->header.id == SERVICE_REQUEST_MESSAGE_ID_SET_DEBUG_LOG_ENABLE) {
     bool isLogEnabled = (bool)message->parameter2;
-    if (isLogEnabled == _actualSettings.isLogEnabled) {
+    if (isLogEnabled == settings->isLogEnabled) {
       return true;
     }
-    _actualSettings.isLogEnabled = isLogEnabled;
-    return UpdateAndNotify(message);
+    return UpdateAndNotify(message,
+                           offsetof(ItemStore_SystemConfig_t, isLogEnabled),
+                           &isLogEnabled, sizeof isLogEnabled);
   }
   return false;
 }
 
-static bool UpdateAndNotify(Message_Message_t* msg) {
-  uint32_t crc = ComputeCrcOnActualSetting();
-  _actualSettings.crc = crc;
-  ItemStore_AddItem(ITEM_DEF_SYSTEM_CONFIG,
-                    (ItemStore_ItemStruct_t*)&_actualSettings);
+static bool UpdateAndNotify(Message_Message_t* msg,
+                            uint8_t offset,
+                            const void* value,
+                            uint8_t length) {
+  SettingsStore_Update(offset, value, length);
   BleInterface_Message_t bleMessage = {
       .head.category = MESSAGE_BROKER_CATEGORY_SYSTEM_STATE_CHANGE,
       .head.id = MESSAGE_ID_DEVICE_SETTINGS_CHANGED,
@@ -200,12 +190,3 @@ static bool UpdateAndNotify(Message_Message_t* msg) {
   Message_PublishAppMessage((Message_Message_t*)&bleMessage);
   return true;
 }
-
-static uint32_t ComputeCrcOnActualSetting() {
-  Crc_Enable();
-  uint32_t crc = Crc_ComputeCrc((uint8_t*)&_actualSettings,
-                                sizeof(_actualSettings) - sizeof(uint32_t));
-  // the crc is not disabled here as we might interfere with the sensor
-  // that is not switching the crc on for each crc computation!
-  return crc;
-}
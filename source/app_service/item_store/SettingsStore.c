@@ -0,0 +1,344 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file SettingsStore.c
+///
+/// Implementation of SettingsStore.h
+
+#include "SettingsStore.h"
+
+#include "app_common.h"
+#include "hal/Crc.h"
+#include "utility/AppDefines.h"
+#include "utility/ErrorHandler.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/// Number of bytes of the settings that are persisted; the crc is only used
+/// by the legacy format.
+#define SETTINGS_SIZE offsetof(ItemStore_SystemConfig_t, crc)
+
+/// Number of records of a snapshot
+#define SNAPSHOT_NR_OF_RECORDS                                        \
+  ((SETTINGS_SIZE + ITEM_STORE_SETTINGS_RECORD_VALUE_SIZE - 1) / \
+   ITEM_STORE_SETTINGS_RECORD_VALUE_SIZE)
+
+/// Maximal number of records between two committed snapshots.
+///
+/// The threshold together with a delta and a snapshot needs to fit into one
+/// page of the item store (127 records). Otherwise the page of the last
+/// committed snapshot could be erased before the next snapshot is committed.
+#define COMPACTION_THRESHOLD 64
+
+/// Kinds of settings records
+typedef enum {
+  /// A changed field; applies to the settings restored so far
+  RECORD_TAG_DELTA = 0x01,
+  /// Part of a snapshot; the snapshot starts with the record at offset 0.
+  RECORD_TAG_SNAPSHOT = 0x02,
+  /// Last part of a snapshot; the snapshot becomes valid with this record.
+  RECORD_TAG_SNAPSHOT_COMMIT = 0x03,
+} RecordTag_t;
+
+/// Data of the settings store
+typedef struct _tSettingsStore {
+  /// Actual settings
+  ItemStore_SystemConfig_t settings;
+  /// Settings of a snapshot that is not yet committed while loading
+  ItemStore_SystemConfig_t staging;
+  /// Callback to notify the end of the load operation
+  SettingsStore_LoadedCb_t onLoadedCb;
+  /// Flag to indicate that a committed snapshot is stored
+  bool hasSnapshot;
+  /// Flag to indicate that records are written to the item store
+  bool isBatchPending;
+  /// Flag to indicate that settings changed while records were written;
+  /// they are persisted with a snapshot.
+  bool isSnapshotRequired;
+  /// Flag to indicate that the legacy settings are deleted once the snapshot
+  /// that holds them is written
+  bool isMigrationPending;
+  /// Number of records that were written after the last committed snapshot
+  uint16_t recordsSinceSnapshot;
+} SettingsStore_t;
+
+/// Restore the settings from the records in the item store
+/// @param enumerator The record enumerator
+/// @param ready Flag to indicate if the enumerator is valid and can be used.
+static void LoadRecords(ItemStore_Enumerator_t* enumerator, bool ready);
+
+/// Replay the records that are read by the enumerator.
+static void ReplayRecords();
+
+/// Restore the settings that were stored as single item by an older
+/// firmware and write them as a snapshot; the legacy item is deleted after
+/// the snapshot is committed.
+static void MigrateLegacySettings();
+
+/// Apply the value of a record to a settings structure.
+/// @param record The record to be applied
+/// @param settings The settings that receive the value
+static void ApplyRecord(const ItemStore_SettingsRecord_t* record,
+                        ItemStore_SystemConfig_t* settings);
+
+/// Check if a record was completely written and is well formed.
+/// @param record The record to be checked
+/// @return true if the record is valid; false otherwise
+static bool IsValidRecord(ItemStore_SettingsRecord_t* record);
+
+/// Fill a batch record with a range of bytes of the actual settings.
+/// @param index Index of the record within the batch
+/// @param tag Kind of the record
+/// @param offset Position of the first byte within the settings
+/// @param length Number of bytes; at most the value size of a record
+static void PrepareRecord(uint8_t index,
+                          RecordTag_t tag,
+                          uint8_t offset,
+                          uint8_t length);
+
+/// Write the changed bytes of the settings as delta records.
+/// @param offset Position of the changed bytes within the settings
+/// @param length Number of changed bytes
+static void WriteDelta(uint8_t offset, uint8_t length);
+
+/// Write the complete settings as snapshot.
+static void WriteSnapshot();
+
+/// Add the prepared records to the item store.
+/// @param nrOfRecords Number of prepared records
+static void WriteRecords(uint8_t nrOfRecords);
+
+/// Callback that notifies that the records of a batch are written.
+/// @param success true if all records were written; false otherwise
+static void RecordsWrittenCb(bool success);
+
+/// Instance of the settings store
+static SettingsStore_t _store;
+
+/// Enumerator to read the records at load time
+static ItemStore_Enumerator_t _recordEnumerator;
+
+/// Records that are written with the next batch;
+/// The records need to be 8 byte aligned!
+static ItemStore_SettingsRecord_t _records[SNAPSHOT_NR_OF_RECORDS] ALIGN(8);
+
+/// Batch to write the records
+static ItemStore_ItemBatch_t _recordBatch = {.items = _records,
+                                             .onDoneCb = RecordsWrittenCb};
+
+void SettingsStore_Load(const ItemStore_SystemConfig_t* defaults,
+                        SettingsStore_LoadedCb_t onLoadedCb) {
+  _store.settings = *defaults;
+  _store.onLoadedCb = onLoadedCb;
+  _store.hasSnapshot = false;
+  _store.isMigrationPending = false;
+  _store.recordsSinceSnapshot = 0;
+  _recordEnumerator.startIndex = 0;
+  ItemStore_BeginEnumerate(ITEM_DEF_SYSTEM_CONFIG, &_recordEnumerator,
+                           LoadRecords);
+}
+
+ItemStore_SystemConfig_t* SettingsStore_Settings() {
+  return &_store.settings;
+}
+
+void SettingsStore_Update(uint8_t offset, const void* value, uint8_t length) {
+  ASSERT(offset + length <= SETTINGS_SIZE);
+  memcpy((uint8_t*)&_store.settings + offset, value, length);
+  // the change is contained in the snapshot after the pending batch
+  if (_store.isBatchPending) {
+    _store.isSnapshotRequired = true;
+    return;
+  }
+  uint8_t nrOfDeltas = (length + ITEM_STORE_SETTINGS_RECORD_VALUE_SIZE - 1) /
+                       ITEM_STORE_SETTINGS_RECORD_VALUE_SIZE;
+  if (!_store.hasSnapshot ||
+      _store.recordsSinceSnapshot + nrOfDeltas > COMPACTION_THRESHOLD) {
+    WriteSnapshot();
+    return;
+  }
+  WriteDelta(offset, length);
+}
+
+static void LoadRecords(ItemStore_Enumerator_t* enumerator, bool ready) {
+  if (ready && enumerator->hasMoreItems) {
+    ReplayRecords();
+  }
+  ItemStore_EndEnumerate(&_recordEnumerator, ITEM_DEF_SYSTEM_CONFIG);
+  // without the records it is unknown whether a migration was committed;
+  // an empty item store can not be enumerated but holds no records either.
+  if (ready || ItemStore_IsEmpty(ITEM_DEF_SYSTEM_CONFIG)) {
+    MigrateLegacySettings();
+  }
+  if (_store.onLoadedCb != 0) {
+    _store.onLoadedCb();
+  }
+}
+
+static void ReplayRecords() {
+  ItemStore_SettingsRecord_t record;
+  bool isSnapshotOpen = false;
+  while (_recordEnumerator.hasMoreItems &&
+         ItemStore_GetNext(&_recordEnumerator,
+                           (ItemStore_ItemStruct_t*)&record)) {
+    _store.recordsSinceSnapshot++;
+    // a torn snapshot is never completed
+    if (!IsValidRecord(&record)) {
+      isSnapshotOpen = false;
+      continue;
+    }
+    if (record.tag == RECORD_TAG_DELTA) {
+      isSnapshotOpen = false;
+      ApplyRecord(&record, &_store.settings);
+      continue;
+    }
+    if (record.offset == 0) {
+      memset(&_store.staging, 0, sizeof _store.staging);
+      isSnapshotOpen = true;
+    }
+    if (!isSnapshotOpen) {
+      continue;
+    }
+    ApplyRecord(&record, &_store.staging);
+    if (record.tag == RECORD_TAG_SNAPSHOT_COMMIT) {
+      _store.settings = _store.staging;
+      _store.hasSnapshot = true;
+      _store.recordsSinceSnapshot = 0;
+      isSnapshotOpen = false;
+    }
+  }
+}
+
+static void MigrateLegacySettings() {
+  ItemStore_SystemConfig_t legacy;
+  if (!ItemStore_ReadLegacyItem(ITEM_DEF_SYSTEM_CONFIG, &legacy,
+                                sizeof legacy)) {
+    return;
+  }
+  // the power failed after the migrated snapshot was committed
+  if (_store.hasSnapshot) {
+    ItemStore_DeleteLegacyItems(ITEM_DEF_SYSTEM_CONFIG);
+    return;
+  }
+  Crc_Enable();
+  // the crc is not disabled here as we might interfere with the sensor
+  // that is not switching the crc on for each crc computation!
+  if (Crc_ComputeCrc((uint8_t*)&legacy, SETTINGS_SIZE) == legacy.crc) {
+    _store.settings = legacy;
+  }
+  // the legacy item stays readable until the snapshot is committed
+  _store.isMigrationPending = true;
+  WriteSnapshot();
+}
+
+static void ApplyRecord(const ItemStore_SettingsRecord_t* record,
+                        ItemStore_SystemConfig_t* settings) {
+  memcpy((uint8_t*)settings + record->offset, record->value, record->length);
+}
+
+static bool IsValidRecord(ItemStore_SettingsRecord_t* record) {
+  Crc_Enable();
+  return record->crc ==
+             Crc_ComputeCrc((uint8_t*)record,
+                            offsetof(ItemStore_SettingsRecord_t, crc)) &&
+         record->tag >= RECORD_TAG_DELTA &&
+         record->tag <= RECORD_TAG_SNAPSHOT_COMMIT &&
+         record->length <= ITEM_STORE_SETTINGS_RECORD_VALUE_SIZE &&
+         record->offset + record->length <= SETTINGS_SIZE;
+}
+
+static void PrepareRecord(uint8_t index,
+                          RecordTag_t tag,
+                          uint8_t offset,
+                          uint8_t length) {
+  ItemStore_SettingsRecord_t* record = &_records[index];
+  memset(record, 0xFF, sizeof *record);
+  record->tag = tag;
+  record->offset = offset;
+  record->length = length;
+  memcpy(record->value, (uint8_t*)&_store.settings + offset, length);
+  Crc_Enable();
+  record->crc = Crc_ComputeCrc((uint8_t*)record,
+                               offsetof(ItemStore_SettingsRecord_t, crc));
+}
+
+static void WriteDelta(uint8_t offset, uint8_t length) {
+  uint8_t nrOfRecords = 0;
+  while (length > 0) {
+    uint8_t recordLength = MIN(length, ITEM_STORE_SETTINGS_RECORD_VALUE_SIZE);
+    PrepareRecord(nrOfRecords++, RECORD_TAG_DELTA, offset, recordLength);
+    offset += recordLength;
+    length -= recordLength;
+  }
+  _store.recordsSinceSnapshot += nrOfRecords;
+  WriteRecords(nrOfRecords);
+}
+
+static void WriteSnapshot() {
+  uint8_t offset = 0;
+  for (uint8_t i = 0; i < SNAPSHOT_NR_OF_RECORDS; i++) {
+    uint8_t length = MIN((uint8_t)(SETTINGS_SIZE - offset),
+                         ITEM_STORE_SETTINGS_RECORD_VALUE_SIZE);
+    RecordTag_t tag = i + 1u < SNAPSHOT_NR_OF_RECORDS
+                          ? RECORD_TAG_SNAPSHOT
+                          : RECORD_TAG_SNAPSHOT_COMMIT;
+    PrepareRecord(i, tag, offset, length);
+    offset += length;
+  }
+  _store.hasSnapshot = true;
+  _store.recordsSinceSnapshot = 0;
+  _store.isSnapshotRequired = false;
+  WriteRecords(SNAPSHOT_NR_OF_RECORDS);
+}
+
+static void WriteRecords(uint8_t nrOfRecords) {
+  _store.isBatchPending = true;
+  _recordBatch.nrOfItems = nrOfRecords;
+  ItemStore_AddItems(ITEM_DEF_SYSTEM_CONFIG, &_recordBatch);
+}
+
+static void RecordsWrittenCb(bool success) {
+  _store.isBatchPending = false;
+  if (!success) {
+    ErrorHandler_RecoverableError(ERROR_CODE_ITEM_STORE);
+  } else if (_store.isMigrationPending) {
+    // the snapshot with the legacy settings is committed
+    ItemStore_DeleteLegacyItems(ITEM_DEF_SYSTEM_CONFIG);
+  }
+  // a failed migration is repeated at the next start
+  _store.isMigrationPending = false;
+  if (_store.isSnapshotRequired) {
+    WriteSnapshot();
+  }
+}
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file SettingsStore.h
+///
+/// Persistent storage of the system configuration.
+///
+/// The system configuration is kept in RAM; reading it does not access the
+/// flash. A change is persisted as a delta record that holds only the changed
+/// bytes. After a number of deltas the complete configuration is written as
+/// a snapshot, such that the configuration can be restored from the last
+/// snapshot and the deltas that follow it.
+///
+/// A snapshot consists of several records; only the last record commits the
+/// snapshot. If the power fails while a snapshot is written, the previous
+/// snapshot and its deltas remain valid. The number of deltas between two
+/// snapshots is limited, such that the page with the last committed snapshot
+/// is never erased before the next snapshot is committed.
+///
+/// Settings that were stored by an older firmware as a single item are
+/// migrated to a snapshot when they are loaded. The single item is deleted
+/// only after the snapshot is committed; if the power fails before, the
+/// migration is repeated at the next start.
+
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include "app_service/item_store/ItemStore.h"
+
+#include <stdint.h>
+
+/// Callback to notify that the settings are loaded
+typedef void (*SettingsStore_LoadedCb_t)();
+
+/// Load the settings from the flash.
+///
+/// The settings are restored from the records on the flash. If there are no
+/// valid records, the defaults are used.
+/// @param defaults The settings that are used if nothing is stored
+/// @param onLoadedCb Callback that is called when the settings are loaded;
+///                   may be 0.
+void SettingsStore_Load(const ItemStore_SystemConfig_t* defaults,
+                        SettingsStore_LoadedCb_t onLoadedCb);
+
+/// Get the actual settings.
+/// @return Pointer to the settings in RAM
+ItemStore_SystemConfig_t* SettingsStore_Settings();
+
+/// Change a field of the settings and persist the change.
+///
+/// The settings in RAM are updated immediately; the change is written to the
+/// flash asynchronously.
+/// @param offset Position of the field within the settings
+/// @param value The new value of the field
+/// @param length Size of the field in bytes
+void SettingsStore_Update(uint8_t offset, const void* value, uint8_t length);
+
+#endif  // SETTINGS_STORE_H
@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file BleBulkChannel.c
+#include "BleBulkChannel.h"
+
+#include "app_service/networking/ble/BleHelper.h"
+#include "utility/ErrorHandler.h"
+
+#include <string.h>
+
+/// Size of the SDU length field at the beginning of the first K-frame
+#define SDU_LENGTH_SIZE 2
+
+/// Largest K-frame that is sent; it fills a link layer packet of 251 bytes
+/// together with the 4 bytes of the L2CAP header.
+#define MAX_K_FRAME_SIZE 247
+
+/// Largest SDU the device receives; the commands have one byte
+#define RX_MTU 23
+
+/// Largest K-frame the device receives
+#define RX_MPS 23
+
+/// Credits granted to the client; one is returned with every K-frame
+#define RX_CREDITS 1
+
+/// Lowest security level of the link that is accepted for the channel;
+/// the same as the data logger characteristics require.
+#define MIN_SECURITY_LEVEL 3
+
+/// Result codes of the credit based connection response
+typedef enum {
+  CONNECTION_RESULT_SUCCESS = 0x0000,
+  CONNECTION_RESULT_SPSM_NOT_SUPPORTED = 0x0002,
+  CONNECTION_RESULT_NO_RESOURCES = 0x0004,
+  CONNECTION_RESULT_INSUFFICIENT_AUTHENTICATION = 0x0005,
+  CONNECTION_RESULT_UNACCEPTABLE_PARAMETERS = 0x000B,
+} ConnectionResult_t;
+
+/// Position within the segments of an SDU
+typedef struct {
+  uint8_t segment;  ///< Index of the segment
+  uint16_t offset;  ///< Offset within the segment
+} Position_t;
+
+/// State of the bulk channel
+static struct {
+  bool isOpen;                ///< Flag to indicate an open channel
+  uint8_t channelIndex;       ///< Index of the channel within the stack
+  uint16_t connectionHandle;  ///< Connection the channel belongs to
+  uint16_t peerMtu;           ///< Largest SDU the client accepts
+  uint16_t peerMps;           ///< Largest K-frame the client accepts
+  uint16_t credits;           ///< K-frames the client is able to receive
+  uint16_t rxRemaining;       ///< Bytes of a received SDU still to come
+  uint16_t sduRemaining;      ///< Bytes of the sent SDU still to be passed
+  bool isSduStarted;          ///< Flag to indicate that a K-frame was passed
+  Position_t position;        ///< Position of the next byte to be passed
+  uint8_t nrOfSegments;       ///< Number of segments of the sent SDU
+  /// Segments of the sent SDU
+  BleBulkChannel_Segment_t segments[BLE_BULK_CHANNEL_MAX_SEGMENTS];
+  uint8_t kFrame[MAX_K_FRAME_SIZE];  ///< The K-frame that is passed
+} _channel;
+
+/// Check if the link is authenticated and encrypted
+/// @param connectionHandle Handle of the connection
+/// @return true if the link has the required security level
+static bool IsLinkSecure(uint16_t connectionHandle);
+
+/// Copy the next bytes of the sent SDU
+/// @param destination Receives the bytes
+/// @param length Number of bytes to copy
+/// @param position Position of the first byte; it is advanced
+static void Gather(uint8_t* destination,
+                   uint16_t length,
+                   Position_t* position);
+
+void BleBulkChannel_Reset() {
+  memset(&_channel, 0, sizeof _channel);
+}
+
+void BleBulkChannel_HandleConnectRequest(
+    const aci_l2cap_coc_connect_event_rp0* request) {
+  ConnectionResult_t result = CONNECTION_RESULT_SUCCESS;
+  if (request->SPSM != BLE_BULK_CHANNEL_SPSM) {
+    result = CONNECTION_RESULT_SPSM_NOT_SUPPORTED;
+  } else if (_channel.isOpen || request->Channel_Number > 1) {
+    // enhanced credit based channels are accepted if only one is requested
+    result = CONNECTION_RESULT_NO_RESOURCES;
+  } else if (!IsLinkSecure(request->Connection_Handle)) {
+    result = CONNECTION_RESULT_INSUFFICIENT_AUTHENTICATION;
+  } else if (request->MTU < BLE_BULK_CHANNEL_MAX_SDU_SIZE) {
+    result = CONNECTION_RESULT_UNACCEPTABLE_PARAMETERS;
+  }
+
+  uint8_t nrOfChannels = 0;
+  uint8_t channelIndex[5] = {0};
+  tBleStatus status = aci_l2cap_coc_connect_confirm(
+      request->Connection_Handle, RX_MTU, RX_MPS, RX_CREDITS, result,
+      &nrOfChannels, channelIndex);
+  LOG_DEBUG_CALLSTATUS("aci_l2cap_coc_connect_confirm()", status);
+  if (result != CONNECTION_RESULT_SUCCESS || status != BLE_STATUS_SUCCESS ||
+      nrOfChannels == 0) {
+    return;
+  }
+  BleBulkChannel_Reset();
+  _channel.isOpen = true;
+  _channel.channelIndex = channelIndex[0];
+  _channel.connectionHandle = request->Connection_Handle;
+  _channel.peerMtu = request->MTU;
+  _channel.peerMps = MIN(request->MPS, MAX_K_FRAME_SIZE);
+  _channel.credits = request->Initial_Credits;
+}
+
+bool BleBulkChannel_HandleDisconnect(uint8_t channelIndex) {
+  if (!_channel.isOpen || channelIndex != _channel.channelIndex) {
+    return false;
+  }
+  BleBulkChannel_Reset();
+  return true;
+}
+
+bool BleBulkChannel_HandleCredits(
+    const aci_l2cap_coc_flow_control_event_rp0* event) {
+  if (!_channel.isOpen || event->Channel_Index != _channel.channelIndex) {
+    return false;
+  }
+  _channel.credits += MIN(event->Credits, UINT16_MAX - _channel.credits);
+  return true;
+}
+
+BleBulkChannel_Command_t BleBulkChannel_HandleRxData(
+    const aci_l2cap_coc_rx_data_event_rp0* event) {
+  if (!_channel.isOpen || event->Channel_Index != _channel.channelIndex) {
+    return BLE_BULK_CHANNEL_COMMAND_NONE;
+  }
+  tBleStatus status = aci_l2cap_coc_flow_control(_channel.channelIndex, 1);
+  LOG_DEBUG_CALLSTATUS("aci_l2cap_coc_flow_control()", status);
+  UNUSED(status);
+
+  // the following K-frames of an SDU hold no SDU length
+  if (_channel.rxRemaining > 0) {
+    _channel.rxRemaining -= MIN(event->Length, _channel.rxRemaining);
+    return BLE_BULK_CHANNEL_COMMAND_NONE;
+  }
+  if (event->Length <= SDU_LENGTH_SIZE) {
+    return BLE_BULK_CHANNEL_COMMAND_NONE;
+  }
+  uint16_t sduLength = event->Data[0] | (event->Data[1] << 8);
+  uint16_t payloadLength = event->Length - SDU_LENGTH_SIZE;
+  _channel.rxRemaining = sduLength - MIN(payloadLength, sduLength);
+  return (BleBulkChannel_Command_t)event->Data[SDU_LENGTH_SIZE];
+}
+
+bool BleBulkChannel_IsOpen() {
+  return _channel.isOpen;
+}
+
+uint16_t BleBulkChannel_GetConnectionHandle() {
+  return _channel.connectionHandle;
+}
+
+bool BleBulkChannel_Send(const BleBulkChannel_Segment_t* segments,
+                         uint8_t nrOfSegments) {
+  if (!_channel.isOpen || _channel.sduRemaining > 0) {
+    return false;
+  }
+  ASSERT(nrOfSegments <= BLE_BULK_CHANNEL_MAX_SEGMENTS);
+  uint16_t sduLength = 0;
+  for (uint8_t i = 0; i < nrOfSegments; i++) {
+    _channel.segments[i] = segments[i];
+    sduLength += segments[i].length;
+  }
+  ASSERT(sduLength <= _channel.peerMtu);
+  _channel.nrOfSegments = nrOfSegments;
+  _channel.sduRemaining = sduLength;
+  _channel.isSduStarted = false;
+  _channel.position = (Position_t){0};
+  BleBulkChannel_Flush();
+  return true;
+}
+
+bool BleBulkChannel_Flush() {
+  while (_channel.sduRemaining > 0) {
+    if (_channel.credits == 0) {
+      return false;
+    }
+    // the K-frame is built again if the stack rejects it
+    Position_t position = _channel.position;
+    uint16_t length = 0;
+    if (!_channel.isSduStarted) {
+      uint16_t sduLength = _channel.sduRemaining;
+      _channel.kFrame[length++] = sduLength & 0xFF;
+      _channel.kFrame[length++] = sduLength >> 8;
+    }
+    uint16_t payloadLength =
+        MIN(_channel.peerMps - length, _channel.sduRemaining);
+    Gather(&_channel.kFrame[length], payloadLength, &position);
+    length += payloadLength;
+
+    tBleStatus status =
+        aci_l2cap_coc_tx_data(_channel.channelIndex, length, _channel.kFrame);
+    if (status == BLE_STATUS_INSUFFICIENT_RESOURCES) {
+      return false;
+    }
+    if (status != BLE_STATUS_SUCCESS) {
+      // the channel is going down; the SDU is dropped
+      LOG_DEBUG_CALLSTATUS("aci_l2cap_coc_tx_data()", status);
+      _channel.sduRemaining = 0;
+      return true;
+    }
+    _channel.credits--;
+    _channel.isSduStarted = true;
+    _channel.position = position;
+    _channel.sduRemaining -= payloadLength;
+  }
+  return true;
+}
+
+static bool IsLinkSecure(uint16_t connectionHandle) {
+  uint8_t securityMode = 0;
+  uint8_t securityLevel = 0;
+  tBleStatus status = aci_gap_get_security_level(
+      connectionHandle, &securityMode, &securityLevel);
+  return status == BLE_STATUS_SUCCESS && securityLevel >= MIN_SECURITY_LEVEL;
+}
+
+static void Gather(uint8_t* destination,
+                   uint16_t length,
+                   Position_t* position) {
+  while (length > 0) {
+    const BleBulkChannel_Segment_t* segment =
+        &_channel.segments[position->segment];
+    uint16_t chunk = MIN(segment->length - position->offset, length);
+    memcpy(destination, &segment->data[position->offset], chunk);
+    destination += chunk;
+    length -= chunk;
+    position->offset += chunk;
+    if (position->offset == segment->length) {
+      position->segment++;
+      position->offset = 0;
+    }
+  }
+}
@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file BleBulkChannel.h
+///
+/// L2CAP connection oriented channel for bulk transfers.
+///
+/// One client may open one LE credit based channel with the SPSM
+/// BLE_BULK_CHANNEL_SPSM on an authenticated link. The device sends SDUs of
+/// up to BLE_BULK_CHANNEL_MAX_SDU_SIZE bytes; they are segmented into
+/// K-frames that fill a link layer packet and are sent as long as the client
+/// grants credits. The client sends commands as SDUs of one byte.
+///
+/// There is a single channel for all connections; the request of another
+/// client is rejected for lack of resources until the channel is closed.
+#ifndef BLE_BULK_CHANNEL_H
+#define BLE_BULK_CHANNEL_H
+
+#include "app_service/networking/ble/BleTypes.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Simplified protocol/service multiplexer of the bulk channel; it is taken
+/// from the range of dynamically assigned LE SPSMs.
+#define BLE_BULK_CHANNEL_SPSM 0x0080
+
+/// Largest SDU that is sent; a client has to accept SDUs of this size
+#define BLE_BULK_CHANNEL_MAX_SDU_SIZE 512
+
+/// Maximal number of segments an SDU is gathered from
+#define BLE_BULK_CHANNEL_MAX_SEGMENTS 12
+
+/// Commands a client sends on the bulk channel
+typedef enum {
+  /// The received SDU does not hold a command
+  BLE_BULK_CHANNEL_COMMAND_NONE = 0,
+  /// Download the samples selected by the data logger characteristics
+  BLE_BULK_CHANNEL_COMMAND_START_DOWNLOAD = 1,
+  /// Stop a running download
+  BLE_BULK_CHANNEL_COMMAND_STOP_DOWNLOAD = 2,
+} BleBulkChannel_Command_t;
+
+/// A part of an SDU; the SDU is gathered from its segments while it is sent.
+typedef struct {
+  const uint8_t* data;  ///< Bytes of the segment
+  uint16_t length;      ///< Number of bytes of the segment
+} BleBulkChannel_Segment_t;
+
+/// Forget the channel; to be called when the connection is closed.
+void BleBulkChannel_Reset();
+
+/// Handle the request of a client to open a channel.
+///
+/// The request is accepted if it addresses BLE_BULK_CHANNEL_SPSM, if no
+/// channel is open, if the link is authenticated and if the client accepts
+/// SDUs of BLE_BULK_CHANNEL_MAX_SDU_SIZE bytes.
+/// @param request The ACI_L2CAP_COC_CONNECT_EVENT of the stack
+void BleBulkChannel_HandleConnectRequest(
+    const aci_l2cap_coc_connect_event_rp0* request);
+
+/// Handle the disconnection of a channel.
+/// @param channelIndex Index of the disconnected channel
+/// @return true if the bulk channel was closed; false otherwise
+bool BleBulkChannel_HandleDisconnect(uint8_t channelIndex);
+
+/// Add the credits the client granted.
+/// @param event The ACI_L2CAP_COC_FLOW_CONTROL_EVENT of the stack
+/// @return true if the credits are granted for the bulk channel
+bool BleBulkChannel_HandleCredits(
+    const aci_l2cap_coc_flow_control_event_rp0* event);
+
+/// Handle a K-frame the client sent and return a credit for it.
+/// @param event The ACI_L2CAP_COC_RX_DATA_EVENT of the stack
+/// @return The command of a new SDU; BLE_BULK_CHANNEL_COMMAND_NONE otherwise
+BleBulkChannel_Command_t BleBulkChannel_HandleRxData(
+    const aci_l2cap_coc_rx_data_event_rp0* event);
+
+/// Check if a client opened the bulk channel.
+/// @return true if the channel is open; false otherwise
+bool BleBulkChannel_IsOpen();
+
+/// Get the connection of the client that opened the bulk channel.
+/// @return The connection handle; only valid if the channel is open
+uint16_t BleBulkChannel_GetConnectionHandle();
+
+/// Start to send an SDU.
+///
+/// The data of the segments is not copied; it has to stay valid until
+/// `BleBulkChannel_Flush()` returns true.
+/// @param segments The segments the SDU is gathered from
+/// @param nrOfSegments Number of segments
+/// @return true if the SDU is accepted; false if the channel is closed or
+///         the previous SDU is not yet passed to the stack
+bool BleBulkChannel_Send(const BleBulkChannel_Segment_t* segments,
+                         uint8_t nrOfSegments);
+
+/// Pass the pending K-frames of an SDU to the stack.
+///
+/// The function is to be called again when the client grants credits or
+/// when the stack reports ACI_L2CAP_COC_TX_POOL_AVAILABLE_EVENT.
+/// @return true if no K-frame is pending; false otherwise
+bool BleBulkChannel_Flush();
+
+#endif  // BLE_BULK_CHANNEL_H
@@ -84,6 +84,16 @@ tBleStatus BleGatt_UpdateCharacteristic(uint16_t serviceHandle,
   return status;
 }
 
+tBleStatus BleGatt_NotifyCharacteristic(uint16_t connectionHandle,
+                                        uint16_t serviceHandle,
+                                        uint16_t characteristicHandle,
+                                        uint8_t* value,
+                                        uint8_t valueLength) {
+  return aci_gatt_update_char_value_ext(
+      connectionHandle, serviceHandle, characteristicHandle,
+      GATT_CHAR_UPDATE_SEND_NOTIFICATION, valueLength, 0, valueLength, value);
+}
+
 /// Build characteristic uuid from a service uuid and a 16-bit characteristic
 /// id.
 void BleGatt_ExtendCharacteristicUuid(BleTypes_Uuid_t* characteristicId,
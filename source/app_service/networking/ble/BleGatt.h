@@ -55,12 +55,28 @@ typedef enum {
   SERVICE_REQUEST_MESSAGE_ID_SAVE_LOGGING_INTERVAL,
   SERVICE_REQUEST_MESSAGE_ID_GET_AVAILABLE_SAMPLES,
   SERVICE_REQUEST_MESSAGE_ID_SET_REQUESTED_SAMPLES,
+  /// The parameter2 points to a `DataLoggerService_FrameBuffer_t` that is
+  /// filled with the next samples; the response points to the same buffer.
+  /// The parameter1 holds the generation of the request; a request whose
+  /// buffer was requested again since is not answered.
   SERVICE_REQUEST_MESSAGE_ID_GET_NEXT_SAMPLES,
   SERVICE_REQUEST_MESSAGE_ID_SET_ALTERNATIVE_DEVICE_NAME,
   SERVICE_REQUEST_MESSAGE_ID_SET_DEBUG_LOG_ENABLE,
   SERVICE_REQUEST_MESSAGE_ID_SET_ADVERTISE_DATA_ENABLE,
   SERVICE_REQUEST_MESSAGE_ID_GET_SETTINGS_VERSION,
   SERVICE_REQUEST_MESSAGE_ID_TX_POOL_AVAILABLE,
+  /// The parameter2 points to a `BleTypes_SampleAgeRange_t`
+  SERVICE_REQUEST_MESSAGE_ID_SET_REQUESTED_AGE_RANGE,
+  /// The client stopped the download before all samples were sent
+  SERVICE_REQUEST_MESSAGE_ID_END_SAMPLE_DOWNLOAD,
+  /// The parameter2 holds the sequence number of the newest sample the
+  /// client already has; the next download starts after this sample.
+  SERVICE_REQUEST_MESSAGE_ID_SET_RESUME_SEQUENCE,
+  /// The parameter2 holds the `BleTypes_SampleTier_t` of the next download
+  SERVICE_REQUEST_MESSAGE_ID_SET_SAMPLE_TIER,
+  /// The parameter2 holds the epoch of the sequence numbers of the
+  /// measurement log that is saved in the settings
+  SERVICE_REQUEST_MESSAGE_ID_SAVE_LOG_EPOCH,
 } BleGatt_ServiceRequestMessageId_t;
 
 /// This generic data structure is used to exchange data between the
@@ -150,6 +166,24 @@ tBleStatus BleGatt_UpdateCharacteristic(uint16_t serviceHandle,
                                         uint8_t* value,
                                         uint16_t valueLength);
 
+/// Update a characteristic and notify only one of the subscribed clients.
+///
+/// This method serves as a wrapper of the function
+/// aci_gatt_update_char_value_ext(..)
+///
+/// @param connectionHandle The connection of the notified client
+/// @param serviceHandle The handle of a gatt service
+/// @param characteristicHandle The handle of the characteristic
+/// @param value A pointer to a byte array containing the value of
+///              the characteristic.
+/// @param valueLength number of used bytes
+/// @return The status of the update operation
+tBleStatus BleGatt_NotifyCharacteristic(uint16_t connectionHandle,
+                                        uint16_t serviceHandle,
+                                        uint16_t characteristicHandle,
+                                        uint8_t* value,
+                                        uint8_t valueLength);
+
 /// Helper function to support the implementation of service specific
 /// event handlers.
 /// @param event Event received from the BLE core
@@ -58,6 +58,7 @@ typedef enum {
   BLE_INTERFACE_MSG_ID_USER_ACCEPTED_PAIRING,
   BLE_INTERFACE_MSG_ID_PAIRING_TIMEOUT,
   BLE_INTERFACE_MSG_ID_BLE_OFF,
+  BLE_INTERFACE_MSG_ID_CHECK_DOWNLOAD_PROGRESS,
 } BLE_INTERFACE_MSG_ID_t;
 
 /// Defines the message structure of explicit BleInterface
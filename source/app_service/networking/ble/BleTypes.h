@@ -64,6 +64,12 @@
 /// Full manufacturer data length; include 4 bytes of measurement data
 #define LONG_MANUFACTURER_DATA_LENGTH 11
 
+/// Maximal number of clients that are connected at the same time
+#define BLE_TYPES_MAX_CLIENTS CFG_BLE_NUM_LINK
+
+/// Client index that does not refer to a connected client
+#define BLE_TYPES_NO_CLIENT 0xFF
+
 /// security parameters structure
 typedef struct _tSecurityParams {
   /// IO capability of the device
@@ -217,4 +223,38 @@ typedef struct __PACKED {
   uint16_t numberOfSamples;    ///< Number of samples that will be delivered
 } BleTypes_SamplesMetaData_t;
 
+/// Age range of the samples that shall be delivered by the data logger.
+/// A limit of 0 does not restrict the samples on that side of the range.
+typedef struct __PACKED {
+  uint32_t maxAgeS;  ///< Age of the oldest sample to be delivered in seconds
+  uint32_t minAgeS;  ///< Age of the newest sample to be delivered in seconds
+} BleTypes_SampleAgeRange_t;
+
+/// Sequence number that does not restrict the samples of a download
+#define BLE_TYPES_NO_SEQUENCE_NUMBER 0xFFFFFFFFU
+
+/// Tiers of the measurement history that can be downloaded
+typedef enum {
+  /// The logged samples
+  BLE_TYPES_SAMPLE_TIER_RAW = 0,
+  /// Hourly summaries; each is sent as minimum, maximum and mean sample
+  BLE_TYPES_SAMPLE_TIER_HOURLY,
+  /// Daily summaries; each is sent as minimum, maximum and mean sample
+  BLE_TYPES_SAMPLE_TIER_DAILY,
+  BLE_TYPES_NR_OF_SAMPLE_TIERS,
+} BleTypes_SampleTier_t;
+
+/// Describes a download of samples that was prepared by the application.
+typedef struct {
+  /// Metadata that is sent with the header frame
+  BleTypes_SamplesMetaData_t metadata;
+  /// Sequence number of the first sample of the download; the sequence
+  /// numbers of the stored samples are consecutive and survive a reset.
+  uint32_t firstSequenceNumber;
+  /// BleTypes_SampleTier_t of the downloaded samples
+  uint8_t tier;
+  /// Index of the client that downloads the samples
+  uint8_t client;
+} BleTypes_SampleDownload_t;
+
 #endif  // BLE_TYPES_H
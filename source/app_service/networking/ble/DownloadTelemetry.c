@@ -0,0 +1,241 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file DownloadTelemetry.c
+#include "DownloadTelemetry.h"
+
+#include "app_service/timer_server/TimerServer.h"
+#include "utility/log/Log.h"
+
+#include <string.h>
+
+/// Internal state of the download telemetry
+static struct {
+  uint8_t nrOfDownloads;            ///< Number of ongoing downloads
+  bool isSubscribed;                ///< Flag to indicate a pending subscription
+  bool isTxPoolFull;                ///< Flag to indicate a wait for the TX pool
+  bool isWaitingForBuffer;          ///< Flag to indicate a wait for a buffer
+  uint16_t subscribedStamp;         ///< Time stamp of the subscription
+  uint16_t lastTicks;               ///< Tick counter at the last event
+  uint32_t elapsedTicks;            ///< Ticks since the begin of the download
+  uint32_t waitBeginTicks[2];       ///< Begin of the waits in elapsed ticks
+  uint32_t txPoolWaitTicks;         ///< Accumulated wait for the TX pool
+  uint32_t bufferWaitTicks;         ///< Accumulated wait for frame buffers
+  uint32_t enumerationTicks;        ///< Accumulated time to fill frame buffers
+  uint32_t brokerDelayTicks;        ///< Accumulated queueing delay
+  uint16_t maxBrokerDelayTicks;     ///< Longest queueing delay
+  uint16_t startLatencyTicks;       ///< Ticks from subscription to header frame
+  DownloadTelemetry_Stats_t stats;  ///< Statistics in external units
+} _telemetry;
+
+/// Index of the wait for the TX pool in waitBeginTicks
+#define WAIT_TX_POOL 0
+/// Index of the wait for a frame buffer in waitBeginTicks
+#define WAIT_BUFFER 1
+
+/// Compute the ticks since a time stamp
+/// @param stamp Time stamp of the tick counter
+/// @return Ticks since the stamp modulo the wrap of the tick counter
+static uint16_t TicksSince(uint16_t stamp);
+
+/// Advance the ticks since the begin of the download to the actual time
+static void Advance();
+
+/// End the waits for the TX pool and for a frame buffer
+static void EndWaits();
+
+/// Convert ticks to milliseconds
+/// @param ticks Number of ticks
+/// @return Number of milliseconds
+static uint32_t TicksToMs(uint32_t ticks);
+
+/// Update the statistics in external units from the internal state
+static void UpdateStats();
+
+uint16_t DownloadTelemetry_Stamp() {
+  return TimerServer_GetTicks();
+}
+
+void DownloadTelemetry_Subscribed() {
+  _telemetry.isSubscribed = true;
+  _telemetry.subscribedStamp = DownloadTelemetry_Stamp();
+}
+
+void DownloadTelemetry_Begin(uint8_t frameLength) {
+  if (_telemetry.nrOfDownloads > 0) {
+    // a concurrent download adds to the running statistics
+    _telemetry.nrOfDownloads++;
+    DownloadTelemetry_FrameSent(frameLength);
+    return;
+  }
+  bool isSubscribed = _telemetry.isSubscribed;
+  uint16_t startLatencyTicks = TicksSince(_telemetry.subscribedStamp);
+  memset(&_telemetry, 0, sizeof _telemetry);
+  if (isSubscribed) {
+    _telemetry.startLatencyTicks = startLatencyTicks;
+  }
+  _telemetry.nrOfDownloads = 1;
+  _telemetry.lastTicks = DownloadTelemetry_Stamp();
+  _telemetry.stats.framesSent = 1;
+  _telemetry.stats.bytesSent = frameLength;
+}
+
+void DownloadTelemetry_FrameSent(uint8_t frameLength) {
+  if (_telemetry.nrOfDownloads == 0) {
+    return;
+  }
+  Advance();
+  EndWaits();
+  _telemetry.stats.framesSent++;
+  _telemetry.stats.bytesSent += frameLength;
+}
+
+void DownloadTelemetry_TxPoolFull() {
+  if (_telemetry.nrOfDownloads == 0) {
+    return;
+  }
+  _telemetry.stats.txPoolStalls++;
+  if (!_telemetry.isTxPoolFull) {
+    Advance();
+    _telemetry.isTxPoolFull = true;
+    _telemetry.waitBeginTicks[WAIT_TX_POOL] = _telemetry.elapsedTicks;
+  }
+}
+
+void DownloadTelemetry_WaitForBuffer() {
+  if (_telemetry.nrOfDownloads == 0 || _telemetry.isWaitingForBuffer) {
+    return;
+  }
+  Advance();
+  _telemetry.isWaitingForBuffer = true;
+  _telemetry.waitBeginTicks[WAIT_BUFFER] = _telemetry.elapsedTicks;
+}
+
+void DownloadTelemetry_AddBrokerDelay(uint16_t stamp) {
+  if (_telemetry.nrOfDownloads == 0) {
+    return;
+  }
+  uint16_t delay = TicksSince(stamp);
+  _telemetry.brokerDelayTicks += delay;
+  if (delay > _telemetry.maxBrokerDelayTicks) {
+    _telemetry.maxBrokerDelayTicks = delay;
+  }
+}
+
+void DownloadTelemetry_AddEnumerationTime(uint16_t stamp) {
+  if (_telemetry.nrOfDownloads == 0) {
+    return;
+  }
+  _telemetry.enumerationTicks += TicksSince(stamp);
+}
+
+bool DownloadTelemetry_End() {
+  if (_telemetry.nrOfDownloads == 0) {
+    return false;
+  }
+  // concurrent downloads are reported when the last one ends
+  if (--_telemetry.nrOfDownloads > 0) {
+    return false;
+  }
+  // the waits that are still pending end with the download
+  Advance();
+  EndWaits();
+  UpdateStats();
+
+  DownloadTelemetry_Stats_t* stats = &_telemetry.stats;
+  LOG_INFO("download: %lu bytes in %u frames, %lums, %lu bytes/s",
+           stats->bytesSent, stats->framesSent, stats->durationMs,
+           stats->bytesPerSecond);
+  LOG_INFO("download: %u tx pool stalls, waits tx pool %lums, buffer %lums",
+           stats->txPoolStalls, stats->txPoolWaitMs, stats->bufferWaitMs);
+  LOG_INFO("download: enumeration %lums, broker %lums (max %ums), start %ums",
+           stats->enumerationMs, stats->brokerDelayMs,
+           stats->maxBrokerDelayMs, stats->startLatencyMs);
+  return true;
+}
+
+const DownloadTelemetry_Stats_t* DownloadTelemetry_GetStats() {
+  if (_telemetry.nrOfDownloads > 0) {
+    Advance();
+    UpdateStats();
+  }
+  return &_telemetry.stats;
+}
+
+static uint16_t TicksSince(uint16_t stamp) {
+  return (uint16_t)((DownloadTelemetry_Stamp() + TIMER_SERVER_TICKS_WRAP -
+                     stamp) %
+                    TIMER_SERVER_TICKS_WRAP);
+}
+
+static void Advance() {
+  uint16_t ticks = DownloadTelemetry_Stamp();
+  _telemetry.elapsedTicks +=
+      (ticks + TIMER_SERVER_TICKS_WRAP - _telemetry.lastTicks) %
+      TIMER_SERVER_TICKS_WRAP;
+  _telemetry.lastTicks = ticks;
+}
+
+static void EndWaits() {
+  if (_telemetry.isTxPoolFull) {
+    _telemetry.isTxPoolFull = false;
+    _telemetry.txPoolWaitTicks +=
+        _telemetry.elapsedTicks - _telemetry.waitBeginTicks[WAIT_TX_POOL];
+  }
+  if (_telemetry.isWaitingForBuffer) {
+    _telemetry.isWaitingForBuffer = false;
+    _telemetry.bufferWaitTicks +=
+        _telemetry.elapsedTicks - _telemetry.waitBeginTicks[WAIT_BUFFER];
+  }
+}
+
+static uint32_t TicksToMs(uint32_t ticks) {
+  return (uint32_t)((uint64_t)ticks * 1000 / TIMER_SERVER_TICKS_PER_SECOND);
+}
+
+static void UpdateStats() {
+  DownloadTelemetry_Stats_t* stats = &_telemetry.stats;
+  stats->durationMs = TicksToMs(_telemetry.elapsedTicks);
+  stats->bytesPerSecond = 0;
+  if (_telemetry.elapsedTicks > 0) {
+    stats->bytesPerSecond =
+        (uint32_t)((uint64_t)stats->bytesSent * TIMER_SERVER_TICKS_PER_SECOND /
+                   _telemetry.elapsedTicks);
+  }
+  stats->txPoolWaitMs = TicksToMs(_telemetry.txPoolWaitTicks);
+  stats->bufferWaitMs = TicksToMs(_telemetry.bufferWaitTicks);
+  stats->enumerationMs = TicksToMs(_telemetry.enumerationTicks);
+  stats->brokerDelayMs = TicksToMs(_telemetry.brokerDelayTicks);
+  stats->maxBrokerDelayMs = (uint16_t)TicksToMs(_telemetry.maxBrokerDelayTicks);
+  stats->startLatencyMs = (uint16_t)TicksToMs(_telemetry.startLatencyTicks);
+}
@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file DownloadTelemetry.h
+///
+/// Throughput and latency statistics of the sample downloads.
+///
+/// The BLE context and the measurement item controller report the events of
+/// a download; the statistics tell whether a slow download waits on the TX
+/// pool of the BLE stack, on the enumeration of the item store or on the
+/// message broker. Durations are measured with the tick counter of the timer
+/// server; a single wait longer than the wrap of that counter (16s) is
+/// undercounted. Downloads of several clients that overlap are measured
+/// together as one download.
+#ifndef DOWNLOAD_TELEMETRY_H
+#define DOWNLOAD_TELEMETRY_H
+
+#include "stm32wbxx_hal.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Statistics of a download
+///
+/// This is also the value of the download statistics characteristic of the
+/// data logger service; all durations are in milliseconds.
+typedef struct __PACKED {
+  uint32_t durationMs;        ///< From the header frame to the last frame
+  uint32_t bytesSent;         ///< Bytes of all sent frames
+  uint32_t bytesPerSecond;    ///< Achieved throughput of the download
+  uint16_t framesSent;        ///< Number of sent frames including the header
+  uint16_t txPoolStalls;      ///< Number of frames rejected by the TX pool
+  uint32_t txPoolWaitMs;      ///< Time waited for ACI_GATT_TX_POOL_AVAILABLE
+  uint32_t bufferWaitMs;      ///< Time waited for a filled frame buffer
+  uint32_t enumerationMs;     ///< Time spent filling the frame buffers
+  uint32_t brokerDelayMs;     ///< Time the frame buffers were queued
+  uint16_t maxBrokerDelayMs;  ///< Longest time a frame buffer was queued
+  uint16_t startLatencyMs;    ///< From the subscription to the header frame
+} DownloadTelemetry_Stats_t;
+
+/// Read the tick counter to stamp a message that is queued in the broker.
+/// @return A time stamp to be passed to DownloadTelemetry_AddBrokerDelay()
+uint16_t DownloadTelemetry_Stamp();
+
+/// Note that a client subscribed to the sample data.
+///
+/// The statistics of the previous download are kept until the header frame
+/// of the new one is sent.
+void DownloadTelemetry_Subscribed();
+
+/// Note that the header frame of a download was sent; this starts a new
+/// download unless another one is ongoing.
+/// @param frameLength Number of bytes of the header frame
+void DownloadTelemetry_Begin(uint8_t frameLength);
+
+/// Note that a data frame was sent.
+/// @param frameLength Number of bytes of the frame
+void DownloadTelemetry_FrameSent(uint8_t frameLength);
+
+/// Note that a frame was rejected because the TX pool is full.
+void DownloadTelemetry_TxPoolFull();
+
+/// Note that the next frame buffer is not yet filled.
+void DownloadTelemetry_WaitForBuffer();
+
+/// Add the time a message was queued in the broker.
+/// @param stamp Time stamp taken when the message was published
+void DownloadTelemetry_AddBrokerDelay(uint16_t stamp);
+
+/// Add the time spent to fill a frame buffer.
+/// @param stamp Time stamp taken when the filling began
+void DownloadTelemetry_AddEnumerationTime(uint16_t stamp);
+
+/// Note that a download is complete or aborted.
+///
+/// The statistics are written to the trace output when the last of the
+/// ongoing downloads ends. Calling this function without an ongoing download
+/// has no effect.
+/// @return true if the statistics are complete; false otherwise
+bool DownloadTelemetry_End();
+
+/// Get the statistics of the ongoing or the last download.
+/// @return The statistics of the download
+const DownloadTelemetry_Stats_t* DownloadTelemetry_GetStats();
+
+#endif  // DOWNLOAD_TELEMETRY_H
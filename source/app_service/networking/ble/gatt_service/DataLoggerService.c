@@ -52,6 +52,24 @@
 #define SAMPLE_TYPE_OFFSET 0x4
 /// Offset of metadata in data logger frame[0]
 #define METADATA_OFFSET 0x6
+/// Offset of the data frame size in data logger frame[0]
+#define FRAME_SIZE_OFFSET 0x10
+/// Offset of the sample encoding in data logger frame[0]
+#define ENCODING_OFFSET 0x12
+/// Offset of the tier of the samples in data logger frame[0]
+#define TIER_OFFSET 0x13
+
+/// Position of the encoding flags in the value of the requested samples
+#define REQUESTED_ENCODING_POSITION 2
+/// Flag of the requested samples value that selects the delta encoding
+#define REQUESTED_ENCODING_DELTA 0x01
+
+/// Size of the header of a notification (opcode and attribute handle)
+#define NOTIFICATION_HEADER_SIZE 3
+/// Size of the L2CAP header within a link layer packet
+#define L2CAP_HEADER_SIZE 4
+/// Maximal payload of a link layer packet without data length extension
+#define DEFAULT_MAX_TX_OCTETS 27
 
 /// Copy a uint16_t value into a buffer
 #define SET_UINT16(buffer, value, offset) *((uint16_t*)&buffer[offset]) = value
@@ -72,17 +90,39 @@ typedef enum {
   CHARACTERISTIC_ID_AVAILABLE_SAMPLES,
   CHARACTERISTIC_ID_REQUEST_SAMPLES,
   CHARACTERISTIC_ID_SAMPLE_DATA,
+  CHARACTERISTIC_ID_REQUESTED_AGE_RANGE,
+  CHARACTERISTIC_ID_SAMPLE_SEQUENCE,
+  CHARACTERISTIC_ID_SAMPLE_TIER,
+  CHARACTERISTIC_ID_DOWNLOAD_STATISTICS,
   CHARACTERISTIC_ID_NR_OF_CHARS,
 } CharacteristicIds_t;
 
+/// Connection handle of a client slot that is not in use
+#define NO_CONNECTION 0xFFFF
+
+/// Download settings and link properties of a connected client
+typedef struct {
+  uint16_t connectionHandle;      ///< Handle of the client connection
+  bool isReadPending;             ///< Flag to indicate a read to be allowed
+  uint16_t requestedNrOfSamples;  ///< nr of requested samples
+  uint8_t requestedEncoding;      ///< encoding of the requested samples
+  /// age range of the requested samples
+  BleTypes_SampleAgeRange_t requestedAgeRange;
+  uint16_t attMtu;       ///< ATT MTU of the connection
+  uint16_t maxTxOctets;  ///< Maximal payload of a link layer packet
+  uint32_t sampleSequence;  ///< value of the sample sequence characteristic
+  uint8_t sampleTier;       ///< value of the sample tier characteristic
+  /// value of the download statistics characteristic
+  DownloadTelemetry_Stats_t downloadStatistics;
+} Client_t;
+
 /// structure to hold the handles for gatt service and its characteristics
 PLACE_IN_SECTION("BLE_DRIVER_CONTEXT") static struct _tService {
   uint16_t serviceHandle;  ///< Service handle
   /// table with characteristics
   BleGatt_ServiceCharacteristic_t characteristic[CHARACTERISTIC_ID_NR_OF_CHARS];
-  uint16_t currentConnection;     ///< Handle to the current connection
-  uint16_t requestedNrOfSamples;  ///< nr of requested samples
-} _service;                       ///< service instance
+  Client_t clients[BLE_TYPES_MAX_CLIENTS];  ///< The connected clients
+} _service;  ///< service instance
 
 /// Uuid of device data logger service
 /// 00008000-B38D-4985-720E-0F993A68EE41
@@ -107,6 +147,66 @@ static void AddRequestSamplesCharacteristic(struct _tService* service);
 /// @param service Pointer to the service structure
 static void AddSampleDataCharacteristic(struct _tService* service);
 
+/// Add the requested age range characteristic
+/// @param service Pointer to the service structure
+static void AddRequestedAgeRangeCharacteristic(struct _tService* service);
+
+/// Add the sample sequence characteristic
+/// @param service Pointer to the service structure
+static void AddSampleSequenceCharacteristic(struct _tService* service);
+
+/// Add the sample tier characteristic
+/// @param service Pointer to the service structure
+static void AddSampleTierCharacteristic(struct _tService* service);
+
+/// Add the download statistics characteristic
+/// @param service Pointer to the service structure
+static void AddDownloadStatisticsCharacteristic(struct _tService* service);
+
+/// Forget the sequence number of a client that resumed a download.
+///
+/// The client gets the newest samples unless it resumes a download.
+/// @param client Index of the client
+static void ResetSampleSequence(uint8_t client);
+
+/// Forget the tier a client selected for its downloads.
+///
+/// The client gets the logged samples unless it selects another tier.
+/// @param client Index of the client
+static void ResetSampleTier(uint8_t client);
+
+/// Allow the stack to answer the reads that wait for an updated value
+static void AllowPendingReads();
+
+/// Answer the read of a characteristic whose value is kept for each client.
+///
+/// The stack holds a single value of the characteristic; the value of the
+/// reading client is written to it just before the read is allowed.
+/// @param connectionHandle Connection of the reading client
+/// @param characteristicId The read characteristic
+/// @param value The value of the client
+/// @param valueLength Number of bytes of the value
+/// @return the status of the event handler
+static SVCCTL_EvtAckStatus_t AllowClientRead(
+    uint16_t connectionHandle,
+    CharacteristicIds_t characteristicId,
+    uint8_t* value,
+    uint16_t valueLength);
+
+/// Append a sample with its 4 bytes to the frames of a frame buffer
+/// @param buffer The frame buffer
+/// @param sample The sample bytes to be appended
+/// @return true if the sample was appended; false if the buffer is full
+static bool PutRawSample(DataLoggerService_FrameBuffer_t* buffer,
+                         const uint8_t sample[TX_FRAME_SAMPLE_SIZE]);
+
+/// Append a delta encoded sample to the frames of a frame buffer
+/// @param buffer The frame buffer
+/// @param sample The sample bytes to be appended
+/// @return true if the sample was appended; false if the buffer is full
+static bool PutDeltaEncodedSample(DataLoggerService_FrameBuffer_t* buffer,
+                                  const uint8_t sample[TX_FRAME_SAMPLE_SIZE]);
+
 /// Handle the client request of reading the logging interval
 /// @param currentConnection Client connection handle
 /// @param data The data of the request
@@ -154,6 +254,66 @@ SVCCTL_EvtAckStatus_t WriteRequestedSamples(uint16_t currentConnection,
                                             uint8_t* data,
                                             uint8_t dataLength);
 
+/// Handle the client request to write the age range of the requested
+/// samples.
+///
+/// @param currentConnection Client connection handle
+/// @param data The data of the request
+/// @param dataLength The number of bytes in data
+/// @return the status of the event handler
+SVCCTL_EvtAckStatus_t WriteRequestedAgeRange(uint16_t currentConnection,
+                                             uint8_t* data,
+                                             uint8_t dataLength);
+
+/// Handle the client request to write the sequence number of the newest
+/// sample the client already has.
+///
+/// @param currentConnection Client connection handle
+/// @param data The data of the request
+/// @param dataLength The number of bytes in data
+/// @return the status of the event handler
+SVCCTL_EvtAckStatus_t WriteSampleSequence(uint16_t currentConnection,
+                                          uint8_t* data,
+                                          uint8_t dataLength);
+
+/// Handle the client request reading the sequence number of its download.
+/// @param currentConnection Client connection handle
+/// @param data The data of the request
+/// @param dataLength The number of bytes in data
+/// @return the status of the event handler
+SVCCTL_EvtAckStatus_t ReadSampleSequence(uint16_t currentConnection,
+                                         uint8_t* data,
+                                         uint8_t dataLength);
+
+/// Handle the client request reading the tier it selected.
+/// @param currentConnection Client connection handle
+/// @param data The data of the request
+/// @param dataLength The number of bytes in data
+/// @return the status of the event handler
+SVCCTL_EvtAckStatus_t ReadSampleTier(uint16_t currentConnection,
+                                     uint8_t* data,
+                                     uint8_t dataLength);
+
+/// Handle the client request reading the statistics of its last download.
+/// @param currentConnection Client connection handle
+/// @param data The data of the request
+/// @param dataLength The number of bytes in data
+/// @return the status of the event handler
+SVCCTL_EvtAckStatus_t ReadDownloadStatistics(uint16_t currentConnection,
+                                             uint8_t* data,
+                                             uint8_t dataLength);
+
+/// Handle the client request to select the tier of the history that is
+/// downloaded.
+///
+/// @param currentConnection Client connection handle
+/// @param data The data of the request
+/// @param dataLength The number of bytes in data
+/// @return the status of the event handler
+SVCCTL_EvtAckStatus_t WriteSampleTier(uint16_t currentConnection,
+                                      uint8_t* data,
+                                      uint8_t dataLength);
+
 /// Default handler to be used for read only characteristic
 /// @param currentConnection Client connection handle
 /// @param data The data of the request
@@ -165,8 +325,12 @@ SVCCTL_EvtAckStatus_t NopWriteHandler(uint16_t currentConnection,
 
 /// Setup the data logger service
 void DataLoggerService_Create() {
+  for (uint8_t i = 0; i < BLE_TYPES_MAX_CLIENTS; i++) {
+    _service.clients[i].connectionHandle = NO_CONNECTION;
+  }
+
   // create service
-  _service.serviceHandle = BleGatt_AddPrimaryService(_serviceId, 5);
+  _service.serviceHandle = BleGatt_AddPrimaryService(_serviceId, 9);
   ASSERT(_service.serviceHandle != 0);
 
   // register service handle; needed for data logger service
@@ -177,6 +341,10 @@ void DataLoggerService_Create() {
   AddAvailableSamplesCharacteristic(&_service);
   AddRequestSamplesCharacteristic(&_service);
   AddSampleDataCharacteristic(&_service);
+  AddRequestedAgeRangeCharacteristic(&_service);
+  AddSampleSequenceCharacteristic(&_service);
+  AddSampleTierCharacteristic(&_service);
+  AddDownloadStatisticsCharacteristic(&_service);
 }
 
 void DataLoggerService_UpdateDataLoggingIntervalCharacteristic(
@@ -186,7 +354,7 @@ void DataLoggerService_UpdateDataLoggingIntervalCharacteristic(
       _service.characteristic[CHARACTERISTIC_ID_LOGGING_INTERVAL].handle,
       (uint8_t*)&dataLoggingInterval, sizeof dataLoggingInterval);
   ASSERT(status == BLE_STATUS_SUCCESS);
-  aci_gatt_allow_read(_service.currentConnection);
+  AllowPendingReads();
 }
 
 void DataLoggerService_UpdateAvailableSamplesCharacteristic(uint32_t samples) {
@@ -195,18 +363,144 @@ void DataLoggerService_UpdateAvailableSamplesCharacteristic(uint32_t samples) {
       _service.characteristic[CHARACTERISTIC_ID_AVAILABLE_SAMPLES].handle,
       (uint8_t*)&samples, sizeof samples);
   ASSERT(status == BLE_STATUS_SUCCESS);
-  aci_gatt_allow_read(_service.currentConnection);
+  AllowPendingReads();
 }
 
 bool DataLoggerService_UpdateSampleDataCharacteristic(
-    uint8_t frame[TX_FRAME_SIZE]) {
-  tBleStatus status = BleGatt_UpdateCharacteristic(
-      _service.serviceHandle,
+    uint8_t client,
+    uint8_t frame[TX_FRAME_SIZE],
+    uint8_t frameSize) {
+  tBleStatus status = BleGatt_NotifyCharacteristic(
+      _service.clients[client].connectionHandle, _service.serviceHandle,
       _service.characteristic[CHARACTERISTIC_ID_SAMPLE_DATA].handle, frame,
-      TX_FRAME_SIZE);
+      frameSize);
   return (status == BLE_STATUS_SUCCESS);
 }
 
+void DataLoggerService_UpdateSampleSequenceCharacteristic(
+    uint8_t client,
+    uint32_t sequenceNumber) {
+  ASSERT(client < BLE_TYPES_MAX_CLIENTS);
+  _service.clients[client].sampleSequence = sequenceNumber;
+}
+
+static void ResetSampleSequence(uint8_t client) {
+  DataLoggerService_UpdateSampleSequenceCharacteristic(
+      client, BLE_TYPES_NO_SEQUENCE_NUMBER);
+  Message_Message_t msg = {
+      .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
+      .header.id = SERVICE_REQUEST_MESSAGE_ID_SET_RESUME_SEQUENCE,
+      .header.parameter1 = client,
+      .parameter2 = BLE_TYPES_NO_SEQUENCE_NUMBER};
+  Message_PublishAppMessage(&msg);
+}
+
+static void ResetSampleTier(uint8_t client) {
+  _service.clients[client].sampleTier = BLE_TYPES_SAMPLE_TIER_RAW;
+  Message_Message_t msg = {
+      .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
+      .header.id = SERVICE_REQUEST_MESSAGE_ID_SET_SAMPLE_TIER,
+      .header.parameter1 = client,
+      .parameter2 = BLE_TYPES_SAMPLE_TIER_RAW};
+  Message_PublishAppMessage(&msg);
+}
+
+static void AllowPendingReads() {
+  for (uint8_t i = 0; i < BLE_TYPES_MAX_CLIENTS; i++) {
+    if (_service.clients[i].isReadPending) {
+      _service.clients[i].isReadPending = false;
+      aci_gatt_allow_read(_service.clients[i].connectionHandle);
+    }
+  }
+}
+
+static SVCCTL_EvtAckStatus_t AllowClientRead(
+    uint16_t connectionHandle,
+    CharacteristicIds_t characteristicId,
+    uint8_t* value,
+    uint16_t valueLength) {
+  tBleStatus status = BleGatt_UpdateCharacteristic(
+      _service.serviceHandle, _service.characteristic[characteristicId].handle,
+      value, valueLength);
+  ASSERT(status == BLE_STATUS_SUCCESS);
+  aci_gatt_allow_read(connectionHandle);
+  return SVCCTL_EvtAckFlowEnable;
+}
+
+void DataLoggerService_UpdateDownloadStatisticsCharacteristic(
+    uint8_t client,
+    const DownloadTelemetry_Stats_t* stats) {
+  ASSERT(client < BLE_TYPES_MAX_CLIENTS);
+  _service.clients[client].downloadStatistics = *stats;
+}
+
+uint8_t DataLoggerService_OpenClient(uint16_t connectionHandle) {
+  uint8_t client = DataLoggerService_FindClient(NO_CONNECTION);
+  if (client == BLE_TYPES_NO_CLIENT) {
+    return BLE_TYPES_NO_CLIENT;
+  }
+  memset(&_service.clients[client], 0, sizeof(Client_t));
+  _service.clients[client].connectionHandle = connectionHandle;
+  _service.clients[client].attMtu = BLE_DEFAULT_ATT_MTU;
+  _service.clients[client].maxTxOctets = DEFAULT_MAX_TX_OCTETS;
+  // the application may still hold the settings of the previous client
+  ResetSampleSequence(client);
+  ResetSampleTier(client);
+  return client;
+}
+
+void DataLoggerService_CloseClient(uint8_t client) {
+  ASSERT(client < BLE_TYPES_MAX_CLIENTS);
+  _service.clients[client].connectionHandle = NO_CONNECTION;
+  _service.clients[client].isReadPending = false;
+}
+
+uint8_t DataLoggerService_FindClient(uint16_t connectionHandle) {
+  for (uint8_t i = 0; i < BLE_TYPES_MAX_CLIENTS; i++) {
+    if (_service.clients[i].connectionHandle == connectionHandle) {
+      return i;
+    }
+  }
+  return BLE_TYPES_NO_CLIENT;
+}
+
+void DataLoggerService_SetAttMtu(uint16_t connectionHandle, uint16_t attMtu) {
+  uint8_t client = DataLoggerService_FindClient(connectionHandle);
+  if (client != BLE_TYPES_NO_CLIENT) {
+    _service.clients[client].attMtu = attMtu;
+  }
+}
+
+void DataLoggerService_SetMaxTxOctets(uint16_t connectionHandle,
+                                      uint16_t maxTxOctets) {
+  uint8_t client = DataLoggerService_FindClient(connectionHandle);
+  if (client != BLE_TYPES_NO_CLIENT) {
+    _service.clients[client].maxTxOctets = maxTxOctets;
+  }
+}
+
+uint8_t DataLoggerService_GetFrameSize(uint8_t client) {
+  Client_t* link = &_service.clients[client];
+  // a notification that does not fit into one link layer packet is
+  // fragmented; this costs more air time than an additional notification.
+  uint16_t payload = link->attMtu - NOTIFICATION_HEADER_SIZE;
+  uint16_t packetPayload =
+      link->maxTxOctets - L2CAP_HEADER_SIZE - NOTIFICATION_HEADER_SIZE;
+  if (packetPayload < payload) {
+    payload = packetPayload;
+  }
+  uint16_t frameSize =
+      TX_FRAME_INDEX_SIZE + (payload - TX_FRAME_INDEX_SIZE) /
+                                TX_FRAME_SAMPLE_SIZE * TX_FRAME_SAMPLE_SIZE;
+  if (frameSize > TX_FRAME_SIZE) {
+    return TX_FRAME_SIZE;
+  }
+  if (frameSize < TX_LEGACY_FRAME_SIZE) {
+    return TX_LEGACY_FRAME_SIZE;
+  }
+  return frameSize;
+}
+
 static void AddLoggingIntervalCharacteristic(struct _tService* service) {
   BleTypes_Characteristic_t loggingIntervalCharacteristic = {
       .uuid.uuid.Char_UUID_16 = 0x8001,
@@ -291,18 +585,121 @@ static void AddSampleDataCharacteristic(struct _tService* service) {
       .securityFlags = SECURE_ACCESS,
       .eventFlags = GATT_DONT_NOTIFY_EVENTS,
       .encryptionKeySize = 10,
-      .isVariableLengthValue = false};
+      .isVariableLengthValue = true};
   BleGatt_ExtendCharacteristicUuid(&sampleDataCharacteristic.uuid, &_serviceId);
-  uint8_t value[TX_FRAME_SIZE] = {0};
+  uint8_t value[TX_LEGACY_FRAME_SIZE] = {0};
 
-  uint16_t handle = BleGatt_AddCharacteristic(
-      service->serviceHandle, &sampleDataCharacteristic, value, TX_FRAME_SIZE);
+  uint16_t handle =
+      BleGatt_AddCharacteristic(service->serviceHandle,
+                                &sampleDataCharacteristic, value, sizeof value);
   ASSERT(handle != 0);
   _service.characteristic[CHARACTERISTIC_ID_SAMPLE_DATA].handle = handle;
   _service.characteristic[CHARACTERISTIC_ID_SAMPLE_DATA].onWrite =
       NopWriteHandler;
 }
 
+static void AddRequestedAgeRangeCharacteristic(struct _tService* service) {
+  BleTypes_Characteristic_t requestedAgeRangeCharacteristic = {
+      .uuid.uuid.Char_UUID_16 = 0x8005,
+      .maxValueLength = sizeof(BleTypes_SampleAgeRange_t),
+      .characteristicPropertyFlags = CHAR_PROP_READ | CHAR_PROP_WRITE,
+      .securityFlags = SECURE_ACCESS,
+      .eventFlags = GATT_NOTIFY_ATTRIBUTE_WRITE,
+      .encryptionKeySize = 10,
+      .isVariableLengthValue = false};
+  BleGatt_ExtendCharacteristicUuid(&requestedAgeRangeCharacteristic.uuid,
+                                   &_serviceId);
+
+  BleTypes_SampleAgeRange_t value = {0};
+
+  uint16_t handle = BleGatt_AddCharacteristic(service->serviceHandle,
+                                              &requestedAgeRangeCharacteristic,
+                                              (uint8_t*)&value, sizeof(value));
+  ASSERT(handle != 0);
+  _service.characteristic[CHARACTERISTIC_ID_REQUESTED_AGE_RANGE].handle =
+      handle;
+  _service.characteristic[CHARACTERISTIC_ID_REQUESTED_AGE_RANGE].onWrite =
+      WriteRequestedAgeRange;
+}
+
+static void AddSampleSequenceCharacteristic(struct _tService* service) {
+  BleTypes_Characteristic_t sampleSequenceCharacteristic = {
+      .uuid.uuid.Char_UUID_16 = 0x8006,
+      .maxValueLength = 4,
+      .characteristicPropertyFlags = CHAR_PROP_READ | CHAR_PROP_WRITE,
+      .securityFlags = SECURE_ACCESS,
+      .eventFlags = GATT_NOTIFY_ATTRIBUTE_WRITE |
+                    GATT_NOTIFY_READ_REQ_AND_WAIT_FOR_APPL_RESP,
+      .encryptionKeySize = 10,
+      .isVariableLengthValue = false};
+  BleGatt_ExtendCharacteristicUuid(&sampleSequenceCharacteristic.uuid,
+                                   &_serviceId);
+
+  uint32_t value = BLE_TYPES_NO_SEQUENCE_NUMBER;
+
+  uint16_t handle = BleGatt_AddCharacteristic(service->serviceHandle,
+                                              &sampleSequenceCharacteristic,
+                                              (uint8_t*)&value, sizeof(value));
+  ASSERT(handle != 0);
+  _service.characteristic[CHARACTERISTIC_ID_SAMPLE_SEQUENCE].handle = handle;
+  _service.characteristic[CHARACTERISTIC_ID_SAMPLE_SEQUENCE].onRead =
+      ReadSampleSequence;
+  _service.characteristic[CHARACTERISTIC_ID_SAMPLE_SEQUENCE].onWrite =
+      WriteSampleSequence;
+}
+
+static void AddSampleTierCharacteristic(struct _tService* service) {
+  BleTypes_Characteristic_t sampleTierCharacteristic = {
+      .uuid.uuid.Char_UUID_16 = 0x8007,
+      .maxValueLength = 1,
+      .characteristicPropertyFlags = CHAR_PROP_READ | CHAR_PROP_WRITE,
+      .securityFlags = SECURE_ACCESS,
+      .eventFlags = GATT_NOTIFY_ATTRIBUTE_WRITE |
+                    GATT_NOTIFY_READ_REQ_AND_WAIT_FOR_APPL_RESP,
+      .encryptionKeySize = 10,
+      .isVariableLengthValue = false};
+  BleGatt_ExtendCharacteristicUuid(&sampleTierCharacteristic.uuid,
+                                   &_serviceId);
+
+  uint8_t value = BLE_TYPES_SAMPLE_TIER_RAW;
+
+  uint16_t handle = BleGatt_AddCharacteristic(service->serviceHandle,
+                                              &sampleTierCharacteristic,
+                                              &value, sizeof(value));
+  ASSERT(handle != 0);
+  _service.characteristic[CHARACTERISTIC_ID_SAMPLE_TIER].handle = handle;
+  _service.characteristic[CHARACTERISTIC_ID_SAMPLE_TIER].onRead =
+      ReadSampleTier;
+  _service.characteristic[CHARACTERISTIC_ID_SAMPLE_TIER].onWrite =
+      WriteSampleTier;
+}
+
+static void AddDownloadStatisticsCharacteristic(struct _tService* service) {
+  BleTypes_Characteristic_t downloadStatisticsCharacteristic = {
+      .uuid.uuid.Char_UUID_16 = 0x8008,
+      .maxValueLength = sizeof(DownloadTelemetry_Stats_t),
+      .characteristicPropertyFlags = CHAR_PROP_READ,
+      .securityFlags = SECURE_ACCESS,
+      .eventFlags = GATT_NOTIFY_READ_REQ_AND_WAIT_FOR_APPL_RESP,
+      .encryptionKeySize = 10,
+      .isVariableLengthValue = false};
+  BleGatt_ExtendCharacteristicUuid(&downloadStatisticsCharacteristic.uuid,
+                                   &_serviceId);
+
+  DownloadTelemetry_Stats_t value = {0};
+
+  uint16_t handle = BleGatt_AddCharacteristic(service->serviceHandle,
+                                              &downloadStatisticsCharacteristic,
+                                              (uint8_t*)&value, sizeof(value));
+  ASSERT(handle != 0);
+  _service.characteristic[CHARACTERISTIC_ID_DOWNLOAD_STATISTICS].handle =
+      handle;
+  _service.characteristic[CHARACTERISTIC_ID_DOWNLOAD_STATISTICS].onRead =
+      ReadDownloadStatistics;
+  _service.characteristic[CHARACTERISTIC_ID_DOWNLOAD_STATISTICS].onWrite =
+      NopWriteHandler;
+}
+
 static SVCCTL_EvtAckStatus_t EventHandler(void* void_event) {
   hci_event_pckt* event_pckt =
       (hci_event_pckt*)(((hci_uart_pckt*)void_event)->data);
@@ -321,7 +718,12 @@ static SVCCTL_EvtAckStatus_t EventHandler(void* void_event) {
 SVCCTL_EvtAckStatus_t ReadLoggingInterval(uint16_t connectionHandle,
                                           uint8_t* data,
                                           uint8_t dataLength) {
-  _service.currentConnection = connectionHandle;
+  uint8_t client = DataLoggerService_FindClient(connectionHandle);
+  if (client == BLE_TYPES_NO_CLIENT) {
+    aci_gatt_allow_read(connectionHandle);
+    return SVCCTL_EvtAckFlowEnable;
+  }
+  _service.clients[client].isReadPending = true;
   Message_Message_t msg = {
       .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
       .header.id = SERVICE_REQUEST_MESSAGE_ID_GET_LOGGING_INTERVAL,
@@ -345,7 +747,12 @@ SVCCTL_EvtAckStatus_t WriteLoggingInterval(uint16_t connectionHandle,
 SVCCTL_EvtAckStatus_t ReadAvailableSamples(uint16_t connectionHandle,
                                            uint8_t* data,
                                            uint8_t dataLength) {
-  _service.currentConnection = connectionHandle;
+  uint8_t client = DataLoggerService_FindClient(connectionHandle);
+  if (client == BLE_TYPES_NO_CLIENT) {
+    aci_gatt_allow_read(connectionHandle);
+    return SVCCTL_EvtAckFlowEnable;
+  }
+  _service.clients[client].isReadPending = true;
   Message_Message_t msg = {
       .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
       .header.id = SERVICE_REQUEST_MESSAGE_ID_GET_AVAILABLE_SAMPLES,
@@ -371,9 +778,22 @@ SVCCTL_EvtAckStatus_t ReadRequestedSamples(uint16_t currentConnection,
 SVCCTL_EvtAckStatus_t WriteRequestedSamples(uint16_t currentConnection,
                                             uint8_t* data,
                                             uint8_t dataLength) {
+  uint8_t client = DataLoggerService_FindClient(currentConnection);
+  if (client == BLE_TYPES_NO_CLIENT) {
+    return SVCCTL_EvtAckFlowEnable;
+  }
   // just update the characteristic with this value; isn't very meaningful
   // though
-  _service.requestedNrOfSamples = *((uint16_t*)data);
+  // the value of the event is not aligned
+  memcpy(&_service.clients[client].requestedNrOfSamples, data,
+         sizeof(uint16_t));
+  _service.clients[client].requestedEncoding =
+      DATA_LOGGER_SERVICE_ENCODING_RAW;
+  if (dataLength > REQUESTED_ENCODING_POSITION &&
+      (data[REQUESTED_ENCODING_POSITION] & REQUESTED_ENCODING_DELTA) != 0) {
+    _service.clients[client].requestedEncoding =
+        DATA_LOGGER_SERVICE_ENCODING_DELTA;
+  }
 
   tBleStatus status = BleGatt_UpdateCharacteristic(
       _service.serviceHandle,
@@ -383,22 +803,190 @@ SVCCTL_EvtAckStatus_t WriteRequestedSamples(uint16_t currentConnection,
   return SVCCTL_EvtAckFlowEnable;
 }
 
-void DataLoggerService_BuildHeaderFrame(uint8_t txFrameBuffer[TX_FRAME_SIZE],
-                                        BleTypes_SamplesMetaData_t* metadata) {
-  memset(txFrameBuffer, 0, TX_FRAME_SIZE);
+SVCCTL_EvtAckStatus_t WriteRequestedAgeRange(uint16_t currentConnection,
+                                             uint8_t* data,
+                                             uint8_t dataLength) {
+  uint8_t client = DataLoggerService_FindClient(currentConnection);
+  if (client == BLE_TYPES_NO_CLIENT ||
+      dataLength != sizeof(BleTypes_SampleAgeRange_t)) {
+    return SVCCTL_EvtAckFlowEnable;
+  }
+  BleTypes_SampleAgeRange_t* ageRange =
+      &_service.clients[client].requestedAgeRange;
+  memcpy(ageRange, data, dataLength);
+  tBleStatus status = BleGatt_UpdateCharacteristic(
+      _service.serviceHandle,
+      _service.characteristic[CHARACTERISTIC_ID_REQUESTED_AGE_RANGE].handle,
+      data, dataLength);
+  ASSERT(status == BLE_STATUS_SUCCESS);
+
+  // the range is applied with the next download of samples
+  Message_Message_t msg = {
+      .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
+      .header.id = SERVICE_REQUEST_MESSAGE_ID_SET_REQUESTED_AGE_RANGE,
+      .header.parameter1 = client,
+      .parameter2 = (uint32_t)ageRange};
+  Message_PublishAppMessage(&msg);
+  return SVCCTL_EvtAckFlowEnable;
+}
+
+void DataLoggerService_BuildHeaderFrame(
+    uint8_t txFrameBuffer[TX_FRAME_SIZE],
+    const BleTypes_SampleDownload_t* download,
+    uint8_t frameSize,
+    DataLoggerService_Encoding_t encoding) {
+  memset(txFrameBuffer, 0, TX_LEGACY_FRAME_SIZE);
   SET_UINT16(txFrameBuffer, SHT4x_SAMPLE_TYPE, SAMPLE_TYPE_OFFSET);
-  SET_MEM(txFrameBuffer, metadata, METADATA_OFFSET,
+  SET_MEM(txFrameBuffer, &download->metadata, METADATA_OFFSET,
           sizeof(BleTypes_SamplesMetaData_t));
+  // legacy clients ignore this field and expect frames of 20 bytes;
+  // they get them as long as they do not negotiate a bigger MTU.
+  SET_UINT16(txFrameBuffer, frameSize, FRAME_SIZE_OFFSET);
+  // legacy clients never request an encoding or a tier and get the logged
+  // samples in raw frames
+  txFrameBuffer[ENCODING_OFFSET] = encoding;
+  txFrameBuffer[TIER_OFFSET] = download->tier;
+}
+
+SVCCTL_EvtAckStatus_t WriteSampleSequence(uint16_t currentConnection,
+                                          uint8_t* data,
+                                          uint8_t dataLength) {
+  uint8_t client = DataLoggerService_FindClient(currentConnection);
+  if (client == BLE_TYPES_NO_CLIENT || dataLength != sizeof(uint32_t)) {
+    return SVCCTL_EvtAckFlowEnable;
+  }
+  // the sequence number is applied with the next download of samples
+  memcpy(&_service.clients[client].sampleSequence, data, dataLength);
+  Message_Message_t msg = {
+      .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
+      .header.id = SERVICE_REQUEST_MESSAGE_ID_SET_RESUME_SEQUENCE,
+      .header.parameter1 = client,
+      .parameter2 = *((uint32_t*)data)};
+  Message_PublishAppMessage(&msg);
+  return SVCCTL_EvtAckFlowEnable;
+}
+
+SVCCTL_EvtAckStatus_t ReadSampleSequence(uint16_t currentConnection,
+                                         uint8_t* data,
+                                         uint8_t dataLength) {
+  uint8_t client = DataLoggerService_FindClient(currentConnection);
+  uint32_t sequenceNumber = BLE_TYPES_NO_SEQUENCE_NUMBER;
+  if (client != BLE_TYPES_NO_CLIENT) {
+    sequenceNumber = _service.clients[client].sampleSequence;
+  }
+  return AllowClientRead(currentConnection, CHARACTERISTIC_ID_SAMPLE_SEQUENCE,
+                         (uint8_t*)&sequenceNumber, sizeof sequenceNumber);
 }
 
-void DataLoggerService_BuildDataFrame(uint8_t txFrameBuffer[TX_FRAME_SIZE],
-                                      uint16_t frameIndex,
+SVCCTL_EvtAckStatus_t ReadSampleTier(uint16_t currentConnection,
+                                     uint8_t* data,
+                                     uint8_t dataLength) {
+  uint8_t client = DataLoggerService_FindClient(currentConnection);
+  uint8_t tier = BLE_TYPES_SAMPLE_TIER_RAW;
+  if (client != BLE_TYPES_NO_CLIENT) {
+    tier = _service.clients[client].sampleTier;
+  }
+  return AllowClientRead(currentConnection, CHARACTERISTIC_ID_SAMPLE_TIER,
+                         &tier, sizeof tier);
+}
+
+SVCCTL_EvtAckStatus_t ReadDownloadStatistics(uint16_t currentConnection,
+                                             uint8_t* data,
+                                             uint8_t dataLength) {
+  uint8_t client = DataLoggerService_FindClient(currentConnection);
+  DownloadTelemetry_Stats_t stats = {0};
+  if (client != BLE_TYPES_NO_CLIENT) {
+    stats = _service.clients[client].downloadStatistics;
+  }
+  return AllowClientRead(currentConnection,
+                         CHARACTERISTIC_ID_DOWNLOAD_STATISTICS,
+                         (uint8_t*)&stats, sizeof stats);
+}
+
+SVCCTL_EvtAckStatus_t WriteSampleTier(uint16_t currentConnection,
                                       uint8_t* data,
                                       uint8_t dataLength) {
-  ASSERT(dataLength <= 16);
-  memset(txFrameBuffer, 0, TX_FRAME_SIZE);
-  SET_UINT16(txFrameBuffer, frameIndex, 0);
-  SET_MEM(txFrameBuffer, data, sizeof(frameIndex), dataLength);
+  uint8_t client = DataLoggerService_FindClient(currentConnection);
+  if (client == BLE_TYPES_NO_CLIENT || dataLength != sizeof(uint8_t) ||
+      data[0] >= BLE_TYPES_NR_OF_SAMPLE_TIERS) {
+    return SVCCTL_EvtAckFlowEnable;
+  }
+  _service.clients[client].sampleTier = data[0];
+  // the tier is applied with the next download of samples
+  Message_Message_t msg = {
+      .header.category = MESSAGE_BROKER_CATEGORY_BLE_SERVICE_REQUEST,
+      .header.id = SERVICE_REQUEST_MESSAGE_ID_SET_SAMPLE_TIER,
+      .header.parameter1 = client,
+      .parameter2 = data[0]};
+  Message_PublishAppMessage(&msg);
+  return SVCCTL_EvtAckFlowEnable;
+}
+
+void DataLoggerService_ClearFrameBuffer(
+    DataLoggerService_FrameBuffer_t* buffer) {
+  ASSERT(buffer->frameSize >= TX_LEGACY_FRAME_SIZE &&
+         buffer->frameSize <= TX_FRAME_SIZE);
+  buffer->nrOfFrames = 0;
+  buffer->nrOfSamples = 0;
+  buffer->filledGeneration = buffer->generation;
+}
+
+bool DataLoggerService_PutSample(DataLoggerService_FrameBuffer_t* buffer,
+                                 const uint8_t sample[TX_FRAME_SAMPLE_SIZE]) {
+  if (buffer->encoding == DATA_LOGGER_SERVICE_ENCODING_DELTA) {
+    return PutDeltaEncodedSample(buffer, sample);
+  }
+  return PutRawSample(buffer, sample);
+}
+
+static bool PutRawSample(DataLoggerService_FrameBuffer_t* buffer,
+                         const uint8_t sample[TX_FRAME_SAMPLE_SIZE]) {
+  uint8_t samplesPerFrame =
+      (buffer->frameSize - TX_FRAME_INDEX_SIZE) / TX_FRAME_SAMPLE_SIZE;
+  uint8_t frame = buffer->nrOfFrames - 1;
+  if (buffer->nrOfFrames == 0 ||
+      buffer->frameSamples[frame] == samplesPerFrame) {
+    if (buffer->nrOfFrames == TX_FRAMES_PER_BUFFER) {
+      return false;
+    }
+    frame = buffer->nrOfFrames++;
+    memset(buffer->frames[frame], 0, buffer->frameSize);
+    SET_UINT16(buffer->frames[frame], buffer->firstFrameIndex + frame, 0);
+    // raw frames are always sent with their full size
+    buffer->frameLength[frame] = buffer->frameSize;
+    buffer->frameSamples[frame] = 0;
+  }
+  SET_MEM(buffer->frames[frame], sample,
+          TX_FRAME_INDEX_SIZE +
+              buffer->frameSamples[frame] * TX_FRAME_SAMPLE_SIZE,
+          TX_FRAME_SAMPLE_SIZE);
+  buffer->frameSamples[frame]++;
+  buffer->nrOfSamples++;
+  return true;
+}
+
+static bool PutDeltaEncodedSample(DataLoggerService_FrameBuffer_t* buffer,
+                                  const uint8_t sample[TX_FRAME_SAMPLE_SIZE]) {
+  SampleStreamCodec_Sample_t codecSample;
+  memcpy(&codecSample, sample, sizeof codecSample);
+  if (buffer->nrOfFrames == 0 ||
+      !SampleStreamCodec_AddSample(&buffer->encoder, &codecSample)) {
+    if (buffer->nrOfFrames == TX_FRAMES_PER_BUFFER) {
+      return false;
+    }
+    uint8_t frame = buffer->nrOfFrames++;
+    SampleStreamCodec_BeginFrame(&buffer->encoder, buffer->frames[frame],
+                                 buffer->frameSize,
+                                 buffer->firstFrameIndex + frame);
+    // the key sample always fits into an empty frame
+    bool isAdded = SampleStreamCodec_AddSample(&buffer->encoder, &codecSample);
+    ASSERT(isAdded);
+  }
+  uint8_t frame = buffer->nrOfFrames - 1;
+  buffer->frameLength[frame] = buffer->encoder.length;
+  buffer->frameSamples[frame] = buffer->encoder.nrOfSamples;
+  buffer->nrOfSamples++;
+  return true;
 }
 
 bool DataLoggerService_IsSampleDataCharacteristic(uint16_t handle) {
@@ -406,6 +994,12 @@ bool DataLoggerService_IsSampleDataCharacteristic(uint16_t handle) {
           (_service.characteristic[CHARACTERISTIC_ID_SAMPLE_DATA].handle + 2));
 }
 
-uint16_t DataLoggerService_GetNumberOfRequestedSamples() {
-  return _service.requestedNrOfSamples;
+uint16_t DataLoggerService_GetNumberOfRequestedSamples(uint8_t client) {
+  return _service.clients[client].requestedNrOfSamples;
+}
+
+DataLoggerService_Encoding_t DataLoggerService_GetRequestedEncoding(
+    uint8_t client) {
+  return (DataLoggerService_Encoding_t)_service.clients[client]
+      .requestedEncoding;
 }
@@ -36,12 +36,65 @@
 #define DATA_LOGGER_SERVICE_H
 
 #include "app_service/networking/ble/BleInterface.h"
+#include "app_service/networking/ble/DownloadTelemetry.h"
+#include "app_service/networking/ble/gatt_service/SampleStreamCodec.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 
-/// Size of data logger frame
-#define TX_FRAME_SIZE 20
+/// Size of the frame index at the beginning of a data frame
+#define TX_FRAME_INDEX_SIZE 2
+
+/// Size of one sample within a data frame
+#define TX_FRAME_SAMPLE_SIZE 4
+
+/// Size of a data logger frame that fits into the default ATT MTU of 23 bytes;
+/// the header frame always has this size.
+#define TX_LEGACY_FRAME_SIZE 20
+
+/// Maximal size of a data logger frame; it is given by the maximal ATT MTU
+/// minus the 3 bytes of the notification header.
+#define TX_FRAME_SIZE                                                        \
+  (TX_FRAME_INDEX_SIZE + (CFG_BLE_MAX_ATT_MTU - 3 - TX_FRAME_INDEX_SIZE) / \
+                             TX_FRAME_SAMPLE_SIZE * TX_FRAME_SAMPLE_SIZE)
+
+/// Number of data frames of a frame buffer
+#define TX_FRAMES_PER_BUFFER 8
+
+/// Encoding of the samples within the data frames
+typedef enum {
+  /// Every sample is sent with its 4 bytes
+  DATA_LOGGER_SERVICE_ENCODING_RAW = 0,
+  /// Every frame holds a key sample and the deltas of the further samples;
+  /// see SampleStreamCodec.h
+  DATA_LOGGER_SERVICE_ENCODING_DELTA = 1,
+} DataLoggerService_Encoding_t;
+
+/// A buffer of data frames that are ready to be sent.
+///
+/// The producer of the samples writes them directly into the frames with
+/// `DataLoggerService_PutSample()`; the frames are sent without copying.
+typedef struct _tDataLoggerService_FrameBuffer {
+  uint8_t frameSize;         ///< Size of the frames; set by the consumer
+  uint16_t firstFrameIndex;  ///< Index of the first frame; set by the consumer
+  uint8_t client;            ///< Index of the client; set by the consumer
+  /// Generation of the last request of the buffer; set by the consumer
+  uint8_t generation;
+  /// Generation of the request the frames were filled for
+  uint8_t filledGeneration;
+  uint8_t encoding;          ///< DataLoggerService_Encoding_t of the frames
+  uint8_t nrOfFrames;        ///< Number of filled frames
+  uint16_t nrOfSamples;      ///< Number of samples in the filled frames
+  /// Time stamp of the last hand over through the message broker
+  uint16_t publishedStamp;
+  /// Number of used bytes of each filled frame
+  uint8_t frameLength[TX_FRAMES_PER_BUFFER];
+  /// Number of samples of each filled frame
+  uint8_t frameSamples[TX_FRAMES_PER_BUFFER];
+  /// Encoder of the last frame if the samples are delta encoded
+  SampleStreamCodec_Encoder_t encoder;
+  uint8_t frames[TX_FRAMES_PER_BUFFER][TX_FRAME_SIZE];  ///< The data frames
+} DataLoggerService_FrameBuffer_t;
 
 /// Setup the data logger service
 /// The service is specified in
@@ -61,32 +114,111 @@ void DataLoggerService_UpdateDataLoggingIntervalCharacteristic(
 /// @param samples Number of available samples
 void DataLoggerService_UpdateAvailableSamplesCharacteristic(uint32_t samples);
 
-/// Write the next frame to the sample data characteristic.
+/// Write the sequence number of the first sample of a download to the sample
+/// sequence characteristic of a client.
+///
+/// The client writes the sequence number of the newest sample it has to the
+/// same characteristic to resume a download; writing
+/// BLE_TYPES_NO_SEQUENCE_NUMBER requests the newest samples again. The
+/// sequence number of a log that was erased since also requests the newest
+/// samples. Each client reads the value of its own download.
+/// @param client Index of the client that downloads the samples
+/// @param sequenceNumber Sequence number of the first sample of the download
+void DataLoggerService_UpdateSampleSequenceCharacteristic(
+    uint8_t client,
+    uint32_t sequenceNumber);
+
+/// Assign a client index to a new connection.
+///
+/// The requested samples, their encoding and age range, the sample sequence,
+/// the tier, the download statistics and the link properties are kept for
+/// each client. A new client starts with the defaults and gets the newest
+/// logged samples unless it resumes a download or selects another tier.
+/// @param connectionHandle Handle of the new connection
+/// @return Index of the client; BLE_TYPES_NO_CLIENT if all are in use
+uint8_t DataLoggerService_OpenClient(uint16_t connectionHandle);
+
+/// Release the client index of a closed connection.
+/// @param client Index of the client
+void DataLoggerService_CloseClient(uint8_t client);
+
+/// Find the client of a connection.
+/// @param connectionHandle Handle of the connection
+/// @return Index of the client; BLE_TYPES_NO_CLIENT if there is none
+uint8_t DataLoggerService_FindClient(uint16_t connectionHandle);
+
+/// Notify the next frame of the sample data characteristic to a client.
 ///
+/// @param client Index of the client that downloads the samples
 /// @param frame data frame to be notified to the client
+/// @param frameSize number of bytes of the frame
 /// @return true if the characteristic was updated successfully;
 ///         false otherwise.
 /// @note:  In case the function returns false, the update shall be retried as
 ///         soon as a ACI_GATT_TX_POOL_AVAILABLE_EVENT has been received.
 bool DataLoggerService_UpdateSampleDataCharacteristic(
-    uint8_t frame[TX_FRAME_SIZE]);
+    uint8_t client,
+    uint8_t frame[TX_FRAME_SIZE],
+    uint8_t frameSize);
+
+/// Write the statistics of the last download of a client to its download
+/// statistics characteristic; the other clients keep reading their own.
+/// @param client Index of the client that downloaded the samples
+/// @param stats Statistics of the last download
+void DataLoggerService_UpdateDownloadStatisticsCharacteristic(
+    uint8_t client,
+    const DownloadTelemetry_Stats_t* stats);
 
 /// Build the first notification frame containing the metadata of the
 /// MeasurementSampleData.
+///
+/// The header frame has always TX_LEGACY_FRAME_SIZE bytes. It tells the
+/// client the size of the data frames that follow, how the samples within
+/// them are encoded and which tier of the history they belong to.
 /// @param txFrameBuffer Storage for the first frame
-/// @param metadata Metadata to be embedded in the frame
-void DataLoggerService_BuildHeaderFrame(uint8_t txFrameBuffer[TX_FRAME_SIZE],
-                                        BleTypes_SamplesMetaData_t* metadata);
-
-/// Build a data frame containing logged data.
-/// @param txFrameBuffer Storage for the data frame
-/// @param frameIndex Index of the frame
-/// @param data Data bytes to be sent
-/// @param dataLength Number of valid data bytes
-void DataLoggerService_BuildDataFrame(uint8_t txFrameBuffer[TX_FRAME_SIZE],
-                                      uint16_t frameIndex,
-                                      uint8_t* data,
-                                      uint8_t dataLength);
+/// @param download Metadata and tier of the download
+/// @param frameSize Maximal size of the data frames of the download
+/// @param encoding Encoding of the samples in the data frames
+void DataLoggerService_BuildHeaderFrame(
+    uint8_t txFrameBuffer[TX_FRAME_SIZE],
+    const BleTypes_SampleDownload_t* download,
+    uint8_t frameSize,
+    DataLoggerService_Encoding_t encoding);
+
+/// Clear a frame buffer before it is filled for its last request.
+/// @param buffer The frame buffer to be cleared
+void DataLoggerService_ClearFrameBuffer(
+    DataLoggerService_FrameBuffer_t* buffer);
+
+/// Append a sample to the frames of a frame buffer.
+///
+/// The frame index is written when a frame receives its first sample; the
+/// unused bytes of the last raw frame are zero.
+/// @param buffer The frame buffer with frame size and encoding set
+/// @param sample The sample bytes to be appended
+/// @return true if the sample was appended; false if the buffer is full
+bool DataLoggerService_PutSample(DataLoggerService_FrameBuffer_t* buffer,
+                                 const uint8_t sample[TX_FRAME_SAMPLE_SIZE]);
+
+/// Update the ATT MTU that was negotiated with a client.
+/// @param connectionHandle Handle of the client connection
+/// @param attMtu The negotiated ATT MTU
+void DataLoggerService_SetAttMtu(uint16_t connectionHandle, uint16_t attMtu);
+
+/// Update the maximal payload of a link layer packet that was negotiated
+/// with the data length extension.
+/// @param connectionHandle Handle of the client connection
+/// @param maxTxOctets Maximal number of payload octets of a sent packet
+void DataLoggerService_SetMaxTxOctets(uint16_t connectionHandle,
+                                      uint16_t maxTxOctets);
+
+/// Get the size of the data frames for the link properties of a client.
+///
+/// A frame contains as many samples as fit into one notification that is
+/// sent within one link layer packet.
+/// @param client Index of the client
+/// @return The size of a data frame; at least TX_LEGACY_FRAME_SIZE
+uint8_t DataLoggerService_GetFrameSize(uint8_t client);
 
 /// Function to check if the supplied handle corresponds to the
 /// SampleDataCharacteristic handle.
@@ -101,7 +233,17 @@ void DataLoggerService_BuildDataFrame(uint8_t txFrameBuffer[TX_FRAME_SIZE],
 bool DataLoggerService_IsSampleDataCharacteristic(uint16_t handle);
 
 /// Function to read the number of requested samples from the service.
-/// @return number of requested samples requestedSamples of the service
-uint16_t DataLoggerService_GetNumberOfRequestedSamples();
+/// @param client Index of the client
+/// @return number of samples the client requested
+uint16_t DataLoggerService_GetNumberOfRequestedSamples(uint8_t client);
+
+/// Get the encoding of the samples the client asked for.
+///
+/// A client opts in to the delta encoding by setting bit 16 of the value it
+/// writes to the requested samples characteristic.
+/// @param client Index of the client
+/// @return The requested encoding
+DataLoggerService_Encoding_t DataLoggerService_GetRequestedEncoding(
+    uint8_t client);
 
 #endif  // DATA_LOGGER_SERVICE_H
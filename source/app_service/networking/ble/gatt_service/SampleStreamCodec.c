@@ -0,0 +1,223 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file SampleStreamCodec.c
+#include "SampleStreamCodec.h"
+
+/// Position of the number of samples within a frame
+#define NR_OF_SAMPLES_POSITION 2
+
+/// Position of the key sample within a frame
+#define KEY_SAMPLE_POSITION 3
+
+/// Maximal number of bytes of an encoded delta; a zig-zag encoded delta of
+/// two 16 bit values needs 17 bits.
+#define MAX_DELTA_SIZE 3
+
+/// Bit that tells that another byte of the variable length integer follows
+#define CONTINUATION_BIT 0x80
+
+/// Mask of the payload bits of a byte of a variable length integer
+#define PAYLOAD_MASK 0x7F
+
+/// Write a 16 bit value in little endian byte order.
+/// @param buffer The destination of the value
+/// @param value The value to be written
+static void WriteUint16(uint8_t* buffer, uint16_t value);
+
+/// Read a 16 bit value in little endian byte order.
+/// @param buffer The source of the value
+/// @return The read value
+static uint16_t ReadUint16(const uint8_t* buffer);
+
+/// Map a signed delta to an unsigned value; small magnitudes get small
+/// values.
+/// @param delta The signed delta
+/// @return The zig-zag encoded delta
+static uint32_t ZigZagEncode(int32_t delta);
+
+/// Inverse of ZigZagEncode().
+/// @param value The zig-zag encoded delta
+/// @return The signed delta
+static int32_t ZigZagDecode(uint32_t value);
+
+/// Get the number of bytes of a variable length integer.
+/// @param value The value to be encoded
+/// @return The number of bytes
+static uint8_t VarintSize(uint32_t value);
+
+/// Write a variable length integer.
+/// @param buffer The destination of the value
+/// @param value The value to be written
+/// @return The number of written bytes
+static uint8_t WriteVarint(uint8_t* buffer, uint32_t value);
+
+/// Read a variable length integer.
+/// @param buffer The source of the value
+/// @param length Number of available bytes
+/// @param [out] value Receives the read value
+/// @return The number of read bytes; 0 if the value is not complete
+static uint8_t ReadVarint(const uint8_t* buffer,
+                          uint8_t length,
+                          uint32_t* value);
+
+void SampleStreamCodec_BeginFrame(SampleStreamCodec_Encoder_t* encoder,
+                                  uint8_t* frame,
+                                  uint8_t frameSize,
+                                  uint16_t frameIndex) {
+  encoder->frame = frame;
+  encoder->frameSize = frameSize;
+  encoder->length = KEY_SAMPLE_POSITION;
+  encoder->nrOfSamples = 0;
+  WriteUint16(frame, frameIndex);
+  frame[NR_OF_SAMPLES_POSITION] = 0;
+}
+
+bool SampleStreamCodec_AddSample(SampleStreamCodec_Encoder_t* encoder,
+                                 const SampleStreamCodec_Sample_t* sample) {
+  uint8_t* frame = encoder->frame;
+  if (encoder->nrOfSamples == UINT8_MAX) {
+    return false;
+  }
+  if (encoder->nrOfSamples == 0) {
+    if (encoder->frameSize < SAMPLE_STREAM_CODEC_HEADER_SIZE) {
+      return false;
+    }
+    WriteUint16(&frame[KEY_SAMPLE_POSITION], sample->temperatureTicks);
+    WriteUint16(&frame[KEY_SAMPLE_POSITION + 2], sample->humidityTicks);
+    encoder->length = SAMPLE_STREAM_CODEC_HEADER_SIZE;
+  } else {
+    uint32_t temperatureDelta =
+        ZigZagEncode((int32_t)sample->temperatureTicks -
+                     encoder->previous.temperatureTicks);
+    uint32_t humidityDelta = ZigZagEncode((int32_t)sample->humidityTicks -
+                                          encoder->previous.humidityTicks);
+    if (encoder->length + VarintSize(temperatureDelta) +
+            VarintSize(humidityDelta) >
+        encoder->frameSize) {
+      return false;
+    }
+    encoder->length += WriteVarint(&frame[encoder->length], temperatureDelta);
+    encoder->length += WriteVarint(&frame[encoder->length], humidityDelta);
+  }
+  encoder->previous = *sample;
+  frame[NR_OF_SAMPLES_POSITION] = ++encoder->nrOfSamples;
+  return true;
+}
+
+uint8_t SampleStreamCodec_DecodeFrame(const uint8_t* frame,
+                                      uint8_t length,
+                                      uint16_t* frameIndex,
+                                      SampleStreamCodec_Sample_t* samples,
+                                      uint8_t maxNrOfSamples) {
+  if (length < SAMPLE_STREAM_CODEC_HEADER_SIZE) {
+    return 0;
+  }
+  uint8_t nrOfSamples = frame[NR_OF_SAMPLES_POSITION];
+  if (nrOfSamples == 0 || nrOfSamples > maxNrOfSamples) {
+    return 0;
+  }
+  *frameIndex = ReadUint16(frame);
+  samples[0].temperatureTicks = ReadUint16(&frame[KEY_SAMPLE_POSITION]);
+  samples[0].humidityTicks = ReadUint16(&frame[KEY_SAMPLE_POSITION + 2]);
+  uint8_t position = SAMPLE_STREAM_CODEC_HEADER_SIZE;
+  for (uint8_t i = 1; i < nrOfSamples; i++) {
+    uint32_t temperatureDelta;
+    uint32_t humidityDelta;
+    uint8_t size =
+        ReadVarint(&frame[position], length - position, &temperatureDelta);
+    if (size == 0) {
+      return 0;
+    }
+    position += size;
+    size = ReadVarint(&frame[position], length - position, &humidityDelta);
+    if (size == 0) {
+      return 0;
+    }
+    position += size;
+    samples[i].temperatureTicks = (uint16_t)(samples[i - 1].temperatureTicks +
+                                             ZigZagDecode(temperatureDelta));
+    samples[i].humidityTicks = (uint16_t)(samples[i - 1].humidityTicks +
+                                          ZigZagDecode(humidityDelta));
+  }
+  return nrOfSamples;
+}
+
+static void WriteUint16(uint8_t* buffer, uint16_t value) {
+  buffer[0] = value & 0xFF;
+  buffer[1] = value >> 8;
+}
+
+static uint16_t ReadUint16(const uint8_t* buffer) {
+  return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static uint32_t ZigZagEncode(int32_t delta) {
+  return ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+}
+
+static int32_t ZigZagDecode(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint8_t VarintSize(uint32_t value) {
+  uint8_t size = 1;
+  while (value > PAYLOAD_MASK) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+static uint8_t WriteVarint(uint8_t* buffer, uint32_t value) {
+  uint8_t size = 0;
+  while (value > PAYLOAD_MASK) {
+    buffer[size++] = (value & PAYLOAD_MASK) | CONTINUATION_BIT;
+    value >>= 7;
+  }
+  buffer[size++] = value;
+  return size;
+}
+
+static uint8_t ReadVarint(const uint8_t* buffer,
+                          uint8_t length,
+                          uint32_t* value) {
+  *value = 0;
+  for (uint8_t i = 0; i < length && i < MAX_DELTA_SIZE; i++) {
+    *value |= (uint32_t)(buffer[i] & PAYLOAD_MASK) << (7 * i);
+    if ((buffer[i] & CONTINUATION_BIT) == 0) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
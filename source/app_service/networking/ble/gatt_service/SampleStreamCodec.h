@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file SampleStreamCodec.h
+///
+/// Compressed encoding of the samples in the data frames of the data logger
+/// service.
+///
+/// A compressed frame starts with a key sample followed by the deltas of
+/// each further sample to its predecessor. The deltas are zig-zag encoded
+/// and written as variable length integers with 7 bits per byte; the most
+/// significant bit of a byte tells that another byte follows.
+///
+/// | bytes | content                                               |
+/// |-------|-------------------------------------------------------|
+/// | 0..1  | frame index                                           |
+/// | 2     | number of samples in the frame                        |
+/// | 3..4  | temperature ticks of the key sample                   |
+/// | 5..6  | humidity ticks of the key sample                      |
+/// | 7..   | temperature and humidity delta of each further sample |
+///
+/// Every frame is self-contained and is sent with its used length only.
+///
+/// The decoder is not used by the firmware. It is the reference for
+/// clients, depends on the standard library only and is checked against the
+/// encoder by the host tests.
+#ifndef SAMPLE_STREAM_CODEC_H
+#define SAMPLE_STREAM_CODEC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Size of the frame header and of the key sample of a compressed frame
+#define SAMPLE_STREAM_CODEC_HEADER_SIZE 7
+
+/// A sample as it is transmitted by the data logger service
+typedef struct _tSampleStreamCodec_Sample {
+  uint16_t temperatureTicks;  ///< raw measurement value of temperature
+  uint16_t humidityTicks;     ///< raw measurement value of humidity
+} SampleStreamCodec_Sample_t;
+
+/// Collects the samples of one compressed frame
+typedef struct _tSampleStreamCodec_Encoder {
+  uint8_t* frame;                       ///< The frame that is filled
+  uint8_t frameSize;                    ///< Maximal size of the frame
+  uint8_t length;                       ///< Number of used bytes
+  uint8_t nrOfSamples;                  ///< Number of samples in the frame
+  SampleStreamCodec_Sample_t previous;  ///< The last added sample
+} SampleStreamCodec_Encoder_t;
+
+/// Start a new compressed frame.
+/// @param encoder The encoder that fills the frame
+/// @param frame Storage of the frame
+/// @param frameSize Maximal size of the frame
+/// @param frameIndex Index of the frame
+void SampleStreamCodec_BeginFrame(SampleStreamCodec_Encoder_t* encoder,
+                                  uint8_t* frame,
+                                  uint8_t frameSize,
+                                  uint16_t frameIndex);
+
+/// Add a sample to the frame of the encoder.
+/// @param encoder The encoder that fills the frame
+/// @param sample The sample to be added
+/// @return true if the sample was added; false if it does not fit into the
+///         frame anymore
+bool SampleStreamCodec_AddSample(SampleStreamCodec_Encoder_t* encoder,
+                                 const SampleStreamCodec_Sample_t* sample);
+
+/// Decode a compressed frame.
+/// @param frame The received frame
+/// @param length Number of received bytes
+/// @param [out] frameIndex Receives the index of the frame
+/// @param [out] samples Receives the samples of the frame
+/// @param maxNrOfSamples Number of samples that fit into samples
+/// @return Number of decoded samples; 0 if the frame is not valid
+uint8_t SampleStreamCodec_DecodeFrame(const uint8_t* frame,
+                                      uint8_t length,
+                                      uint16_t* frameIndex,
+                                      SampleStreamCodec_Sample_t* samples,
+                                      uint8_t maxNrOfSamples);
+
+#endif  // SAMPLE_STREAM_CODEC_H
@@ -0,0 +1,396 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file ExternalFlash.c
+///
+/// Implementation of ExternalFlash.h
+
+#include "ExternalFlash.h"
+
+#include "app_service/timer_server/TimerServer.h"
+#include "hal/Clock.h"
+#include "hal/Qspi.h"
+#include "stm32_seq.h"
+#include "utility/ErrorHandler.h"
+#include "utility/scheduler/Scheduler.h"
+
+#include <stdint.h>
+
+/// Size of a program page; a program operation must not cross its boundary
+#define PROGRAM_PAGE_SIZE 256
+
+/// Interval to poll the status register while a page is erased
+#define ERASE_POLL_INTERVAL_MS 10
+
+/// Clock cycles between the address and the data of a fast read quad output
+#define FAST_READ_WAIT_CYCLES 8
+
+/// Core clock cycles per microsecond; the core runs from the 32MHz HSE.
+#define CORE_CYCLES_PER_US 32
+
+/// Minimal time between the resume of an erase and the next suspend (tSUS).
+/// The erase does not make progress if it is suspended again too early.
+#define ERASE_RESUME_TO_SUSPEND_US 20
+
+/// Time the flash needs to enter or to leave the power down mode (tDP and
+/// tRES1)
+#define POWER_DOWN_TRANSITION_US 3
+
+/// Write in progress flag of the status register 1
+#define STATUS_1_BUSY 0x01
+
+/// Quad enable flag of the status register 2
+#define STATUS_2_QUAD_ENABLE 0x02
+
+/// Instructions of the W25Q80 that are used by this driver
+typedef enum {
+  INSTRUCTION_WRITE_STATUS = 0x01,
+  INSTRUCTION_READ_STATUS_1 = 0x05,
+  INSTRUCTION_WRITE_ENABLE = 0x06,
+  INSTRUCTION_QUAD_PAGE_PROGRAM = 0x32,
+  INSTRUCTION_READ_STATUS_2 = 0x35,
+  INSTRUCTION_BLOCK_ERASE_32K = 0x52,
+  INSTRUCTION_FAST_READ_QUAD_OUTPUT = 0x6B,
+  INSTRUCTION_ERASE_SUSPEND = 0x75,
+  INSTRUCTION_ERASE_RESUME = 0x7A,
+  INSTRUCTION_RELEASE_POWER_DOWN = 0xAB,
+  INSTRUCTION_POWER_DOWN = 0xB9,
+} Instruction_t;
+
+/// Write an instruction without parameters and wait until it is sent.
+/// @param instruction The instruction to be sent
+static void WriteInstruction(Instruction_t instruction);
+
+/// Read a status register of the flash.
+/// @param instruction Instruction to read status register 1 or 2
+/// @return The value of the status register
+static uint8_t ReadStatusRegister(Instruction_t instruction);
+
+/// Wait until the flash finished the ongoing program operation.
+static void AwaitNotBusy();
+
+/// Wait until the QSPI peripheral signals the end of a transfer.
+static void AwaitTransfer();
+
+/// Program data that fits into one program page of the flash.
+/// @param address Start address of the data
+/// @param buffer The data to be written
+/// @param nrOfBytes Number of bytes to be written
+static void ProgramPage(uint32_t address,
+                        const uint8_t* buffer,
+                        uint16_t nrOfBytes);
+
+/// Start the erase of a single page.
+/// @param pageNr Page to be erased
+static void StartErase(uint16_t pageNr);
+
+/// Suspend an ongoing erase such that the flash can be read.
+///
+/// The erase stays suspended until the flash operation task runs; all reads
+/// until then are served by the same suspend.
+static void SuspendErase();
+
+/// Resume a suspended erase.
+static void ResumeErase();
+
+/// Release the flash from the power down mode if needed.
+///
+/// The flash operation task puts the flash back into power down mode.
+static void WakeUp();
+
+/// Put the flash into the power down mode unless an erase is ongoing.
+static void PowerDown();
+
+/// Wait until some time has elapsed since a reference point.
+/// @param startCycle Core clock cycle of the reference point
+/// @param durationUs Time that needs to elapse in microseconds
+static void AwaitElapsed(uint32_t startCycle, uint32_t durationUs);
+
+/// Resume a suspended erase, check if the erase is complete and continue with
+/// the next page. The flash is put into power down mode when it is idle.
+///
+/// Runs as task of the scheduler.
+static void FlashOperationTask();
+
+/// Trigger the task that polls the erase status; called by the timer server.
+static void ErasePollTimerElapsedCb();
+
+/// Read the result of an instruction that was just written.
+static void ReadInstructionResultCb();
+
+/// Signal the end of a transfer.
+static void SignalTransferDoneCb();
+
+/// Flag that is set by the QSPI interrupt when a transfer is complete
+static volatile bool _isTransferDone;
+
+/// Receives the result of a read status register instruction
+static uint8_t _instructionResult[1];
+
+/// Timer to poll the status register while erasing
+static uint8_t _erasePollTimer;
+
+/// Callback that is notified when the erase operation is complete;
+/// only set while an erase is ongoing.
+static Flash_OperationComplete _eraseCompleteCb;
+
+/// Page that is currently erased
+static uint16_t _erasePageNr;
+
+/// Number of pages that still need to be erased
+static uint8_t _pagesToErase;
+
+/// Flag to indicate that the ongoing erase is suspended
+static bool _isEraseSuspended;
+
+/// Core clock cycle at which the erase was started or resumed the last time
+static uint32_t _eraseResumeCycle;
+
+/// Flag to indicate that the flash is in power down mode
+static bool _isPoweredDown;
+
+/// Core clock cycle at which the flash entered or left the power down mode
+static uint32_t _powerModeCycle;
+
+void ExternalFlash_Init() {
+  static bool initialized = false;
+  if (initialized) {
+    return;
+  }
+  initialized = true;
+  _erasePollTimer = TimerServer_CreateTimer(TIMER_SERVER_MODE_SINGLE_SHOT,
+                                            ErasePollTimerElapsedCb);
+  UTIL_SEQ_RegTask(1 << SCHEDULER_TASK_HANDLE_EXTERNAL_FLASH_OPERATION,
+                   UTIL_SEQ_RFU, FlashOperationTask);
+  // the flash may still be in power down mode after a reset of the MCU
+  _isPoweredDown = true;
+  _powerModeCycle = Clock_GetCycleCount();
+  WakeUp();
+  uint8_t status1 = ReadStatusRegister(INSTRUCTION_READ_STATUS_1);
+  uint8_t status2 = ReadStatusRegister(INSTRUCTION_READ_STATUS_2);
+  // the quad enable bit is non volatile; it is only written once.
+  if ((status2 & STATUS_2_QUAD_ENABLE) != 0) {
+    return;
+  }
+  WriteInstruction(INSTRUCTION_WRITE_ENABLE);
+  _isTransferDone = false;
+  Qspi_WriteInstruction(INSTRUCTION_WRITE_STATUS,
+                        status1 | ((status2 | STATUS_2_QUAD_ENABLE) << 8),
+                        QSPI_INSTRUCTION_DATA_SIZE_TWO_BYTE, 0,
+                        SignalTransferDoneCb);
+  AwaitTransfer();
+  AwaitNotBusy();
+}
+
+bool ExternalFlash_Read(uint32_t address, uint8_t* buffer, uint16_t nrOfBytes) {
+  WakeUp();
+  SuspendErase();
+  _isTransferDone = false;
+  Qspi_QuadInitiateBulkTransfer(INSTRUCTION_FAST_READ_QUAD_OUTPUT,
+                                (uint8_t*)&address, 3, buffer, nrOfBytes,
+                                FAST_READ_WAIT_CYCLES,
+                                QSPI_TRANSFER_DIRECTION_READ,
+                                SignalTransferDoneCb);
+  AwaitTransfer();
+  return true;
+}
+
+bool ExternalFlash_Write(uint32_t address,
+                         const uint8_t* buffer,
+                         uint16_t nrOfBytes) {
+  ASSERT(_eraseCompleteCb == 0);  // do not write while erasing
+  ASSERT(address + nrOfBytes <=
+         EXTERNAL_FLASH_PAGE_ADDR(EXTERNAL_FLASH_NR_OF_PAGES));
+  WakeUp();
+  while (nrOfBytes > 0) {
+    uint16_t chunkSize = PROGRAM_PAGE_SIZE - (address % PROGRAM_PAGE_SIZE);
+    if (chunkSize > nrOfBytes) {
+      chunkSize = nrOfBytes;
+    }
+    ProgramPage(address, buffer, chunkSize);
+    address += chunkSize;
+    buffer += chunkSize;
+    nrOfBytes -= chunkSize;
+  }
+  return true;
+}
+
+void ExternalFlash_Erase(uint16_t startPageNr,
+                         uint8_t nrOfPages,
+                         Flash_OperationComplete callback) {
+  ASSERT(startPageNr + nrOfPages <= EXTERNAL_FLASH_NR_OF_PAGES);
+  ASSERT(_eraseCompleteCb == 0);
+  WakeUp();
+  _pagesToErase = nrOfPages;
+  _eraseCompleteCb = callback;
+  StartErase(startPageNr);
+}
+
+static void WriteInstruction(Instruction_t instruction) {
+  _isTransferDone = false;
+  Qspi_WriteInstruction(instruction, 0, QSPI_INSTRUCTION_DATA_SIZE_NONE, 0,
+                        SignalTransferDoneCb);
+  AwaitTransfer();
+}
+
+static uint8_t ReadStatusRegister(Instruction_t instruction) {
+  _isTransferDone = false;
+  Qspi_WriteInstruction(instruction, 0, QSPI_INSTRUCTION_DATA_SIZE_NONE,
+                        sizeof _instructionResult, ReadInstructionResultCb);
+  AwaitTransfer();
+  return _instructionResult[0];
+}
+
+static void AwaitNotBusy() {
+  while ((ReadStatusRegister(INSTRUCTION_READ_STATUS_1) & STATUS_1_BUSY) != 0)
+    ;
+}
+
+static void AwaitTransfer() {
+  while (!_isTransferDone)
+    ;
+}
+
+static void ProgramPage(uint32_t address,
+                        const uint8_t* buffer,
+                        uint16_t nrOfBytes) {
+  WriteInstruction(INSTRUCTION_WRITE_ENABLE);
+  _isTransferDone = false;
+  Qspi_QuadInitiateBulkTransfer(
+      INSTRUCTION_QUAD_PAGE_PROGRAM, (uint8_t*)&address, 3, (uint8_t*)buffer,
+      nrOfBytes, 0, QSPI_TRANSFER_DIRECTION_WRITE, SignalTransferDoneCb);
+  AwaitTransfer();
+  // programming a page takes less than 3ms
+  AwaitNotBusy();
+}
+
+static void StartErase(uint16_t pageNr) {
+  uint32_t address = EXTERNAL_FLASH_PAGE_ADDR(pageNr);
+  _erasePageNr = pageNr;
+  WriteInstruction(INSTRUCTION_WRITE_ENABLE);
+  // the address is sent as instruction data; most significant byte first
+  uint32_t instructionData = ((address >> 16) & 0xFF) | (address & 0xFF00) |
+                             ((address & 0xFF) << 16);
+  _isTransferDone = false;
+  Qspi_WriteInstruction(INSTRUCTION_BLOCK_ERASE_32K, instructionData,
+                        QSPI_INSTRUCTION_DATA_SIZE_THREE_BYTE, 0,
+                        SignalTransferDoneCb);
+  AwaitTransfer();
+  _eraseResumeCycle = Clock_GetCycleCount();
+  TimerServer_Start(_erasePollTimer, ERASE_POLL_INTERVAL_MS);
+}
+
+static void SuspendErase() {
+  if (_eraseCompleteCb == 0 || _isEraseSuspended) {
+    return;
+  }
+  AwaitElapsed(_eraseResumeCycle, ERASE_RESUME_TO_SUSPEND_US);
+  if ((ReadStatusRegister(INSTRUCTION_READ_STATUS_1) & STATUS_1_BUSY) == 0) {
+    return;
+  }
+  WriteInstruction(INSTRUCTION_ERASE_SUSPEND);
+  AwaitNotBusy();
+  _isEraseSuspended = true;
+  // the erase is resumed after the reads of the running task
+  UTIL_SEQ_SetTask(1 << SCHEDULER_TASK_HANDLE_EXTERNAL_FLASH_OPERATION,
+                   SCHEDULER_PRIO_2);
+}
+
+static void ResumeErase() {
+  WriteInstruction(INSTRUCTION_ERASE_RESUME);
+  _eraseResumeCycle = Clock_GetCycleCount();
+  _isEraseSuspended = false;
+}
+
+static void WakeUp() {
+  if (!_isPoweredDown) {
+    return;
+  }
+  AwaitElapsed(_powerModeCycle, POWER_DOWN_TRANSITION_US);
+  WriteInstruction(INSTRUCTION_RELEASE_POWER_DOWN);
+  _powerModeCycle = Clock_GetCycleCount();
+  _isPoweredDown = false;
+  AwaitElapsed(_powerModeCycle, POWER_DOWN_TRANSITION_US);
+  UTIL_SEQ_SetTask(1 << SCHEDULER_TASK_HANDLE_EXTERNAL_FLASH_OPERATION,
+                   SCHEDULER_PRIO_2);
+}
+
+static void PowerDown() {
+  if (_isPoweredDown || _eraseCompleteCb != 0) {
+    return;
+  }
+  WriteInstruction(INSTRUCTION_POWER_DOWN);
+  _powerModeCycle = Clock_GetCycleCount();
+  _isPoweredDown = true;
+}
+
+static void AwaitElapsed(uint32_t startCycle, uint32_t durationUs) {
+  while (Clock_GetCycleCount() - startCycle < durationUs * CORE_CYCLES_PER_US)
+    ;
+}
+
+static void FlashOperationTask() {
+  if (_eraseCompleteCb == 0) {
+    PowerDown();
+    return;
+  }
+  if (_isEraseSuspended) {
+    ResumeErase();
+  }
+  if ((ReadStatusRegister(INSTRUCTION_READ_STATUS_1) & STATUS_1_BUSY) != 0) {
+    TimerServer_Start(_erasePollTimer, ERASE_POLL_INTERVAL_MS);
+    return;
+  }
+  _pagesToErase--;
+  if (_pagesToErase > 0) {
+    StartErase(_erasePageNr + 1);
+    return;
+  }
+  Flash_OperationComplete callback = _eraseCompleteCb;
+  _eraseCompleteCb = 0;
+  PowerDown();
+  callback(_erasePageNr, 0);
+}
+
+static void ErasePollTimerElapsedCb() {
+  UTIL_SEQ_SetTask(1 << SCHEDULER_TASK_HANDLE_EXTERNAL_FLASH_OPERATION,
+                   SCHEDULER_PRIO_2);
+}
+
+static void ReadInstructionResultCb() {
+  Qspi_ReadInstructionData(_instructionResult, SignalTransferDoneCb);
+}
+
+static void SignalTransferDoneCb() {
+  _isTransferDone = true;
+}
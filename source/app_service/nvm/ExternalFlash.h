@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file ExternalFlash.h
+///
+/// Driver for the W25Q80 NOR flash that is attached to the QSPI peripheral.
+///
+/// The external flash is organized in pages of 32KB, which is the size of a
+/// block erase of the W25Q80. Reads and writes are executed synchronously;
+/// the data is transferred on all four data lines. The erase of a page takes
+/// between 120ms and 1.6s; it runs in the background and the completion is
+/// detected by polling the status register with a timer.
+///
+/// A read that is requested while a page is erased suspends the erase
+/// operation. The erase is resumed by a scheduler task, such that the reads
+/// of one task share a single suspend, and it is not suspended again before
+/// it made some progress. The flash is put into power down mode when no
+/// operation is ongoing and released from it on the next access.
+
+#ifndef EXTERNAL_FLASH_H
+#define EXTERNAL_FLASH_H
+
+#include "hal/Flash.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Size of an erasable page of the external flash
+#define EXTERNAL_FLASH_PAGE_SIZE 0x8000
+
+/// Number of pages of the external flash; the W25Q80 has 1MB.
+#define EXTERNAL_FLASH_NR_OF_PAGES 32
+
+/// Compute the address of a page on the external flash
+#define EXTERNAL_FLASH_PAGE_ADDR(x) ((uint32_t)(x)*EXTERNAL_FLASH_PAGE_SIZE)
+
+/// Initialize the external flash.
+///
+/// The flash is released from power down and the quad mode is enabled.
+/// Needs to be called after the timer server is initialized.
+void ExternalFlash_Init();
+
+/// Read a memory block from the external flash.
+/// @param address Start address of the read operation
+/// @param buffer Buffer to contain the read data
+/// @param nrOfBytes Nr of bytes to read
+/// @return true if operation successful; false otherwise
+bool ExternalFlash_Read(uint32_t address, uint8_t* buffer, uint16_t nrOfBytes);
+
+/// Write a memory block to the external flash.
+///
+/// The data is programmed in chunks that do not cross the 256 byte program
+/// pages of the flash.
+/// @param address Start address of the write operation
+/// @param buffer The buffer containing the data to be written.
+/// @param nrOfBytes Nr of bytes to be written
+/// @return true if the write was successful, false otherwise
+bool ExternalFlash_Write(uint32_t address,
+                         const uint8_t* buffer,
+                         uint16_t nrOfBytes);
+
+/// Erase one or several pages starting from a specific page number.
+///
+/// The pages are erased one by one. The callback is invoked only after
+/// all pages are erased.
+/// @param startPageNr First page to erase
+/// @param nrOfPages Number of pages to erase; must be bigger than 0!
+/// @param callback The callback indicates the end of the erase operation.
+void ExternalFlash_Erase(uint16_t startPageNr,
+                         uint8_t nrOfPages,
+                         Flash_OperationComplete callback);
+
+#endif  // EXTERNAL_FLASH_H
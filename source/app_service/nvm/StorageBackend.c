@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file StorageBackend.c
+///
+/// Implementation of StorageBackend.h
+
+#include "StorageBackend.h"
+
+#include "ExternalFlash.h"
+#include "stm32wbxx_hal.h"
+
+/// Compute the address of a page of the internal flash
+/// @param pageNr Page number within the internal flash
+/// @return Address of the first byte of the page
+static uint32_t InternalFlashPageAddress(uint8_t pageNr);
+
+/// Compute the address of a page of the external flash
+/// @param pageNr Page number within the external flash
+/// @return Address of the first byte of the page
+static uint32_t ExternalFlashPageAddress(uint8_t pageNr);
+
+/// The external flash is not shared with CPU2; there is nothing to reserve.
+static void ExternalFlashWriteSession();
+
+/// Backend of the internal flash; the flash is initialized by the system.
+static const StorageBackend_t _internalFlash = {
+    .pageSize = FLASH_PAGE_SIZE,
+    .init = 0,
+    .pageAddress = InternalFlashPageAddress,
+    .read = Flash_Read,
+    .write = Flash_Write,
+    .beginWriteSession = Flash_BeginWriteSession,
+    .endWriteSession = Flash_EndWriteSession,
+    .erase = Flash_Erase};
+
+/// Backend of the external flash
+static const StorageBackend_t _externalFlash = {
+    .pageSize = EXTERNAL_FLASH_PAGE_SIZE,
+    .init = ExternalFlash_Init,
+    .pageAddress = ExternalFlashPageAddress,
+    .read = ExternalFlash_Read,
+    .write = ExternalFlash_Write,
+    .beginWriteSession = ExternalFlashWriteSession,
+    .endWriteSession = ExternalFlashWriteSession,
+    .erase = ExternalFlash_Erase};
+
+const StorageBackend_t* StorageBackend_InternalFlashInstance() {
+  return &_internalFlash;
+}
+
+const StorageBackend_t* StorageBackend_ExternalFlashInstance() {
+  return &_externalFlash;
+}
+
+static uint32_t InternalFlashPageAddress(uint8_t pageNr) {
+  return PAGE_ADDR(pageNr);
+}
+
+static uint32_t ExternalFlashPageAddress(uint8_t pageNr) {
+  return EXTERNAL_FLASH_PAGE_ADDR(pageNr);
+}
+
+static void ExternalFlashWriteSession() {
+}
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file StorageBackend.h
+///
+/// Interface to the non volatile memory that holds the pages of an item store.
+///
+/// The item store accesses its pages only through this interface. It is
+/// implemented by the internal flash of the microcontroller and by the
+/// external QSPI flash. A backend is organized in pages of equal size; a page
+/// is the smallest unit that can be erased. Erased memory reads as 0xFF.
+
+#ifndef STORAGE_BACKEND_H
+#define STORAGE_BACKEND_H
+
+#include "hal/Flash.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Defines the operations of a storage backend
+typedef struct _tStorageBackend {
+  uint32_t pageSize;  ///< Size of an erasable page in bytes
+  /// Initialize the backend; may be 0 if no initialization is required.
+  void (*init)();
+  /// Compute the start address of a page.
+  uint32_t (*pageAddress)(uint8_t pageNr);
+  /// Synchronously read a memory block; see `Flash_Read()`.
+  bool (*read)(uint32_t address, uint8_t* buffer, uint16_t nrOfBytes);
+  /// Synchronously write a memory block; see `Flash_Write()`.
+  bool (*write)(uint32_t address, const uint8_t* buffer, uint16_t nrOfBytes);
+  /// Reserve the backend for a sequence of writes.
+  void (*beginWriteSession)();
+  /// Release the backend that was reserved by `beginWriteSession`.
+  void (*endWriteSession)();
+  /// Erase a sequence of pages in the background; see `Flash_Erase()`.
+  void (*erase)(uint16_t startPageNr,
+                uint8_t nrOfPages,
+                Flash_OperationComplete callback);
+} StorageBackend_t;
+
+/// Get the backend that stores pages in the internal flash.
+///
+/// The page numbers are the page numbers of the internal flash.
+/// @return Pointer to the backend
+const StorageBackend_t* StorageBackend_InternalFlashInstance();
+
+/// Get the backend that stores pages in the external QSPI flash.
+///
+/// The page numbers start at 0.
+/// @return Pointer to the backend
+const StorageBackend_t* StorageBackend_ExternalFlashInstance();
+
+#endif  // STORAGE_BACKEND_H
@@ -323,6 +323,10 @@ static uint8_t FindFirstFreeId(void) {
   return id;
 }
 
+uint16_t TimerServer_GetTicks(void) {
+  return TimerServerRtcInterface_ReadTicks();
+}
+
 uint32_t MillisecondsToTicks(uint32_t milliseconds) {
   return (
       uint32_t)((LSE_VALUE / (CFG_RTC_ASYNCH_PRESCALER + 1) * milliseconds) /
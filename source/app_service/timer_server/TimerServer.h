@@ -45,6 +45,13 @@
 ///  should be set to 0x7FFF (MAX VALUE)
 #define CFG_RTC_SYNCH_PRESCALER (0x7FFF)
 
+/// Number of ticks per second of the free running tick counter
+#define TIMER_SERVER_TICKS_PER_SECOND \
+  (LSE_VALUE / (CFG_RTC_ASYNCH_PRESCALER + 1))
+
+/// Number of ticks after which the free running tick counter wraps to 0
+#define TIMER_SERVER_TICKS_WRAP (CFG_RTC_SYNCH_PRESCALER + 1)
+
 /// Typedef for the callback to be called when a timer elapsed
 typedef void (*TimerServer_ElapsedCallback_t)(void);
 
@@ -123,4 +130,14 @@ void TimerServer_Start(uint8_t timerId, uint32_t timeoutMs);
 /// @param  timerId Id of the timer to stop
 void TimerServer_Stop(uint8_t timerId);
 
+/// Read the free running tick counter
+///
+/// The counter is derived from the RTC and keeps running in stop mode. It
+/// counts TIMER_SERVER_TICKS_PER_SECOND ticks per second and wraps to 0 after
+/// TIMER_SERVER_TICKS_WRAP ticks (16s). Time stamps of this counter allow to
+/// measure short durations without keeping a timer running.
+///
+/// @return The actual value of the counter
+uint16_t TimerServer_GetTicks(void);
+
 #endif  // TIMERSERVER_H
@@ -126,6 +126,10 @@ TimerServerRtcInterface_GetWakeupTimerLimitation() {
   return gWakeupTimerLimitation;
 }
 
+uint16_t TimerServerRtcInterface_ReadTicks(void) {
+  return (uint16_t)(gSynchPrescalerUserConfig - 1 - ReadRtcSsrValue());
+}
+
 uint16_t TimerServerRtcInterface_ReturnTimeElapsed(void) {
   uint32_t returnValue;
   uint32_t wrapCounter;
@@ -73,6 +73,14 @@ TimerServerRtcInterface_GetWakeupTimerLimitation();
 /// @retval Time expired in Ticks
 uint16_t TimerServerRtcInterface_ReturnTimeElapsed(void);
 
+/// Read the ticks counted by the sub-second register of the RTC
+///
+/// The register counts down; the returned value counts up and wraps to 0
+/// once per period of the synchronous prescaler.
+///
+/// @retval Ticks counted in the actual period of the synchronous prescaler
+uint16_t TimerServerRtcInterface_ReadTicks(void);
+
 /// Reschedule the list of timer
 ///
 /// 1) Update the count left for each timer in the list
@@ -138,3 +138,13 @@ bool Clock_ReadAndClearPorActiveFlag() {
   LL_RCC_ClearResetFlags();
   return por;
 }
+
+void Clock_EnableCycleCounter() {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t Clock_GetCycleCount() {
+  return DWT->CYCCNT;
+}
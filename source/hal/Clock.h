@@ -61,4 +61,13 @@ void Clock_ConfigureSystemAndPeripheralClocks(uint8_t hseTuning);
 /// @return true if the POR was active; false otherwise.
 bool Clock_ReadAndClearPorActiveFlag();
 
+/// Start the cycle counter of the core
+///
+/// The counter runs with the system clock and stops in the low power modes.
+void Clock_EnableCycleCounter();
+
+/// Get the value of the cycle counter
+/// @return The number of core cycles; wraps around after 2^32 cycles
+uint32_t Clock_GetCycleCount();
+
 #endif  // CONFIGURE_CLOCK_H
@@ -105,6 +105,9 @@ static Flash_OperationComplete _flashOperationComplete;
 /// Memory structure that holds the erase parameters
 static FLASH_EraseInitTypeDef _eraseStruct;
 
+/// Flag to indicate that the flash semaphore is held by a write session
+static bool _writeSessionOpen = false;
+
 /// Number of pages to erase
 static uint16_t _pagesToErase;
 
@@ -147,9 +150,12 @@ bool Flash_Write(uint32_t address, const uint8_t* buffer, uint16_t nrOfBytes) {
   uint32_t writeAddress = address;
   uint16_t bytesWritten = 0;
 
-  // reserve flash accesses for CPU1
-  while (LL_HSEM_1StepLock(HSEM, CFG_HW_FLASH_SEMID))
-    ;
+  // reserve flash accesses for CPU1 unless a write session holds the lock
+  bool releaseLock = !_writeSessionOpen;
+  if (releaseLock) {
+    while (LL_HSEM_1StepLock(HSEM, CFG_HW_FLASH_SEMID))
+      ;
+  }
   do {
     uint64_t data = *((uint64_t*)buffer);
     bytesWritten += sizeof(uint64_t);
@@ -166,16 +172,37 @@ bool Flash_Write(uint32_t address, const uint8_t* buffer, uint16_t nrOfBytes) {
         HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, writeAddress, data);
     HAL_FLASH_Lock();
     if (status != HAL_OK) {
-      LL_HSEM_ReleaseLock(HSEM, CFG_HW_FLASH_SEMID, 0);
+      if (releaseLock) {
+        LL_HSEM_ReleaseLock(HSEM, CFG_HW_FLASH_SEMID, 0);
+      }
       return false;
     }
     writeAddress += sizeof(uint64_t);
     buffer += sizeof(uint64_t);
   } while (bytesWritten < nrOfBytes);
-  LL_HSEM_ReleaseLock(HSEM, CFG_HW_FLASH_SEMID, 0);
+  if (releaseLock) {
+    LL_HSEM_ReleaseLock(HSEM, CFG_HW_FLASH_SEMID, 0);
+  }
   return true;
 }
 
+void Flash_BeginWriteSession() {
+  ASSERT(!_writeSessionOpen);
+  ASSERT(_flashOperationComplete == 0);  // do not write while erasing
+  // reserve flash accesses for CPU1
+  while (LL_HSEM_1StepLock(HSEM, CFG_HW_FLASH_SEMID))
+    ;
+  _writeSessionOpen = true;
+}
+
+void Flash_EndWriteSession() {
+  if (!_writeSessionOpen) {
+    return;
+  }
+  _writeSessionOpen = false;
+  LL_HSEM_ReleaseLock(HSEM, CFG_HW_FLASH_SEMID, 0);
+}
+
 // start the erase procedure
 //
 // It it not allowed to erase more than one page in a row since this
@@ -192,9 +219,14 @@ void Flash_Erase(uint16_t startPageNr,
   _pagesToErase = nrOfPages;
   _flashOperationComplete = callback;
 
-  // reserve flash accesses for CPU1
-  while (LL_HSEM_1StepLock(HSEM, CFG_HW_FLASH_SEMID))
-    ;
+  // reserve flash accesses for CPU1; the lock of an open write session is
+  // taken over and released when the erase is done.
+  if (_writeSessionOpen) {
+    _writeSessionOpen = false;
+  } else {
+    while (LL_HSEM_1StepLock(HSEM, CFG_HW_FLASH_SEMID))
+      ;
+  }
 
   // prevent enter stop mode
   UTIL_LPM_SetStopMode(1 << APP_DEFINE_LPM_CLIENT_FLASH, UTIL_LPM_DISABLE);
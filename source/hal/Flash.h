@@ -99,6 +99,20 @@ bool Flash_Read(uint32_t address, uint8_t* buffer, uint16_t nrOfBytes);
 /// @return true if the write was successful, false otherwise
 bool Flash_Write(uint32_t address, const uint8_t* buffer, uint16_t nrOfBytes);
 
+/// Reserve the flash for a sequence of writes.
+///
+/// The hardware semaphore that protects the flash against accesses of CPU2 is
+/// taken once and held until `Flash_EndWriteSession()` is called. All calls to
+/// `Flash_Write()` within the session reuse this lock instead of acquiring
+/// the semaphore for each call.
+/// A call to `Flash_Erase()` takes over the lock and ends the session.
+void Flash_BeginWriteSession();
+
+/// Release the flash that was reserved by `Flash_BeginWriteSession()`.
+///
+/// Calling this function without an open session has no effect.
+void Flash_EndWriteSession();
+
 /// Erase one or several pages staring from a specific page number
 /// The pages are erased one by one. The callback is invoked only after
 /// all pages are erased.
@@ -62,6 +62,11 @@ static Qspi_OperationCompleteCb_t gCurrentInstructionWrittenCb;
 /// Current instruction data received handler
 static Qspi_OperationCompleteCb_t gCurrentDataReceivedCb;
 
+/// Instruction data that is transmitted by the interrupt handler
+///
+/// The data has to outlive the call to Qspi_WriteInstruction().
+static uint32_t gInstructionData;
+
 /// We need this mapping for an efficient translation of
 /// byte value to register value
 static const uint32_t gAddressSizeToRegValue[] = {
@@ -170,7 +175,8 @@ void Qspi_WriteInstruction(uint8_t instruction,
     return;
   }
   if (cmd.DataMode != QSPI_DATA_NONE && instructionResultSize == 0) {
-    HAL_QSPI_Transmit_IT(Qspi_Instance(), (uint8_t*)&instructionData);
+    gInstructionData = instructionData;
+    HAL_QSPI_Transmit_IT(Qspi_Instance(), (uint8_t*)&gInstructionData);
     return;
   }
 }
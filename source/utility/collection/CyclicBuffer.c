@@ -38,12 +38,51 @@
 #include "CyclicBuffer.h"
 
 #include "utility/ErrorHandler.h"
-#include "utility/concurrency/Concurrency.h"
 
-#include <string.h>
+/// Number of bits of an index in the producer state
+#define INDEX_BITS 8
 
-/// Helper macro to make wrap around more readable
-#define RESTRICT_BOUND(q, index) (q)->index >= (q)->capacity ? 0 : (q)->index
+/// Mask of an index in the producer state
+#define INDEX_MASK ((1U << INDEX_BITS) - 1)
+
+/// Index of the next element that is passed to the consumer
+#define INDEX_IN(state) ((state) & INDEX_MASK)
+
+/// Index of the next element that is reserved by a producer
+#define INDEX_RESERVED(state) (((state) >> INDEX_BITS) & INDEX_MASK)
+
+/// Number of producers that write a reserved element
+#define NR_OF_WRITERS(state) ((state) >> (2 * INDEX_BITS))
+
+/// Compose the producer state
+#define PRODUCER_STATE(index_in, index_reserved, nr_of_writers) \
+  ((index_in) | ((index_reserved) << INDEX_BITS) |              \
+   ((uint32_t)(nr_of_writers) << (2 * INDEX_BITS)))
+
+/// Compute the index that follows an index
+/// @param queue The queue of the index
+/// @param index An index in the buffer
+/// @return The following index
+static uint16_t NextIndex(const CyclicBuffer_Buffer_t* queue, uint16_t index);
+
+/// Put a new element into a queue with several producers.
+///
+/// A producer reserves an element with an atomic compare and exchange. The
+/// last producer that finishes writing passes all reserved elements to the
+/// consumer; a producer that interrupts another one therefore never
+/// publishes an element that is not yet written.
+/// @param queue The queue that shall contain the new element
+/// @param element The element to be put
+/// @return True if the element was added, false if the queue was full
+static bool EnqueueMultiProducer(CyclicBuffer_Buffer_t* queue,
+                                 const uint64_t* element);
+
+/// Put a new element into a queue with a single producer
+/// @param queue The queue that shall contain the new element
+/// @param element The element to be put
+/// @return True if the element was added, false if the queue was full
+static bool EnqueueSingleProducer(CyclicBuffer_Buffer_t* queue,
+                                  const uint64_t* element);
 
 // We assume that the function is not called from different
 // execution contexts.
@@ -55,48 +94,126 @@ void CyclicBuffer_Create(CyclicBuffer_Buffer_t* queue,
 
   queue->capacity = capacity;
   queue->elementStorage = storage;
-  queue->indexIn = 0;
-  queue->indexOut = 0;
+  queue->isSingleProducer = false;
+  atomic_init(&queue->producerState, 0);
+  atomic_init(&queue->indexOut, 0);
+}
+
+void CyclicBuffer_CreateSingleProducer(CyclicBuffer_Buffer_t* queue,
+                                       uint64_t* storage,
+                                       uint16_t capacity) {
+  CyclicBuffer_Create(queue, storage, capacity);
+  queue->isSingleProducer = true;
 }
 
 bool CyclicBuffer_Enqueue(CyclicBuffer_Buffer_t* queue,
                           const uint64_t* element) {
-  uint32_t priorityMask = Concurrency_EnterCriticalSection();
-  if (CyclicBuffer_IsFull(queue)) {
-    Concurrency_LeaveCriticalSection(priorityMask);
-    return false;
+  if (queue->isSingleProducer) {
+    return EnqueueSingleProducer(queue, element);
   }
-  queue->elementStorage[queue->indexIn++] = *element;
-  queue->indexIn = RESTRICT_BOUND(queue, indexIn);
-  Concurrency_LeaveCriticalSection(priorityMask);
-  return true;
+  return EnqueueMultiProducer(queue, element);
 }
 
 bool CyclicBuffer_Dequeue(CyclicBuffer_Buffer_t* queue, uint64_t* element) {
-  uint32_t priorityMask = Concurrency_EnterCriticalSection();
-  if (CyclicBuffer_IsEmpty(queue)) {
-    Concurrency_LeaveCriticalSection(priorityMask);
+  uint16_t indexOut =
+      atomic_load_explicit(&queue->indexOut, memory_order_relaxed);
+  uint32_t state =
+      atomic_load_explicit(&queue->producerState, memory_order_acquire);
+  if (indexOut == INDEX_IN(state)) {
     return false;
   }
-  *element = queue->elementStorage[queue->indexOut++];
-  queue->indexOut = RESTRICT_BOUND(queue, indexOut);
-  Concurrency_LeaveCriticalSection(priorityMask);
+  *element = queue->elementStorage[indexOut];
+  // the element is copied before its storage is released to the producers
+  atomic_store_explicit(&queue->indexOut, NextIndex(queue, indexOut),
+                        memory_order_release);
   return true;
 }
 
 void CyclicBuffer_Empty(CyclicBuffer_Buffer_t* queue) {
-  uint32_t priorityMask = Concurrency_EnterCriticalSection();
-  queue->indexIn = 0;
-  queue->indexOut = 0;
-  Concurrency_LeaveCriticalSection(priorityMask);
+  uint32_t state =
+      atomic_load_explicit(&queue->producerState, memory_order_acquire);
+  atomic_store_explicit(&queue->indexOut, INDEX_IN(state),
+                        memory_order_release);
 }
 
 bool CyclicBuffer_IsEmpty(CyclicBuffer_Buffer_t* queue) {
-  return queue->indexIn == queue->indexOut;
+  uint32_t state =
+      atomic_load_explicit(&queue->producerState, memory_order_acquire);
+  return INDEX_IN(state) ==
+         atomic_load_explicit(&queue->indexOut, memory_order_relaxed);
 }
 
 bool CyclicBuffer_IsFull(CyclicBuffer_Buffer_t* queue) {
-  uint16_t nextIndex = queue->indexIn + 1;
-  nextIndex = nextIndex >= queue->capacity ? 0 : nextIndex;
-  return nextIndex == queue->indexOut;
+  uint32_t state =
+      atomic_load_explicit(&queue->producerState, memory_order_relaxed);
+  return NextIndex(queue, INDEX_RESERVED(state)) ==
+         atomic_load_explicit(&queue->indexOut, memory_order_acquire);
+}
+
+uint16_t CyclicBuffer_Count(CyclicBuffer_Buffer_t* queue) {
+  uint32_t state =
+      atomic_load_explicit(&queue->producerState, memory_order_acquire);
+  uint16_t indexOut =
+      atomic_load_explicit(&queue->indexOut, memory_order_relaxed);
+  uint16_t indexIn = INDEX_IN(state);
+  return indexIn >= indexOut ? indexIn - indexOut
+                             : indexIn + queue->capacity - indexOut;
+}
+
+static uint16_t NextIndex(const CyclicBuffer_Buffer_t* queue, uint16_t index) {
+  uint16_t nextIndex = index + 1;
+  return nextIndex >= queue->capacity ? 0 : nextIndex;
+}
+
+static bool EnqueueMultiProducer(CyclicBuffer_Buffer_t* queue,
+                                 const uint64_t* element) {
+  uint32_t state =
+      atomic_load_explicit(&queue->producerState, memory_order_relaxed);
+  uint32_t reservedState = 0;
+  uint16_t indexReserved = 0;
+  do {
+    indexReserved = INDEX_RESERVED(state);
+    uint16_t nextIndex = NextIndex(queue, indexReserved);
+    if (nextIndex ==
+        atomic_load_explicit(&queue->indexOut, memory_order_acquire)) {
+      return false;
+    }
+    reservedState = PRODUCER_STATE(INDEX_IN(state), nextIndex,
+                                   NR_OF_WRITERS(state) + 1);
+  } while (!atomic_compare_exchange_weak_explicit(
+      &queue->producerState, &state, reservedState, memory_order_acquire,
+      memory_order_relaxed));
+  queue->elementStorage[indexReserved] = *element;
+
+  state = atomic_load_explicit(&queue->producerState, memory_order_relaxed);
+  uint32_t writtenState = 0;
+  do {
+    uint32_t nrOfWriters = NR_OF_WRITERS(state) - 1;
+    // the last writer passes all reserved elements to the consumer
+    uint32_t indexIn =
+        nrOfWriters == 0 ? INDEX_RESERVED(state) : INDEX_IN(state);
+    writtenState =
+        PRODUCER_STATE(indexIn, INDEX_RESERVED(state), nrOfWriters);
+  } while (!atomic_compare_exchange_weak_explicit(
+      &queue->producerState, &state, writtenState, memory_order_release,
+      memory_order_relaxed));
+  return true;
+}
+
+static bool EnqueueSingleProducer(CyclicBuffer_Buffer_t* queue,
+                                  const uint64_t* element) {
+  uint32_t state =
+      atomic_load_explicit(&queue->producerState, memory_order_relaxed);
+  uint16_t indexIn = INDEX_IN(state);
+  uint16_t nextIndex = NextIndex(queue, indexIn);
+  if (nextIndex ==
+      atomic_load_explicit(&queue->indexOut, memory_order_acquire)) {
+    return false;
+  }
+  queue->elementStorage[indexIn] = *element;
+  // the element is written before it is passed to the consumer
+  atomic_store_explicit(&queue->producerState,
+                        PRODUCER_STATE(nextIndex, nextIndex, 0),
+                        memory_order_release);
+  return true;
 }
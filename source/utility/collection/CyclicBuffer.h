@@ -37,6 +37,12 @@
 /// from within interrupt context. The current use case is to send messages
 /// from a producer to one or many listeners.
 ///
+/// The queue is lock-free; it does not disable interrupts. Elements may be
+/// put from several execution contexts, but only one context takes them out.
+/// A queue with a single producer may be created with
+/// `CyclicBuffer_CreateSingleProducer()` to save the atomic
+/// read-modify-write of the multi-producer queue.
+///
 /// Differences to the stm_queue:
 /// - Can be used from within interrupt context
 /// - Fixed size of elements (8 bytes). In case the usage of this
@@ -46,6 +52,7 @@
 #ifndef CYCLIC_BUFFER_H
 #define CYCLIC_BUFFER_H
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -55,8 +62,14 @@ typedef struct _tCyclicBuffer_Buffer {
   uint64_t* elementStorage;  ///< The buffer that holds the elements in the
                              ///< queue
   ///< All elements are copied and contained by value.
-  uint16_t indexIn;   ///< index in the buffer to insert the next element
-  uint16_t indexOut;  ///< index in the buffer to take out the next element
+  /// Flag to indicate that elements are put from a single execution context
+  bool isSingleProducer;
+  /// State of the producers; holds the index of the next element that is
+  /// passed to the consumer, the index of the next element that is reserved
+  /// by a producer and the number of producers that are writing an element.
+  atomic_uint_least32_t producerState;
+  /// index in the buffer to take out the next element
+  atomic_uint_least16_t indexOut;
 } CyclicBuffer_Buffer_t;
 
 /// Create a queue by initializing the queue parameter with the appropriate
@@ -71,6 +84,14 @@ void CyclicBuffer_Create(CyclicBuffer_Buffer_t* queue,
                          uint64_t* storage,
                          uint16_t capacity);
 
+/// Create a queue whose elements are put from a single execution context
+/// @param queue Queue object to be initialized
+/// @param storage  Memory to store the elements in the buffer.
+/// @param capacity Capacity of the queue; see `CyclicBuffer_Create()`
+void CyclicBuffer_CreateSingleProducer(CyclicBuffer_Buffer_t* queue,
+                                       uint64_t* storage,
+                                       uint16_t capacity);
+
 /// Put a new element into the queue.
 /// @param queue The queue that shall contain the new element
 /// @param element The element to be put (it will be copied)
@@ -79,6 +100,8 @@ bool CyclicBuffer_Enqueue(CyclicBuffer_Buffer_t* queue,
                           const uint64_t* element);
 
 /// Get a value from the queue and remove it
+///
+/// Only one execution context may take out elements.
 /// @param queue The queue with elements
 /// @param element A pointer where the element can be copied.
 /// @return True if the element was copied successfully, false if the queue
@@ -86,6 +109,8 @@ bool CyclicBuffer_Enqueue(CyclicBuffer_Buffer_t* queue,
 bool CyclicBuffer_Dequeue(CyclicBuffer_Buffer_t* queue, uint64_t* element);
 
 /// Remove all elements from the queue
+///
+/// The elements are removed on behalf of the consumer.
 /// @param queue The queue to be emptied
 void CyclicBuffer_Empty(CyclicBuffer_Buffer_t* queue);
 
@@ -99,4 +124,9 @@ bool CyclicBuffer_IsEmpty(CyclicBuffer_Buffer_t* queue);
 /// @return True if the queue is full, false otherwise.
 bool CyclicBuffer_IsFull(CyclicBuffer_Buffer_t* queue);
 
+/// Get the number of elements that are passed to the consumer
+/// @param queue Queue to be queried
+/// @return The number of elements in the queue
+uint16_t CyclicBuffer_Count(CyclicBuffer_Buffer_t* queue);
+
 #endif  // CYCLIC_BUFFER_H
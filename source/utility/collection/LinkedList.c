@@ -79,22 +79,21 @@ bool LinkedList_Remove(LinkedList_List_t* list, LinkedList_Node_t* node) {
   ASSERT(list != 0);
   ASSERT(node != &list->head);
   bool elementIsInList = false;
-  LinkedList_Node_t* current = &list->head;
-  LinkedList_Node_t* previous = current;
+  LinkedList_Node_t* previous = &list->head;
   uint32_t priorityMask = Concurrency_EnterCriticalSection();
-  while (current->next != &list->head) {
-    if (current == node) {
+  // the last node of the list is followed by the head
+  while (previous->next != &list->head) {
+    if (previous->next == node) {
       elementIsInList = true;
       break;
     }
-    previous = current;
-    current = current->next;
+    previous = previous->next;
   }
   if (!elementIsInList) {
     Concurrency_LeaveCriticalSection(priorityMask);
     return false;
   }
-  previous->next = current->next;
+  previous->next = node->next;
   node->next = 0;
   list->nrOfElements -= 1;
   Concurrency_LeaveCriticalSection(priorityMask);
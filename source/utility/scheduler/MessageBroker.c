@@ -34,55 +34,226 @@
 #include "MessageBroker.h"
 
 #include "stm32_seq.h"
+#include "utility/concurrency/Concurrency.h"
 #include "utility/ErrorHandler.h"
 #include "utility/log/Log.h"
 
+#include <string.h>
+
+/// Get the listener slots that subscribed to any of the categories
+/// @param broker The instance of the message broker
+/// @param category Bitmask of categories
+/// @return Bit set of the listener slots
+static uint16_t SubscribersOf(MessageBroker_Broker_t* broker,
+                              uint16_t category);
+
+/// Get the queue of the lane from which the next message is dispatched
+/// @param broker The instance of the message broker
+/// @return The queue of the selected lane
+static CyclicBuffer_Buffer_t* SelectQueue(MessageBroker_Broker_t* broker);
+
+/// Check if any lane of the broker has a message waiting
+/// @param broker The instance of the message broker
+/// @return true if a message is waiting; false otherwise
+static bool HasPendingMessages(MessageBroker_Broker_t* broker);
+
+/// Put a message into the queue of its lane
+/// @param broker The instance of the message broker
+/// @param message The message to be queued
+/// @return true if the message was queued; false if the queue was full
+static bool EnqueueMessage(MessageBroker_Broker_t* broker,
+                           Message_Message_t* message);
+
+/// Coalesce a message with its waiting message or queue it if none is waiting
+/// @param broker The instance of the message broker
+/// @param message The message of a coalesced category
+static void PublishCoalescedMessage(MessageBroker_Broker_t* broker,
+                                    Message_Message_t* message);
+
+/// Replace the current message with the latest content of its coalescing slot
+/// and free the slot
+/// @param broker The instance of the message broker
+static void TakeCoalescedMessage(MessageBroker_Broker_t* broker);
+
+/// Find the coalescing slot of a waiting message
+/// @param broker The instance of the message broker
+/// @param message The message whose waiting message is searched
+/// @return The slot of the waiting message; 0 if no such message is waiting
+static MessageBroker_CoalescingSlot_t* FindCoalescingSlot(
+    MessageBroker_Broker_t* broker,
+    const Message_Message_t* message);
+
+/// Pass the current message to the handler of a listener and update its
+/// statistics
+/// @param broker The instance of the message broker
+/// @param slot The slot of the listener
+/// @return true if the listener consumed the message; false otherwise
+static bool CallHandler(MessageBroker_Broker_t* broker, uint8_t slot);
+
 void MessageBroker_Create(MessageBroker_Broker_t* broker,
                           uint64_t* messageBuffer,
                           uint16_t capacity,
                           uint8_t id,
                           Scheduler_SchedulerPriority_t priority) {
   LinkedList_Create(&broker->listeners);
+  memset(broker->listenerSlots, 0, sizeof broker->listenerSlots);
+  memset(broker->subscribers, 0, sizeof broker->subscribers);
   CyclicBuffer_Create(&broker->messageQueue, messageBuffer, capacity);
   broker->priority = priority;
+  broker->priorityCategories = 0;
+  broker->priorityWeight = 0;
+  broker->priorityBurst = 0;
+  broker->coalescedCategories = 0;
+  memset(broker->coalesceCbs, 0, sizeof broker->coalesceCbs);
+  memset(broker->coalescingSlots, 0, sizeof broker->coalescingSlots);
+  memset(&broker->stats, 0, sizeof broker->stats);
+  broker->profilingClockCb = 0;
   ASSERT(id < 32);
   broker->taskBitmap = 1 << id;
 }
 
+void MessageBroker_AddPriorityLane(MessageBroker_Broker_t* broker,
+                                   uint64_t* messageBuffer,
+                                   uint16_t capacity,
+                                   uint16_t categories,
+                                   uint8_t weight) {
+  ASSERT(categories != 0);
+  CyclicBuffer_Create(&broker->priorityQueue, messageBuffer, capacity);
+  broker->priorityWeight = weight;
+  broker->priorityBurst = 0;
+  broker->priorityCategories = categories;
+}
+
+void MessageBroker_CoalesceCategory(MessageBroker_Broker_t* broker,
+                                    uint16_t category,
+                                    MessageBroker_CoalesceCb_t coalesceCb) {
+  ASSERT(category != 0 && (category & (category - 1)) == 0);
+  broker->coalesceCbs[__builtin_ctz(category)] = coalesceCb;
+  broker->coalescedCategories |= category;
+}
+
 void MessageBroker_RegisterListener(MessageBroker_Broker_t* broker,
                                     MessageListener_Listener_t* listener) {
   LinkedList_Insert(&broker->listeners, (LinkedList_Node_t*)listener);
+  uint8_t slot = 0;
+  while (slot < MESSAGE_BROKER_MAX_NR_OF_LISTENERS &&
+         broker->listenerSlots[slot] != 0) {
+    slot++;
+  }
+  ASSERT(slot < MESSAGE_BROKER_MAX_NR_OF_LISTENERS);
+  broker->listenerSlots[slot] = listener;
+  memset(&broker->stats.listeners[slot], 0,
+         sizeof broker->stats.listeners[slot]);
+  for (uint8_t i = 0; i < MESSAGE_BROKER_NR_OF_CATEGORIES; i++) {
+    if ((listener->receiveMask & (1U << i)) != 0) {
+      broker->subscribers[i] |= 1U << slot;
+    }
+  }
 }
 
 void MessageBroker_UnregisterListener(MessageBroker_Broker_t* broker,
                                       MessageListener_Listener_t* listener) {
   LinkedList_Remove(&broker->listeners, (LinkedList_Node_t*)listener);
+  for (uint8_t slot = 0; slot < MESSAGE_BROKER_MAX_NR_OF_LISTENERS; slot++) {
+    if (broker->listenerSlots[slot] != listener) {
+      continue;
+    }
+    broker->listenerSlots[slot] = 0;
+    for (uint8_t i = 0; i < MESSAGE_BROKER_NR_OF_CATEGORIES; i++) {
+      broker->subscribers[i] &= ~(1U << slot);
+    }
+  }
 }
 
 void MessageBroker_PublishMessage(MessageBroker_Broker_t* broker,
                                   Message_Message_t* message) {
-  bool scheduleNeeded = CyclicBuffer_IsEmpty(&broker->messageQueue);
-  CyclicBuffer_Enqueue(&broker->messageQueue, (uint64_t*)message);
-  if (scheduleNeeded) {
-    UTIL_SEQ_SetTask(broker->taskBitmap, broker->priority);
+  if ((message->header.category & broker->coalescedCategories) != 0) {
+    PublishCoalescedMessage(broker, message);
+    return;
+  }
+  EnqueueMessage(broker, message);
+}
+
+void MessageBroker_DiscardMessages(MessageBroker_Broker_t* broker) {
+  CyclicBuffer_Empty(&broker->messageQueue);
+  if (broker->priorityCategories != 0) {
+    CyclicBuffer_Empty(&broker->priorityQueue);
+  }
+  broker->priorityBurst = 0;
+  uint32_t priMask = Concurrency_EnterCriticalSection();
+  for (uint8_t i = 0; i < MESSAGE_BROKER_NR_OF_COALESCING_SLOTS; i++) {
+    broker->coalescingSlots[i].isWaiting = false;
+  }
+  Concurrency_LeaveCriticalSection(priMask);
+}
+
+void MessageBroker_SetProfilingClock(MessageBroker_Broker_t* broker,
+                                     MessageBroker_ClockCb_t clockCb) {
+  broker->profilingClockCb = clockCb;
+}
+
+void MessageBroker_GetStats(MessageBroker_Broker_t* broker,
+                            MessageBroker_Stats_t* stats) {
+  *stats = broker->stats;
+  stats->lanes[MESSAGE_BROKER_LANE_NORMAL].depth =
+      CyclicBuffer_Count(&broker->messageQueue);
+  stats->lanes[MESSAGE_BROKER_LANE_PRIORITY].depth =
+      broker->priorityCategories != 0
+          ? CyclicBuffer_Count(&broker->priorityQueue)
+          : 0;
+}
+
+void MessageBroker_ResetStats(MessageBroker_Broker_t* broker) {
+  memset(&broker->stats, 0, sizeof broker->stats);
+}
+
+void MessageBroker_LogStats(MessageBroker_Broker_t* broker, const char* name) {
+  MessageBroker_Stats_t stats;
+  MessageBroker_GetStats(broker, &stats);
+  for (uint8_t i = 0; i < MESSAGE_BROKER_NR_OF_LANES; i++) {
+    LOG_INFO("%s lane %i: depth %i, peak %i, overflows %lu", name, i,
+             stats.lanes[i].depth, stats.lanes[i].peakDepth,
+             stats.lanes[i].nrOfOverflows);
+  }
+  for (uint8_t i = 0; i < MESSAGE_BROKER_NR_OF_CATEGORIES; i++) {
+    if (stats.nrOfDispatches[i] != 0) {
+      LOG_INFO("%s category 0x%x: %lu dispatches", name, 1U << i,
+               stats.nrOfDispatches[i]);
+    }
+  }
+  for (uint8_t i = 0; i < MESSAGE_BROKER_MAX_NR_OF_LISTENERS; i++) {
+    MessageBroker_ListenerStats_t* listener = &stats.listeners[i];
+    if (listener->nrOfCalls != 0) {
+      LOG_INFO("%s listener %i: %lu calls, %lu ticks, max %lu", name, i,
+               listener->nrOfCalls, listener->totalTicks,
+               listener->maxTicks);
+    }
   }
 }
 
 void MessageBroker_Run(MessageBroker_Broker_t* broker) {
-  CyclicBuffer_Buffer_t* queue = &broker->messageQueue;
+  CyclicBuffer_Buffer_t* queue = SelectQueue(broker);
 
   if (CyclicBuffer_Dequeue(queue, (uint64_t*)&broker->currentMessage)) {
-    LinkedList_Iterator_t iterator = {0};
-    LinkedList_IteratorInit(&broker->listeners, &iterator);
+    if ((broker->currentMessage.header.category &
+         broker->coalescedCategories) != 0) {
+      TakeCoalescedMessage(broker);
+    }
+    uint16_t category = broker->currentMessage.header.category;
+    if (category != 0) {
+      broker->stats.nrOfDispatches[__builtin_ctz(category)]++;
+    }
+    uint16_t subscribers = SubscribersOf(broker, category);
     bool messageConsumed = false;
-    while (iterator.hasMoreElements) {
-      LinkedList_Iterate(&broker->listeners, &iterator);
-      MessageListener_Listener_t* listener =
-          (MessageListener_Listener_t*)iterator.node;
-      if (0 !=
-          (listener->receiveMask & broker->currentMessage.header.category)) {
-        bool localConsumed =
-            listener->currentMessageHandlerCb(&broker->currentMessage);
+    // the listener in the highest slot was registered last
+    while (subscribers != 0) {
+      uint8_t slot = 31 - __builtin_clz(subscribers);
+      subscribers &= ~(1U << slot);
+      MessageListener_Listener_t* listener = broker->listenerSlots[slot];
+      // the listener may have been unregistered by a previous handler or may
+      // have removed the category from its receive mask
+      if (listener != 0 && 0 != (listener->receiveMask & category)) {
+        bool localConsumed = CallHandler(broker, slot);
         messageConsumed = messageConsumed || localConsumed;
       }
     }
@@ -91,7 +262,141 @@ void MessageBroker_Run(MessageBroker_Broker_t* broker) {
                 broker->currentMessage.header.id);
     }
   }
-  if (!CyclicBuffer_IsEmpty(queue)) {
+  if (HasPendingMessages(broker)) {
+    UTIL_SEQ_SetTask(broker->taskBitmap, broker->priority);
+  }
+}
+
+static uint16_t SubscribersOf(MessageBroker_Broker_t* broker,
+                              uint16_t category) {
+  uint16_t subscribers = 0;
+  while (category != 0) {
+    subscribers |= broker->subscribers[__builtin_ctz(category)];
+    category &= category - 1;
+  }
+  return subscribers;
+}
+
+static CyclicBuffer_Buffer_t* SelectQueue(MessageBroker_Broker_t* broker) {
+  if (broker->priorityCategories == 0 ||
+      CyclicBuffer_IsEmpty(&broker->priorityQueue)) {
+    broker->priorityBurst = 0;
+    return &broker->messageQueue;
+  }
+  if (CyclicBuffer_IsEmpty(&broker->messageQueue)) {
+    broker->priorityBurst = 0;
+    return &broker->priorityQueue;
+  }
+  // both lanes have messages waiting
+  if (broker->priorityWeight == 0 ||
+      broker->priorityBurst < broker->priorityWeight) {
+    broker->priorityBurst++;
+    return &broker->priorityQueue;
+  }
+  broker->priorityBurst = 0;
+  return &broker->messageQueue;
+}
+
+static bool HasPendingMessages(MessageBroker_Broker_t* broker) {
+  return !CyclicBuffer_IsEmpty(&broker->messageQueue) ||
+         (broker->priorityCategories != 0 &&
+          !CyclicBuffer_IsEmpty(&broker->priorityQueue));
+}
+
+static bool EnqueueMessage(MessageBroker_Broker_t* broker,
+                           Message_Message_t* message) {
+  MessageBroker_Lane_t lane =
+      (message->header.category & broker->priorityCategories) != 0
+          ? MESSAGE_BROKER_LANE_PRIORITY
+          : MESSAGE_BROKER_LANE_NORMAL;
+  CyclicBuffer_Buffer_t* queue = lane == MESSAGE_BROKER_LANE_PRIORITY
+                                     ? &broker->priorityQueue
+                                     : &broker->messageQueue;
+  // the broker task reschedules itself as long as any lane has a message
+  bool scheduleNeeded = CyclicBuffer_IsEmpty(queue);
+  bool isQueued = CyclicBuffer_Enqueue(queue, (uint64_t*)message);
+  MessageBroker_LaneStats_t* laneStats = &broker->stats.lanes[lane];
+  if (isQueued) {
+    uint16_t depth = CyclicBuffer_Count(queue);
+    if (depth > laneStats->peakDepth) {
+      laneStats->peakDepth = depth;
+    }
+  } else {
+    laneStats->nrOfOverflows++;
+  }
+  if (scheduleNeeded) {
     UTIL_SEQ_SetTask(broker->taskBitmap, broker->priority);
   }
+  return isQueued;
+}
+
+static void PublishCoalescedMessage(MessageBroker_Broker_t* broker,
+                                    Message_Message_t* message) {
+  // the slot must not be taken by the dispatcher while it is updated
+  uint32_t priMask = Concurrency_EnterCriticalSection();
+  MessageBroker_CoalescingSlot_t* slot = FindCoalescingSlot(broker, message);
+  if (slot != 0) {
+    uint16_t category =
+        message->header.category & broker->coalescedCategories;
+    MessageBroker_CoalesceCb_t coalesceCb =
+        broker->coalesceCbs[__builtin_ctz(category)];
+    if (coalesceCb != 0) {
+      coalesceCb(&slot->message, message);
+    } else {
+      slot->message = *message;
+    }
+    Concurrency_LeaveCriticalSection(priMask);
+    return;
+  }
+  uint8_t i = 0;
+  while (i < MESSAGE_BROKER_NR_OF_COALESCING_SLOTS &&
+         broker->coalescingSlots[i].isWaiting) {
+    i++;
+  }
+  ASSERT(i < MESSAGE_BROKER_NR_OF_COALESCING_SLOTS);
+  slot = &broker->coalescingSlots[i];
+  slot->message = *message;
+  slot->isWaiting = EnqueueMessage(broker, message);
+  Concurrency_LeaveCriticalSection(priMask);
+}
+
+static void TakeCoalescedMessage(MessageBroker_Broker_t* broker) {
+  uint32_t priMask = Concurrency_EnterCriticalSection();
+  MessageBroker_CoalescingSlot_t* slot =
+      FindCoalescingSlot(broker, &broker->currentMessage);
+  if (slot != 0) {
+    broker->currentMessage = slot->message;
+    slot->isWaiting = false;
+  }
+  Concurrency_LeaveCriticalSection(priMask);
+}
+
+static MessageBroker_CoalescingSlot_t* FindCoalescingSlot(
+    MessageBroker_Broker_t* broker,
+    const Message_Message_t* message) {
+  for (uint8_t i = 0; i < MESSAGE_BROKER_NR_OF_COALESCING_SLOTS; i++) {
+    MessageBroker_CoalescingSlot_t* slot = &broker->coalescingSlots[i];
+    if (slot->isWaiting && slot->message.header.id == message->header.id &&
+        slot->message.header.category == message->header.category) {
+      return slot;
+    }
+  }
+  return 0;
+}
+
+static bool CallHandler(MessageBroker_Broker_t* broker, uint8_t slot) {
+  MessageListener_Listener_t* listener = broker->listenerSlots[slot];
+  MessageBroker_ListenerStats_t* stats = &broker->stats.listeners[slot];
+  MessageBroker_ClockCb_t clockCb = broker->profilingClockCb;
+  uint32_t start = clockCb != 0 ? clockCb() : 0;
+  bool consumed = listener->currentMessageHandlerCb(&broker->currentMessage);
+  stats->nrOfCalls++;
+  if (clockCb != 0) {
+    uint32_t ticks = clockCb() - start;
+    stats->totalTicks += ticks;
+    if (ticks > stats->maxTicks) {
+      stats->maxTicks = ticks;
+    }
+  }
+  return consumed;
 }
@@ -42,6 +42,21 @@
 /// The listener will declare their interest in specific information with a
 /// Bitmask. Each message is associated to a category that is represented by
 /// a single bit.
+/// The broker keeps a table with the subscribed listeners of each category.
+/// The table is updated when a listener is registered; a message is only
+/// passed to the listeners of its category.
+/// Optionally, a broker has a second, high priority lane with its own queue.
+/// Messages of the categories that are assigned to this lane bypass the
+/// messages waiting in the normal lane. The order of messages within one
+/// category is always preserved.
+/// Categories may be declared "latest wins". A message of such a category
+/// that is published while a message with the same id is still waiting is
+/// coalesced with the waiting message instead of being queued. The waiting
+/// message keeps its position in the queue but is dispatched with the latest
+/// content.
+/// The broker keeps statistics about its queues and its dispatched messages.
+/// If a profiling clock is set, it also measures the execution time of the
+/// message handlers.
 
 #ifndef MESSAGE_BROKER_H
 #define MESSAGE_BROKER_H
@@ -52,6 +67,66 @@
 #include "utility/collection/CyclicBuffer.h"
 #include "utility/scheduler/Scheduler.h"
 
+/// Number of message categories; one for each bit of the receive mask
+#define MESSAGE_BROKER_NR_OF_CATEGORIES 16
+
+/// Maximal number of listeners that may be registered in a message broker
+#define MESSAGE_BROKER_MAX_NR_OF_LISTENERS 16
+
+/// Maximal number of coalesced messages that may wait at the same time
+#define MESSAGE_BROKER_NR_OF_COALESCING_SLOTS 4
+
+/// Lanes of a message broker
+typedef enum {
+  MESSAGE_BROKER_LANE_NORMAL = 0,  ///< Lane of all other categories
+  MESSAGE_BROKER_LANE_PRIORITY,    ///< Lane of the high priority categories
+  MESSAGE_BROKER_NR_OF_LANES
+} MessageBroker_Lane_t;
+
+/// Clock to profile the message handlers
+/// @return A free running tick count
+typedef uint32_t (*MessageBroker_ClockCb_t)(void);
+
+/// Statistics of a lane of a message broker
+typedef struct _tMessageBroker_LaneStats {
+  uint16_t depth;          ///< Number of messages that are waiting
+  uint16_t peakDepth;      ///< Highest number of messages that were waiting
+  uint32_t nrOfOverflows;  ///< Number of messages dropped on a full queue
+} MessageBroker_LaneStats_t;
+
+/// Statistics of the message handler of a listener
+typedef struct _tMessageBroker_ListenerStats {
+  uint32_t nrOfCalls;   ///< Number of messages passed to the handler
+  uint32_t totalTicks;  ///< Sum of the execution times in clock ticks
+  uint32_t maxTicks;    ///< Longest execution time in clock ticks
+} MessageBroker_ListenerStats_t;
+
+/// Statistics of a message broker
+///
+/// Counters are updated without locking; a message that is published from
+/// an interrupt at the same time may be missed.
+typedef struct _tMessageBroker_Stats {
+  MessageBroker_LaneStats_t lanes[MESSAGE_BROKER_NR_OF_LANES];  ///< by lane
+  /// Number of dispatched messages by category
+  uint32_t nrOfDispatches[MESSAGE_BROKER_NR_OF_CATEGORIES];
+  /// Handler statistics by listener slot; the listeners take the slots in
+  /// their registration order
+  MessageBroker_ListenerStats_t listeners[MESSAGE_BROKER_MAX_NR_OF_LISTENERS];
+} MessageBroker_Stats_t;
+
+/// Callback to coalesce a message with a message that is still waiting
+/// @param waitingMessage The waiting message; it takes the coalesced content
+/// @param message The message that was published
+typedef void (*MessageBroker_CoalesceCb_t)(Message_Message_t* waitingMessage,
+                                           const Message_Message_t* message);
+
+/// Holds the latest content of a coalesced message while it is waiting
+typedef struct _tMessageBroker_CoalescingSlot {
+  Message_Message_t message;  ///< The latest content of the message
+  bool isWaiting;  ///< true if the message is waiting in a queue; a free slot
+                   ///< otherwise
+} MessageBroker_CoalescingSlot_t;
+
 /// Definition of the message broker
 typedef struct _tMessageBroker_Broker {
   LinkedList_List_t listeners;             ///< The collection with listeners
@@ -61,7 +136,35 @@ typedef struct _tMessageBroker_Broker {
   uint32_t taskBitmap;                     ///< The bitmap used in the scheduler
   Scheduler_SchedulerPriority_t priority;  ///< The priority in the scheduler
   ProcessNodeCb_t messageDispatchCb;  ///< Pointer to message dispatch callback
-
+  /// Registered listeners by their slot in the subscriber table; 0 if the
+  /// slot is free
+  MessageListener_Listener_t*
+      listenerSlots[MESSAGE_BROKER_MAX_NR_OF_LISTENERS];
+  /// Subscriber table; for each category a bit set of the listener slots
+  /// whose receive mask contains the category
+  uint16_t subscribers[MESSAGE_BROKER_NR_OF_CATEGORIES];
+  /// The message queue of the high priority lane
+  CyclicBuffer_Buffer_t priorityQueue;
+  /// Bitmask of the categories that are published in the high priority lane;
+  /// 0 if the broker has no high priority lane
+  uint16_t priorityCategories;
+  /// Number of high priority messages that are dispatched in a row before a
+  /// waiting message of the normal lane is dispatched; 0 for strict priority
+  uint8_t priorityWeight;
+  /// Number of high priority messages that were dispatched in a row while
+  /// messages of the normal lane were waiting
+  uint8_t priorityBurst;
+  /// Bitmask of the categories whose messages are coalesced
+  uint16_t coalescedCategories;
+  /// For each category the callback to coalesce its messages; 0 if the latest
+  /// message replaces the waiting one
+  MessageBroker_CoalesceCb_t coalesceCbs[MESSAGE_BROKER_NR_OF_CATEGORIES];
+  /// Slots with the content of the waiting coalesced messages
+  MessageBroker_CoalescingSlot_t
+      coalescingSlots[MESSAGE_BROKER_NR_OF_COALESCING_SLOTS];
+  MessageBroker_Stats_t stats;  ///< The statistics of the broker
+  /// The clock to profile the message handlers; 0 if handlers are not timed
+  MessageBroker_ClockCb_t profilingClockCb;
 } MessageBroker_Broker_t;
 
 /// Create a message broker by initializing its members
@@ -79,7 +182,47 @@ void MessageBroker_Create(MessageBroker_Broker_t* broker,
                           uint8_t id,
                           Scheduler_SchedulerPriority_t priority);
 
+/// Add a high priority lane to a message broker
+///
+/// Messages of the given categories are queued in the high priority lane and
+/// are dispatched before the messages of the normal lane.
+/// @param broker The broker instance
+/// @param messageBuffer A pointer to the storage for the message queue of
+///                      the high priority lane
+/// @param capacity The number of elements the storage can take. Value needs
+///                 to be in range [2,256] @see CyclicBuffer_Buffer_t
+/// @param categories Bitmask of the categories that are published in the
+///                   high priority lane
+/// @param weight Number of high priority messages that are dispatched in a
+///               row before a waiting message of the normal lane gets its
+///               turn; 0 dispatches the high priority lane strictly first.
+void MessageBroker_AddPriorityLane(MessageBroker_Broker_t* broker,
+                                   uint64_t* messageBuffer,
+                                   uint16_t capacity,
+                                   uint16_t categories,
+                                   uint8_t weight);
+
+/// Declare a category of a message broker as "latest wins"
+///
+/// A message of this category that is published while a message with the
+/// same id is waiting is not queued again. It is coalesced with the waiting
+/// message that keeps its position in the queue. Messages published before
+/// the waiting message are dispatched before it, all others after it.
+/// At most #MESSAGE_BROKER_NR_OF_COALESCING_SLOTS coalesced messages may
+/// wait at the same time.
+/// @param broker The broker instance
+/// @param category The category to be coalesced; a single bit
+/// @param coalesceCb Callback that coalesces the published message with the
+///                   waiting one; 0 if the published message replaces the
+///                   waiting one.
+void MessageBroker_CoalesceCategory(MessageBroker_Broker_t* broker,
+                                    uint16_t category,
+                                    MessageBroker_CoalesceCb_t coalesceCb);
+
 /// Register a listener in the message broker
+///
+/// The listener subscribes to the categories of its receive mask. Listeners
+/// that are registered later receive a message first.
 /// @param broker The instance of the message broker
 /// @param listener The instance of the listener to be registered
 void MessageBroker_RegisterListener(MessageBroker_Broker_t* broker,
@@ -98,6 +241,31 @@ void MessageBroker_UnregisterListener(MessageBroker_Broker_t* broker,
 void MessageBroker_PublishMessage(MessageBroker_Broker_t* broker,
                                   Message_Message_t* message);
 
+/// Discard all messages that are waiting in the lanes of the broker
+/// @param broker The instance of the message broker
+void MessageBroker_DiscardMessages(MessageBroker_Broker_t* broker);
+
+/// Set the clock to measure the execution time of the message handlers
+/// @param broker The instance of the message broker
+/// @param clockCb The clock; 0 to stop timing the handlers
+void MessageBroker_SetProfilingClock(MessageBroker_Broker_t* broker,
+                                     MessageBroker_ClockCb_t clockCb);
+
+/// Get the statistics of a message broker
+/// @param broker The instance of the message broker
+/// @param stats Takes a copy of the statistics
+void MessageBroker_GetStats(MessageBroker_Broker_t* broker,
+                            MessageBroker_Stats_t* stats);
+
+/// Reset the statistics of a message broker
+/// @param broker The instance of the message broker
+void MessageBroker_ResetStats(MessageBroker_Broker_t* broker);
+
+/// Write the statistics of a message broker to the log
+/// @param broker The instance of the message broker
+/// @param name The name of the broker in the log
+void MessageBroker_LogStats(MessageBroker_Broker_t* broker, const char* name);
+
 /// Function to be executed in the context of the scheduler to forward a
 /// message to all registered listeners
 /// @param broker The instance of the message broker
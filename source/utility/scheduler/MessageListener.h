@@ -52,6 +52,10 @@ typedef bool (*MessageListener_HandleReceivedMessageCb_t)(
 /// A listener may register in the message broker (only in one at a time).
 /// By setting its receive mask it manifests its interest in a specific
 /// category of information @see MessageBroker_Category_t
+/// The broker subscribes the listener to the categories of the receive mask
+/// when the listener is registered. Categories may be removed from the mask
+/// at any time; a category that is added later requires to register the
+/// listener again.
 typedef struct _tMessageListener_Listener {
   LinkedList_Node_t listNode;  ///< list node. We have an intrusive list.
   uint16_t receiveMask;        ///< Bitmask with the interested categories set
@@ -55,7 +55,9 @@ typedef enum {
       SCHEDULER_LAST_HCICMD_TASK - 1,  //first enum item
   SCHEDULER_TASK_HANDLE_SYSTEM_HCI_EVENT,
   SCHEDULER_TASK_HANDLE_FLASH_OPERATION,
+  SCHEDULER_TASK_HANDLE_EXTERNAL_FLASH_OPERATION,
   SCHEDULER_TASK_HANDLE_APP_MESSAGES,
+  SCHEDULER_TASK_HANDLE_ITEM_STORE_READ_AHEAD,
   SCHEDULER_LAST_NO_HCI_CMD_TASK  // this is the last id of the enum
 } Scheduler_NoHciCmdTaskId_t;
 
@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file CyclicBufferHostTest.c
+///
+/// Host tests of the lock-free cyclic buffer. Threads take the role of the
+/// interrupts that put messages into a queue.
+
+#include "HostTest.h"
+#include "utility/collection/CyclicBuffer.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+/// Capacity of the tested queues
+#define CAPACITY 16
+
+/// Number of threads that put elements into the queue
+#define NR_OF_PRODUCERS 4
+
+/// Number of elements that each producer puts into the queue
+#define NR_OF_VALUES 200000
+
+/// Compose an element from the producer and its sequence number
+#define ELEMENT(producer, value) (((uint64_t)(producer) << 32) | (value))
+
+/// Put the elements of one producer into the queue
+/// @param producer Index of the producer
+/// @return 0
+static void* Produce(void* producer);
+
+/// Take out the elements of all producers and check their order.
+/// @param nrOfProducers Number of running producers
+static void Consume(uint8_t nrOfProducers);
+
+/// The count follows the elements that are put and taken out
+static void TestCount();
+
+/// The elements of concurrent producers arrive complete and in order
+static void TestConcurrentProducers();
+
+/// The elements of a single producer thread arrive complete and in order
+static void TestSingleProducerThread();
+
+/// The tested queue
+static CyclicBuffer_Buffer_t _queue;
+
+/// Storage of the tested queue
+static uint64_t _storage[CAPACITY];
+
+int main() {
+  HOST_TEST_RUN(TestCount);
+  HOST_TEST_RUN(TestConcurrentProducers);
+  HOST_TEST_RUN(TestSingleProducerThread);
+  return 0;
+}
+
+static void TestCount() {
+  for (uint8_t flavour = 0; flavour < 2; flavour++) {
+    if (flavour == 0) {
+      CyclicBuffer_Create(&_queue, _storage, CAPACITY);
+    } else {
+      CyclicBuffer_CreateSingleProducer(&_queue, _storage, CAPACITY);
+    }
+    uint64_t next = 0;
+    uint64_t expected = 0;
+    // the indices wrap around several times
+    for (uint16_t round = 0; round < 5 * CAPACITY; round++) {
+      uint16_t nrOfElements = round % CAPACITY;
+      for (uint16_t i = 0; i < nrOfElements; i++) {
+        HOST_TEST_ASSERT(CyclicBuffer_Enqueue(&_queue, &next));
+        next++;
+        HOST_TEST_ASSERT(CyclicBuffer_Count(&_queue) == i + 1);
+      }
+      HOST_TEST_ASSERT(CyclicBuffer_IsFull(&_queue) ==
+                       (nrOfElements == CAPACITY - 1));
+      HOST_TEST_ASSERT(CyclicBuffer_Enqueue(&_queue, &next) ==
+                       (nrOfElements < CAPACITY - 1));
+      if (nrOfElements < CAPACITY - 1) {
+        next++;
+        nrOfElements++;
+      }
+      for (uint16_t i = nrOfElements; i > 0; i--) {
+        HOST_TEST_ASSERT(CyclicBuffer_Count(&_queue) == i);
+        uint64_t element;
+        HOST_TEST_ASSERT(CyclicBuffer_Dequeue(&_queue, &element));
+        HOST_TEST_ASSERT(element == expected);
+        expected++;
+      }
+      HOST_TEST_ASSERT(CyclicBuffer_IsEmpty(&_queue));
+      HOST_TEST_ASSERT(CyclicBuffer_Count(&_queue) == 0);
+    }
+    // emptying the queue drops the elements
+    HOST_TEST_ASSERT(CyclicBuffer_Enqueue(&_queue, &next));
+    CyclicBuffer_Empty(&_queue);
+    HOST_TEST_ASSERT(CyclicBuffer_IsEmpty(&_queue));
+    uint64_t element;
+    HOST_TEST_ASSERT(!CyclicBuffer_Dequeue(&_queue, &element));
+  }
+}
+
+static void TestConcurrentProducers() {
+  CyclicBuffer_Create(&_queue, _storage, CAPACITY);
+  pthread_t producers[NR_OF_PRODUCERS];
+  for (uintptr_t i = 0; i < NR_OF_PRODUCERS; i++) {
+    HOST_TEST_ASSERT(pthread_create(&producers[i], 0, Produce, (void*)i) ==
+                     0);
+  }
+  Consume(NR_OF_PRODUCERS);
+  for (uint8_t i = 0; i < NR_OF_PRODUCERS; i++) {
+    HOST_TEST_ASSERT(pthread_join(producers[i], 0) == 0);
+  }
+  HOST_TEST_ASSERT(CyclicBuffer_IsEmpty(&_queue));
+}
+
+static void TestSingleProducerThread() {
+  CyclicBuffer_CreateSingleProducer(&_queue, _storage, CAPACITY);
+  pthread_t producer;
+  HOST_TEST_ASSERT(pthread_create(&producer, 0, Produce, (void*)0) == 0);
+  Consume(1);
+  HOST_TEST_ASSERT(pthread_join(producer, 0) == 0);
+  HOST_TEST_ASSERT(CyclicBuffer_IsEmpty(&_queue));
+}
+
+static void* Produce(void* producer) {
+  for (uint32_t value = 0; value < NR_OF_VALUES; value++) {
+    uint64_t element = ELEMENT((uintptr_t)producer, value);
+    while (!CyclicBuffer_Enqueue(&_queue, &element)) {
+      sched_yield();
+    }
+  }
+  return 0;
+}
+
+static void Consume(uint8_t nrOfProducers) {
+  uint32_t nextValues[NR_OF_PRODUCERS] = {0};
+  uint32_t nrOfElements = 0;
+  while (nrOfElements < nrOfProducers * NR_OF_VALUES) {
+    uint64_t element;
+    if (!CyclicBuffer_Dequeue(&_queue, &element)) {
+      sched_yield();
+      continue;
+    }
+    uint32_t producer = element >> 32;
+    HOST_TEST_ASSERT(producer < nrOfProducers);
+    HOST_TEST_ASSERT((uint32_t)element == nextValues[producer]);
+    nextValues[producer]++;
+    nrOfElements++;
+  }
+}
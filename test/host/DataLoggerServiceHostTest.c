@@ -0,0 +1,664 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file DataLoggerServiceHostTest.c
+///
+/// Host tests of the data frames of the data logger service.
+///
+/// The test takes the role of the BLE stack below BleGatt and of a client
+/// that downloads the samples. A download is sent as the BLE context sends
+/// it over GATT: the header frame is followed by frame buffers that are
+/// filled with DataLoggerService_PutSample() and notified one frame at a
+/// time. The client parses the notifications back into samples.
+
+#include "HostTest.h"
+#include "app_service/networking/ble/gatt_service/DataLoggerService.h"
+#include "ble.h"
+#include "tl.h"
+
+#include <string.h>
+
+/// Handle of the connection of the client
+#define CONNECTION_HANDLE 0x0801
+
+/// Handle of the connection of a second client
+#define OTHER_CONNECTION_HANDLE 0x0802
+
+/// Handle of the data logger service in the stack
+#define SERVICE_HANDLE 0x0C
+
+/// Distance between the handles of two characteristics
+#define CHARACTERISTIC_HANDLE_STEP 3
+
+/// Maximal number of characteristics of the stack
+#define MAX_NR_OF_CHARACTERISTICS 16
+
+/// Id of the requested samples characteristic
+#define REQUESTED_SAMPLES_UUID 0x8003
+
+/// Id of the sample data characteristic
+#define SAMPLE_DATA_UUID 0x8004
+
+/// Id of the sample sequence characteristic
+#define SAMPLE_SEQUENCE_UUID 0x8006
+
+/// Id of the sample tier characteristic
+#define SAMPLE_TIER_UUID 0x8007
+
+/// Id of the download statistics characteristic
+#define DOWNLOAD_STATISTICS_UUID 0x8008
+
+/// Position of the encoding flags in the value of the requested samples
+#define REQUESTED_ENCODING_POSITION 2
+
+/// Encoding flag of the requested samples that selects the delta encoding
+#define REQUESTED_ENCODING_DELTA 0x01
+
+/// Size of the header of a notification (opcode and attribute handle)
+#define NOTIFICATION_HEADER_SIZE 3
+
+/// Size of the L2CAP header within a link layer packet
+#define L2CAP_HEADER_SIZE 4
+
+/// Sample type of the header frame
+#define HEADER_SAMPLE_TYPE 0x5
+
+/// Offsets of the fields of the header frame as a client reads them
+#define HEADER_SAMPLE_TYPE_OFFSET 0x4
+#define HEADER_METADATA_OFFSET 0x6
+#define HEADER_FRAME_SIZE_OFFSET 0x10
+#define HEADER_ENCODING_OFFSET 0x12
+#define HEADER_TIER_OFFSET 0x13
+
+/// Maximal number of samples of a download
+#define MAX_NR_OF_SAMPLES 16000
+
+/// Number of samples of the round trip downloads
+#define NR_OF_SAMPLES 1000
+
+/// Logging interval that is announced in the header frame
+#define LOGGING_INTERVAL_MS 60000
+
+/// Link properties of a client
+typedef struct {
+  uint16_t attMtu;       ///< Negotiated ATT MTU
+  uint16_t maxTxOctets;  ///< Negotiated payload of a link layer packet
+  uint8_t frameSize;     ///< Expected size of the data frames
+} Link_t;
+
+/// A characteristic that was added to the stack
+typedef struct {
+  uint16_t uuid;    ///< 16 bit id of the characteristic
+  uint16_t handle;  ///< Handle of the characteristic
+} Characteristic_t;
+
+/// State of the client that downloads the samples
+typedef struct {
+  uint16_t attMtu;               ///< Negotiated ATT MTU
+  bool isHeaderReceived;         ///< The header frame was received
+  uint8_t frameSize;             ///< Frame size of the header frame
+  uint8_t encoding;              ///< Encoding of the header frame
+  uint16_t nrOfSamples;          ///< Number of samples of the header frame
+  uint16_t nextFrameIndex;       ///< Index of the next expected frame
+  uint16_t nrOfReceivedSamples;  ///< Number of decoded samples
+  uint32_t nrOfNotifications;    ///< Number of received notifications
+  /// The decoded samples
+  SampleStreamCodec_Sample_t samples[MAX_NR_OF_SAMPLES];
+} Client_t;
+
+/// Download samples over a link and check that the client receives them.
+/// @param link Link properties of the client
+/// @param encoding Encoding the client asks for
+/// @param nrOfSamples Number of samples of the download
+/// @return Number of notifications of the download
+static uint32_t Download(const Link_t* link,
+                         DataLoggerService_Encoding_t encoding,
+                         uint16_t nrOfSamples);
+
+/// Notify the frames of a frame buffer one per notification and count the
+/// sent samples as the BLE context does.
+/// @param client Index of the client
+/// @param buffer The filled frame buffer
+/// @return Number of sent samples
+static uint16_t SendFrames(uint8_t client,
+                           DataLoggerService_FrameBuffer_t* buffer);
+
+/// Write the requested samples characteristic as a client
+/// @param nrOfSamples Number of requested samples
+/// @param encoding Requested encoding
+static void RequestSamples(uint16_t nrOfSamples,
+                           DataLoggerService_Encoding_t encoding);
+
+/// Read a characteristic as a client; the service answers the read permit
+/// request of the stack.
+/// @param connectionHandle Connection of the reading client
+/// @param uuid 16 bit id of the characteristic
+/// @return The value of the characteristic when the read was allowed
+static const uint8_t* ReadCharacteristic(uint16_t connectionHandle,
+                                         uint16_t uuid);
+
+/// Get the handle of a characteristic that was added to the stack
+/// @param uuid 16 bit id of the characteristic
+/// @return Handle of the characteristic
+static uint16_t CharacteristicHandle(uint16_t uuid);
+
+/// Parse a received header frame
+/// @param frame The received frame
+/// @param length Number of received bytes
+static void ReceiveHeaderFrame(const uint8_t* frame, uint8_t length);
+
+/// Parse a received data frame
+/// @param frame The received frame
+/// @param length Number of received bytes
+static void ReceiveDataFrame(const uint8_t* frame, uint8_t length);
+
+/// Read a little endian uint16_t
+/// @param data The bytes to be read
+/// @return The value
+static uint16_t ReadUint16(const uint8_t* data);
+
+/// Get a pseudo random number
+/// @return The next number of the sequence
+static uint32_t Random();
+
+/// The frame size follows the ATT MTU and the data length of each client
+static void TestFrameSizeFollowsLink();
+
+/// The header frame has the legacy size and announces the download
+static void TestHeaderFrame();
+
+/// Raw samples arrive unchanged at every frame size
+static void TestRawRoundTrip();
+
+/// Delta encoded samples arrive unchanged at every frame size
+static void TestDeltaRoundTrip();
+
+/// Big frames cut the number of notifications of a large download
+static void TestNotificationCount();
+
+/// Every client reads its own sample sequence, tier and statistics
+static void TestClientValues();
+
+/// Links of the clients; the frames of a client that negotiated neither a
+/// bigger MTU nor a longer data length keep the legacy size.
+static const Link_t _links[] = {
+    {BLE_DEFAULT_ATT_MTU, 27, TX_LEGACY_FRAME_SIZE},
+    {BLE_DEFAULT_ATT_MTU, 251, TX_LEGACY_FRAME_SIZE},
+    {CFG_BLE_MAX_ATT_MTU, 27, TX_LEGACY_FRAME_SIZE},
+    {48, 251, 42},
+    {CFG_BLE_MAX_ATT_MTU, 60, 50},
+    {CFG_BLE_MAX_ATT_MTU, 251, TX_FRAME_SIZE},
+    {247, 251, TX_FRAME_SIZE},
+};
+
+/// The characteristics that were added to the stack
+static Characteristic_t _characteristics[MAX_NR_OF_CHARACTERISTICS];
+
+/// Number of characteristics that were added to the stack
+static uint8_t _nrOfCharacteristics;
+
+/// Event handler of the service
+static SVC_CTL_p_EvtHandler_t _eventHandler;
+
+/// The client that downloads the samples
+static Client_t _client;
+
+/// The samples of a download
+static SampleStreamCodec_Sample_t _samples[MAX_NR_OF_SAMPLES];
+
+/// Frame buffer of the downloads
+static DataLoggerService_FrameBuffer_t _buffer;
+
+/// Listener of the application; it ignores the messages of the service
+static MessageListener_Listener_t _application;
+
+/// Value of the last updated characteristic
+static uint8_t _value[UINT8_MAX];
+
+/// Handle of the last updated characteristic
+static uint16_t _valueHandle;
+
+/// Connection of the last allowed read
+static uint16_t _allowedReadConnection;
+
+/// State of the pseudo random number generator
+static uint32_t _randomState = 1;
+
+int main() {
+  // a random walk needs deltas of different sizes
+  SampleStreamCodec_Sample_t sample = {.temperatureTicks = 0x6000,
+                                       .humidityTicks = 0x8000};
+  for (uint16_t i = 0; i < MAX_NR_OF_SAMPLES; i++) {
+    sample.temperatureTicks += (uint16_t)(Random() % 401 - 200);
+    sample.humidityTicks += (uint16_t)(Random() % 4001 - 2000);
+    _samples[i] = sample;
+  }
+  DataLoggerService_Create();
+  HOST_TEST_RUN(TestFrameSizeFollowsLink);
+  HOST_TEST_RUN(TestHeaderFrame);
+  HOST_TEST_RUN(TestRawRoundTrip);
+  HOST_TEST_RUN(TestDeltaRoundTrip);
+  HOST_TEST_RUN(TestNotificationCount);
+  HOST_TEST_RUN(TestClientValues);
+  return 0;
+}
+
+static void TestFrameSizeFollowsLink() {
+  HOST_TEST_ASSERT(TX_FRAME_SIZE == 58);
+  for (uint8_t i = 0; i < sizeof _links / sizeof _links[0]; i++) {
+    const Link_t* link = &_links[i];
+    uint8_t client = DataLoggerService_OpenClient(CONNECTION_HANDLE);
+    HOST_TEST_ASSERT(client != BLE_TYPES_NO_CLIENT);
+    // a new client starts with the defaults of the link
+    HOST_TEST_ASSERT(DataLoggerService_GetFrameSize(client) ==
+                     TX_LEGACY_FRAME_SIZE);
+    DataLoggerService_SetAttMtu(CONNECTION_HANDLE, link->attMtu);
+    DataLoggerService_SetMaxTxOctets(CONNECTION_HANDLE, link->maxTxOctets);
+    uint8_t frameSize = DataLoggerService_GetFrameSize(client);
+    HOST_TEST_ASSERT(frameSize == link->frameSize);
+    // a bigger frame has no unused bytes
+    HOST_TEST_ASSERT(frameSize == TX_LEGACY_FRAME_SIZE ||
+                     (frameSize - TX_FRAME_INDEX_SIZE) %
+                             TX_FRAME_SAMPLE_SIZE ==
+                         0);
+    // a notification fits into the MTU and a bigger one into a single
+    // link layer packet
+    HOST_TEST_ASSERT(frameSize + NOTIFICATION_HEADER_SIZE <= link->attMtu);
+    HOST_TEST_ASSERT(frameSize == TX_LEGACY_FRAME_SIZE ||
+                     frameSize + NOTIFICATION_HEADER_SIZE +
+                             L2CAP_HEADER_SIZE <=
+                         link->maxTxOctets);
+    DataLoggerService_CloseClient(client);
+  }
+  // the clients keep their own link properties
+  uint8_t client = DataLoggerService_OpenClient(CONNECTION_HANDLE);
+  uint8_t otherClient = DataLoggerService_OpenClient(OTHER_CONNECTION_HANDLE);
+  HOST_TEST_ASSERT(otherClient != BLE_TYPES_NO_CLIENT && otherClient != client);
+  DataLoggerService_SetAttMtu(CONNECTION_HANDLE, CFG_BLE_MAX_ATT_MTU);
+  DataLoggerService_SetMaxTxOctets(CONNECTION_HANDLE, 251);
+  HOST_TEST_ASSERT(DataLoggerService_GetFrameSize(client) == TX_FRAME_SIZE);
+  HOST_TEST_ASSERT(DataLoggerService_GetFrameSize(otherClient) ==
+                   TX_LEGACY_FRAME_SIZE);
+  DataLoggerService_CloseClient(otherClient);
+  DataLoggerService_CloseClient(client);
+  HostTest_DispatchMessages(&_application);
+}
+
+static void TestHeaderFrame() {
+  const BleTypes_SampleDownload_t download = {
+      .metadata = {.loggingIntervalMs = 3600000,
+                   .ageOfLatestSample = 0x12345678,
+                   .numberOfSamples = 0xABCD},
+      .tier = BLE_TYPES_SAMPLE_TIER_HOURLY};
+  uint8_t frame[TX_FRAME_SIZE];
+  memset(frame, 0xAA, sizeof frame);
+  DataLoggerService_BuildHeaderFrame(frame, &download, TX_FRAME_SIZE,
+                                     DATA_LOGGER_SERVICE_ENCODING_DELTA);
+  HOST_TEST_ASSERT(ReadUint16(frame) == 0);
+  HOST_TEST_ASSERT(ReadUint16(&frame[HEADER_SAMPLE_TYPE_OFFSET]) ==
+                   HEADER_SAMPLE_TYPE);
+  HOST_TEST_ASSERT(memcmp(&frame[HEADER_METADATA_OFFSET], &download.metadata,
+                          sizeof download.metadata) == 0);
+  HOST_TEST_ASSERT(ReadUint16(&frame[HEADER_FRAME_SIZE_OFFSET]) ==
+                   TX_FRAME_SIZE);
+  HOST_TEST_ASSERT(frame[HEADER_ENCODING_OFFSET] ==
+                   DATA_LOGGER_SERVICE_ENCODING_DELTA);
+  HOST_TEST_ASSERT(frame[HEADER_TIER_OFFSET] == BLE_TYPES_SAMPLE_TIER_HOURLY);
+  // the header frame does not grow with the data frames
+  for (uint8_t i = TX_LEGACY_FRAME_SIZE; i < sizeof frame; i++) {
+    HOST_TEST_ASSERT(frame[i] == 0xAA);
+  }
+}
+
+static void TestRawRoundTrip() {
+  for (uint8_t i = 0; i < sizeof _links / sizeof _links[0]; i++) {
+    uint16_t samplesPerFrame = (_links[i].frameSize - TX_FRAME_INDEX_SIZE) /
+                               TX_FRAME_SAMPLE_SIZE;
+    uint32_t nrOfNotifications =
+        Download(&_links[i], DATA_LOGGER_SERVICE_ENCODING_RAW, NR_OF_SAMPLES);
+    HOST_TEST_ASSERT(nrOfNotifications ==
+                     1u + (NR_OF_SAMPLES + samplesPerFrame - 1) /
+                              samplesPerFrame);
+    // a download with a partially filled last frame
+    Download(&_links[i], DATA_LOGGER_SERVICE_ENCODING_RAW, 1);
+  }
+}
+
+static void TestDeltaRoundTrip() {
+  for (uint8_t i = 0; i < sizeof _links / sizeof _links[0]; i++) {
+    uint32_t nrOfRawNotifications =
+        Download(&_links[i], DATA_LOGGER_SERVICE_ENCODING_RAW, NR_OF_SAMPLES);
+    HOST_TEST_ASSERT(Download(&_links[i], DATA_LOGGER_SERVICE_ENCODING_DELTA,
+                              NR_OF_SAMPLES) < nrOfRawNotifications);
+    Download(&_links[i], DATA_LOGGER_SERVICE_ENCODING_DELTA, 1);
+  }
+}
+
+static void TestNotificationCount() {
+  const Link_t* legacyLink = &_links[0];
+  const Link_t* fastLink = &_links[5];
+  uint32_t legacyNotifications = Download(
+      legacyLink, DATA_LOGGER_SERVICE_ENCODING_RAW, MAX_NR_OF_SAMPLES);
+  uint32_t fastNotifications =
+      Download(fastLink, DATA_LOGGER_SERVICE_ENCODING_RAW, MAX_NR_OF_SAMPLES);
+  HOST_TEST_ASSERT(legacyNotifications >= 3 * fastNotifications);
+  HOST_TEST_ASSERT(Download(fastLink, DATA_LOGGER_SERVICE_ENCODING_DELTA,
+                            MAX_NR_OF_SAMPLES) < fastNotifications);
+}
+
+static void TestClientValues() {
+  uint8_t client = DataLoggerService_OpenClient(CONNECTION_HANDLE);
+  uint8_t otherClient = DataLoggerService_OpenClient(OTHER_CONNECTION_HANDLE);
+  HOST_TEST_ASSERT(otherClient != BLE_TYPES_NO_CLIENT && otherClient != client);
+  DataLoggerService_UpdateSampleSequenceCharacteristic(client, 0x01000123);
+  DownloadTelemetry_Stats_t stats;
+  memset(&stats, 0x5A, sizeof stats);
+  DataLoggerService_UpdateDownloadStatisticsCharacteristic(client, &stats);
+
+  uint32_t sequenceNumber;
+  memcpy(&sequenceNumber,
+         ReadCharacteristic(CONNECTION_HANDLE, SAMPLE_SEQUENCE_UUID),
+         sizeof sequenceNumber);
+  HOST_TEST_ASSERT(sequenceNumber == 0x01000123);
+  memcpy(&sequenceNumber,
+         ReadCharacteristic(OTHER_CONNECTION_HANDLE, SAMPLE_SEQUENCE_UUID),
+         sizeof sequenceNumber);
+  HOST_TEST_ASSERT(sequenceNumber == BLE_TYPES_NO_SEQUENCE_NUMBER);
+  HOST_TEST_ASSERT(memcmp(ReadCharacteristic(CONNECTION_HANDLE,
+                                             DOWNLOAD_STATISTICS_UUID),
+                          &stats, sizeof stats) == 0);
+  memset(&stats, 0, sizeof stats);
+  HOST_TEST_ASSERT(memcmp(ReadCharacteristic(OTHER_CONNECTION_HANDLE,
+                                             DOWNLOAD_STATISTICS_UUID),
+                          &stats, sizeof stats) == 0);
+  HOST_TEST_ASSERT(*ReadCharacteristic(OTHER_CONNECTION_HANDLE,
+                                       SAMPLE_TIER_UUID) ==
+                   BLE_TYPES_SAMPLE_TIER_RAW);
+  DataLoggerService_CloseClient(otherClient);
+  DataLoggerService_CloseClient(client);
+  HostTest_DispatchMessages(&_application);
+}
+
+static uint32_t Download(const Link_t* link,
+                         DataLoggerService_Encoding_t encoding,
+                         uint16_t nrOfSamples) {
+  uint8_t client = DataLoggerService_OpenClient(CONNECTION_HANDLE);
+  HOST_TEST_ASSERT(client != BLE_TYPES_NO_CLIENT);
+  DataLoggerService_SetAttMtu(CONNECTION_HANDLE, link->attMtu);
+  DataLoggerService_SetMaxTxOctets(CONNECTION_HANDLE, link->maxTxOctets);
+  memset(&_client, 0, sizeof _client);
+  _client.attMtu = link->attMtu;
+  RequestSamples(nrOfSamples, encoding);
+  HOST_TEST_ASSERT(DataLoggerService_GetNumberOfRequestedSamples(client) ==
+                   nrOfSamples);
+  HOST_TEST_ASSERT(DataLoggerService_GetRequestedEncoding(client) == encoding);
+
+  uint8_t frameSize = DataLoggerService_GetFrameSize(client);
+  HOST_TEST_ASSERT(frameSize == link->frameSize);
+  BleTypes_SampleDownload_t download = {
+      .metadata = {.loggingIntervalMs = LOGGING_INTERVAL_MS,
+                   .numberOfSamples = nrOfSamples},
+      .tier = BLE_TYPES_SAMPLE_TIER_RAW,
+      .client = client};
+  uint8_t header[TX_FRAME_SIZE];
+  DataLoggerService_BuildHeaderFrame(header, &download, frameSize, encoding);
+  HOST_TEST_ASSERT(DataLoggerService_UpdateSampleDataCharacteristic(
+      client, header, TX_LEGACY_FRAME_SIZE));
+
+  // the data frames follow the header frame
+  uint16_t nextFrameIndex = 1;
+  uint16_t nrOfPutSamples = 0;
+  uint16_t nrOfSentSamples = 0;
+  while (nrOfPutSamples < nrOfSamples) {
+    _buffer.client = client;
+    _buffer.frameSize = frameSize;
+    _buffer.encoding = encoding;
+    _buffer.firstFrameIndex = nextFrameIndex;
+    nextFrameIndex += TX_FRAMES_PER_BUFFER;
+    DataLoggerService_ClearFrameBuffer(&_buffer);
+    // a sample that does not fit is put into the next buffer
+    while (nrOfPutSamples < nrOfSamples &&
+           DataLoggerService_PutSample(&_buffer,
+                                       (uint8_t*)&_samples[nrOfPutSamples])) {
+      nrOfPutSamples++;
+    }
+    HOST_TEST_ASSERT(_buffer.nrOfSamples > 0);
+    nrOfSentSamples += SendFrames(client, &_buffer);
+  }
+  HOST_TEST_ASSERT(nrOfSentSamples == nrOfSamples);
+  HOST_TEST_ASSERT(_client.isHeaderReceived);
+  HOST_TEST_ASSERT(_client.nrOfReceivedSamples == nrOfSamples);
+  HOST_TEST_ASSERT(memcmp(_client.samples, _samples,
+                          nrOfSamples * sizeof _samples[0]) == 0);
+  DataLoggerService_CloseClient(client);
+  HostTest_DispatchMessages(&_application);
+  return _client.nrOfNotifications;
+}
+
+static uint16_t SendFrames(uint8_t client,
+                           DataLoggerService_FrameBuffer_t* buffer) {
+  uint16_t nrOfSamples = 0;
+  for (uint8_t frame = 0; frame < buffer->nrOfFrames; frame++) {
+    HOST_TEST_ASSERT(buffer->frameLength[frame] <= buffer->frameSize);
+    HOST_TEST_ASSERT(buffer->frameSamples[frame] > 0);
+    HOST_TEST_ASSERT(DataLoggerService_UpdateSampleDataCharacteristic(
+        client, buffer->frames[frame], buffer->frameLength[frame]));
+    nrOfSamples += buffer->frameSamples[frame];
+  }
+  HOST_TEST_ASSERT(nrOfSamples == buffer->nrOfSamples);
+  return nrOfSamples;
+}
+
+static void RequestSamples(uint16_t nrOfSamples,
+                           DataLoggerService_Encoding_t encoding) {
+  static uint8_t packet[sizeof(hci_uart_pckt) + sizeof(hci_event_pckt) +
+                        sizeof(evt_blecore_aci) +
+                        sizeof(aci_gatt_attribute_modified_event_rp0)];
+  memset(packet, 0, sizeof packet);
+  hci_event_pckt* hciEvent = (hci_event_pckt*)((hci_uart_pckt*)packet)->data;
+  hciEvent->evt = HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE;
+  evt_blecore_aci* coreEvent = (evt_blecore_aci*)hciEvent->data;
+  coreEvent->ecode = ACI_GATT_ATTRIBUTE_MODIFIED_VSEVT_CODE;
+  aci_gatt_attribute_modified_event_rp0* write =
+      (aci_gatt_attribute_modified_event_rp0*)coreEvent->data;
+  write->Connection_Handle = CONNECTION_HANDLE;
+  // the value attribute follows the declaration of the characteristic
+  write->Attr_Handle = CharacteristicHandle(REQUESTED_SAMPLES_UUID) + 1;
+  write->Attr_Data_Length = 4;
+  write->Attr_Data[0] = nrOfSamples & 0xFF;
+  write->Attr_Data[1] = nrOfSamples >> 8;
+  if (encoding == DATA_LOGGER_SERVICE_ENCODING_DELTA) {
+    write->Attr_Data[REQUESTED_ENCODING_POSITION] = REQUESTED_ENCODING_DELTA;
+  }
+  HOST_TEST_ASSERT(_eventHandler(packet) == SVCCTL_EvtAckFlowEnable);
+}
+
+static const uint8_t* ReadCharacteristic(uint16_t connectionHandle,
+                                         uint16_t uuid) {
+  static uint8_t packet[sizeof(hci_uart_pckt) + sizeof(hci_event_pckt) +
+                        sizeof(evt_blecore_aci) +
+                        sizeof(aci_gatt_read_permit_req_event_rp0)];
+  memset(packet, 0, sizeof packet);
+  hci_event_pckt* hciEvent = (hci_event_pckt*)((hci_uart_pckt*)packet)->data;
+  hciEvent->evt = HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE;
+  evt_blecore_aci* coreEvent = (evt_blecore_aci*)hciEvent->data;
+  coreEvent->ecode = ACI_GATT_READ_PERMIT_REQ_VSEVT_CODE;
+  aci_gatt_read_permit_req_event_rp0* read =
+      (aci_gatt_read_permit_req_event_rp0*)coreEvent->data;
+  read->Connection_Handle = connectionHandle;
+  read->Attribute_Handle = CharacteristicHandle(uuid) + 1;
+  _allowedReadConnection = 0;
+  HOST_TEST_ASSERT(_eventHandler(packet) == SVCCTL_EvtAckFlowEnable);
+  // the value of the client is in place when the read is allowed
+  HOST_TEST_ASSERT(_allowedReadConnection == connectionHandle);
+  HOST_TEST_ASSERT(_valueHandle == CharacteristicHandle(uuid));
+  return _value;
+}
+
+static uint16_t CharacteristicHandle(uint16_t uuid) {
+  for (uint8_t i = 0; i < _nrOfCharacteristics; i++) {
+    if (_characteristics[i].uuid == uuid) {
+      return _characteristics[i].handle;
+    }
+  }
+  HOST_TEST_ASSERT(false);
+  return 0;
+}
+
+static void ReceiveHeaderFrame(const uint8_t* frame, uint8_t length) {
+  HOST_TEST_ASSERT(length == TX_LEGACY_FRAME_SIZE);
+  HOST_TEST_ASSERT(ReadUint16(frame) == 0);
+  HOST_TEST_ASSERT(ReadUint16(&frame[HEADER_SAMPLE_TYPE_OFFSET]) ==
+                   HEADER_SAMPLE_TYPE);
+  BleTypes_SamplesMetaData_t metadata;
+  memcpy(&metadata, &frame[HEADER_METADATA_OFFSET], sizeof metadata);
+  HOST_TEST_ASSERT(metadata.loggingIntervalMs == LOGGING_INTERVAL_MS);
+  _client.nrOfSamples = metadata.numberOfSamples;
+  _client.frameSize = (uint8_t)ReadUint16(&frame[HEADER_FRAME_SIZE_OFFSET]);
+  _client.encoding = frame[HEADER_ENCODING_OFFSET];
+  HOST_TEST_ASSERT(frame[HEADER_TIER_OFFSET] == BLE_TYPES_SAMPLE_TIER_RAW);
+  _client.nextFrameIndex = 1;
+  _client.isHeaderReceived = true;
+}
+
+static void ReceiveDataFrame(const uint8_t* frame, uint8_t length) {
+  HOST_TEST_ASSERT(length <= _client.frameSize);
+  uint16_t remainingSamples = _client.nrOfSamples - _client.nrOfReceivedSamples;
+  SampleStreamCodec_Sample_t* samples =
+      &_client.samples[_client.nrOfReceivedSamples];
+  uint16_t frameIndex = 0;
+  uint8_t nrOfSamples = 0;
+  if (_client.encoding == DATA_LOGGER_SERVICE_ENCODING_RAW) {
+    // raw frames have the announced size; the samples after the last one of
+    // the download are zero
+    HOST_TEST_ASSERT(length == _client.frameSize);
+    frameIndex = ReadUint16(frame);
+    nrOfSamples = (length - TX_FRAME_INDEX_SIZE) / TX_FRAME_SAMPLE_SIZE;
+    if (nrOfSamples > remainingSamples) {
+      nrOfSamples = remainingSamples;
+    }
+    memcpy(samples, &frame[TX_FRAME_INDEX_SIZE],
+           nrOfSamples * TX_FRAME_SAMPLE_SIZE);
+  } else {
+    uint8_t maxNrOfSamples =
+        remainingSamples < UINT8_MAX ? remainingSamples : UINT8_MAX;
+    nrOfSamples = SampleStreamCodec_DecodeFrame(frame, length, &frameIndex,
+                                                samples, maxNrOfSamples);
+  }
+  HOST_TEST_ASSERT(nrOfSamples > 0);
+  HOST_TEST_ASSERT(frameIndex == _client.nextFrameIndex);
+  _client.nextFrameIndex++;
+  _client.nrOfReceivedSamples += nrOfSamples;
+}
+
+static uint16_t ReadUint16(const uint8_t* data) {
+  return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static uint32_t Random() {
+  _randomState = _randomState * 1103515245u + 12345u;
+  return _randomState >> 16;
+}
+
+tBleStatus aci_gatt_add_service(uint8_t Service_UUID_Type,
+                                const Service_UUID_t* Service_UUID,
+                                uint8_t Service_Type,
+                                uint8_t Max_Attribute_Records,
+                                uint16_t* Service_Handle) {
+  *Service_Handle = SERVICE_HANDLE;
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gatt_add_char(uint16_t Service_Handle,
+                             uint8_t Char_UUID_Type,
+                             const Char_UUID_t* Char_UUID,
+                             uint16_t Char_Value_Length,
+                             uint8_t Char_Properties,
+                             uint8_t Security_Permissions,
+                             uint8_t GATT_Evt_Mask,
+                             uint8_t Enc_Key_Size,
+                             uint8_t Is_Variable,
+                             uint16_t* Char_Handle) {
+  HOST_TEST_ASSERT(Service_Handle == SERVICE_HANDLE);
+  HOST_TEST_ASSERT(_nrOfCharacteristics < MAX_NR_OF_CHARACTERISTICS);
+  Characteristic_t* characteristic = &_characteristics[_nrOfCharacteristics];
+  // the 16 bit id is part of the 128 bit uuid of the service
+  characteristic->uuid = ReadUint16(&Char_UUID->Char_UUID_128[12]);
+  characteristic->handle = SERVICE_HANDLE + 1 +
+                           _nrOfCharacteristics * CHARACTERISTIC_HANDLE_STEP;
+  _nrOfCharacteristics++;
+  *Char_Handle = characteristic->handle;
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gatt_update_char_value(uint16_t Service_Handle,
+                                      uint16_t Char_Handle,
+                                      uint8_t Val_Offset,
+                                      uint8_t Char_Value_Length,
+                                      const uint8_t* Char_Value) {
+  HOST_TEST_ASSERT(Val_Offset == 0);
+  memcpy(_value, Char_Value, Char_Value_Length);
+  _valueHandle = Char_Handle;
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gatt_update_char_value_ext(uint16_t Conn_Handle_To_Notify,
+                                          uint16_t Service_Handle,
+                                          uint16_t Char_Handle,
+                                          uint8_t Update_Type,
+                                          uint16_t Char_Length,
+                                          uint16_t Value_Offset,
+                                          uint8_t Value_Length,
+                                          const uint8_t* Value) {
+  HOST_TEST_ASSERT(Conn_Handle_To_Notify == CONNECTION_HANDLE);
+  HOST_TEST_ASSERT(Char_Handle == CharacteristicHandle(SAMPLE_DATA_UUID));
+  HOST_TEST_ASSERT(Update_Type == GATT_CHAR_UPDATE_SEND_NOTIFICATION);
+  HOST_TEST_ASSERT(Value_Offset == 0 && Char_Length == Value_Length);
+  // a notification is never truncated by the stack
+  HOST_TEST_ASSERT(Value_Length + NOTIFICATION_HEADER_SIZE <= _client.attMtu);
+  _client.nrOfNotifications++;
+  if (!_client.isHeaderReceived) {
+    ReceiveHeaderFrame(Value, Value_Length);
+  } else {
+    ReceiveDataFrame(Value, Value_Length);
+  }
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gatt_allow_read(uint16_t Connection_Handle) {
+  _allowedReadConnection = Connection_Handle;
+  return BLE_STATUS_SUCCESS;
+}
+
+void SVCCTL_RegisterSvcHandler(SVC_CTL_p_EvtHandler_t handler) {
+  _eventHandler = handler;
+}
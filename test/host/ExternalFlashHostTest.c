@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file ExternalFlashHostTest.c
+///
+/// Host tests of the driver of the external W25Q80 flash.
+///
+/// The driver runs against the simulation of the flash, which aborts the
+/// test if the driver violates the protocol of the flash.
+
+#include "HostTest.h"
+#include "W25q80Simulator.h"
+#include "app_service/nvm/ExternalFlash.h"
+
+#include <string.h>
+
+/// Number of bytes that are written and read by the tests; spans three
+/// program pages of the flash.
+#define TEST_DATA_SIZE 600
+
+/// Run the tasks and let the timer elapse until the flash is idle.
+static void RunUntilIdle();
+
+/// Fill the test data with a pattern
+/// @param seed Value of the first byte of the pattern
+static void FillPattern(uint8_t seed);
+
+/// Callback of the erase operation
+/// @param pageNr Last erased page
+/// @param remaining Number of pages that are not erased
+static void EraseDoneCb(uint32_t pageNr, uint8_t remaining);
+
+/// The initialization wakes up the flash and enables the quad mode once
+static void TestInit();
+
+/// Writes are split at the program pages and read back unchanged
+static void TestWriteAndRead();
+
+/// An erase is complete after all pages are erased; the flash is put into
+/// power down mode afterwards
+static void TestErase();
+
+/// The reads of one task share a single suspend of the erase, which is
+/// resumed by the flash operation task
+static void TestReadWhileErasing();
+
+/// A read after the end of the erase does not suspend it
+static void TestReadAfterEraseEnded();
+
+/// Data to be written and read
+static uint8_t _data[TEST_DATA_SIZE];
+
+/// Buffer that receives the read data
+static uint8_t _readBuffer[TEST_DATA_SIZE];
+
+/// Number of calls to the erase callback
+static uint32_t _nrOfEraseDone;
+
+/// Page that was passed to the last erase callback
+static uint32_t _erasedPage;
+
+int main() {
+  W25q80Simulator_Reset();
+  HOST_TEST_RUN(TestInit);
+  HOST_TEST_RUN(TestWriteAndRead);
+  HOST_TEST_RUN(TestErase);
+  HOST_TEST_RUN(TestReadWhileErasing);
+  HOST_TEST_RUN(TestReadAfterEraseEnded);
+  return 0;
+}
+
+static void TestInit() {
+  const W25q80Simulator_State_t* state = W25q80Simulator_State();
+  HOST_TEST_ASSERT(state->isPoweredDown);
+  ExternalFlash_Init();
+  HOST_TEST_ASSERT(!state->isPoweredDown);
+  HOST_TEST_ASSERT(state->nrOfStatusWrites == 1);
+  RunUntilIdle();
+  HOST_TEST_ASSERT(state->isPoweredDown);
+  // the quad enable bit is non volatile
+  ExternalFlash_Init();
+  HOST_TEST_ASSERT(state->nrOfStatusWrites == 1);
+}
+
+static void TestWriteAndRead() {
+  const W25q80Simulator_State_t* state = W25q80Simulator_State();
+  uint32_t nrOfPrograms = state->nrOfPrograms;
+  uint32_t address = EXTERNAL_FLASH_PAGE_ADDR(3) + 200;
+  FillPattern(1);
+  HOST_TEST_ASSERT(ExternalFlash_Write(address, _data, TEST_DATA_SIZE));
+  // 56 + 256 + 256 + 32 bytes
+  HOST_TEST_ASSERT(state->nrOfPrograms == nrOfPrograms + 4);
+  HOST_TEST_ASSERT(memcmp(W25q80Simulator_Memory(address), _data,
+                          TEST_DATA_SIZE) == 0);
+  RunUntilIdle();
+  HOST_TEST_ASSERT(state->isPoweredDown);
+  memset(_readBuffer, 0, sizeof _readBuffer);
+  HOST_TEST_ASSERT(ExternalFlash_Read(address, _readBuffer, TEST_DATA_SIZE));
+  HOST_TEST_ASSERT(memcmp(_readBuffer, _data, TEST_DATA_SIZE) == 0);
+  HOST_TEST_ASSERT(!state->isPoweredDown);
+  RunUntilIdle();
+  HOST_TEST_ASSERT(state->isPoweredDown);
+}
+
+static void TestErase() {
+  const W25q80Simulator_State_t* state = W25q80Simulator_State();
+  FillPattern(2);
+  HOST_TEST_ASSERT(ExternalFlash_Write(EXTERNAL_FLASH_PAGE_ADDR(5), _data,
+                                       TEST_DATA_SIZE));
+  HOST_TEST_ASSERT(ExternalFlash_Write(EXTERNAL_FLASH_PAGE_ADDR(7), _data,
+                                       TEST_DATA_SIZE));
+  HOST_TEST_ASSERT(ExternalFlash_Write(EXTERNAL_FLASH_PAGE_ADDR(8), _data,
+                                       TEST_DATA_SIZE));
+  uint32_t nrOfErases = state->nrOfErases;
+  _nrOfEraseDone = 0;
+  ExternalFlash_Erase(6, 2, EraseDoneCb);
+  HOST_TEST_ASSERT(state->isErasing);
+  // the flash stays powered while it is erased
+  HostTest_RunTasks();
+  HOST_TEST_ASSERT(!state->isPoweredDown);
+  HOST_TEST_ASSERT(_nrOfEraseDone == 0);
+  RunUntilIdle();
+  HOST_TEST_ASSERT(_nrOfEraseDone == 1);
+  HOST_TEST_ASSERT(_erasedPage == 7);
+  HOST_TEST_ASSERT(state->nrOfErases == nrOfErases + 2);
+  HOST_TEST_ASSERT(state->isPoweredDown);
+  // only the erased pages are cleared
+  HOST_TEST_ASSERT(*W25q80Simulator_Memory(EXTERNAL_FLASH_PAGE_ADDR(7)) ==
+                   0xFF);
+  HOST_TEST_ASSERT(memcmp(W25q80Simulator_Memory(EXTERNAL_FLASH_PAGE_ADDR(5)),
+                          _data, TEST_DATA_SIZE) == 0);
+  HOST_TEST_ASSERT(memcmp(W25q80Simulator_Memory(EXTERNAL_FLASH_PAGE_ADDR(8)),
+                          _data, TEST_DATA_SIZE) == 0);
+}
+
+static void TestReadWhileErasing() {
+  const W25q80Simulator_State_t* state = W25q80Simulator_State();
+  FillPattern(3);
+  uint32_t address = EXTERNAL_FLASH_PAGE_ADDR(10);
+  HOST_TEST_ASSERT(ExternalFlash_Write(address, _data, TEST_DATA_SIZE));
+  HOST_TEST_ASSERT(ExternalFlash_Write(EXTERNAL_FLASH_PAGE_ADDR(11), _data,
+                                       TEST_DATA_SIZE));
+  uint32_t nrOfSuspends = state->nrOfSuspends;
+  uint32_t nrOfResumes = state->nrOfResumes;
+  _nrOfEraseDone = 0;
+  ExternalFlash_Erase(11, 1, EraseDoneCb);
+  // the reads of a task share one suspend
+  for (uint16_t offset = 0; offset < TEST_DATA_SIZE; offset += 100) {
+    HOST_TEST_ASSERT(ExternalFlash_Read(address + offset, _readBuffer, 100));
+    HOST_TEST_ASSERT(memcmp(_readBuffer, &_data[offset], 100) == 0);
+  }
+  HOST_TEST_ASSERT(state->isEraseSuspended);
+  HOST_TEST_ASSERT(state->nrOfSuspends == nrOfSuspends + 1);
+  // the flash operation task resumes the erase
+  HostTest_RunTasks();
+  HOST_TEST_ASSERT(!state->isEraseSuspended);
+  HOST_TEST_ASSERT(state->nrOfResumes == nrOfResumes + 1);
+  // a read right after the resume waits until the erase made progress
+  HOST_TEST_ASSERT(ExternalFlash_Read(address, _readBuffer, 100));
+  HOST_TEST_ASSERT(state->nrOfSuspends == nrOfSuspends + 2);
+  HOST_TEST_ASSERT(_nrOfEraseDone == 0);
+  RunUntilIdle();
+  HOST_TEST_ASSERT(_nrOfEraseDone == 1);
+  HOST_TEST_ASSERT(_erasedPage == 11);
+  HOST_TEST_ASSERT(*W25q80Simulator_Memory(EXTERNAL_FLASH_PAGE_ADDR(11)) ==
+                   0xFF);
+  HOST_TEST_ASSERT(state->nrOfResumes == state->nrOfSuspends);
+  HOST_TEST_ASSERT(state->isPoweredDown);
+}
+
+static void TestReadAfterEraseEnded() {
+  const W25q80Simulator_State_t* state = W25q80Simulator_State();
+  FillPattern(4);
+  uint32_t address = EXTERNAL_FLASH_PAGE_ADDR(12);
+  HOST_TEST_ASSERT(ExternalFlash_Write(address, _data, TEST_DATA_SIZE));
+  uint32_t nrOfSuspends = state->nrOfSuspends;
+  _nrOfEraseDone = 0;
+  ExternalFlash_Erase(13, 1, EraseDoneCb);
+  W25q80Simulator_AdvanceUs(W25Q80_SIMULATOR_ERASE_US);
+  HOST_TEST_ASSERT(ExternalFlash_Read(address, _readBuffer, TEST_DATA_SIZE));
+  HOST_TEST_ASSERT(memcmp(_readBuffer, _data, TEST_DATA_SIZE) == 0);
+  HOST_TEST_ASSERT(state->nrOfSuspends == nrOfSuspends);
+  // the end of the erase is still detected by the poll
+  HOST_TEST_ASSERT(_nrOfEraseDone == 0);
+  RunUntilIdle();
+  HOST_TEST_ASSERT(_nrOfEraseDone == 1);
+  HOST_TEST_ASSERT(state->isPoweredDown);
+}
+
+static void RunUntilIdle() {
+  while (HostTest_RunTasks() || W25q80Simulator_ElapseTimer()) {
+  }
+}
+
+static void FillPattern(uint8_t seed) {
+  for (uint16_t i = 0; i < TEST_DATA_SIZE; i++) {
+    _data[i] = (uint8_t)(seed + i * 7);
+  }
+}
+
+static void EraseDoneCb(uint32_t pageNr, uint8_t remaining) {
+  _nrOfEraseDone++;
+  _erasedPage = pageNr;
+}
@@ -0,0 +1,207 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file HostTest.c
+///
+/// Implementation of HostTest.h and of the firmware functions that the
+/// tested modules call.
+
+#include "HostTest.h"
+
+#include "RamBackend.h"
+#include "app_service/item_store/ItemStore.h"
+#include "hal/Crc.h"
+#include "stm32_seq.h"
+#include "utility/AppDefines.h"
+#include "utility/concurrency/Concurrency.h"
+#include "utility/ErrorHandler.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// Number of messages that may wait for the dispatch
+#define MESSAGE_QUEUE_SIZE 64
+
+/// Number of tasks of the sequencer
+#define NR_OF_TASKS 32
+
+/// Size of the stored messages. The messages of the item store carry a
+/// pointer; on a 64 bit host it does not fit into parameter2.
+#define MESSAGE_SIZE 16
+
+/// A published message
+typedef union {
+  Message_Message_t message;     ///< Access to the message header
+  uint8_t bytes[MESSAGE_SIZE];  ///< Copy of the published message
+} QueuedMessage_t;
+
+/// Get the number of bytes of a message that are copied when it is published
+/// @param message The published message
+/// @return Number of bytes to copy
+static uint8_t MessageSize(const Message_Message_t* message);
+
+/// Published messages that are not yet dispatched
+static QueuedMessage_t _messages[MESSAGE_QUEUE_SIZE];
+
+/// Index of the oldest pending message
+static uint16_t _firstMessage;
+
+/// Number of pending messages
+static uint16_t _nrOfMessages;
+
+/// Registered sequencer tasks
+static void (*_tasks[NR_OF_TASKS])();
+
+/// Bit mask of the scheduled sequencer tasks
+static UTIL_SEQ_bm_t _scheduledTasks;
+
+/// Number of recoverable errors
+static uint32_t _nrOfRecoverableErrors;
+
+void HostTest_Fail(const char* file, int line, const char* condition) {
+  fprintf(stderr, "%s:%d: assertion failed: %s\n", file, line, condition);
+  abort();
+}
+
+uint32_t HostTest_NrOfRecoverableErrors() {
+  return _nrOfRecoverableErrors;
+}
+
+uint16_t HostTest_PendingMessages() {
+  return _nrOfMessages;
+}
+
+void HostTest_DispatchMessages(MessageListener_Listener_t* listener) {
+  while (HostTest_DispatchMessage(listener) || RamBackend_CompleteErase() ||
+         HostTest_RunTasks()) {
+  }
+}
+
+bool HostTest_DispatchMessage(MessageListener_Listener_t* listener) {
+  if (_nrOfMessages == 0) {
+    return false;
+  }
+  QueuedMessage_t message = _messages[_firstMessage];
+  _firstMessage = (_firstMessage + 1) % MESSAGE_QUEUE_SIZE;
+  _nrOfMessages--;
+  if ((message.message.header.category & listener->receiveMask) != 0) {
+    listener->currentMessageHandlerCb(&message.message);
+  }
+  return true;
+}
+
+bool HostTest_RunTasks() {
+  if (_scheduledTasks == 0) {
+    return false;
+  }
+  for (uint8_t i = 0; i < NR_OF_TASKS; i++) {
+    if ((_scheduledTasks & (1UL << i)) != 0) {
+      _scheduledTasks &= ~(1UL << i);
+      if (_tasks[i] != 0) {
+        _tasks[i]();
+      }
+    }
+  }
+  return true;
+}
+
+void Message_PublishAppMessage(Message_Message_t* message) {
+  HOST_TEST_ASSERT(_nrOfMessages < MESSAGE_QUEUE_SIZE);
+  QueuedMessage_t* queued =
+      &_messages[(_firstMessage + _nrOfMessages) % MESSAGE_QUEUE_SIZE];
+  memset(queued, 0, sizeof *queued);
+  memcpy(queued, message, MessageSize(message));
+  _nrOfMessages++;
+}
+
+void ErrorHandler_UnrecoverableError(ErrorHandler_ErrorCode_t code) {
+  fprintf(stderr, "unrecoverable error %d\n", code);
+  abort();
+}
+
+void ErrorHandler_RecoverableError(ErrorHandler_ErrorCode_t code) {
+  _nrOfRecoverableErrors++;
+}
+
+void ErrorHandler_RecoverableErrorExtended(ErrorHandler_ErrorCode_t code,
+                                           uint8_t parameter) {
+  _nrOfRecoverableErrors++;
+}
+
+void UTIL_SEQ_RegTask(UTIL_SEQ_bm_t TaskId_bm,
+                      uint32_t Flags,
+                      void (*Task)(void)) {
+  for (uint8_t i = 0; i < NR_OF_TASKS; i++) {
+    if ((TaskId_bm & (1UL << i)) != 0) {
+      _tasks[i] = Task;
+    }
+  }
+}
+
+void UTIL_SEQ_SetTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Task_Prio) {
+  _scheduledTasks |= TaskId_bm;
+}
+
+uint32_t Concurrency_EnterCriticalSection() {
+  // the modules under test run in a single thread
+  return 0;
+}
+
+void Concurrency_LeaveCriticalSection(uint32_t priorityMaskBackup) {
+}
+
+void Crc_Enable() {
+}
+
+void Crc_Disable() {
+}
+
+uint32_t Crc_ComputeCrc(uint8_t* buffer, uint16_t nrOfBytes) {
+  // like the crc block: polynomial 0x31 and initial value 0xFF
+  uint8_t crc = 0xFF;
+  for (uint16_t i = 0; i < nrOfBytes; i++) {
+    crc ^= buffer[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) != 0 ? (uint8_t)((crc << 1) ^ 0x31) : crc << 1;
+    }
+  }
+  return crc;
+}
+
+static uint8_t MessageSize(const Message_Message_t* message) {
+  // only the erase done message of the item store is a plain message
+  if (message->header.category == MESSAGE_BROKER_CATEGORY_ITEM_STORE &&
+      message->header.id != ITEM_STORE_MESSAGE_ERASE_DONE) {
+    return MESSAGE_SIZE;
+  }
+  return sizeof(Message_Message_t);
+}
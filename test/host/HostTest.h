@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file HostTest.h
+///
+/// Helpers of the tests that run on the development host.
+///
+/// The host tests compile single modules of the firmware together with
+/// replacements of the hardware dependent modules. The replacements of the
+/// message broker and the sequencer keep the published messages and the
+/// scheduled tasks until the test dispatches them.
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include "utility/scheduler/MessageListener.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/// Abort the test if a condition does not hold
+#define HOST_TEST_ASSERT(x)                  \
+  do {                                       \
+    if (!(x)) {                              \
+      HostTest_Fail(__FILE__, __LINE__, #x); \
+    }                                        \
+  } while (0)
+
+/// Run a test case and print its name
+#define HOST_TEST_RUN(test) \
+  do {                      \
+    printf("%s\n", #test);  \
+    test();                 \
+  } while (0)
+
+/// Report a failed condition and abort the test.
+/// @param file Source file of the condition
+/// @param line Line of the condition
+/// @param condition Text of the condition
+void HostTest_Fail(const char* file, int line, const char* condition);
+
+/// Get the number of recoverable errors that were signaled
+/// @return Number of calls to the recoverable error handler
+uint32_t HostTest_NrOfRecoverableErrors();
+
+/// Get the number of published messages that are not yet dispatched
+/// @return Number of pending messages
+uint16_t HostTest_PendingMessages();
+
+/// Dispatch the published messages to a listener.
+///
+/// When no message is pending, a running erase of the storage backend is
+/// completed and the scheduled sequencer tasks are run. The function returns
+/// when there is nothing left to do.
+/// @param listener The listener that receives the messages
+void HostTest_DispatchMessages(MessageListener_Listener_t* listener);
+
+/// Dispatch a single published message to a listener.
+/// @param listener The listener that receives the message
+/// @return true if a message was dispatched; false if none is pending
+bool HostTest_DispatchMessage(MessageListener_Listener_t* listener);
+
+/// Run the scheduled sequencer tasks
+/// @return true if a task was run; false otherwise
+bool HostTest_RunTasks();
+
+#endif  // HOST_TEST_H
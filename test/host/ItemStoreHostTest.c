@@ -0,0 +1,1066 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file ItemStoreHostTest.c
+///
+/// Host tests of the page index and the enumerator cursors of the item store.
+///
+/// The measurement item store is used for all tests; its pages are kept in
+/// the RAM backend. A reset of the device is simulated by calling
+/// `ItemStore_Init()` again on the same memory.
+
+#include "HostTest.h"
+#include "RamBackend.h"
+#include "app_service/item_store/ItemStore.h"
+#include "stm32wbxx_hal.h"
+#include "utility/AppDefines.h"
+
+#include <string.h>
+
+/// Size of the page header that precedes the items of a page
+#define PAGE_HEADER_SIZE 16
+
+/// Number of measurement items on a page
+#define ITEMS_PER_PAGE                    \
+  ((FLASH_PAGE_SIZE - PAGE_HEADER_SIZE) / \
+   sizeof(ItemStore_MeasurementSample_t))
+
+/// Number of items that are added with one batch
+#define BATCH_SIZE 200
+
+/// Number of items of a batch that spans several pages
+#define LARGE_BATCH_SIZE (2 * ITEMS_PER_PAGE + 10)
+
+/// Maximal number of writes within one write session; a session writes up
+/// to eight items and the tags of the page that is opened or closed.
+#define MAX_WRITES_PER_SESSION 10
+
+/// Item store that is tested
+#define ITEM_STORE ITEM_DEF_MEASUREMENT_SAMPLE
+
+/// Number of requests that may wait for the end of an erase
+#define DEFERRED_QUEUE_SIZE (ITEM_STORE_MAX_NR_OF_ENUMERATORS + 3)
+
+/// Erase count that marks the pages of a firmware without erase counters
+#define LEGACY_ERASE_COUNT 0xA53C
+
+/// First page of the settings records
+#define CONFIG_FIRST_PAGE FIRST_WRITABLE_FLASH_PAGE
+
+/// Number of settings records on a page
+#define RECORDS_PER_PAGE                  \
+  ((FLASH_PAGE_SIZE - PAGE_HEADER_SIZE) / \
+   sizeof(ItemStore_SettingsRecord_t))
+
+/// Simulate a reset of the device
+/// @param isFlashErased Flag to erase all pages before the reset
+static void Reset(bool isFlashErased);
+
+/// Add items with ascending values to the item store
+/// @param nrOfItems Number of items to be added
+static void AddItems(uint32_t nrOfItems);
+
+/// Add items with a single batch and wait until it is written
+/// @param nrOfItems Number of items; at most LARGE_BATCH_SIZE
+static void AddBatch(uint16_t nrOfItems);
+
+/// Open an enumerator and wait until it is ready
+/// @param enumerator The enumerator to be opened
+/// @param startIndex Index of the first item to be enumerated
+/// @return true if the enumerator is ready; false otherwise
+static bool OpenEnumerator(ItemStore_Enumerator_t* enumerator,
+                          int32_t startIndex);
+
+/// Start to delete all items; the erase is running when the function returns
+static void StartDelete();
+
+/// Write a page of settings as an older firmware did; the items hold their
+/// value in the first byte.
+/// @param pageNr Number of the page
+/// @param blockId Block id of the page
+/// @param nrOfItems Number of items on the page
+/// @param firstValue Value of the first item
+static void WriteLegacyPage(uint8_t pageNr,
+                            uint8_t blockId,
+                            uint8_t nrOfItems,
+                            uint8_t firstValue);
+
+/// Mark the pages of the item store as written by a firmware without erase
+/// counters.
+static void MarkLegacyPages();
+
+/// Read an item of the legacy log and return its value
+/// @param nrOfNewerItems Number of newer items of the legacy log
+/// @return The value of the item
+static uint32_t LegacyValue(uint32_t nrOfNewerItems);
+
+/// Add a settings record
+/// @param value Value of the record
+static void AddRecord(uint8_t value);
+
+/// Count the settings records
+/// @return Number of records in the item store
+static int32_t NrOfRecords();
+
+/// Read a settings record
+/// @param startIndex Index of the record; negative from the newest record
+/// @param record Receives the record
+static void ReadRecord(int32_t startIndex, ItemStore_SettingsRecord_t* record);
+
+/// Read the next item and return its value
+/// @param enumerator The enumerator that reads the item
+/// @return The value of the item
+static uint32_t NextValue(ItemStore_Enumerator_t* enumerator);
+
+/// Key callback of the key search; every seventh item holds a key.
+/// @param item The item to be inspected
+/// @param [out] key Receives the key of the item
+/// @return true if the item holds a key; false otherwise
+static bool KeyOfItem(const ItemStore_ItemStruct_t* item, uint32_t* key);
+
+/// Get the number of pages of the item store
+/// @return Number of pages
+static uint8_t NrOfPages();
+
+/// Get the first page of the item store; it ends with the last writable page.
+/// @return Number of the first page
+static uint8_t FirstPage();
+
+/// Callback of the batches
+/// @param success true if all items of the batch were written
+static void BatchDoneCb(bool success);
+
+/// Callback of the enumerators
+/// @param enumerator The enumerator that was opened
+/// @param ready true if the enumerator is ready to be used
+static void EnumeratorStatusCb(ItemStore_Enumerator_t* enumerator,
+                               bool ready);
+
+/// An empty store can not be enumerated
+static void TestEmptyStore();
+
+/// The items and their order survive a reset
+static void TestPageIndexAfterReset();
+
+/// Enumerators start and seek at any item, also at page boundaries
+static void TestStartIndexAndSeek();
+
+/// The page index follows the item store through several wrap arounds
+static void TestWrapAround();
+
+/// The key search finds the newest keyed item whose key is not above the
+/// searched key, also in a wrapped store
+static void TestSeekKey();
+
+/// An enumerator whose unread items are erased reports that it is overtaken
+static void TestOvertakenEnumerator();
+
+/// The number of open enumerators is limited by the number of cursors
+static void TestCursorLimit();
+
+/// All items are removed by a delete
+static void TestDeleteAllItems();
+
+/// A batch releases the write session after a few items
+static void TestBatchWriteSessions();
+
+/// A batch is written page by page; other requests are handled in between
+static void TestBatchSlices();
+
+/// The items of a firmware without erase counters are kept as legacy log
+/// until they are deleted or overwritten
+static void TestLegacyLog();
+
+/// The newest page of a wrapped legacy log is found by its block id
+static void TestWrappedLegacyLog();
+
+/// The oldest page of a legacy log without empty page is replaced by the
+/// first items of this firmware
+static void TestFullLegacyLog();
+
+/// The newest settings of an older firmware are kept until they are deleted
+static void TestLegacySettings();
+
+/// The kept settings of an older firmware are erased when their page is
+/// needed
+static void TestLegacyPageReused();
+
+/// Requests that arrive during an erase are handled when the erase is done
+static void TestRequestsDuringErase();
+
+/// Requests that arrive during an erase are rejected if too many wait
+static void TestDeferredQueueFull();
+
+/// Requests that arrive during a pre-erase are handled when it is done
+static void TestPreEraseWithPendingRequests();
+
+/// A batch that spans several pages of a wrapped log waits for each
+/// pre-erase
+static void TestLargeBatchAfterWrapAround();
+
+/// A record whose write is cut by a power loss is cleared after the reset;
+/// the records that were written before are kept.
+static void TestPowerLossDuringRecordWrite();
+
+/// A batch that is cut by a power loss keeps the items that were written
+static void TestPowerLossDuringBatch();
+
+/// Items of the running batch
+static ItemStore_MeasurementSample_t _batchItems[LARGE_BATCH_SIZE];
+
+/// The running batch
+static ItemStore_ItemBatch_t _batch = {.items = _batchItems,
+                                       .onDoneCb = BatchDoneCb};
+
+/// Number of completed batches
+static uint32_t _nrOfCompletedBatches;
+
+/// Value of the next added item
+static uint32_t _nextValue;
+
+/// Result of the last enumerator callback
+static bool _isEnumeratorReady;
+
+/// Number of enumerator callbacks
+static uint32_t _nrOfEnumeratorCbs;
+
+int main() {
+  HOST_TEST_RUN(TestEmptyStore);
+  HOST_TEST_RUN(TestPageIndexAfterReset);
+  HOST_TEST_RUN(TestStartIndexAndSeek);
+  HOST_TEST_RUN(TestWrapAround);
+  HOST_TEST_RUN(TestSeekKey);
+  HOST_TEST_RUN(TestOvertakenEnumerator);
+  HOST_TEST_RUN(TestCursorLimit);
+  HOST_TEST_RUN(TestDeleteAllItems);
+  HOST_TEST_RUN(TestBatchWriteSessions);
+  HOST_TEST_RUN(TestBatchSlices);
+  HOST_TEST_RUN(TestLegacyLog);
+  HOST_TEST_RUN(TestWrappedLegacyLog);
+  HOST_TEST_RUN(TestFullLegacyLog);
+  HOST_TEST_RUN(TestLegacySettings);
+  HOST_TEST_RUN(TestLegacyPageReused);
+  HOST_TEST_RUN(TestRequestsDuringErase);
+  HOST_TEST_RUN(TestDeferredQueueFull);
+  HOST_TEST_RUN(TestPreEraseWithPendingRequests);
+  HOST_TEST_RUN(TestLargeBatchAfterWrapAround);
+  HOST_TEST_RUN(TestPowerLossDuringRecordWrite);
+  HOST_TEST_RUN(TestPowerLossDuringBatch);
+  return 0;
+}
+
+static void TestEmptyStore() {
+  Reset(true);
+  HOST_TEST_ASSERT(ItemStore_IsEmpty(ITEM_STORE));
+  ItemStore_Enumerator_t enumerator = {0};
+  HOST_TEST_ASSERT(!OpenEnumerator(&enumerator, 0));
+  HOST_TEST_ASSERT(enumerator.enumeratorDetails == 0);
+}
+
+static void TestPageIndexAfterReset() {
+  Reset(true);
+  uint32_t nrOfItems = 3 * ITEMS_PER_PAGE + 100;
+  AddItems(nrOfItems);
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    ItemStore_Enumerator_t enumerator = {0};
+    HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+    HOST_TEST_ASSERT(ItemStore_Count(&enumerator) == (int32_t)nrOfItems);
+    for (uint32_t i = 0; i < nrOfItems; i++) {
+      HOST_TEST_ASSERT(NextValue(&enumerator) == i);
+    }
+    HOST_TEST_ASSERT(!enumerator.hasMoreItems);
+    ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+    Reset(false);
+  }
+  // one read per page header and a binary search on the open page
+  HOST_TEST_ASSERT(ItemStore_GetRecoveryReads(ITEM_STORE) <= NrOfPages() + 11);
+}
+
+static void TestStartIndexAndSeek() {
+  Reset(true);
+  uint32_t nrOfItems = 4 * ITEMS_PER_PAGE + 7;
+  AddItems(nrOfItems);
+  ItemStore_Enumerator_t enumerator = {0};
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, -10));
+  for (uint32_t i = nrOfItems - 10; i < nrOfItems; i++) {
+    HOST_TEST_ASSERT(NextValue(&enumerator) == i);
+  }
+  HOST_TEST_ASSERT(!enumerator.hasMoreItems);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, ITEMS_PER_PAGE));
+  HOST_TEST_ASSERT(NextValue(&enumerator) == ITEMS_PER_PAGE);
+  const uint32_t seekIndices[] = {0,
+                                  ITEMS_PER_PAGE - 1,
+                                  ITEMS_PER_PAGE,
+                                  ITEMS_PER_PAGE + 1,
+                                  3 * ITEMS_PER_PAGE,
+                                  nrOfItems - 1};
+  for (uint8_t i = 0; i < sizeof seekIndices / sizeof seekIndices[0]; i++) {
+    HOST_TEST_ASSERT(ItemStore_Seek(&enumerator, seekIndices[i]));
+    HOST_TEST_ASSERT(NextValue(&enumerator) == seekIndices[i]);
+  }
+  // the items are continued on the next page
+  HOST_TEST_ASSERT(ItemStore_Seek(&enumerator, ITEMS_PER_PAGE - 2));
+  for (uint32_t i = ITEMS_PER_PAGE - 2; i < ITEMS_PER_PAGE + 2; i++) {
+    HOST_TEST_ASSERT(NextValue(&enumerator) == i);
+  }
+  HOST_TEST_ASSERT(!ItemStore_Seek(&enumerator, nrOfItems));
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestWrapAround() {
+  Reset(true);
+  // the block ids wrap around after 64 pages
+  for (uint8_t round = 0; round < 3; round++) {
+    AddItems(NrOfPages() * ITEMS_PER_PAGE + ITEMS_PER_PAGE / 3);
+    for (uint8_t pass = 0; pass < 2; pass++) {
+      ItemStore_Enumerator_t enumerator = {0};
+      HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+      uint32_t nrOfItems = ItemStore_Count(&enumerator);
+      // the page ahead of the write page is erased in advance
+      HOST_TEST_ASSERT(nrOfItems > (NrOfPages() - 2) * ITEMS_PER_PAGE);
+      HOST_TEST_ASSERT(nrOfItems < NrOfPages() * ITEMS_PER_PAGE);
+      for (uint32_t i = _nextValue - nrOfItems; i < _nextValue; i++) {
+        HOST_TEST_ASSERT(NextValue(&enumerator) == i);
+      }
+      HOST_TEST_ASSERT(!enumerator.hasMoreItems);
+      ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+      Reset(false);
+    }
+  }
+}
+
+static void TestSeekKey() {
+  Reset(true);
+  AddItems(NrOfPages() * ITEMS_PER_PAGE + ITEMS_PER_PAGE / 2);
+  ItemStore_Enumerator_t enumerator = {0};
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  uint32_t nrOfItems = ItemStore_Count(&enumerator);
+  uint32_t oldestValue = _nextValue - nrOfItems;
+  // the keyed items have the values 7 * key + 3
+  uint32_t oldestKey = (oldestValue + 3) / 7;
+  uint32_t newestKey = (_nextValue - 4) / 7;
+  const uint32_t keys[] = {0,
+                           oldestKey,
+                           oldestKey + 1,
+                           (oldestKey + newestKey) / 2,
+                           newestKey - 1,
+                           newestKey,
+                           newestKey + 1000};
+  for (uint8_t i = 0; i < sizeof keys / sizeof keys[0]; i++) {
+    uint32_t key = keys[i] < oldestKey   ? oldestKey
+                   : keys[i] > newestKey ? newestKey
+                                         : keys[i];
+    uint32_t index;
+    HOST_TEST_ASSERT(
+        ItemStore_SeekKey(&enumerator, keys[i], KeyOfItem, 6, &index));
+    HOST_TEST_ASSERT(index == 7 * key + 3 - oldestValue);
+    HOST_TEST_ASSERT(NextValue(&enumerator) == 7 * key + 3);
+    HOST_TEST_ASSERT(NextValue(&enumerator) == 7 * key + 4);
+  }
+  // the search fails if the oldest item is not keyed and no gap is allowed
+  uint32_t index;
+  HOST_TEST_ASSERT(ItemStore_SeekKey(&enumerator, 0, KeyOfItem, 0, &index) ==
+                   (oldestValue % 7 == 3));
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestOvertakenEnumerator() {
+  Reset(true);
+  AddItems(NrOfPages() * ITEMS_PER_PAGE);
+  ItemStore_Enumerator_t enumerator = {0};
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  uint32_t oldestValue = NextValue(&enumerator);
+  AddItems(2 * ITEMS_PER_PAGE);
+  ItemStore_ItemStruct_t item;
+  while (ItemStore_GetNext(&enumerator, &item)) {
+  }
+  HOST_TEST_ASSERT(enumerator.isOvertaken);
+  // the erased item can not be reached anymore
+  HOST_TEST_ASSERT(!ItemStore_Seek(&enumerator, 0));
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  HOST_TEST_ASSERT(NextValue(&enumerator) > oldestValue);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestCursorLimit() {
+  Reset(true);
+  AddItems(10);
+  ItemStore_Enumerator_t enumerators[ITEM_STORE_MAX_NR_OF_ENUMERATORS + 1];
+  memset(enumerators, 0, sizeof enumerators);
+  for (uint8_t i = 0; i < ITEM_STORE_MAX_NR_OF_ENUMERATORS; i++) {
+    HOST_TEST_ASSERT(OpenEnumerator(&enumerators[i], i));
+  }
+  uint32_t nrOfErrors = HostTest_NrOfRecoverableErrors();
+  ItemStore_Enumerator_t* last = &enumerators[ITEM_STORE_MAX_NR_OF_ENUMERATORS];
+  HOST_TEST_ASSERT(!OpenEnumerator(last, 0));
+  HOST_TEST_ASSERT(HostTest_NrOfRecoverableErrors() == nrOfErrors + 1);
+  // every enumerator reads with its own cursor
+  for (uint8_t i = 0; i < ITEM_STORE_MAX_NR_OF_ENUMERATORS; i++) {
+    HOST_TEST_ASSERT(NextValue(&enumerators[i]) == i);
+  }
+  ItemStore_EndEnumerate(&enumerators[0], ITEM_STORE);
+  HOST_TEST_ASSERT(OpenEnumerator(last, 5));
+  HOST_TEST_ASSERT(NextValue(last) == 5);
+  for (uint8_t i = 1; i <= ITEM_STORE_MAX_NR_OF_ENUMERATORS; i++) {
+    ItemStore_EndEnumerate(&enumerators[i], ITEM_STORE);
+  }
+}
+
+static void TestDeleteAllItems() {
+  Reset(true);
+  AddItems(2 * ITEMS_PER_PAGE);
+  ItemStore_DeleteAllItems(ITEM_STORE);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  HOST_TEST_ASSERT(ItemStore_IsEmpty(ITEM_STORE));
+  Reset(false);
+  HOST_TEST_ASSERT(ItemStore_IsEmpty(ITEM_STORE));
+  AddItems(3);
+  ItemStore_Enumerator_t enumerator = {0};
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  HOST_TEST_ASSERT(ItemStore_Count(&enumerator) == 3);
+  HOST_TEST_ASSERT(NextValue(&enumerator) == _nextValue - 3);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestBatchWriteSessions() {
+  Reset(true);
+  AddItems(ITEMS_PER_PAGE - 5);
+  RamBackend_Stats_t* stats = RamBackend_Stats();
+  memset(stats, 0, sizeof *stats);
+  // the batch closes a page and opens the next one
+  AddItems(BATCH_SIZE);
+  HOST_TEST_ASSERT(!RamBackend_IsSessionOpen());
+  HOST_TEST_ASSERT(stats->nrOfWrites >= BATCH_SIZE);
+  HOST_TEST_ASSERT(stats->maxWritesPerSession <= MAX_WRITES_PER_SESSION);
+  HOST_TEST_ASSERT(stats->nrOfSessions * MAX_WRITES_PER_SESSION >=
+                   stats->nrOfWrites);
+}
+
+static void TestBatchSlices() {
+  Reset(true);
+  AddItems(ITEMS_PER_PAGE - 5);
+  for (uint16_t i = 0; i < LARGE_BATCH_SIZE; i++) {
+    _batchItems[i].data[0] = _nextValue;
+    _batchItems[i].data[1] = ~_nextValue;
+    _nextValue++;
+  }
+  _batch.nrOfItems = LARGE_BATCH_SIZE;
+  uint32_t nrOfCompletedBatches = _nrOfCompletedBatches;
+  ItemStore_AddItems(ITEM_STORE, &_batch);
+  ItemStore_Enumerator_t enumerator = {0};
+  uint32_t nrOfEnumeratorCbs = _nrOfEnumeratorCbs;
+  ItemStore_BeginEnumerate(ITEM_STORE, &enumerator, EnumeratorStatusCb);
+  // the first slice closes the write page
+  HOST_TEST_ASSERT(HostTest_DispatchMessage(ItemStore_ListenerInstance()));
+  HOST_TEST_ASSERT(_batch.nrOfItemsWritten == 5);
+  HOST_TEST_ASSERT(HostTest_DispatchMessage(ItemStore_ListenerInstance()));
+  HOST_TEST_ASSERT(_nrOfEnumeratorCbs == nrOfEnumeratorCbs + 1);
+  HOST_TEST_ASSERT(_isEnumeratorReady);
+  HOST_TEST_ASSERT(ItemStore_Count(&enumerator) == ITEMS_PER_PAGE);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+  // each further slice fills one page
+  HOST_TEST_ASSERT(HostTest_DispatchMessage(ItemStore_ListenerInstance()));
+  HOST_TEST_ASSERT(_batch.nrOfItemsWritten == 5 + ITEMS_PER_PAGE);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  HOST_TEST_ASSERT(_nrOfCompletedBatches == nrOfCompletedBatches + 1);
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  HOST_TEST_ASSERT(ItemStore_Count(&enumerator) ==
+                   ITEMS_PER_PAGE + LARGE_BATCH_SIZE - 5);
+  for (uint32_t i = 0; i < ITEMS_PER_PAGE + LARGE_BATCH_SIZE - 5; i++) {
+    HOST_TEST_ASSERT(NextValue(&enumerator) == i);
+  }
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestLegacyLog() {
+  Reset(true);
+  AddItems(2 * ITEMS_PER_PAGE + 10);
+  MarkLegacyPages();
+  uint32_t nrOfErrors = HostTest_NrOfRecoverableErrors();
+  Reset(false);
+  // the items of the older firmware are kept as legacy log
+  HOST_TEST_ASSERT(ItemStore_IsEmpty(ITEM_STORE));
+  HOST_TEST_ASSERT(HostTest_NrOfRecoverableErrors() == nrOfErrors);
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) ==
+                   2 * ITEMS_PER_PAGE + 10);
+  HOST_TEST_ASSERT(LegacyValue(0) == 2 * ITEMS_PER_PAGE + 9);
+  HOST_TEST_ASSERT(LegacyValue(2 * ITEMS_PER_PAGE + 9) == 0);
+  ItemStore_MeasurementSample_t item;
+  HOST_TEST_ASSERT(!ItemStore_ReadLegacyLogItem(
+      ITEM_STORE, 2 * ITEMS_PER_PAGE + 10, &item, sizeof item));
+  // the items of this firmware are written after the legacy log
+  _nextValue = 5000;
+  AddItems(3);
+  Reset(false);
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) ==
+                   2 * ITEMS_PER_PAGE + 10);
+  ItemStore_Enumerator_t enumerator = {0};
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  HOST_TEST_ASSERT(ItemStore_Count(&enumerator) == 3);
+  HOST_TEST_ASSERT(NextValue(&enumerator) == 5000);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+  // the oldest legacy page is erased in advance when the item store wraps
+  // around; the address of the newer items does not change.
+  AddItems((NrOfPages() - 4) * ITEMS_PER_PAGE - 3);
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) ==
+                   2 * ITEMS_PER_PAGE + 10);
+  AddItems(1);
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) ==
+                   ITEMS_PER_PAGE + 10);
+  HOST_TEST_ASSERT(LegacyValue(0) == 2 * ITEMS_PER_PAGE + 9);
+  HOST_TEST_ASSERT(LegacyValue(ITEMS_PER_PAGE + 9) == ITEMS_PER_PAGE);
+  Reset(false);
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) ==
+                   ITEMS_PER_PAGE + 10);
+  HOST_TEST_ASSERT(HostTest_NrOfRecoverableErrors() == nrOfErrors);
+  // the deleted legacy log is erased
+  ItemStore_DeleteLegacyItems(ITEM_STORE);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) == 0);
+  HOST_TEST_ASSERT(!ItemStore_ReadLegacyLogItem(ITEM_STORE, 0, &item,
+                                                sizeof item));
+  Reset(false);
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) == 0);
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  HOST_TEST_ASSERT(ItemStore_Count(&enumerator) ==
+                   (int32_t)((NrOfPages() - 4) * ITEMS_PER_PAGE + 1));
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestWrappedLegacyLog() {
+  Reset(true);
+  // the block ids of the legacy log wrap around
+  AddItems(3 * NrOfPages() * ITEMS_PER_PAGE + ITEMS_PER_PAGE / 3);
+  ItemStore_Enumerator_t enumerator = {0};
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  uint32_t nrOfItems = ItemStore_Count(&enumerator);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+  MarkLegacyPages();
+  // firmware 1.0.0 had more pages; the block ids jump where its pages in
+  // front of the first page of this item store are missing.
+  uint8_t* newestPage = RamBackend_Page(FirstPage());
+  newestPage[5] = (newestPage[5] + 6) % 64;
+  Reset(false);
+  HOST_TEST_ASSERT(ItemStore_IsEmpty(ITEM_STORE));
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) == nrOfItems);
+  HOST_TEST_ASSERT(LegacyValue(0) == _nextValue - 1);
+  HOST_TEST_ASSERT(LegacyValue(nrOfItems - 1) == _nextValue - nrOfItems);
+  // the first item is written to the empty page after the newest legacy
+  // page; the page after it holds the oldest legacy items.
+  uint32_t newestLegacyValue = _nextValue - 1;
+  AddItems(1);
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) ==
+                   nrOfItems - ITEMS_PER_PAGE);
+  HOST_TEST_ASSERT(LegacyValue(0) == newestLegacyValue);
+  Reset(false);
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) ==
+                   nrOfItems - ITEMS_PER_PAGE);
+  HOST_TEST_ASSERT(LegacyValue(0) == newestLegacyValue);
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  HOST_TEST_ASSERT(ItemStore_Count(&enumerator) == 1);
+  HOST_TEST_ASSERT(NextValue(&enumerator) == _nextValue - 1);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestFullLegacyLog() {
+  Reset(true);
+  AddItems((NrOfPages() - 1) * ITEMS_PER_PAGE + 1);
+  MarkLegacyPages();
+  // the older firmware also wrote to the page that was erased in advance
+  uint8_t* page = RamBackend_Page(FirstPage());
+  HOST_TEST_ASSERT(page[0] == 0xFF);
+  memcpy(page, RamBackend_Page(FirstPage() + 1), PAGE_HEADER_SIZE / 2);
+  page[4] = FirstPage();
+  page[5] = NrOfPages() % 64;
+  ItemStore_MeasurementSample_t item = {{9999, ~9999U}};
+  memcpy(page + PAGE_HEADER_SIZE, &item, sizeof item);
+  uint32_t nrOfErrors = HostTest_NrOfRecoverableErrors();
+  Reset(false);
+  // the first items of this firmware replace the oldest legacy page
+  HOST_TEST_ASSERT(ItemStore_IsEmpty(ITEM_STORE));
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) ==
+                   (NrOfPages() - 3) * ITEMS_PER_PAGE + 2);
+  HOST_TEST_ASSERT(LegacyValue(0) == 9999);
+  HOST_TEST_ASSERT(LegacyValue(1) == _nextValue - 1);
+  AddItems(1);
+  Reset(false);
+  HOST_TEST_ASSERT(ItemStore_CountLegacyLogItems(ITEM_STORE) ==
+                   (NrOfPages() - 4) * ITEMS_PER_PAGE + 2);
+  HOST_TEST_ASSERT(HostTest_NrOfRecoverableErrors() == nrOfErrors);
+  ItemStore_Enumerator_t enumerator = {0};
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  HOST_TEST_ASSERT(ItemStore_Count(&enumerator) == 1);
+  HOST_TEST_ASSERT(NextValue(&enumerator) == _nextValue - 1);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestLegacySettings() {
+  Reset(true);
+  WriteLegacyPage(CONFIG_FIRST_PAGE, 7, 31, 10);
+  WriteLegacyPage(CONFIG_FIRST_PAGE + 1, 8, 3, 50);
+  Reset(false);
+  // the older page is erased; the items are not part of the item store
+  HOST_TEST_ASSERT(RamBackend_Page(CONFIG_FIRST_PAGE)[0] == 0xFF);
+  HOST_TEST_ASSERT(ItemStore_IsEmpty(ITEM_DEF_SYSTEM_CONFIG));
+  ItemStore_SystemConfig_t legacy;
+  HOST_TEST_ASSERT(ItemStore_ReadLegacyItem(ITEM_DEF_SYSTEM_CONFIG, &legacy,
+                                            sizeof legacy));
+  HOST_TEST_ASSERT(((uint8_t*)&legacy)[0] == 52);
+  ItemStore_SettingsRecord_t record;
+  HOST_TEST_ASSERT(!ItemStore_ReadLegacyItem(ITEM_DEF_SYSTEM_CONFIG, &record,
+                                             sizeof record));
+  // the new records do not touch the kept page, also after a reset
+  AddRecord(1);
+  AddRecord(2);
+  Reset(false);
+  HOST_TEST_ASSERT(NrOfRecords() == 2);
+  HOST_TEST_ASSERT(ItemStore_ReadLegacyItem(ITEM_DEF_SYSTEM_CONFIG, &legacy,
+                                            sizeof legacy));
+  HOST_TEST_ASSERT(((uint8_t*)&legacy)[0] == 52);
+  ItemStore_DeleteLegacyItems(ITEM_DEF_SYSTEM_CONFIG);
+  AddRecord(3);
+  HOST_TEST_ASSERT(RamBackend_Page(CONFIG_FIRST_PAGE + 1)[0] == 0xFF);
+  HOST_TEST_ASSERT(!ItemStore_ReadLegacyItem(ITEM_DEF_SYSTEM_CONFIG, &legacy,
+                                             sizeof legacy));
+  Reset(false);
+  HOST_TEST_ASSERT(NrOfRecords() == 3);
+  HOST_TEST_ASSERT(!ItemStore_ReadLegacyItem(ITEM_DEF_SYSTEM_CONFIG, &legacy,
+                                             sizeof legacy));
+}
+
+static void TestLegacyPageReused() {
+  Reset(true);
+  // the newer page was opened without its first item after a wrap around
+  WriteLegacyPage(CONFIG_FIRST_PAGE, 0, 0, 0);
+  WriteLegacyPage(CONFIG_FIRST_PAGE + 1, 63, 5, 20);
+  Reset(false);
+  HOST_TEST_ASSERT(RamBackend_Page(CONFIG_FIRST_PAGE)[0] == 0xFF);
+  ItemStore_SystemConfig_t legacy;
+  HOST_TEST_ASSERT(ItemStore_ReadLegacyItem(ITEM_DEF_SYSTEM_CONFIG, &legacy,
+                                            sizeof legacy));
+  HOST_TEST_ASSERT(((uint8_t*)&legacy)[0] == 24);
+  uint32_t nrOfErrors = HostTest_NrOfRecoverableErrors();
+  for (uint16_t i = 0; i < RECORDS_PER_PAGE + 2; i++) {
+    AddRecord((uint8_t)i);
+  }
+  HOST_TEST_ASSERT(HostTest_NrOfRecoverableErrors() == nrOfErrors);
+  HOST_TEST_ASSERT(!ItemStore_ReadLegacyItem(ITEM_DEF_SYSTEM_CONFIG, &legacy,
+                                             sizeof legacy));
+  HOST_TEST_ASSERT(NrOfRecords() == RECORDS_PER_PAGE + 2);
+  Reset(false);
+  HOST_TEST_ASSERT(NrOfRecords() == RECORDS_PER_PAGE + 2);
+}
+
+static void TestRequestsDuringErase() {
+  Reset(true);
+  AddItems(2 * ITEMS_PER_PAGE);
+  StartDelete();
+  _batchItems[0].data[0] = _nextValue;
+  _batchItems[0].data[1] = ~_nextValue;
+  _nextValue++;
+  ItemStore_AddItem(ITEM_STORE, (ItemStore_ItemStruct_t*)&_batchItems[0]);
+  ItemStore_Enumerator_t enumerator = {0};
+  uint32_t nrOfEnumeratorCbs = _nrOfEnumeratorCbs;
+  ItemStore_BeginEnumerate(ITEM_STORE, &enumerator, EnumeratorStatusCb);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  // the enumeration starts after the item was added to the emptied store
+  HOST_TEST_ASSERT(_nrOfEnumeratorCbs == nrOfEnumeratorCbs + 1);
+  HOST_TEST_ASSERT(_isEnumeratorReady);
+  HOST_TEST_ASSERT(ItemStore_Count(&enumerator) == 1);
+  HOST_TEST_ASSERT(NextValue(&enumerator) == _nextValue - 1);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+  // a batch that arrives during an erase is completed
+  StartDelete();
+  AddItems(BATCH_SIZE);
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  HOST_TEST_ASSERT(ItemStore_Count(&enumerator) == BATCH_SIZE);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestDeferredQueueFull() {
+  Reset(true);
+  AddItems(10);
+  StartDelete();
+  for (uint8_t i = 0; i < DEFERRED_QUEUE_SIZE; i++) {
+    ItemStore_AddItem(ITEM_STORE, (ItemStore_ItemStruct_t*)&_batchItems[i]);
+  }
+  ItemStore_Enumerator_t enumerator = {0};
+  uint32_t nrOfEnumeratorCbs = _nrOfEnumeratorCbs;
+  uint32_t nrOfErrors = HostTest_NrOfRecoverableErrors();
+  ItemStore_BeginEnumerate(ITEM_STORE, &enumerator, EnumeratorStatusCb);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  // the client is told and the cursor is released
+  HOST_TEST_ASSERT(_nrOfEnumeratorCbs == nrOfEnumeratorCbs + 1);
+  HOST_TEST_ASSERT(!_isEnumeratorReady);
+  HOST_TEST_ASSERT(enumerator.enumeratorDetails == 0);
+  HOST_TEST_ASSERT(HostTest_NrOfRecoverableErrors() == nrOfErrors + 1);
+  ItemStore_Enumerator_t enumerators[ITEM_STORE_MAX_NR_OF_ENUMERATORS];
+  memset(enumerators, 0, sizeof enumerators);
+  for (uint8_t i = 0; i < ITEM_STORE_MAX_NR_OF_ENUMERATORS; i++) {
+    HOST_TEST_ASSERT(OpenEnumerator(&enumerators[i], 0));
+    HOST_TEST_ASSERT(ItemStore_Count(&enumerators[i]) == DEFERRED_QUEUE_SIZE);
+  }
+  for (uint8_t i = 0; i < ITEM_STORE_MAX_NR_OF_ENUMERATORS; i++) {
+    ItemStore_EndEnumerate(&enumerators[i], ITEM_STORE);
+  }
+}
+
+static void TestPreEraseWithPendingRequests() {
+  Reset(true);
+  AddItems((NrOfPages() - 1) * ITEMS_PER_PAGE - 10);
+  ItemStore_EraseStats_t eraseStats;
+  ItemStore_GetEraseStats(&eraseStats);
+  uint16_t nrOfPreErasedPages = eraseStats.nrOfPreErasedPages;
+  uint32_t nrOfErrors = HostTest_NrOfRecoverableErrors();
+  // the batch opens the last free page and starts the pre-erase of the
+  // oldest page; the rest of the batch waits for the erase
+  for (uint16_t i = 0; i < 20; i++) {
+    _batchItems[i].data[0] = _nextValue;
+    _batchItems[i].data[1] = ~_nextValue;
+    _nextValue++;
+  }
+  _batch.nrOfItems = 20;
+  uint32_t nrOfCompletedBatches = _nrOfCompletedBatches;
+  ItemStore_AddItems(ITEM_STORE, &_batch);
+  // the first slice of the batch fills the page before the last free page
+  HOST_TEST_ASSERT(HostTest_DispatchMessage(ItemStore_ListenerInstance()));
+  HOST_TEST_ASSERT(HostTest_PendingMessages() == 1);
+  HOST_TEST_ASSERT(HostTest_DispatchMessage(ItemStore_ListenerInstance()));
+  HOST_TEST_ASSERT(HostTest_PendingMessages() == 0);
+  HOST_TEST_ASSERT(_nrOfCompletedBatches == nrOfCompletedBatches);
+  // the requests arrive while the pre-erase is running
+  ItemStore_MeasurementSample_t item = {.data = {_nextValue, ~_nextValue}};
+  _nextValue++;
+  ItemStore_Enumerator_t enumerator = {0};
+  uint32_t nrOfEnumeratorCbs = _nrOfEnumeratorCbs;
+  ItemStore_AddItem(ITEM_STORE, (ItemStore_ItemStruct_t*)&item);
+  ItemStore_BeginEnumerate(ITEM_STORE, &enumerator, EnumeratorStatusCb);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  ItemStore_GetEraseStats(&eraseStats);
+  HOST_TEST_ASSERT(eraseStats.nrOfPreErasedPages == nrOfPreErasedPages + 1);
+  HOST_TEST_ASSERT(HostTest_NrOfRecoverableErrors() == nrOfErrors);
+  HOST_TEST_ASSERT(_nrOfCompletedBatches == nrOfCompletedBatches + 1);
+  // the oldest page is gone; the single item follows the batch
+  HOST_TEST_ASSERT(_nrOfEnumeratorCbs == nrOfEnumeratorCbs + 1);
+  HOST_TEST_ASSERT(_isEnumeratorReady);
+  uint32_t nrOfItems = ItemStore_Count(&enumerator);
+  HOST_TEST_ASSERT(nrOfItems == (NrOfPages() - 2) * ITEMS_PER_PAGE + 11);
+  for (uint32_t i = _nextValue - nrOfItems; i < _nextValue; i++) {
+    HOST_TEST_ASSERT(NextValue(&enumerator) == i);
+  }
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestLargeBatchAfterWrapAround() {
+  Reset(true);
+  AddItems(NrOfPages() * ITEMS_PER_PAGE - 5);
+  ItemStore_EraseStats_t eraseStats;
+  ItemStore_GetEraseStats(&eraseStats);
+  uint16_t nrOfPreErasedPages = eraseStats.nrOfPreErasedPages;
+  uint32_t nrOfErrors = HostTest_NrOfRecoverableErrors();
+  // the batch closes the write page and fills two more pages
+  AddBatch(LARGE_BATCH_SIZE);
+  AddBatch(LARGE_BATCH_SIZE);
+  HOST_TEST_ASSERT(HostTest_NrOfRecoverableErrors() == nrOfErrors);
+  ItemStore_GetEraseStats(&eraseStats);
+  HOST_TEST_ASSERT(eraseStats.nrOfPreErasedPages >= nrOfPreErasedPages + 4);
+  // all pages but the pre-erased one hold the newest items without a gap
+  ItemStore_Enumerator_t enumerator = {0};
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  uint32_t nrOfItems = ItemStore_Count(&enumerator);
+  HOST_TEST_ASSERT(nrOfItems > (NrOfPages() - 2) * ITEMS_PER_PAGE);
+  HOST_TEST_ASSERT(nrOfItems <= (NrOfPages() - 1) * ITEMS_PER_PAGE);
+  for (uint32_t i = _nextValue - nrOfItems; i < _nextValue; i++) {
+    HOST_TEST_ASSERT(NextValue(&enumerator) == i);
+  }
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+  // the log is recovered after a reset
+  Reset(false);
+  HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+  HOST_TEST_ASSERT(ItemStore_Count(&enumerator) == (int32_t)nrOfItems);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestPowerLossDuringRecordWrite() {
+  // the record is written in the middle of a page, as last record of a page
+  // and as first record of a page
+  const uint16_t nrOfOldRecords[] = {3, RECORDS_PER_PAGE - 1, RECORDS_PER_PAGE};
+  const ItemStore_SettingsRecord_t cleared = {0};
+  ItemStore_SettingsRecord_t record;
+  for (uint8_t i = 0; i < COUNT_OF(nrOfOldRecords); i++) {
+    // the record is missing, then torn and finally complete the more double
+    // words are written before the power loss
+    uint32_t nrOfTornRecords = 0;
+    bool isComplete = false;
+    bool isPowerCut = true;
+    for (uint32_t nrOfDoubleWords = 0; isPowerCut; nrOfDoubleWords++) {
+      Reset(true);
+      for (uint16_t j = 0; j < nrOfOldRecords[i]; j++) {
+        AddRecord((uint8_t)j);
+      }
+      RamBackend_CutPowerAfter(nrOfDoubleWords);
+      AddRecord(0xA5);
+      isPowerCut = RamBackend_IsPowerCut();
+      RamBackend_RestorePower();
+      Reset(false);
+      int32_t nrOfRecords = NrOfRecords();
+      ReadRecord(-1, &record);
+      if (nrOfRecords == nrOfOldRecords[i]) {
+        HOST_TEST_ASSERT(nrOfTornRecords == 0 && !isComplete);
+        HOST_TEST_ASSERT(record.crc == nrOfOldRecords[i] - 1);
+      } else if (record.crc == 0xA5) {
+        HOST_TEST_ASSERT(nrOfRecords == nrOfOldRecords[i] + 1);
+        isComplete = true;
+      } else {
+        // the head is written last; the torn record is cleared
+        HOST_TEST_ASSERT(nrOfRecords == nrOfOldRecords[i] + 1);
+        HOST_TEST_ASSERT(memcmp(&record, &cleared, sizeof record) == 0);
+        HOST_TEST_ASSERT(!isComplete);
+        nrOfTornRecords++;
+        // the records before the power loss are kept
+        ReadRecord(-2, &record);
+        HOST_TEST_ASSERT(record.crc == nrOfOldRecords[i] - 1);
+      }
+      // the log continues after the record
+      AddRecord(0x5A);
+      Reset(false);
+      HOST_TEST_ASSERT(NrOfRecords() == nrOfRecords + 1);
+      ReadRecord(-1, &record);
+      HOST_TEST_ASSERT(record.crc == 0x5A);
+    }
+    // the power was cut after each double word of the tail
+    HOST_TEST_ASSERT(nrOfTornRecords ==
+                     sizeof record / sizeof(uint64_t) - 1);
+    HOST_TEST_ASSERT(isComplete);
+  }
+}
+
+static void TestPowerLossDuringBatch() {
+  bool isPowerCut = true;
+  for (uint32_t nrOfDoubleWords = 0; isPowerCut; nrOfDoubleWords++) {
+    Reset(true);
+    AddItems(ITEMS_PER_PAGE - 5);
+    // the batch closes the page and opens the next one
+    RamBackend_CutPowerAfter(nrOfDoubleWords);
+    AddBatch(10);
+    isPowerCut = RamBackend_IsPowerCut();
+    RamBackend_RestorePower();
+    Reset(false);
+    // the items before the power loss are kept without a gap
+    ItemStore_Enumerator_t enumerator = {0};
+    HOST_TEST_ASSERT(OpenEnumerator(&enumerator, 0));
+    uint32_t nrOfItems = ItemStore_Count(&enumerator);
+    HOST_TEST_ASSERT(nrOfItems >= ITEMS_PER_PAGE - 5);
+    HOST_TEST_ASSERT(nrOfItems <= ITEMS_PER_PAGE + 5);
+    if (nrOfDoubleWords <= 5) {
+      HOST_TEST_ASSERT(nrOfItems == ITEMS_PER_PAGE - 5 + nrOfDoubleWords);
+    }
+    for (uint32_t j = 0; j < nrOfItems; j++) {
+      HOST_TEST_ASSERT(NextValue(&enumerator) == j);
+    }
+    ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+    // the log continues after the kept items
+    _nextValue = nrOfItems;
+    AddBatch(10);
+    HOST_TEST_ASSERT(OpenEnumerator(&enumerator, -1));
+    HOST_TEST_ASSERT(ItemStore_Count(&enumerator) ==
+                     (int32_t)(nrOfItems + 10));
+    HOST_TEST_ASSERT(NextValue(&enumerator) == _nextValue - 1);
+    ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+  }
+}
+
+static void Reset(bool isFlashErased) {
+  if (isFlashErased) {
+    RamBackend_Reset();
+    _nextValue = 0;
+  }
+  ItemStore_Init();
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+}
+
+static void AddItems(uint32_t nrOfItems) {
+  while (nrOfItems > 0) {
+    uint16_t batchSize = nrOfItems < BATCH_SIZE ? nrOfItems : BATCH_SIZE;
+    AddBatch(batchSize);
+    nrOfItems -= batchSize;
+  }
+}
+
+static void AddBatch(uint16_t nrOfItems) {
+  HOST_TEST_ASSERT(nrOfItems <= LARGE_BATCH_SIZE);
+  for (uint16_t i = 0; i < nrOfItems; i++) {
+    _batchItems[i].data[0] = _nextValue;
+    _batchItems[i].data[1] = ~_nextValue;
+    _nextValue++;
+  }
+  _batch.nrOfItems = nrOfItems;
+  uint32_t nrOfCompletedBatches = _nrOfCompletedBatches;
+  ItemStore_AddItems(ITEM_STORE, &_batch);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  HOST_TEST_ASSERT(_nrOfCompletedBatches == nrOfCompletedBatches + 1);
+}
+
+static bool OpenEnumerator(ItemStore_Enumerator_t* enumerator,
+                           int32_t startIndex) {
+  uint32_t nrOfEnumeratorCbs = _nrOfEnumeratorCbs;
+  enumerator->startIndex = startIndex;
+  ItemStore_BeginEnumerate(ITEM_STORE, enumerator, EnumeratorStatusCb);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  HOST_TEST_ASSERT(_nrOfEnumeratorCbs == nrOfEnumeratorCbs + 1);
+  return _isEnumeratorReady;
+}
+
+static void StartDelete() {
+  ItemStore_DeleteAllItems(ITEM_STORE);
+  HOST_TEST_ASSERT(HostTest_DispatchMessage(ItemStore_ListenerInstance()));
+  HOST_TEST_ASSERT(HostTest_PendingMessages() == 0);
+}
+
+static void WriteLegacyPage(uint8_t pageNr,
+                            uint8_t blockId,
+                            uint8_t nrOfItems,
+                            uint8_t firstValue) {
+  uint8_t* page = RamBackend_Page(pageNr);
+  const uint8_t header[PAGE_HEADER_SIZE / 2] = {
+      0x5A,
+      0xC3,
+      LEGACY_ERASE_COUNT & 0xFF,
+      LEGACY_ERASE_COUNT >> 8,
+      pageNr,
+      blockId,
+      ITEM_DEF_SYSTEM_CONFIG,
+      sizeof(ItemStore_SystemConfig_t)};
+  memcpy(page, header, sizeof header);
+  uint8_t* item = page + PAGE_HEADER_SIZE;
+  for (uint8_t i = 0; i < nrOfItems; i++) {
+    memset(item, 0, sizeof(ItemStore_SystemConfig_t));
+    item[0] = firstValue + i;
+    item += sizeof(ItemStore_SystemConfig_t);
+  }
+}
+
+static void MarkLegacyPages() {
+  // the begin tag starts with the magic and the erase count; the item id
+  // follows the page id and the block id.
+  for (uint16_t i = 0; i <= LAST_WRITABLE_FLASH_PAGE; i++) {
+    uint8_t* page = RamBackend_Page(i);
+    if (page[0] == 0x5A && page[1] == 0xC3 && page[6] == ITEM_STORE) {
+      page[2] = LEGACY_ERASE_COUNT & 0xFF;
+      page[3] = LEGACY_ERASE_COUNT >> 8;
+    }
+  }
+}
+
+static uint32_t LegacyValue(uint32_t nrOfNewerItems) {
+  ItemStore_MeasurementSample_t item = {0};
+  HOST_TEST_ASSERT(ItemStore_ReadLegacyLogItem(ITEM_STORE, nrOfNewerItems,
+                                               &item, sizeof item));
+  HOST_TEST_ASSERT(item.data[1] == ~item.data[0]);
+  return item.data[0];
+}
+
+static void AddRecord(uint8_t value) {
+  ItemStore_SettingsRecord_t record;
+  memset(&record, value, sizeof record);
+  record.tag = 0;
+  ItemStore_AddItem(ITEM_DEF_SYSTEM_CONFIG, (ItemStore_ItemStruct_t*)&record);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+}
+
+static int32_t NrOfRecords() {
+  ItemStore_Enumerator_t enumerator = {0};
+  uint32_t nrOfEnumeratorCbs = _nrOfEnumeratorCbs;
+  ItemStore_BeginEnumerate(ITEM_DEF_SYSTEM_CONFIG, &enumerator,
+                           EnumeratorStatusCb);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  HOST_TEST_ASSERT(_nrOfEnumeratorCbs == nrOfEnumeratorCbs + 1);
+  HOST_TEST_ASSERT(_isEnumeratorReady);
+  int32_t nrOfRecords = ItemStore_Count(&enumerator);
+  ItemStore_EndEnumerate(&enumerator, ITEM_DEF_SYSTEM_CONFIG);
+  return nrOfRecords;
+}
+
+static void ReadRecord(int32_t startIndex, ItemStore_SettingsRecord_t* record) {
+  ItemStore_Enumerator_t enumerator = {0};
+  uint32_t nrOfEnumeratorCbs = _nrOfEnumeratorCbs;
+  enumerator.startIndex = startIndex;
+  ItemStore_BeginEnumerate(ITEM_DEF_SYSTEM_CONFIG, &enumerator,
+                           EnumeratorStatusCb);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  HOST_TEST_ASSERT(_nrOfEnumeratorCbs == nrOfEnumeratorCbs + 1);
+  HOST_TEST_ASSERT(_isEnumeratorReady);
+  HOST_TEST_ASSERT(
+      ItemStore_GetNext(&enumerator, (ItemStore_ItemStruct_t*)record));
+  ItemStore_EndEnumerate(&enumerator, ITEM_DEF_SYSTEM_CONFIG);
+}
+
+static uint32_t NextValue(ItemStore_Enumerator_t* enumerator) {
+  ItemStore_ItemStruct_t item;
+  HOST_TEST_ASSERT(ItemStore_GetNext(enumerator, &item));
+  HOST_TEST_ASSERT(item.measurement.data[1] == ~item.measurement.data[0]);
+  return item.measurement.data[0];
+}
+
+static bool KeyOfItem(const ItemStore_ItemStruct_t* item, uint32_t* key) {
+  uint32_t value = item->measurement.data[0];
+  if (value % 7 != 3) {
+    return false;
+  }
+  *key = value / 7;
+  return true;
+}
+
+static uint8_t NrOfPages() {
+  ItemStore_WearStats_t stats;
+  ItemStore_GetWearStats(ITEM_STORE, &stats);
+  return stats.nrOfPages;
+}
+
+static uint8_t FirstPage() {
+  return LAST_WRITABLE_FLASH_PAGE + 1 - NrOfPages();
+}
+
+static void BatchDoneCb(bool success) {
+  HOST_TEST_ASSERT(success);
+  _nrOfCompletedBatches++;
+}
+
+static void EnumeratorStatusCb(ItemStore_Enumerator_t* enumerator,
+                               bool ready) {
+  _isEnumeratorReady = ready;
+  _nrOfEnumeratorCbs++;
+}
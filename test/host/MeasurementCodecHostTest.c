@@ -0,0 +1,263 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file MeasurementCodecHostTest.c
+///
+/// Host tests of the delta compression of the measurement log.
+
+#include "HostTest.h"
+#include "app_service/item_store/MeasurementCodec.h"
+
+#include <string.h>
+
+/// Maximal number of samples of a test sequence
+#define MAX_NR_OF_SAMPLES 2048
+
+/// Encode a sequence of samples and check that the completed items decode
+/// to the same samples.
+/// @param samples The samples to be encoded
+/// @param nrOfSamples Number of samples
+/// @return Number of completed items
+static uint32_t CheckRoundTrip(const ItemStore_Sample_t* samples,
+                               uint32_t nrOfSamples);
+
+/// Fill a sequence whose consecutive samples differ by a fixed delta
+/// @param delta Difference between two consecutive samples
+/// @param nrOfSamples Number of samples
+static void FillConstantDelta(int32_t delta, uint32_t nrOfSamples);
+
+/// Get a pseudo random number
+/// @return The next number of the sequence
+static uint32_t Random();
+
+/// Samples with equal deltas are packed with the smallest possible width
+static void TestDeltaWidths();
+
+/// Deltas that do not fit into 13 bits start a new item
+static void TestLargeDeltas();
+
+/// Random walks of different step sizes survive the round trip
+static void TestRandomWalk();
+
+/// Anchors are recognized and are not decoded as samples
+static void TestAnchor();
+
+/// Segments are told apart from anchors and are not decoded as samples
+static void TestSegment();
+
+/// Erased flash and malformed items are not decoded
+static void TestInvalidItems();
+
+/// The samples of a test sequence
+static ItemStore_Sample_t _samples[MAX_NR_OF_SAMPLES];
+
+/// State of the pseudo random number generator
+static uint32_t _randomState = 1;
+
+int main() {
+  HOST_TEST_RUN(TestDeltaWidths);
+  HOST_TEST_RUN(TestLargeDeltas);
+  HOST_TEST_RUN(TestRandomWalk);
+  HOST_TEST_RUN(TestAnchor);
+  HOST_TEST_RUN(TestSegment);
+  HOST_TEST_RUN(TestInvalidItems);
+  return 0;
+}
+
+static void TestDeltaWidths() {
+  // smallest delta of each width and the resulting samples per item
+  const int32_t deltas[] = {0, -2, 1, -4, 3, -8, 7, -32, 31, -4096, 4095};
+  const uint8_t samplesPerItem[] = {7, 7, 7, 5, 5, 4, 4, 3, 3, 2, 2};
+  for (uint8_t i = 0; i < sizeof deltas / sizeof deltas[0]; i++) {
+    uint32_t nrOfSamples = 10 * samplesPerItem[i];
+    FillConstantDelta(deltas[i], nrOfSamples);
+    HOST_TEST_ASSERT(CheckRoundTrip(_samples, nrOfSamples) == 10);
+  }
+}
+
+static void TestLargeDeltas() {
+  const int32_t deltas[] = {-4097, 4096, 30000, -30000};
+  for (uint8_t i = 0; i < sizeof deltas / sizeof deltas[0]; i++) {
+    FillConstantDelta(deltas[i], 20);
+    // every item holds a single sample
+    HOST_TEST_ASSERT(CheckRoundTrip(_samples, 20) == 19);
+  }
+  // the ticks wrap around at the limits of the 16 bit range; a lone sample
+  // of zero ticks would be taken for a torn item
+  const ItemStore_Sample_t extremes[] = {
+      {0, 1}, {0xFFFF, 0xFFFF}, {0, 0xFFFF}, {0xFFFF, 0}, {1, 0xFFFE}};
+  CheckRoundTrip(extremes, sizeof extremes / sizeof extremes[0]);
+}
+
+static void TestRandomWalk() {
+  const uint16_t stepSizes[] = {1, 3, 15, 63, 511, 8191, 65535};
+  for (uint8_t i = 0; i < sizeof stepSizes / sizeof stepSizes[0]; i++) {
+    ItemStore_Sample_t sample = {.temperatureTicks = 0x6000,
+                                 .humidityTicks = 0x8000};
+    for (uint32_t j = 0; j < MAX_NR_OF_SAMPLES; j++) {
+      sample.temperatureTicks +=
+          (uint16_t)(Random() % (2u * stepSizes[i] + 1) - stepSizes[i]);
+      sample.humidityTicks +=
+          (uint16_t)(Random() % (2u * stepSizes[i] + 1) - stepSizes[i]);
+      _samples[j] = sample;
+    }
+    CheckRoundTrip(_samples, MAX_NR_OF_SAMPLES);
+  }
+}
+
+static void TestAnchor() {
+  const MeasurementCodec_Anchor_t anchors[] = {
+      {.timeS = 0, .ordinal = 0},
+      {.timeS = 0xFFFFFFFF, .ordinal = MEASUREMENT_CODEC_ORDINAL_MASK},
+      {.timeS = 86400, .ordinal = 123456}};
+  for (uint8_t i = 0; i < sizeof anchors / sizeof anchors[0]; i++) {
+    ItemStore_MeasurementSample_t item;
+    MeasurementCodec_EncodeAnchor(&anchors[i], &item);
+    MeasurementCodec_Anchor_t anchor;
+    HOST_TEST_ASSERT(MeasurementCodec_DecodeAnchor(&item, &anchor));
+    HOST_TEST_ASSERT(anchor.timeS == anchors[i].timeS);
+    HOST_TEST_ASSERT(anchor.ordinal == anchors[i].ordinal);
+    ItemStore_Sample_t samples[MEASUREMENT_CODEC_MAX_SAMPLES_PER_ITEM];
+    HOST_TEST_ASSERT(MeasurementCodec_NrOfSamples(&item) == 0);
+    HOST_TEST_ASSERT(MeasurementCodec_DecodeItem(&item, samples) == 0);
+  }
+  // the ordinal is truncated to the bits of the anchor
+  MeasurementCodec_Anchor_t anchor = {.timeS = 1, .ordinal = 0xFFFFFFFF};
+  ItemStore_MeasurementSample_t item;
+  MeasurementCodec_EncodeAnchor(&anchor, &item);
+  HOST_TEST_ASSERT(MeasurementCodec_DecodeAnchor(&item, &anchor));
+  HOST_TEST_ASSERT(anchor.ordinal == MEASUREMENT_CODEC_ORDINAL_MASK);
+  // a sample item is not an anchor
+  MeasurementCodec_Encoder_t encoder;
+  MeasurementCodec_InitEncoder(&encoder);
+  ItemStore_Sample_t sample = {100, 200};
+  HOST_TEST_ASSERT(!MeasurementCodec_AddSample(&encoder, &sample, &item));
+  sample.temperatureTicks = 30000;
+  HOST_TEST_ASSERT(MeasurementCodec_AddSample(&encoder, &sample, &item));
+  HOST_TEST_ASSERT(!MeasurementCodec_DecodeAnchor(&item, &anchor));
+}
+
+static void TestSegment() {
+  const MeasurementCodec_Segment_t segments[] = {
+      {.intervalS = 10, .firstOrdinal = 0},
+      {.intervalS = 0xFFFFFFFF, .firstOrdinal = MEASUREMENT_CODEC_ORDINAL_MASK},
+      {.intervalS = 3600, .firstOrdinal = 98765}};
+  for (uint8_t i = 0; i < sizeof segments / sizeof segments[0]; i++) {
+    ItemStore_MeasurementSample_t item;
+    MeasurementCodec_EncodeSegment(&segments[i], &item);
+    MeasurementCodec_Segment_t segment;
+    HOST_TEST_ASSERT(MeasurementCodec_DecodeSegment(&item, &segment));
+    HOST_TEST_ASSERT(segment.intervalS == segments[i].intervalS);
+    HOST_TEST_ASSERT(segment.firstOrdinal == segments[i].firstOrdinal);
+    MeasurementCodec_Anchor_t anchor;
+    HOST_TEST_ASSERT(!MeasurementCodec_DecodeAnchor(&item, &anchor));
+    HOST_TEST_ASSERT(MeasurementCodec_NrOfSamples(&item) == 0);
+  }
+  // an anchor is not a segment
+  MeasurementCodec_Anchor_t anchor = {.timeS = 600, .ordinal = 10};
+  ItemStore_MeasurementSample_t item;
+  MeasurementCodec_EncodeAnchor(&anchor, &item);
+  MeasurementCodec_Segment_t segment;
+  HOST_TEST_ASSERT(!MeasurementCodec_DecodeSegment(&item, &segment));
+  memset(&item, 0xFF, sizeof item);
+  HOST_TEST_ASSERT(!MeasurementCodec_DecodeSegment(&item, &segment));
+}
+
+static void TestInvalidItems() {
+  ItemStore_Sample_t samples[MEASUREMENT_CODEC_MAX_SAMPLES_PER_ITEM];
+  ItemStore_MeasurementSample_t item;
+  MeasurementCodec_Anchor_t anchor;
+  memset(&item, 0xFF, sizeof item);
+  HOST_TEST_ASSERT(MeasurementCodec_NrOfSamples(&item) == 0);
+  HOST_TEST_ASSERT(MeasurementCodec_DecodeItem(&item, samples) == 0);
+  HOST_TEST_ASSERT(!MeasurementCodec_DecodeAnchor(&item, &anchor));
+  // width code 5 holds at most one delta
+  item.data[0] = 5 | (2 << 3);
+  item.data[1] = 0;
+  HOST_TEST_ASSERT(MeasurementCodec_NrOfSamples(&item) == 0);
+  // width code 0 holds a single sample
+  item.data[0] = 0 | (1 << 3);
+  HOST_TEST_ASSERT(MeasurementCodec_NrOfSamples(&item) == 0);
+  // a torn item is cleared to zero by the item store
+  item.data[0] = 0;
+  HOST_TEST_ASSERT(MeasurementCodec_NrOfSamples(&item) == 0);
+  HOST_TEST_ASSERT(MeasurementCodec_DecodeItem(&item, samples) == 0);
+}
+
+static uint32_t CheckRoundTrip(const ItemStore_Sample_t* samples,
+                               uint32_t nrOfSamples) {
+  MeasurementCodec_Encoder_t encoder;
+  MeasurementCodec_InitEncoder(&encoder);
+  uint32_t nrOfItems = 0;
+  uint32_t nrOfDecodedSamples = 0;
+  for (uint32_t i = 0; i < nrOfSamples; i++) {
+    ItemStore_MeasurementSample_t item;
+    if (!MeasurementCodec_AddSample(&encoder, &samples[i], &item)) {
+      continue;
+    }
+    nrOfItems++;
+    ItemStore_Sample_t decoded[MEASUREMENT_CODEC_MAX_SAMPLES_PER_ITEM];
+    uint8_t nrOfItemSamples = MeasurementCodec_DecodeItem(&item, decoded);
+    HOST_TEST_ASSERT(nrOfItemSamples > 0);
+    HOST_TEST_ASSERT(MeasurementCodec_NrOfSamples(&item) == nrOfItemSamples);
+    HOST_TEST_ASSERT(nrOfDecodedSamples + nrOfItemSamples <= i + 1);
+    for (uint8_t j = 0; j < nrOfItemSamples; j++) {
+      const ItemStore_Sample_t* expected = &samples[nrOfDecodedSamples + j];
+      HOST_TEST_ASSERT(decoded[j].temperatureTicks ==
+                       expected->temperatureTicks);
+      HOST_TEST_ASSERT(decoded[j].humidityTicks == expected->humidityTicks);
+    }
+    nrOfDecodedSamples += nrOfItemSamples;
+  }
+  HOST_TEST_ASSERT(nrOfDecodedSamples +
+                       MeasurementCodec_PendingSamples(&encoder) ==
+                   nrOfSamples);
+  return nrOfItems;
+}
+
+static void FillConstantDelta(int32_t delta, uint32_t nrOfSamples) {
+  ItemStore_Sample_t sample = {.temperatureTicks = 0x8000,
+                               .humidityTicks = 0x4000};
+  for (uint32_t i = 0; i < nrOfSamples; i++) {
+    _samples[i] = sample;
+    sample.temperatureTicks += (uint16_t)delta;
+    sample.humidityTicks += (uint16_t)delta;
+  }
+}
+
+static uint32_t Random() {
+  // xorshift32
+  _randomState ^= _randomState << 13;
+  _randomState ^= _randomState >> 17;
+  _randomState ^= _randomState << 5;
+  return _randomState;
+}
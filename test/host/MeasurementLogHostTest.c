@@ -0,0 +1,745 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file MeasurementLogHostTest.c
+///
+/// Host tests of the layout of the measurement log and the lookup of its
+/// samples.
+///
+/// The samples are written through a log writer into the measurement item
+/// store; its pages are kept in the RAM backend. A reset of the device is
+/// simulated by calling `ItemStore_Init()` again on the same memory.
+
+#include "HostTest.h"
+#include "RamBackend.h"
+#include "app_service/item_store/ItemStore.h"
+#include "app_service/item_store/MeasurementLog.h"
+
+#include <string.h>
+
+/// Item store that is tested
+#define ITEM_STORE ITEM_DEF_MEASUREMENT_SAMPLE
+
+/// Maximal number of samples that are logged by a test
+#define MAX_NR_OF_SAMPLES (1UL << 18)
+
+/// Number of samples that are logged between two checks of a wrapped log
+#define SAMPLES_PER_ROUND 20000
+
+/// Erase count that marks the pages of a firmware without erase counters
+#define LEGACY_ERASE_COUNT 0xA53C
+
+/// Simulate a reset of the device
+/// @param isFlashErased Flag to erase all pages before the reset
+static void Reset(bool isFlashErased);
+
+/// Continue the log after a reset as the measurement item controller does
+/// @param intervalS Logging interval after the reset
+/// @param [out] bounds Receives the bounds of the recovered log
+static void Recover(uint32_t intervalS, MeasurementLog_Bounds_t* bounds);
+
+/// Take the next sample and add it to the log writer
+/// @return Number of items that are ready to be written
+static uint8_t TakeSample();
+
+/// Write the ready items of the log writer and wait until they are written
+/// @param nrOfItems Number of ready items
+static void WriteItems(uint8_t nrOfItems);
+
+/// Log samples with the running logging interval
+/// @param nrOfSamples Number of samples
+static void LogSamples(uint32_t nrOfSamples);
+
+/// Open an enumerator of the log and evaluate the bounds of the log
+/// @param enumerator The enumerator to be opened
+/// @param [out] bounds Receives the bounds of the log
+static void OpenLog(ItemStore_Enumerator_t* enumerator,
+                    MeasurementLog_Bounds_t* bounds);
+
+/// Write items of two raw samples as firmware 1.0.0 did and mark their pages
+/// as legacy pages; the samples take the first ordinals.
+/// @param nrOfItems Number of items
+static void WriteLegacyLog(uint32_t nrOfItems);
+
+/// Select samples of the log
+/// @param enumerator A ready enumerator of the log
+/// @param bounds Bounds of the log
+/// @param request Selection criteria; the log time is set by the function
+/// @param [out] selection Receives the selection
+static void Select(ItemStore_Enumerator_t* enumerator,
+                   const MeasurementLog_Bounds_t* bounds,
+                   MeasurementLog_Request_t* request,
+                   MeasurementLog_Selection_t* selection);
+
+/// Read the selected samples and compare them with the logged samples
+/// @param enumerator A ready enumerator of the log
+/// @param selection The selected samples
+static void CheckSelection(ItemStore_Enumerator_t* enumerator,
+                           const MeasurementLog_Selection_t* selection);
+
+/// Get the sequence number of a sample of the running log
+/// @param ordinal Ordinal of the sample
+/// @return The sequence number
+static uint32_t SequenceNumber(uint32_t ordinal);
+
+/// Get the sample that is logged with an ordinal
+/// @param ordinal Ordinal of the sample
+/// @return The sample
+static ItemStore_Sample_t SampleOf(uint32_t ordinal);
+
+/// Get the ordinal of the oldest stored sample that is not older than a log
+/// time
+/// @param first Ordinal of the oldest stored sample
+/// @param end Ordinal following the newest stored sample
+/// @param timeS Log time in seconds
+/// @return The ordinal
+static uint32_t OrdinalAtTime(uint32_t first, uint32_t end, uint32_t timeS);
+
+/// Callback of the anchored batches
+/// @param success true if all items of the batch were written
+static void BatchDoneCb(bool success);
+
+/// Callback of the enumerators
+/// @param enumerator The enumerator that was opened
+/// @param ready true if the enumerator is ready to be used
+static void EnumeratorStatusCb(ItemStore_Enumerator_t* enumerator,
+                               bool ready);
+
+/// The log continues with the ordinal and the log time after a reset
+static void TestRecovery();
+
+/// Samples are selected by their age and by the ordinal of a resumed
+/// download
+static void TestSelectByAgeAndResume();
+
+/// A change of the logging interval starts a new segment; a download covers
+/// one segment only
+static void TestIntervalChange();
+
+/// A download that is interrupted by a disconnect or a reset resumes
+/// without a gap; a sequence number of an erased log is not resumed
+static void TestResumeAfterDisconnect();
+
+/// The epochs wrap around without giving the sequence number that stands
+/// for no sequence number
+static void TestEpochs();
+
+/// The samples before the oldest anchor of a wrapped log are available
+static void TestWrappedLog();
+
+/// An anchored batch that is cut by a power loss does not break the log
+static void TestPowerLossDuringBatch();
+
+/// The samples of a legacy log precede the samples of the first segment
+static void TestLegacyLog();
+
+/// Writer of the log
+static MeasurementLog_Writer_t _writer;
+
+/// Running logging interval
+static uint32_t _intervalS;
+
+/// Log time of the last sample
+static uint32_t _logTimeS;
+
+/// Log time of the samples by their ordinal
+static uint32_t _timeOfOrdinal[MAX_NR_OF_SAMPLES];
+
+/// Batch of a segment, an anchor and a data item
+static ItemStore_ItemBatch_t _batch = {
+    .items = _writer.items,
+    .nrOfItems = MEASUREMENT_LOG_ITEMS_PER_BATCH,
+    .onDoneCb = BatchDoneCb};
+
+/// Number of completed batches
+static uint32_t _nrOfCompletedBatches;
+
+/// Result of the last batch callback
+static bool _isBatchWritten;
+
+/// Result of the last enumerator callback
+static bool _isEnumeratorReady;
+
+int main() {
+  HOST_TEST_RUN(TestRecovery);
+  HOST_TEST_RUN(TestSelectByAgeAndResume);
+  HOST_TEST_RUN(TestIntervalChange);
+  HOST_TEST_RUN(TestResumeAfterDisconnect);
+  HOST_TEST_RUN(TestEpochs);
+  HOST_TEST_RUN(TestWrappedLog);
+  HOST_TEST_RUN(TestPowerLossDuringBatch);
+  HOST_TEST_RUN(TestLegacyLog);
+  return 0;
+}
+
+static void TestRecovery() {
+  Reset(true);
+  LogSamples(1000);
+  // the samples that are not yet in an item are lost with the reset
+  uint32_t endOrdinal = _writer.nextOrdinal -
+                        MeasurementCodec_PendingSamples(&_writer.encoder);
+  uint32_t endTimeS = _timeOfOrdinal[endOrdinal - 1] + _intervalS;
+  Reset(false);
+  MeasurementLog_Bounds_t bounds;
+  Recover(60, &bounds);
+  HOST_TEST_ASSERT(bounds.isAnchored);
+  HOST_TEST_ASSERT(bounds.firstOrdinal == 0);
+  HOST_TEST_ASSERT(bounds.endOrdinal == endOrdinal);
+  HOST_TEST_ASSERT(bounds.endTimeS == endTimeS);
+  HOST_TEST_ASSERT(_writer.nextOrdinal == endOrdinal);
+  HOST_TEST_ASSERT(_writer.segment.firstOrdinal == 0);
+  LogSamples(500);
+
+  ItemStore_Enumerator_t enumerator = {0};
+  OpenLog(&enumerator, &bounds);
+  HOST_TEST_ASSERT(bounds.firstOrdinal == 0);
+  MeasurementLog_Request_t request = {.maxNrOfSamples = MAX_NR_OF_SAMPLES};
+  MeasurementLog_Selection_t selection;
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == 0);
+  HOST_TEST_ASSERT(selection.nrOfSamples == bounds.endOrdinal);
+  HOST_TEST_ASSERT(selection.intervalS == 60);
+  HOST_TEST_ASSERT(selection.newestTimeS ==
+                   _timeOfOrdinal[bounds.endOrdinal - 1]);
+  CheckSelection(&enumerator, &selection);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestSelectByAgeAndResume() {
+  Reset(true);
+  MeasurementLog_InitWriter(&_writer, 10);
+  _intervalS = 10;
+  LogSamples(3000);
+  ItemStore_Enumerator_t enumerator = {0};
+  MeasurementLog_Bounds_t bounds;
+  OpenLog(&enumerator, &bounds);
+  uint32_t first = bounds.firstOrdinal;
+  uint32_t end = bounds.endOrdinal;
+  MeasurementLog_Selection_t selection;
+
+  // the age range is applied to the stored samples
+  const uint32_t ages[][2] = {
+      {0, 500}, {200, 0}, {200, 5000}, {15, 25}, {0, 40000}, {40000, 0}};
+  for (uint8_t i = 0; i < sizeof ages / sizeof ages[0]; i++) {
+    MeasurementLog_Request_t request = {.maxNrOfSamples = MAX_NR_OF_SAMPLES,
+                                        .minAgeS = ages[i][0],
+                                        .maxAgeS = ages[i][1]};
+    Select(&enumerator, &bounds, &request, &selection);
+    uint32_t expectedFirst = first;
+    uint32_t expectedEnd = end;
+    if (ages[i][1] != 0 && ages[i][1] < _logTimeS) {
+      expectedFirst = OrdinalAtTime(first, end, _logTimeS - ages[i][1]);
+    }
+    if (ages[i][0] != 0) {
+      expectedEnd = ages[i][0] < _logTimeS
+                        ? OrdinalAtTime(first, end, _logTimeS - ages[i][0] + 1)
+                        : first;
+    }
+    if (expectedEnd < expectedFirst) {
+      expectedEnd = expectedFirst;
+    }
+    HOST_TEST_ASSERT(selection.nrOfSamples == expectedEnd - expectedFirst);
+    if (selection.nrOfSamples > 0) {
+      HOST_TEST_ASSERT(selection.firstOrdinal == expectedFirst);
+      HOST_TEST_ASSERT(selection.newestTimeS ==
+                       _timeOfOrdinal[expectedEnd - 1]);
+      CheckSelection(&enumerator, &selection);
+    }
+  }
+
+  // a resumed download sends the oldest missing samples first
+  MeasurementLog_Request_t request = {
+      .maxNrOfSamples = 100, .isResumed = true,
+      .resumeSequenceNumber = SequenceNumber(700)};
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == 701);
+  HOST_TEST_ASSERT(selection.nrOfSamples == 100);
+  CheckSelection(&enumerator, &selection);
+
+  // a client that has all samples gets none
+  request.resumeSequenceNumber = SequenceNumber(end - 1);
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.nrOfSamples == 0);
+  HOST_TEST_ASSERT(selection.firstOrdinal == end);
+
+  // an ordinal beyond the log belongs to another log; the newest samples
+  // are sent
+  request.resumeSequenceNumber = SequenceNumber(end);
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == end - 100);
+  HOST_TEST_ASSERT(selection.nrOfSamples == 100);
+  CheckSelection(&enumerator, &selection);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestIntervalChange() {
+  Reset(true);
+  LogSamples(700);
+  MeasurementLog_StartSegment(&_writer, 10);
+  _intervalS = 10;
+  uint32_t secondSegment = _writer.nextOrdinal;
+  LogSamples(900);
+  // the third segment is started by a reset with another interval
+  Reset(false);
+  MeasurementLog_Bounds_t bounds;
+  Recover(30, &bounds);
+  uint32_t thirdSegment = bounds.endOrdinal;
+  HOST_TEST_ASSERT(_writer.segment.firstOrdinal == thirdSegment);
+  LogSamples(400);
+
+  ItemStore_Enumerator_t enumerator = {0};
+  OpenLog(&enumerator, &bounds);
+  HOST_TEST_ASSERT(bounds.firstOrdinal == 0);
+  MeasurementLog_Selection_t selection;
+  // the newest samples are taken from the newest segment only
+  MeasurementLog_Request_t request = {.maxNrOfSamples = MAX_NR_OF_SAMPLES};
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == thirdSegment);
+  HOST_TEST_ASSERT(selection.nrOfSamples == bounds.endOrdinal - thirdSegment);
+  HOST_TEST_ASSERT(selection.intervalS == 30);
+  CheckSelection(&enumerator, &selection);
+
+  // a resumed download continues segment by segment
+  const uint32_t segments[][2] = {
+      {0, 60}, {secondSegment, 10}, {thirdSegment, 30}};
+  request.isResumed = true;
+  uint32_t resumeOrdinal = 0;
+  uint8_t nrOfSegments = sizeof segments / sizeof segments[0];
+  for (uint8_t i = 0; i < nrOfSegments; i++) {
+    uint32_t segmentEnd =
+        i + 1 < nrOfSegments ? segments[i + 1][0] : bounds.endOrdinal;
+    request.resumeSequenceNumber = SequenceNumber(resumeOrdinal);
+    Select(&enumerator, &bounds, &request, &selection);
+    uint32_t first = MAX(segments[i][0], resumeOrdinal + 1);
+    HOST_TEST_ASSERT(selection.firstOrdinal == first);
+    HOST_TEST_ASSERT(selection.nrOfSamples == segmentEnd - first);
+    HOST_TEST_ASSERT(selection.intervalS == segments[i][1]);
+    HOST_TEST_ASSERT(selection.newestTimeS == _timeOfOrdinal[segmentEnd - 1]);
+    CheckSelection(&enumerator, &selection);
+    resumeOrdinal = segmentEnd - 1;
+  }
+
+  // the age range is applied across the segments
+  request.isResumed = false;
+  request.maxAgeS = _logTimeS - _timeOfOrdinal[secondSegment + 10];
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == thirdSegment);
+  request.minAgeS = _logTimeS - _timeOfOrdinal[thirdSegment - 1];
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == secondSegment + 10);
+  HOST_TEST_ASSERT(selection.nrOfSamples == thirdSegment - secondSegment - 10);
+  HOST_TEST_ASSERT(selection.intervalS == 10);
+  CheckSelection(&enumerator, &selection);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestResumeAfterDisconnect() {
+  Reset(true);
+  LogSamples(2000);
+  ItemStore_Enumerator_t enumerator = {0};
+  MeasurementLog_Bounds_t bounds;
+  OpenLog(&enumerator, &bounds);
+  MeasurementLog_Request_t request = {.maxNrOfSamples = 500};
+  MeasurementLog_Selection_t selection;
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.nrOfSamples == 500);
+  // the client disconnects after a part of the samples
+  selection.nrOfSamples = 120;
+  CheckSelection(&enumerator, &selection);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+  uint32_t clientSequenceNumber = selection.firstSequenceNumber + 119;
+  uint32_t clientOrdinal = selection.firstOrdinal + 119;
+  LogSamples(50);
+
+  // the download resumes after a reconnect, after a reset and after a
+  // power on reset alike since the log and its epoch are kept
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    OpenLog(&enumerator, &bounds);
+    request.isResumed = true;
+    request.resumeSequenceNumber = clientSequenceNumber;
+    request.maxNrOfSamples = 100;
+    Select(&enumerator, &bounds, &request, &selection);
+    HOST_TEST_ASSERT(selection.firstOrdinal == clientOrdinal + 1);
+    HOST_TEST_ASSERT(selection.firstSequenceNumber ==
+                     clientSequenceNumber + 1);
+    HOST_TEST_ASSERT(selection.nrOfSamples == 100);
+    CheckSelection(&enumerator, &selection);
+    ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+    clientSequenceNumber += selection.nrOfSamples;
+    clientOrdinal += selection.nrOfSamples;
+    Reset(false);
+    Recover(60, &bounds);
+    LogSamples(50);
+  }
+
+  // the ordinals of an erased log start over; the stale sequence number
+  // gets the newest samples instead of skipping samples
+  Reset(true);
+  LogSamples(clientOrdinal + 500);
+  OpenLog(&enumerator, &bounds);
+  HOST_TEST_ASSERT(bounds.endOrdinal > clientOrdinal + 100);
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal ==
+                   bounds.endOrdinal - request.maxNrOfSamples);
+  HOST_TEST_ASSERT(selection.firstSequenceNumber != clientSequenceNumber + 1);
+  CheckSelection(&enumerator, &selection);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestEpochs() {
+  uint8_t epoch = _writer.epoch;
+  for (uint8_t i = 0; i < 2 * MEASUREMENT_LOG_NR_OF_EPOCHS; i++) {
+    MeasurementLog_InitWriter(&_writer, 60);
+    HOST_TEST_ASSERT(_writer.epoch ==
+                     (epoch + i + 1) % MEASUREMENT_LOG_NR_OF_EPOCHS);
+    HOST_TEST_ASSERT(
+        MeasurementLog_SequenceNumber(_writer.epoch,
+                                      MEASUREMENT_CODEC_ORDINAL_MASK) !=
+        0xFFFFFFFFU);
+  }
+  // a log without anchors starts over with the next epoch
+  epoch = _writer.epoch;
+  MeasurementLog_Bounds_t bounds = {0};
+  MeasurementLog_ContinueWriter(&_writer, &bounds, 60);
+  HOST_TEST_ASSERT(_writer.epoch == epoch + 1);
+  HOST_TEST_ASSERT(_writer.nextOrdinal == 0);
+}
+
+static void TestWrappedLog() {
+  Reset(true);
+  ItemStore_Enumerator_t enumerator = {0};
+  MeasurementLog_Bounds_t bounds = {0};
+  // continue for a round after the oldest page was erased
+  uint8_t roundsAfterWrap = 0;
+  while (roundsAfterWrap < 2) {
+    HOST_TEST_ASSERT(_writer.nextOrdinal + SAMPLES_PER_ROUND <
+                     MAX_NR_OF_SAMPLES);
+    LogSamples(SAMPLES_PER_ROUND);
+    OpenLog(&enumerator, &bounds);
+    ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+    if (bounds.firstOrdinal > 0) {
+      roundsAfterWrap++;
+    }
+  }
+  Reset(false);
+  OpenLog(&enumerator, &bounds);
+  HOST_TEST_ASSERT(bounds.isAnchored);
+  HOST_TEST_ASSERT(bounds.unanchoredSamples > 0);
+  HOST_TEST_ASSERT(bounds.firstOrdinal ==
+                   bounds.first.anchor.ordinal - bounds.unanchoredSamples);
+  MeasurementLog_Request_t request = {.maxNrOfSamples = MAX_NR_OF_SAMPLES};
+  MeasurementLog_Selection_t selection;
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == bounds.firstOrdinal);
+  HOST_TEST_ASSERT(selection.nrOfSamples ==
+                   bounds.endOrdinal - bounds.firstOrdinal);
+  HOST_TEST_ASSERT(selection.startIndex == 0);
+  CheckSelection(&enumerator, &selection);
+
+  // a download that resumes before the oldest anchor
+  request.isResumed = true;
+  request.resumeSequenceNumber = SequenceNumber(bounds.firstOrdinal + 3);
+  request.maxNrOfSamples = bounds.unanchoredSamples;
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == bounds.firstOrdinal + 4);
+  HOST_TEST_ASSERT(selection.nrOfSamples == bounds.unanchoredSamples);
+  CheckSelection(&enumerator, &selection);
+
+  // the time of the oldest samples
+  request.isResumed = false;
+  request.maxNrOfSamples = MAX_NR_OF_SAMPLES;
+  request.maxAgeS = _logTimeS - _timeOfOrdinal[bounds.firstOrdinal + 2];
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == bounds.firstOrdinal + 2);
+  CheckSelection(&enumerator, &selection);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void TestPowerLossDuringBatch() {
+  // the segment, the anchor and the data item are cut in turn
+  for (uint8_t nrOfWrittenItems = 0;
+       nrOfWrittenItems < MEASUREMENT_LOG_ITEMS_PER_BATCH;
+       nrOfWrittenItems++) {
+    Reset(true);
+    LogSamples(1000);
+    uint8_t nrOfItems = 0;
+    while (nrOfItems < MEASUREMENT_LOG_ITEMS_PER_BATCH) {
+      nrOfItems = TakeSample();
+      if (nrOfItems < MEASUREMENT_LOG_ITEMS_PER_BATCH) {
+        WriteItems(nrOfItems);
+      }
+    }
+    // ordinal of the first sample of the batch
+    uint32_t batchOrdinal = _writer.nextOrdinal -
+                            MeasurementCodec_PendingSamples(&_writer.encoder) -
+                            MeasurementCodec_NrOfSamples(&_writer.items[2]);
+    // the reset follows the power loss before the batch is reported
+    RamBackend_CutPowerAfter(nrOfWrittenItems);
+    ItemStore_AddItems(ITEM_STORE, &_batch);
+    HostTest_DispatchMessages(ItemStore_ListenerInstance());
+    RamBackend_RestorePower();
+    Reset(false);
+    MeasurementLog_Bounds_t bounds;
+    Recover(60, &bounds);
+    // the samples of the cut batch are lost; their ordinals are reused
+    HOST_TEST_ASSERT(bounds.endOrdinal == batchOrdinal);
+    HOST_TEST_ASSERT(bounds.last.anchor.ordinal <= batchOrdinal);
+    LogSamples(1000);
+
+    ItemStore_Enumerator_t enumerator = {0};
+    OpenLog(&enumerator, &bounds);
+    MeasurementLog_Request_t request = {.maxNrOfSamples = MAX_NR_OF_SAMPLES};
+    MeasurementLog_Selection_t selection;
+    Select(&enumerator, &bounds, &request, &selection);
+    HOST_TEST_ASSERT(selection.firstOrdinal == 0);
+    HOST_TEST_ASSERT(selection.nrOfSamples == bounds.endOrdinal);
+    CheckSelection(&enumerator, &selection);
+    ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+  }
+}
+
+static void TestLegacyLog() {
+  Reset(true);
+  const uint32_t nrOfLegacyItems = 300;
+  const uint32_t legacySamples =
+      nrOfLegacyItems * MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM;
+  WriteLegacyLog(nrOfLegacyItems);
+  // a log without anchors starts after the legacy log
+  Reset(false);
+  MeasurementLog_InitWriter(&_writer, 60);
+  HOST_TEST_ASSERT(_writer.nextOrdinal == legacySamples);
+  _logTimeS = (legacySamples - 1) * _intervalS;
+  LogSamples(1000);
+
+  ItemStore_Enumerator_t enumerator = {0};
+  MeasurementLog_Bounds_t bounds;
+  OpenLog(&enumerator, &bounds);
+  HOST_TEST_ASSERT(bounds.isAnchored);
+  HOST_TEST_ASSERT(bounds.legacySamples == legacySamples);
+  HOST_TEST_ASSERT(bounds.unanchoredSamples == legacySamples);
+  HOST_TEST_ASSERT(bounds.firstOrdinal == 0);
+  MeasurementLog_Request_t request = {.maxNrOfSamples = MAX_NR_OF_SAMPLES};
+  MeasurementLog_Selection_t selection;
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == 0);
+  HOST_TEST_ASSERT(selection.nrOfSamples == bounds.endOrdinal);
+  HOST_TEST_ASSERT(selection.legacyItemsToRead == nrOfLegacyItems);
+  HOST_TEST_ASSERT(selection.samplesToSkip == 0);
+  CheckSelection(&enumerator, &selection);
+
+  // a download that resumes within the legacy log
+  request.isResumed = true;
+  request.resumeSequenceNumber = SequenceNumber(4);
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == 5);
+  HOST_TEST_ASSERT(selection.legacyItemsToRead == nrOfLegacyItems - 2);
+  HOST_TEST_ASSERT(selection.samplesToSkip == 1);
+  CheckSelection(&enumerator, &selection);
+
+  // and after it
+  request.resumeSequenceNumber = SequenceNumber(legacySamples + 6);
+  Select(&enumerator, &bounds, &request, &selection);
+  HOST_TEST_ASSERT(selection.firstOrdinal == legacySamples + 7);
+  HOST_TEST_ASSERT(selection.legacyItemsToRead == 0);
+  CheckSelection(&enumerator, &selection);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+}
+
+static void Reset(bool isFlashErased) {
+  if (isFlashErased) {
+    RamBackend_Reset();
+    MeasurementLog_InitWriter(&_writer, 60);
+    _intervalS = 60;
+    _logTimeS = 0;
+  } else {
+    // only the epoch is kept in the settings
+    uint8_t epoch = _writer.epoch;
+    memset(&_writer, 0, sizeof _writer);
+    _writer.epoch = epoch;
+  }
+  ItemStore_Init();
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+}
+
+static void Recover(uint32_t intervalS, MeasurementLog_Bounds_t* bounds) {
+  ItemStore_Enumerator_t enumerator = {0};
+  OpenLog(&enumerator, bounds);
+  ItemStore_EndEnumerate(&enumerator, ITEM_STORE);
+  MeasurementLog_ContinueWriter(&_writer, bounds, intervalS);
+  _intervalS = intervalS;
+  // the next sample is logged when the interval has elapsed
+  _logTimeS = bounds->endTimeS - intervalS;
+}
+
+static uint8_t TakeSample() {
+  HOST_TEST_ASSERT(_writer.nextOrdinal < MAX_NR_OF_SAMPLES);
+  _logTimeS += _intervalS;
+  _timeOfOrdinal[_writer.nextOrdinal] = _logTimeS;
+  ItemStore_Sample_t sample = SampleOf(_writer.nextOrdinal);
+  return MeasurementLog_AddSample(&_writer, &sample, _logTimeS);
+}
+
+static void WriteItems(uint8_t nrOfItems) {
+  if (nrOfItems == MEASUREMENT_LOG_ITEMS_PER_BATCH) {
+    uint32_t nrOfCompletedBatches = _nrOfCompletedBatches;
+    ItemStore_AddItems(ITEM_STORE, &_batch);
+    HostTest_DispatchMessages(ItemStore_ListenerInstance());
+    HOST_TEST_ASSERT(_nrOfCompletedBatches == nrOfCompletedBatches + 1);
+  } else if (nrOfItems == 1) {
+    ItemStore_AddItem(ITEM_STORE, (ItemStore_ItemStruct_t*)&_writer.items[2]);
+    HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  }
+}
+
+static void LogSamples(uint32_t nrOfSamples) {
+  for (uint32_t i = 0; i < nrOfSamples; i++) {
+    uint8_t nrOfItems = TakeSample();
+    WriteItems(nrOfItems);
+    HOST_TEST_ASSERT(nrOfItems < MEASUREMENT_LOG_ITEMS_PER_BATCH ||
+                     _isBatchWritten);
+  }
+}
+
+static void OpenLog(ItemStore_Enumerator_t* enumerator,
+                    MeasurementLog_Bounds_t* bounds) {
+  enumerator->startIndex = 0;
+  _isEnumeratorReady = false;
+  ItemStore_BeginEnumerate(ITEM_STORE, enumerator, EnumeratorStatusCb);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  HOST_TEST_ASSERT(_isEnumeratorReady);
+  MeasurementLog_ScanBounds(enumerator, bounds);
+}
+
+static void WriteLegacyLog(uint32_t nrOfItems) {
+  for (uint32_t i = 0; i < nrOfItems; i++) {
+    ItemStore_MeasurementSample_t item;
+    for (uint8_t j = 0; j < MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM; j++) {
+      ItemStore_Sample_t sample =
+          SampleOf(i * MEASUREMENT_CODEC_LEGACY_SAMPLES_PER_ITEM + j);
+      item.data[j] =
+          sample.temperatureTicks | (uint32_t)sample.humidityTicks << 16;
+    }
+    ItemStore_AddItem(ITEM_STORE, (ItemStore_ItemStruct_t*)&item);
+    HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  }
+  // the begin tag starts with the magic and the erase count; the item id
+  // follows the page id and the block id.
+  for (uint16_t i = 0; i <= LAST_WRITABLE_FLASH_PAGE; i++) {
+    uint8_t* page = RamBackend_Page(i);
+    if (page[0] == 0x5A && page[1] == 0xC3 && page[6] == ITEM_STORE) {
+      page[2] = LEGACY_ERASE_COUNT & 0xFF;
+      page[3] = LEGACY_ERASE_COUNT >> 8;
+    }
+  }
+}
+
+static void Select(ItemStore_Enumerator_t* enumerator,
+                   const MeasurementLog_Bounds_t* bounds,
+                   MeasurementLog_Request_t* request,
+                   MeasurementLog_Selection_t* selection) {
+  request->nowS = _logTimeS;
+  request->epoch = _writer.epoch;
+  MeasurementLog_Select(enumerator, bounds, request, selection);
+  HOST_TEST_ASSERT(selection->firstSequenceNumber ==
+                   SequenceNumber(selection->firstOrdinal));
+  HOST_TEST_ASSERT(selection->nrOfSamples <= request->maxNrOfSamples);
+  HOST_TEST_ASSERT(selection->firstOrdinal >= bounds->firstOrdinal);
+  HOST_TEST_ASSERT(selection->firstOrdinal + selection->nrOfSamples <=
+                   bounds->endOrdinal);
+}
+
+static void CheckSelection(ItemStore_Enumerator_t* enumerator,
+                           const MeasurementLog_Selection_t* selection) {
+  HOST_TEST_ASSERT(ItemStore_Seek(enumerator, selection->startIndex));
+  uint32_t samplesToSkip = selection->samplesToSkip;
+  uint32_t legacyItemsToRead = selection->legacyItemsToRead;
+  uint32_t ordinal = selection->firstOrdinal;
+  uint32_t endOrdinal = ordinal + selection->nrOfSamples;
+  while (ordinal < endOrdinal) {
+    ItemStore_MeasurementSample_t item;
+    ItemStore_Sample_t samples[MEASUREMENT_CODEC_MAX_SAMPLES_PER_ITEM];
+    uint8_t nrOfSamples;
+    // the legacy items are read from the oldest to the newest one
+    if (legacyItemsToRead > 0) {
+      legacyItemsToRead--;
+      HOST_TEST_ASSERT(ItemStore_ReadLegacyLogItem(ITEM_STORE,
+                                                   legacyItemsToRead, &item,
+                                                   sizeof item));
+      nrOfSamples = MeasurementCodec_DecodeLegacyItem(&item, samples);
+    } else {
+      HOST_TEST_ASSERT(
+          ItemStore_GetNext(enumerator, (ItemStore_ItemStruct_t*)&item));
+      nrOfSamples = MeasurementCodec_DecodeItem(&item, samples);
+    }
+    for (uint8_t i = 0; i < nrOfSamples && ordinal < endOrdinal; i++) {
+      if (samplesToSkip > 0) {
+        samplesToSkip--;
+        continue;
+      }
+      ItemStore_Sample_t expected = SampleOf(ordinal);
+      HOST_TEST_ASSERT(samples[i].temperatureTicks ==
+                       expected.temperatureTicks);
+      HOST_TEST_ASSERT(samples[i].humidityTicks == expected.humidityTicks);
+      ordinal++;
+    }
+  }
+}
+
+static uint32_t SequenceNumber(uint32_t ordinal) {
+  return MeasurementLog_SequenceNumber(_writer.epoch, ordinal);
+}
+
+static ItemStore_Sample_t SampleOf(uint32_t ordinal) {
+  // varying deltas give items with different numbers of samples
+  ItemStore_Sample_t sample = {
+      .temperatureTicks = 20000 + (ordinal * 37) % 101 * (ordinal % 5),
+      .humidityTicks = 30000 + (ordinal * 13) % 29};
+  return sample;
+}
+
+static uint32_t OrdinalAtTime(uint32_t first, uint32_t end, uint32_t timeS) {
+  uint32_t ordinal = first;
+  while (ordinal < end && _timeOfOrdinal[ordinal] < timeS) {
+    ordinal++;
+  }
+  return ordinal;
+}
+
+static void BatchDoneCb(bool success) {
+  _isBatchWritten = success;
+  _nrOfCompletedBatches++;
+}
+
+static void EnumeratorStatusCb(ItemStore_Enumerator_t* enumerator,
+                               bool ready) {
+  _isEnumeratorReady = ready;
+}
@@ -0,0 +1,266 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file MeasurementSummaryHostTest.c
+///
+/// Host tests of the aggregation of the logged samples into hourly and
+/// daily summaries.
+
+#include "HostTest.h"
+#include "app_service/item_store/MeasurementSummary.h"
+
+#include <string.h>
+
+/// Number of seconds of a day
+#define DAY_S (MEASUREMENT_SUMMARY_HOURS_PER_DAY * MEASUREMENT_SUMMARY_HOUR_S)
+
+/// Add a sample and return the completed tiers
+/// @param temperatureTicks Temperature ticks of the sample
+/// @param humidityTicks Humidity ticks of the sample
+/// @param durationS Logging interval of the sample
+/// @return Bit mask of the completed tiers
+static uint8_t AddSample(uint16_t temperatureTicks,
+                         uint16_t humidityTicks,
+                         uint32_t durationS);
+
+/// Check the content of a summary
+/// @param record The summary
+/// @param minimum Expected minimal ticks; temperature and humidity
+/// @param maximum Expected maximal ticks; temperature and humidity
+/// @param mean Expected mean ticks; temperature and humidity
+/// @param nrOfSamples Expected number of summarized samples
+static void CheckRecord(const ItemStore_SummaryRecord_t* record,
+                        const uint16_t minimum[2],
+                        const uint16_t maximum[2],
+                        const uint16_t mean[2],
+                        uint16_t nrOfSamples);
+
+/// An hourly summary holds minimum, maximum and rounded mean of its samples
+static void TestHourlySummary();
+
+/// The time a sample covers beyond the end of an hour counts for the next
+/// hour
+static void TestHourRollover();
+
+/// A daily summary is built from 24 hourly summaries
+static void TestDayRollover();
+
+/// A sample of an interval above one hour completes several hours
+static void TestLongInterval();
+
+/// Erased and empty summaries are not decoded
+static void TestDecodeRecord();
+
+/// The aggregator that is tested
+static MeasurementSummary_Aggregator_t _aggregator;
+
+/// Receives the completed summaries
+static ItemStore_SummaryRecord_t _records[MEASUREMENT_SUMMARY_NR_OF_TIERS];
+
+int main() {
+  HOST_TEST_RUN(TestHourlySummary);
+  HOST_TEST_RUN(TestHourRollover);
+  HOST_TEST_RUN(TestDayRollover);
+  HOST_TEST_RUN(TestLongInterval);
+  HOST_TEST_RUN(TestDecodeRecord);
+  return 0;
+}
+
+static void TestHourlySummary() {
+  MeasurementSummary_InitAggregator(&_aggregator);
+  // the temperature runs from 1000 to 1059 with a mean of 1029.5 that is
+  // rounded up; the humidity alternates between 500 and 2000.
+  for (uint16_t i = 0; i < 59; i++) {
+    HOST_TEST_ASSERT(AddSample(1000 + i, i % 2 ? 500 : 2000, 60) == 0);
+    HOST_TEST_ASSERT(MeasurementSummary_ElapsedS(
+                         &_aggregator, MEASUREMENT_SUMMARY_TIER_HOURLY) ==
+                     (i + 1) * 60U);
+  }
+  HOST_TEST_ASSERT(AddSample(1059, 500, 60) ==
+                   1U << MEASUREMENT_SUMMARY_TIER_HOURLY);
+  CheckRecord(&_records[MEASUREMENT_SUMMARY_TIER_HOURLY],
+              (const uint16_t[]){1000, 500}, (const uint16_t[]){1059, 2000},
+              (const uint16_t[]){1030, 1250}, 60);
+  HOST_TEST_ASSERT(MeasurementSummary_ElapsedS(
+                       &_aggregator, MEASUREMENT_SUMMARY_TIER_HOURLY) == 0);
+  HOST_TEST_ASSERT(MeasurementSummary_ElapsedS(
+                       &_aggregator, MEASUREMENT_SUMMARY_TIER_DAILY) ==
+                   MEASUREMENT_SUMMARY_HOUR_S);
+
+  // the next hour starts with the next sample
+  for (uint16_t i = 0; i < 59; i++) {
+    HOST_TEST_ASSERT(AddSample(3000, 3000, 60) == 0);
+  }
+  HOST_TEST_ASSERT(AddSample(3001, 2999, 60) ==
+                   1U << MEASUREMENT_SUMMARY_TIER_HOURLY);
+  CheckRecord(&_records[MEASUREMENT_SUMMARY_TIER_HOURLY],
+              (const uint16_t[]){3000, 2999}, (const uint16_t[]){3001, 3000},
+              (const uint16_t[]){3000, 3000}, 60);
+}
+
+static void TestHourRollover() {
+  MeasurementSummary_InitAggregator(&_aggregator);
+  // 3600 = 514 * 7 + 2; the 515th sample ends 5s after the hour
+  uint32_t nrOfSamples = 0;
+  while (AddSample(2000, 2000, 7) == 0) {
+    nrOfSamples++;
+  }
+  HOST_TEST_ASSERT(nrOfSamples == 514);
+  HOST_TEST_ASSERT(_records[MEASUREMENT_SUMMARY_TIER_HOURLY].nrOfSamples ==
+                   515);
+  HOST_TEST_ASSERT(MeasurementSummary_ElapsedS(
+                       &_aggregator, MEASUREMENT_SUMMARY_TIER_HOURLY) == 5);
+  // the next hour is complete one sample earlier
+  nrOfSamples = 0;
+  while (AddSample(2000, 2000, 7) == 0) {
+    nrOfSamples++;
+  }
+  HOST_TEST_ASSERT(nrOfSamples == 513);
+  HOST_TEST_ASSERT(MeasurementSummary_ElapsedS(
+                       &_aggregator, MEASUREMENT_SUMMARY_TIER_HOURLY) == 3);
+
+  // a change of the logging interval within an hour
+  MeasurementSummary_InitAggregator(&_aggregator);
+  for (uint8_t i = 0; i < 30; i++) {
+    HOST_TEST_ASSERT(AddSample(2000, 2000, 60) == 0);
+  }
+  for (uint16_t i = 0; i < 179; i++) {
+    HOST_TEST_ASSERT(AddSample(2000, 2000, 10) == 0);
+  }
+  HOST_TEST_ASSERT(AddSample(2000, 2000, 10) ==
+                   1U << MEASUREMENT_SUMMARY_TIER_HOURLY);
+  HOST_TEST_ASSERT(_records[MEASUREMENT_SUMMARY_TIER_HOURLY].nrOfSamples ==
+                   210);
+}
+
+static void TestDayRollover() {
+  MeasurementSummary_InitAggregator(&_aggregator);
+  // six samples per hour; the temperature tells the hour of the day
+  for (uint8_t hour = 0; hour < MEASUREMENT_SUMMARY_HOURS_PER_DAY; hour++) {
+    for (uint8_t i = 0; i < 5; i++) {
+      HOST_TEST_ASSERT(AddSample(1000 + hour, 40000 - hour, 600) == 0);
+    }
+    HOST_TEST_ASSERT(MeasurementSummary_ElapsedS(
+                         &_aggregator, MEASUREMENT_SUMMARY_TIER_DAILY) ==
+                     hour * MEASUREMENT_SUMMARY_HOUR_S + 3000U);
+    uint8_t completedTiers = AddSample(1000 + hour, 40000 - hour, 600);
+    if (hour + 1 < MEASUREMENT_SUMMARY_HOURS_PER_DAY) {
+      HOST_TEST_ASSERT(completedTiers == 1U << MEASUREMENT_SUMMARY_TIER_HOURLY);
+    } else {
+      HOST_TEST_ASSERT(completedTiers ==
+                       ((1U << MEASUREMENT_SUMMARY_TIER_HOURLY) |
+                        (1U << MEASUREMENT_SUMMARY_TIER_DAILY)));
+    }
+    CheckRecord(&_records[MEASUREMENT_SUMMARY_TIER_HOURLY],
+                (const uint16_t[]){1000 + hour, 40000 - hour},
+                (const uint16_t[]){1000 + hour, 40000 - hour},
+                (const uint16_t[]){1000 + hour, 40000 - hour}, 6);
+  }
+  // the mean of 1000 to 1023 is 1011.5 and 39988.5; both are rounded up
+  CheckRecord(&_records[MEASUREMENT_SUMMARY_TIER_DAILY],
+              (const uint16_t[]){1000, 39977}, (const uint16_t[]){1023, 40000},
+              (const uint16_t[]){1012, 39989}, 144);
+  HOST_TEST_ASSERT(MeasurementSummary_ElapsedS(
+                       &_aggregator, MEASUREMENT_SUMMARY_TIER_DAILY) == 0);
+  HOST_TEST_ASSERT(MeasurementSummary_PeriodS(MEASUREMENT_SUMMARY_TIER_DAILY) ==
+                   DAY_S);
+
+  // the largest ticks of a full day at the shortest interval do not
+  // overflow the sums
+  for (uint32_t elapsedS = 5; elapsedS < DAY_S; elapsedS += 5) {
+    AddSample(UINT16_MAX, UINT16_MAX, 5);
+  }
+  HOST_TEST_ASSERT(AddSample(UINT16_MAX, UINT16_MAX, 5) &
+                   (1U << MEASUREMENT_SUMMARY_TIER_DAILY));
+  CheckRecord(&_records[MEASUREMENT_SUMMARY_TIER_DAILY],
+              (const uint16_t[]){UINT16_MAX, UINT16_MAX},
+              (const uint16_t[]){UINT16_MAX, UINT16_MAX},
+              (const uint16_t[]){UINT16_MAX, UINT16_MAX}, DAY_S / 5);
+}
+
+static void TestLongInterval() {
+  MeasurementSummary_InitAggregator(&_aggregator);
+  // each sample of a two hour interval completes an hourly summary and
+  // accounts for two hours of the day
+  for (uint8_t i = 0; i < 11; i++) {
+    HOST_TEST_ASSERT(AddSample(1500, 1500, 2 * MEASUREMENT_SUMMARY_HOUR_S) ==
+                     1U << MEASUREMENT_SUMMARY_TIER_HOURLY);
+    HOST_TEST_ASSERT(_records[MEASUREMENT_SUMMARY_TIER_HOURLY].nrOfSamples ==
+                     1);
+  }
+  HOST_TEST_ASSERT(AddSample(1500, 1500, 2 * MEASUREMENT_SUMMARY_HOUR_S) ==
+                   ((1U << MEASUREMENT_SUMMARY_TIER_HOURLY) |
+                    (1U << MEASUREMENT_SUMMARY_TIER_DAILY)));
+  HOST_TEST_ASSERT(_records[MEASUREMENT_SUMMARY_TIER_DAILY].nrOfSamples == 12);
+}
+
+static void TestDecodeRecord() {
+  ItemStore_Sample_t samples[MEASUREMENT_SUMMARY_SAMPLES_PER_RECORD];
+  ItemStore_SummaryRecord_t record;
+  memset(&record, 0xFF, sizeof record);
+  HOST_TEST_ASSERT(MeasurementSummary_DecodeRecord(&record, samples) == 0);
+  memset(&record, 0, sizeof record);
+  HOST_TEST_ASSERT(MeasurementSummary_DecodeRecord(&record, samples) == 0);
+
+  MeasurementSummary_InitAggregator(&_aggregator);
+  AddSample(100, 200, MEASUREMENT_SUMMARY_HOUR_S);
+  HOST_TEST_ASSERT(MeasurementSummary_DecodeRecord(
+                       &_records[MEASUREMENT_SUMMARY_TIER_HOURLY], samples) ==
+                   MEASUREMENT_SUMMARY_SAMPLES_PER_RECORD);
+  for (uint8_t i = 0; i < MEASUREMENT_SUMMARY_SAMPLES_PER_RECORD; i++) {
+    HOST_TEST_ASSERT(samples[i].temperatureTicks == 100);
+    HOST_TEST_ASSERT(samples[i].humidityTicks == 200);
+  }
+}
+
+static uint8_t AddSample(uint16_t temperatureTicks,
+                         uint16_t humidityTicks,
+                         uint32_t durationS) {
+  ItemStore_Sample_t sample = {.temperatureTicks = temperatureTicks,
+                               .humidityTicks = humidityTicks};
+  return MeasurementSummary_AddSample(&_aggregator, &sample, durationS,
+                                      _records);
+}
+
+static void CheckRecord(const ItemStore_SummaryRecord_t* record,
+                        const uint16_t minimum[2],
+                        const uint16_t maximum[2],
+                        const uint16_t mean[2],
+                        uint16_t nrOfSamples) {
+  HOST_TEST_ASSERT(record->minimum.temperatureTicks == minimum[0]);
+  HOST_TEST_ASSERT(record->minimum.humidityTicks == minimum[1]);
+  HOST_TEST_ASSERT(record->maximum.temperatureTicks == maximum[0]);
+  HOST_TEST_ASSERT(record->maximum.humidityTicks == maximum[1]);
+  HOST_TEST_ASSERT(record->mean.temperatureTicks == mean[0]);
+  HOST_TEST_ASSERT(record->mean.humidityTicks == mean[1]);
+  HOST_TEST_ASSERT(record->nrOfSamples == nrOfSamples);
+}
@@ -0,0 +1,470 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file MessageBrokerHostTest.c
+///
+/// Host tests of the message broker: the dispatch to the subscribed
+/// listeners, the high priority lane, the coalescing of latest-wins messages
+/// and the statistics.
+///
+/// The broker task is registered in the replacement of the sequencer; the
+/// tests publish messages and run the scheduled tasks until no message is
+/// waiting. The listeners record the messages they receive.
+
+#include "HostTest.h"
+#include "stm32_seq.h"
+#include "utility/log/Trace.h"
+#include "utility/scheduler/MessageBroker.h"
+
+#include <string.h>
+
+/// Id of the broker task in the sequencer
+#define BROKER_TASK_ID 3
+
+/// Capacity of the queue of each lane; a queue holds one element less
+#define QUEUE_CAPACITY 16
+
+/// Number of test listeners
+#define NR_OF_LISTENERS 3
+
+/// Maximal number of recorded dispatches
+#define MAX_NR_OF_DISPATCHES 128
+
+/// Category of the normal lane
+#define NORMAL_CATEGORY MESSAGE_BROKER_CATEGORY_SENSOR_VALUE
+
+/// Category of the high priority lane
+#define PRIORITY_CATEGORY MESSAGE_BROKER_CATEGORY_BLE_EVENT
+
+/// Category whose messages are coalesced
+#define COALESCED_CATEGORY MESSAGE_BROKER_CATEGORY_TIME_INFORMATION
+
+/// A message as it was received by a listener
+typedef struct {
+  uint8_t listener;             ///< Index of the receiving listener
+  Message_Message_t message;  ///< The received message
+} Dispatch_t;
+
+/// Create the broker and the listeners; no listener is registered.
+/// @param weight Weight of the high priority lane
+static void Setup(uint8_t weight);
+
+/// Publish a message
+/// @param category Category of the message
+/// @param id Id of the message
+/// @param parameter2 Payload of the message
+static void Publish(uint16_t category, uint8_t id, uint32_t parameter2);
+
+/// Run the broker task until no message is waiting
+static void RunBroker();
+
+/// Task of the broker in the sequencer
+static void BrokerTask();
+
+/// Record a dispatched message
+/// @param listener Index of the receiving listener
+/// @param message The received message
+static void Record(uint8_t listener, const Message_Message_t* message);
+
+/// Message handlers of the listeners
+/// @param message The received message
+/// @return true as the message is consumed
+static bool Listener0Cb(Message_Message_t* message);
+static bool Listener1Cb(Message_Message_t* message);
+static bool Listener2Cb(Message_Message_t* message);
+
+/// Coalesce a message by adding its payload to the waiting message
+/// @param waitingMessage The waiting message
+/// @param message The published message
+static void SumCb(Message_Message_t* waitingMessage,
+                  const Message_Message_t* message);
+
+/// Profiling clock that advances by one tick per call
+/// @return The tick count
+static uint32_t ClockCb();
+
+/// Trace function that counts the written lines
+/// @param data The trace output
+/// @param length Number of bytes of the trace output
+static void CountLinesCb(const uint8_t* data, uint16_t length);
+
+/// A message reaches the subscribed listeners only; the listener that was
+/// registered last receives it first
+static void TestDispatchToSubscribers();
+
+/// Listeners may be unregistered and may drop a category while messages are
+/// dispatched
+static void TestUnsubscribe();
+
+/// A strict high priority lane is dispatched first; the order within a
+/// category is preserved
+static void TestStrictPriorityLane();
+
+/// A weighted high priority lane lets a normal message through after at most
+/// weight high priority messages, also if they are published continuously
+static void TestPriorityStarvationBound();
+
+/// Messages with the same id of a latest-wins category are coalesced
+static void TestCoalescing();
+
+/// A coalesce callback merges the payload of the coalesced messages
+static void TestCoalesceCallback();
+
+/// The statistics count the queue depth, the overflows, the dispatches and
+/// the handler calls
+static void TestStats();
+
+/// The broker under test
+static MessageBroker_Broker_t _broker;
+
+/// Storage of the normal lane
+static uint64_t _normalQueue[QUEUE_CAPACITY];
+
+/// Storage of the high priority lane
+static uint64_t _priorityQueue[QUEUE_CAPACITY];
+
+/// The test listeners
+static MessageListener_Listener_t _listeners[NR_OF_LISTENERS] = {
+    {.currentMessageHandlerCb = Listener0Cb},
+    {.currentMessageHandlerCb = Listener1Cb},
+    {.currentMessageHandlerCb = Listener2Cb}};
+
+/// The recorded dispatches
+static Dispatch_t _dispatches[MAX_NR_OF_DISPATCHES];
+
+/// Number of recorded dispatches
+static uint16_t _nrOfDispatches;
+
+/// Number of high priority messages that listener 0 publishes again when it
+/// receives one
+static uint16_t _nrOfRepublishes;
+
+/// Listener that listener 1 unregisters when it receives a message; 0 for
+/// none
+static MessageListener_Listener_t* _listenerToUnregister;
+
+/// Tick count of the profiling clock
+static uint32_t _ticks;
+
+/// Number of lines written to the trace
+static uint16_t _nrOfTraceLines;
+
+int main() {
+  UTIL_SEQ_RegTask(1UL << BROKER_TASK_ID, 0, BrokerTask);
+  HOST_TEST_RUN(TestDispatchToSubscribers);
+  HOST_TEST_RUN(TestUnsubscribe);
+  HOST_TEST_RUN(TestStrictPriorityLane);
+  HOST_TEST_RUN(TestPriorityStarvationBound);
+  HOST_TEST_RUN(TestCoalescing);
+  HOST_TEST_RUN(TestCoalesceCallback);
+  HOST_TEST_RUN(TestStats);
+  return 0;
+}
+
+static void TestDispatchToSubscribers() {
+  Setup(0);
+  _listeners[0].receiveMask = NORMAL_CATEGORY;
+  _listeners[1].receiveMask = NORMAL_CATEGORY | PRIORITY_CATEGORY;
+  _listeners[2].receiveMask = PRIORITY_CATEGORY;
+  for (uint8_t i = 0; i < NR_OF_LISTENERS; i++) {
+    MessageBroker_RegisterListener(&_broker, &_listeners[i]);
+  }
+  Publish(NORMAL_CATEGORY, 1, 10);
+  Publish(MESSAGE_BROKER_CATEGORY_TEST, 2, 20);
+  Publish(PRIORITY_CATEGORY, 3, 30);
+  RunBroker();
+  // the test category has no subscriber; the high priority message is
+  // dispatched first
+  HOST_TEST_ASSERT(_nrOfDispatches == 4);
+  HOST_TEST_ASSERT(_dispatches[0].listener == 2);
+  HOST_TEST_ASSERT(_dispatches[0].message.header.id == 3);
+  HOST_TEST_ASSERT(_dispatches[0].message.parameter2 == 30);
+  HOST_TEST_ASSERT(_dispatches[1].listener == 1);
+  HOST_TEST_ASSERT(_dispatches[1].message.header.id == 3);
+  HOST_TEST_ASSERT(_dispatches[2].listener == 1);
+  HOST_TEST_ASSERT(_dispatches[2].message.header.id == 1);
+  HOST_TEST_ASSERT(_dispatches[2].message.parameter2 == 10);
+  HOST_TEST_ASSERT(_dispatches[3].listener == 0);
+  HOST_TEST_ASSERT(_dispatches[3].message.header.id == 1);
+}
+
+static void TestUnsubscribe() {
+  Setup(0);
+  for (uint8_t i = 0; i < NR_OF_LISTENERS; i++) {
+    _listeners[i].receiveMask = NORMAL_CATEGORY;
+    MessageBroker_RegisterListener(&_broker, &_listeners[i]);
+  }
+  // listener 1 removes listener 0 before it gets the message
+  _listenerToUnregister = &_listeners[0];
+  _listeners[2].receiveMask = 0;
+  Publish(NORMAL_CATEGORY, 1, 0);
+  RunBroker();
+  HOST_TEST_ASSERT(_nrOfDispatches == 1);
+  HOST_TEST_ASSERT(_dispatches[0].listener == 1);
+  // a freed slot is taken by the next registered listener
+  _listenerToUnregister = 0;
+  _listeners[0].receiveMask = NORMAL_CATEGORY;
+  MessageBroker_RegisterListener(&_broker, &_listeners[0]);
+  _nrOfDispatches = 0;
+  Publish(NORMAL_CATEGORY, 2, 0);
+  RunBroker();
+  HOST_TEST_ASSERT(_nrOfDispatches == 2);
+  HOST_TEST_ASSERT(_dispatches[0].listener == 1);
+  HOST_TEST_ASSERT(_dispatches[1].listener == 0);
+}
+
+static void TestStrictPriorityLane() {
+  Setup(0);
+  _listeners[0].receiveMask = NORMAL_CATEGORY | PRIORITY_CATEGORY;
+  MessageBroker_RegisterListener(&_broker, &_listeners[0]);
+  for (uint8_t i = 0; i < 5; i++) {
+    Publish(NORMAL_CATEGORY, i, 0);
+    Publish(PRIORITY_CATEGORY, i, 0);
+  }
+  RunBroker();
+  HOST_TEST_ASSERT(_nrOfDispatches == 10);
+  for (uint8_t i = 0; i < 5; i++) {
+    HOST_TEST_ASSERT(_dispatches[i].message.header.category ==
+                     PRIORITY_CATEGORY);
+    HOST_TEST_ASSERT(_dispatches[i].message.header.id == i);
+    HOST_TEST_ASSERT(_dispatches[5 + i].message.header.category ==
+                     NORMAL_CATEGORY);
+    HOST_TEST_ASSERT(_dispatches[5 + i].message.header.id == i);
+  }
+}
+
+static void TestPriorityStarvationBound() {
+  const uint8_t weight = 3;
+  Setup(weight);
+  _listeners[0].receiveMask = NORMAL_CATEGORY | PRIORITY_CATEGORY;
+  MessageBroker_RegisterListener(&_broker, &_listeners[0]);
+  // each high priority message is published again while it is handled
+  _nrOfRepublishes = 60;
+  for (uint8_t i = 0; i < 10; i++) {
+    Publish(NORMAL_CATEGORY, i, 0);
+  }
+  Publish(PRIORITY_CATEGORY, 0, 0);
+  RunBroker();
+  HOST_TEST_ASSERT(_nrOfDispatches == 10 + 61);
+  uint8_t nrOfNormal = 0;
+  uint8_t burst = 0;
+  for (uint16_t i = 0; i < _nrOfDispatches; i++) {
+    if (_dispatches[i].message.header.category == NORMAL_CATEGORY) {
+      HOST_TEST_ASSERT(_dispatches[i].message.header.id == nrOfNormal);
+      nrOfNormal++;
+      burst = 0;
+    } else if (nrOfNormal < 10) {
+      // a normal message waits for at most weight high priority messages
+      burst++;
+      HOST_TEST_ASSERT(burst <= weight);
+    }
+  }
+  HOST_TEST_ASSERT(nrOfNormal == 10);
+}
+
+static void TestCoalescing() {
+  Setup(0);
+  MessageBroker_CoalesceCategory(&_broker, COALESCED_CATEGORY, 0);
+  _listeners[0].receiveMask = NORMAL_CATEGORY | COALESCED_CATEGORY;
+  MessageBroker_RegisterListener(&_broker, &_listeners[0]);
+  Publish(NORMAL_CATEGORY, 1, 0);
+  Publish(COALESCED_CATEGORY, 1, 1);
+  Publish(COALESCED_CATEGORY, 2, 1);
+  Publish(NORMAL_CATEGORY, 2, 0);
+  Publish(COALESCED_CATEGORY, 1, 2);
+  Publish(COALESCED_CATEGORY, 1, 3);
+  MessageBroker_Stats_t stats;
+  MessageBroker_GetStats(&_broker, &stats);
+  HOST_TEST_ASSERT(stats.lanes[MESSAGE_BROKER_LANE_NORMAL].depth == 4);
+  RunBroker();
+  // the coalesced message keeps its position with the latest content
+  HOST_TEST_ASSERT(_nrOfDispatches == 4);
+  HOST_TEST_ASSERT(_dispatches[0].message.header.category == NORMAL_CATEGORY);
+  HOST_TEST_ASSERT(_dispatches[1].message.header.id == 1);
+  HOST_TEST_ASSERT(_dispatches[1].message.parameter2 == 3);
+  HOST_TEST_ASSERT(_dispatches[2].message.header.id == 2);
+  HOST_TEST_ASSERT(_dispatches[2].message.parameter2 == 1);
+  HOST_TEST_ASSERT(_dispatches[3].message.header.category == NORMAL_CATEGORY);
+  // a message that is published after the dispatch is queued again
+  Publish(COALESCED_CATEGORY, 1, 4);
+  RunBroker();
+  HOST_TEST_ASSERT(_nrOfDispatches == 5);
+  HOST_TEST_ASSERT(_dispatches[4].message.parameter2 == 4);
+  // discarded messages free their slots
+  for (uint8_t i = 0; i < MESSAGE_BROKER_NR_OF_COALESCING_SLOTS; i++) {
+    Publish(COALESCED_CATEGORY, i, 0);
+  }
+  MessageBroker_DiscardMessages(&_broker);
+  for (uint8_t i = 0; i < MESSAGE_BROKER_NR_OF_COALESCING_SLOTS; i++) {
+    Publish(COALESCED_CATEGORY, 10 + i, 0);
+  }
+  RunBroker();
+  HOST_TEST_ASSERT(_nrOfDispatches ==
+                   5 + MESSAGE_BROKER_NR_OF_COALESCING_SLOTS);
+  HOST_TEST_ASSERT(_dispatches[5].message.header.id == 10);
+}
+
+static void TestCoalesceCallback() {
+  Setup(0);
+  MessageBroker_CoalesceCategory(&_broker, COALESCED_CATEGORY, SumCb);
+  _listeners[0].receiveMask = COALESCED_CATEGORY;
+  MessageBroker_RegisterListener(&_broker, &_listeners[0]);
+  for (uint32_t i = 1; i <= 10; i++) {
+    Publish(COALESCED_CATEGORY, 1, i);
+  }
+  RunBroker();
+  HOST_TEST_ASSERT(_nrOfDispatches == 1);
+  HOST_TEST_ASSERT(_dispatches[0].message.parameter2 == 55);
+}
+
+static void TestStats() {
+  Setup(0);
+  MessageBroker_SetProfilingClock(&_broker, ClockCb);
+  _listeners[0].receiveMask = NORMAL_CATEGORY;
+  _listeners[1].receiveMask = NORMAL_CATEGORY | PRIORITY_CATEGORY;
+  MessageBroker_RegisterListener(&_broker, &_listeners[0]);
+  MessageBroker_RegisterListener(&_broker, &_listeners[1]);
+  // one more message than the normal lane can take
+  for (uint8_t i = 0; i < QUEUE_CAPACITY; i++) {
+    Publish(NORMAL_CATEGORY, i, 0);
+  }
+  Publish(PRIORITY_CATEGORY, 0, 0);
+  Publish(PRIORITY_CATEGORY, 1, 0);
+  MessageBroker_Stats_t stats;
+  MessageBroker_GetStats(&_broker, &stats);
+  MessageBroker_LaneStats_t* normal = &stats.lanes[MESSAGE_BROKER_LANE_NORMAL];
+  MessageBroker_LaneStats_t* priority =
+      &stats.lanes[MESSAGE_BROKER_LANE_PRIORITY];
+  HOST_TEST_ASSERT(normal->depth == QUEUE_CAPACITY - 1);
+  HOST_TEST_ASSERT(normal->peakDepth == QUEUE_CAPACITY - 1);
+  HOST_TEST_ASSERT(normal->nrOfOverflows == 1);
+  HOST_TEST_ASSERT(priority->depth == 2);
+  HOST_TEST_ASSERT(priority->peakDepth == 2);
+  HOST_TEST_ASSERT(priority->nrOfOverflows == 0);
+  RunBroker();
+  MessageBroker_GetStats(&_broker, &stats);
+  HOST_TEST_ASSERT(normal->depth == 0);
+  HOST_TEST_ASSERT(normal->peakDepth == QUEUE_CAPACITY - 1);
+  HOST_TEST_ASSERT(stats.nrOfDispatches[__builtin_ctz(NORMAL_CATEGORY)] ==
+                   QUEUE_CAPACITY - 1);
+  HOST_TEST_ASSERT(stats.nrOfDispatches[__builtin_ctz(PRIORITY_CATEGORY)] ==
+                   2);
+  // the listeners take the slots in their registration order
+  HOST_TEST_ASSERT(stats.listeners[0].nrOfCalls == QUEUE_CAPACITY - 1);
+  HOST_TEST_ASSERT(stats.listeners[1].nrOfCalls == QUEUE_CAPACITY + 1);
+  HOST_TEST_ASSERT(stats.listeners[2].nrOfCalls == 0);
+  // each handler call reads the clock twice and the handler once more
+  HOST_TEST_ASSERT(stats.listeners[0].maxTicks == 2);
+  HOST_TEST_ASSERT(stats.listeners[0].totalTicks == 2 * (QUEUE_CAPACITY - 1));
+  // every lane, category and listener with calls writes a line
+  Trace_Init(CountLinesCb);
+  MessageBroker_LogStats(&_broker, "test");
+  HOST_TEST_ASSERT(_nrOfTraceLines == MESSAGE_BROKER_NR_OF_LANES + 2 + 2);
+  MessageBroker_ResetStats(&_broker);
+  MessageBroker_GetStats(&_broker, &stats);
+  HOST_TEST_ASSERT(normal->peakDepth == 0 && normal->nrOfOverflows == 0);
+  HOST_TEST_ASSERT(stats.listeners[1].nrOfCalls == 0);
+}
+
+static void Setup(uint8_t weight) {
+  MessageBroker_Create(&_broker, _normalQueue, QUEUE_CAPACITY, BROKER_TASK_ID,
+                       SCHEDULER_PRIO_0);
+  MessageBroker_AddPriorityLane(&_broker, _priorityQueue, QUEUE_CAPACITY,
+                                PRIORITY_CATEGORY, weight);
+  // the listeners leave the list of the previous broker
+  for (uint8_t i = 0; i < NR_OF_LISTENERS; i++) {
+    _listeners[i].listNode.next = 0;
+    _listeners[i].receiveMask = 0;
+  }
+  _nrOfDispatches = 0;
+  _nrOfRepublishes = 0;
+  _listenerToUnregister = 0;
+}
+
+static void Publish(uint16_t category, uint8_t id, uint32_t parameter2) {
+  Message_Message_t message = {
+      .header = {.id = id, .category = category}, .parameter2 = parameter2};
+  MessageBroker_PublishMessage(&_broker, &message);
+}
+
+static void RunBroker() {
+  while (HostTest_RunTasks()) {
+  }
+}
+
+static void BrokerTask() {
+  MessageBroker_Run(&_broker);
+}
+
+static void Record(uint8_t listener, const Message_Message_t* message) {
+  HOST_TEST_ASSERT(_nrOfDispatches < MAX_NR_OF_DISPATCHES);
+  _dispatches[_nrOfDispatches].listener = listener;
+  _dispatches[_nrOfDispatches].message = *message;
+  _nrOfDispatches++;
+}
+
+static bool Listener0Cb(Message_Message_t* message) {
+  Record(0, message);
+  _ticks++;
+  if (message->header.category == PRIORITY_CATEGORY &&
+      _nrOfRepublishes > 0) {
+    _nrOfRepublishes--;
+    Publish(PRIORITY_CATEGORY, message->header.id + 1, 0);
+  }
+  return true;
+}
+
+static bool Listener1Cb(Message_Message_t* message) {
+  Record(1, message);
+  if (_listenerToUnregister != 0) {
+    MessageBroker_UnregisterListener(&_broker, _listenerToUnregister);
+  }
+  return true;
+}
+
+static bool Listener2Cb(Message_Message_t* message) {
+  Record(2, message);
+  return true;
+}
+
+static void SumCb(Message_Message_t* waitingMessage,
+                  const Message_Message_t* message) {
+  waitingMessage->parameter2 += message->parameter2;
+}
+
+static uint32_t ClockCb() {
+  return _ticks++;
+}
+
+static void CountLinesCb(const uint8_t* data, uint16_t length) {
+  _nrOfTraceLines++;
+}
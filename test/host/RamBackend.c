@@ -0,0 +1,237 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file RamBackend.c
+///
+/// Implementation of RamBackend.h
+
+#include "RamBackend.h"
+
+#include "HostTest.h"
+#include "stm32wbxx_hal.h"
+
+#include <string.h>
+
+/// Number of pages of the backend; covers all pages of the internal flash
+/// that may be written by the application.
+#define NR_OF_PAGES (LAST_WRITABLE_FLASH_PAGE + 1)
+
+/// Compute the start address of a page
+/// @param pageNr Number of the page
+/// @return Address of the first byte of the page
+static uint32_t PageAddress(uint8_t pageNr);
+
+/// Read a memory block
+/// @param address Start address of the read operation
+/// @param buffer Buffer to receive the data
+/// @param nrOfBytes Number of bytes to read
+/// @return true if the address range is valid; false otherwise
+static bool Read(uint32_t address, uint8_t* buffer, uint16_t nrOfBytes);
+
+/// Write a memory block; a programmed byte can only be cleared to zero.
+/// @param address Start address of the write operation
+/// @param buffer The data to be written
+/// @param nrOfBytes Number of bytes to write
+/// @return true if the address range is valid; false otherwise
+static bool Write(uint32_t address, const uint8_t* buffer, uint16_t nrOfBytes);
+
+/// Open a write session
+static void BeginWriteSession();
+
+/// Close the write session
+static void EndWriteSession();
+
+/// Erase pages; the completion is signaled by `RamBackend_CompleteErase()`.
+/// @param startPageNr First page to erase
+/// @param nrOfPages Number of pages to erase
+/// @param callback Callback that is called when the erase is completed
+static void Erase(uint16_t startPageNr,
+                  uint8_t nrOfPages,
+                  Flash_OperationComplete callback);
+
+/// The memory of all pages
+static uint8_t _memory[NR_OF_PAGES * FLASH_PAGE_SIZE];
+
+/// Access statistics
+static RamBackend_Stats_t _stats;
+
+/// Number of writes in the open write session
+static uint32_t _writesInSession;
+
+/// Flag to indicate that a write session is open
+static bool _isSessionOpen;
+
+/// Callback of the running erase; 0 if no erase is running
+static Flash_OperationComplete _eraseDoneCb;
+
+/// First page of the running erase
+static uint16_t _erasePage;
+
+/// Number of double words that can be programmed before the power is cut
+static uint32_t _nrOfDoubleWordsUntilPowerCut;
+
+/// Flag to indicate that the power was cut
+static bool _isPowerCut;
+
+/// The backend instance
+static const StorageBackend_t _ramBackend = {
+    .pageSize = FLASH_PAGE_SIZE,
+    .pageAddress = PageAddress,
+    .read = Read,
+    .write = Write,
+    .beginWriteSession = BeginWriteSession,
+    .endWriteSession = EndWriteSession,
+    .erase = Erase};
+
+const StorageBackend_t* StorageBackend_InternalFlashInstance() {
+  return &_ramBackend;
+}
+
+const StorageBackend_t* StorageBackend_ExternalFlashInstance() {
+  return &_ramBackend;
+}
+
+void RamBackend_Reset() {
+  memset(_memory, 0xFF, sizeof _memory);
+  memset(&_stats, 0, sizeof _stats);
+  _writesInSession = 0;
+  _isSessionOpen = false;
+  _eraseDoneCb = 0;
+  RamBackend_RestorePower();
+}
+
+uint8_t* RamBackend_Page(uint8_t pageNr) {
+  HOST_TEST_ASSERT(pageNr < NR_OF_PAGES);
+  return &_memory[PageAddress(pageNr)];
+}
+
+bool RamBackend_CompleteErase() {
+  if (_eraseDoneCb == 0) {
+    return false;
+  }
+  Flash_OperationComplete callback = _eraseDoneCb;
+  _eraseDoneCb = 0;
+  callback(_erasePage, 0);
+  return true;
+}
+
+bool RamBackend_IsSessionOpen() {
+  return _isSessionOpen;
+}
+
+void RamBackend_CutPowerAfter(uint32_t nrOfDoubleWords) {
+  _nrOfDoubleWordsUntilPowerCut = nrOfDoubleWords;
+  _isPowerCut = nrOfDoubleWords == 0;
+}
+
+void RamBackend_RestorePower() {
+  _nrOfDoubleWordsUntilPowerCut = UINT32_MAX;
+  _isPowerCut = false;
+}
+
+bool RamBackend_IsPowerCut() {
+  return _isPowerCut;
+}
+
+RamBackend_Stats_t* RamBackend_Stats() {
+  return &_stats;
+}
+
+static uint32_t PageAddress(uint8_t pageNr) {
+  return (uint32_t)pageNr * FLASH_PAGE_SIZE;
+}
+
+static bool Read(uint32_t address, uint8_t* buffer, uint16_t nrOfBytes) {
+  if (address + nrOfBytes > sizeof _memory) {
+    return false;
+  }
+  _stats.nrOfReads++;
+  memcpy(buffer, &_memory[address], nrOfBytes);
+  return true;
+}
+
+static bool Write(uint32_t address, const uint8_t* buffer, uint16_t nrOfBytes) {
+  if (address + nrOfBytes > sizeof _memory) {
+    return false;
+  }
+  // the flash must not be written while it is erased
+  HOST_TEST_ASSERT(_eraseDoneCb == 0);
+  _stats.nrOfWrites++;
+  if (_isSessionOpen) {
+    _writesInSession++;
+    if (_writesInSession > _stats.maxWritesPerSession) {
+      _stats.maxWritesPerSession = _writesInSession;
+    }
+  }
+  for (uint16_t i = 0; i < nrOfBytes; i++) {
+    // a double word is either programmed completely or not at all
+    if (i == 0 || (address + i) % sizeof(uint64_t) == 0) {
+      if (_nrOfDoubleWordsUntilPowerCut == 0) {
+        _isPowerCut = true;
+        break;
+      }
+      _nrOfDoubleWordsUntilPowerCut--;
+    }
+    // a programmed double word can only be cleared to zero
+    HOST_TEST_ASSERT(_memory[address + i] == 0xFF || buffer[i] == 0);
+    _memory[address + i] &= buffer[i];
+  }
+  return true;
+}
+
+static void BeginWriteSession() {
+  _stats.nrOfSessions++;
+  _isSessionOpen = true;
+  _writesInSession = 0;
+}
+
+static void EndWriteSession() {
+  _isSessionOpen = false;
+}
+
+static void Erase(uint16_t startPageNr,
+                  uint8_t nrOfPages,
+                  Flash_OperationComplete callback) {
+  HOST_TEST_ASSERT(_eraseDoneCb == 0);
+  HOST_TEST_ASSERT(startPageNr + nrOfPages <= NR_OF_PAGES);
+  // like the internal flash, the erase takes over the write session
+  _isSessionOpen = false;
+  if (_nrOfDoubleWordsUntilPowerCut == 0) {
+    _isPowerCut = true;
+  } else {
+    memset(&_memory[PageAddress(startPageNr)], 0xFF,
+           (uint32_t)nrOfPages * FLASH_PAGE_SIZE);
+  }
+  _stats.nrOfErases += nrOfPages;
+  _erasePage = startPageNr;
+  _eraseDoneCb = callback;
+}
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file RamBackend.h
+///
+/// Storage backend of the host tests that keeps the pages in RAM.
+///
+/// The backend replaces both storage backends of the firmware. Like a flash,
+/// a write can only clear bits and an erase sets all bytes of a page to 0xFF.
+/// A programmed byte can only be cleared to zero.
+/// The erase is executed immediately, but its completion is only signaled
+/// by `RamBackend_CompleteErase()`.
+///
+/// A power loss is simulated by `RamBackend_CutPowerAfter()`. Like the
+/// internal flash, the memory is programmed one double word at a time.
+
+#ifndef RAM_BACKEND_H
+#define RAM_BACKEND_H
+
+#include "app_service/nvm/StorageBackend.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Statistics of the accesses to the backend
+typedef struct {
+  uint32_t nrOfReads;     ///< Number of read accesses
+  uint32_t nrOfWrites;    ///< Number of write accesses
+  uint32_t nrOfErases;    ///< Number of erased pages
+  uint32_t nrOfSessions;  ///< Number of opened write sessions
+  /// Highest number of writes within one write session
+  uint32_t maxWritesPerSession;
+} RamBackend_Stats_t;
+
+/// Erase all pages and reset the statistics
+void RamBackend_Reset();
+
+/// Get a pointer to the memory of a page
+/// @param pageNr Number of the page
+/// @return Pointer to the first byte of the page
+uint8_t* RamBackend_Page(uint8_t pageNr);
+
+/// Signal the completion of the running erase.
+/// @return true if an erase was completed; false if no erase is running
+bool RamBackend_CompleteErase();
+
+/// Check if a write session is open
+/// @return true if a write session is open; false otherwise
+bool RamBackend_IsSessionOpen();
+
+/// Cut the power after the specified number of double words are programmed;
+/// the later double words of the same write and all later writes and erases
+/// leave the memory unchanged.
+/// @param nrOfDoubleWords Number of double words that are still programmed
+void RamBackend_CutPowerAfter(uint32_t nrOfDoubleWords);
+
+/// Restore the power; the memory is programmed and erased again.
+void RamBackend_RestorePower();
+
+/// Check if the power was cut
+/// @return true if the memory is no longer changed; false otherwise
+bool RamBackend_IsPowerCut();
+
+/// Get the access statistics of the backend
+/// @return Pointer to the statistics
+RamBackend_Stats_t* RamBackend_Stats();
+
+#endif  // RAM_BACKEND_H
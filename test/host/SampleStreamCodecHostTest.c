@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+
+/// @file SampleStreamCodecHostTest.c
+///
+/// Host tests of the compressed frames of the data logger service.
+
+#include "HostTest.h"
+#include "app_service/networking/ble/gatt_service/SampleStreamCodec.h"
+
+#include <string.h>
+
+/// Largest frame the encoder can fill
+#define MAX_FRAME_SIZE UINT8_MAX
+
+/// Number of samples of a test sequence
+#define NR_OF_SAMPLES 4096
+
+/// Encode a sequence of samples into frames and check that the frames decode
+/// to the same samples.
+/// @param samples The samples to be encoded
+/// @param nrOfSamples Number of samples
+/// @param frameSize Size of the frames
+/// @return Number of frames
+static uint32_t CheckRoundTrip(const SampleStreamCodec_Sample_t* samples,
+                               uint32_t nrOfSamples,
+                               uint8_t frameSize);
+
+/// Get a pseudo random number
+/// @return The next number of the sequence
+static uint32_t Random();
+
+/// Deltas over the full 16 bit range survive the round trip
+static void TestLargeDeltas();
+
+/// A frame of the maximal size holds as many samples as fit
+static void TestMaximalFrame();
+
+/// Random walks of different step sizes survive the round trip
+static void TestRandomWalk();
+
+/// Truncated and malformed frames are not decoded
+static void TestInvalidFrames();
+
+/// The samples of a test sequence
+static SampleStreamCodec_Sample_t _samples[NR_OF_SAMPLES];
+
+/// State of the pseudo random number generator
+static uint32_t _randomState = 1;
+
+int main() {
+  HOST_TEST_RUN(TestLargeDeltas);
+  HOST_TEST_RUN(TestMaximalFrame);
+  HOST_TEST_RUN(TestRandomWalk);
+  HOST_TEST_RUN(TestInvalidFrames);
+  return 0;
+}
+
+static void TestLargeDeltas() {
+  // the deltas of the extremes need three bytes each
+  const SampleStreamCodec_Sample_t extremes[] = {
+      {0, 0},      {0xFFFF, 0xFFFF}, {0, 0xFFFF}, {0xFFFF, 0},
+      {1, 0xFFFE}, {0x8000, 0x7FFF}, {0x7FFF, 0x8000}};
+  uint8_t nrOfExtremes = sizeof extremes / sizeof extremes[0];
+  HOST_TEST_ASSERT(CheckRoundTrip(extremes, nrOfExtremes, MAX_FRAME_SIZE) ==
+                   1);
+  // a frame of the worst case deltas; each sample needs six bytes
+  for (uint32_t i = 0; i < NR_OF_SAMPLES; i++) {
+    _samples[i].temperatureTicks = (i % 2) == 0 ? 0 : 0xFFFF;
+    _samples[i].humidityTicks = (i % 2) == 0 ? 0xFFFF : 0;
+  }
+  uint32_t samplesPerFrame =
+      1 + (MAX_FRAME_SIZE - SAMPLE_STREAM_CODEC_HEADER_SIZE) / 6;
+  HOST_TEST_ASSERT(CheckRoundTrip(_samples, NR_OF_SAMPLES, MAX_FRAME_SIZE) ==
+                   (NR_OF_SAMPLES + samplesPerFrame - 1) / samplesPerFrame);
+}
+
+static void TestMaximalFrame() {
+  uint8_t frame[MAX_FRAME_SIZE];
+  SampleStreamCodec_Encoder_t encoder;
+  SampleStreamCodec_BeginFrame(&encoder, frame, sizeof frame, 0xFFFF);
+  // constant samples need one byte per delta
+  SampleStreamCodec_Sample_t sample = {0x1234, 0x5678};
+  uint8_t nrOfSamples = 0;
+  while (SampleStreamCodec_AddSample(&encoder, &sample)) {
+    nrOfSamples++;
+  }
+  HOST_TEST_ASSERT(nrOfSamples ==
+                   1 + (MAX_FRAME_SIZE - SAMPLE_STREAM_CODEC_HEADER_SIZE) / 2);
+  HOST_TEST_ASSERT(encoder.length <= sizeof frame);
+  SampleStreamCodec_Sample_t decoded[UINT8_MAX];
+  uint16_t frameIndex = 0;
+  HOST_TEST_ASSERT(SampleStreamCodec_DecodeFrame(frame, encoder.length,
+                                                 &frameIndex, decoded,
+                                                 UINT8_MAX) == nrOfSamples);
+  HOST_TEST_ASSERT(frameIndex == 0xFFFF);
+  for (uint8_t i = 0; i < nrOfSamples; i++) {
+    HOST_TEST_ASSERT(decoded[i].temperatureTicks == sample.temperatureTicks);
+    HOST_TEST_ASSERT(decoded[i].humidityTicks == sample.humidityTicks);
+  }
+  // the samples do not fit into the buffer of the client
+  HOST_TEST_ASSERT(SampleStreamCodec_DecodeFrame(frame, encoder.length,
+                                                 &frameIndex, decoded,
+                                                 nrOfSamples - 1) == 0);
+  // a frame without room for the key sample stays empty
+  SampleStreamCodec_BeginFrame(&encoder, frame,
+                               SAMPLE_STREAM_CODEC_HEADER_SIZE - 1, 0);
+  HOST_TEST_ASSERT(!SampleStreamCodec_AddSample(&encoder, &sample));
+}
+
+static void TestRandomWalk() {
+  const uint16_t stepSizes[] = {1, 63, 64, 8191, 8192, 65535};
+  const uint8_t frameSizes[] = {SAMPLE_STREAM_CODEC_HEADER_SIZE, 20, 244,
+                                MAX_FRAME_SIZE};
+  for (uint8_t i = 0; i < sizeof stepSizes / sizeof stepSizes[0]; i++) {
+    SampleStreamCodec_Sample_t sample = {.temperatureTicks = 0x6000,
+                                         .humidityTicks = 0x8000};
+    for (uint32_t j = 0; j < NR_OF_SAMPLES; j++) {
+      sample.temperatureTicks +=
+          (uint16_t)(Random() % (2u * stepSizes[i] + 1) - stepSizes[i]);
+      sample.humidityTicks +=
+          (uint16_t)(Random() % (2u * stepSizes[i] + 1) - stepSizes[i]);
+      _samples[j] = sample;
+    }
+    for (uint8_t j = 0; j < sizeof frameSizes; j++) {
+      CheckRoundTrip(_samples, NR_OF_SAMPLES, frameSizes[j]);
+    }
+  }
+}
+
+static void TestInvalidFrames() {
+  uint8_t frame[MAX_FRAME_SIZE];
+  SampleStreamCodec_Encoder_t encoder;
+  SampleStreamCodec_BeginFrame(&encoder, frame, sizeof frame, 7);
+  SampleStreamCodec_Sample_t decoded[UINT8_MAX];
+  uint16_t frameIndex = 0;
+  // a frame without samples
+  HOST_TEST_ASSERT(SampleStreamCodec_DecodeFrame(frame, sizeof frame,
+                                                 &frameIndex, decoded,
+                                                 UINT8_MAX) == 0);
+  for (uint8_t i = 0; i < 10; i++) {
+    SampleStreamCodec_Sample_t sample = {(uint16_t)(i * 1000),
+                                         (uint16_t)(i * 20000)};
+    HOST_TEST_ASSERT(SampleStreamCodec_AddSample(&encoder, &sample));
+  }
+  // every truncation of the frame is detected
+  for (uint8_t length = 0; length < encoder.length; length++) {
+    HOST_TEST_ASSERT(SampleStreamCodec_DecodeFrame(frame, length, &frameIndex,
+                                                   decoded, UINT8_MAX) == 0);
+  }
+  HOST_TEST_ASSERT(SampleStreamCodec_DecodeFrame(frame, encoder.length,
+                                                 &frameIndex, decoded,
+                                                 UINT8_MAX) == 10);
+  // a delta of more than three bytes
+  memset(&frame[SAMPLE_STREAM_CODEC_HEADER_SIZE], 0xFF, 4);
+  frame[SAMPLE_STREAM_CODEC_HEADER_SIZE + 4] = 0;
+  HOST_TEST_ASSERT(SampleStreamCodec_DecodeFrame(frame, encoder.length,
+                                                 &frameIndex, decoded,
+                                                 UINT8_MAX) == 0);
+}
+
+static uint32_t CheckRoundTrip(const SampleStreamCodec_Sample_t* samples,
+                               uint32_t nrOfSamples,
+                               uint8_t frameSize) {
+  uint8_t frame[MAX_FRAME_SIZE];
+  SampleStreamCodec_Sample_t decoded[UINT8_MAX];
+  SampleStreamCodec_Encoder_t encoder;
+  uint32_t nrOfFrames = 0;
+  uint32_t nrOfEncodedSamples = 0;
+  while (nrOfEncodedSamples < nrOfSamples) {
+    SampleStreamCodec_BeginFrame(&encoder, frame, frameSize,
+                                 (uint16_t)nrOfFrames);
+    uint32_t firstSample = nrOfEncodedSamples;
+    while (nrOfEncodedSamples < nrOfSamples &&
+           SampleStreamCodec_AddSample(&encoder,
+                                       &samples[nrOfEncodedSamples])) {
+      nrOfEncodedSamples++;
+    }
+    HOST_TEST_ASSERT(nrOfEncodedSamples > firstSample);
+    HOST_TEST_ASSERT(encoder.length <= frameSize);
+    uint16_t frameIndex = 0;
+    uint8_t nrOfFrameSamples = SampleStreamCodec_DecodeFrame(
+        frame, encoder.length, &frameIndex, decoded, UINT8_MAX);
+    HOST_TEST_ASSERT(nrOfFrameSamples == nrOfEncodedSamples - firstSample);
+    HOST_TEST_ASSERT(frameIndex == (uint16_t)nrOfFrames);
+    for (uint8_t i = 0; i < nrOfFrameSamples; i++) {
+      const SampleStreamCodec_Sample_t* expected = &samples[firstSample + i];
+      HOST_TEST_ASSERT(decoded[i].temperatureTicks ==
+                       expected->temperatureTicks);
+      HOST_TEST_ASSERT(decoded[i].humidityTicks == expected->humidityTicks);
+    }
+    nrOfFrames++;
+  }
+  return nrOfFrames;
+}
+
+static uint32_t Random() {
+  // xorshift32
+  _randomState ^= _randomState << 13;
+  _randomState ^= _randomState >> 17;
+  _randomState ^= _randomState << 5;
+  return _randomState;
+}
@@ -0,0 +1,249 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file SettingsStoreHostTest.c
+///
+/// Host tests of the settings store that interrupt its writes by a power loss.
+///
+/// The settings records are kept in the RAM backend. The power is cut after
+/// each double word of a snapshot and of a migration; after the reset, the
+/// settings must be either the old or the new settings, never a mix of both.
+
+#include "HostTest.h"
+#include "RamBackend.h"
+#include "app_service/item_store/ItemStore.h"
+#include "app_service/item_store/SettingsStore.h"
+#include "hal/Crc.h"
+#include "stm32wbxx_hal.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/// Number of bytes of the settings that are persisted
+#define SETTINGS_SIZE offsetof(ItemStore_SystemConfig_t, crc)
+
+/// Number of delta records after which a snapshot is written
+#define COMPACTION_THRESHOLD 64
+
+/// Number of delta records that are written before the power is cut; the
+/// next update of all settings writes a snapshot.
+#define NR_OF_DELTAS (COMPACTION_THRESHOLD - 4)
+
+/// Highest number of snapshots that are written before the power is cut;
+/// the interrupted snapshot moves over both pages of the settings.
+#define MAX_NR_OF_SNAPSHOTS 4
+
+/// Size of the page header that precedes the items of a page
+#define PAGE_HEADER_SIZE 16
+
+/// Erase count that marks the pages of a firmware without erase counters
+#define LEGACY_ERASE_COUNT 0xA53C
+
+/// First page of the settings records
+#define CONFIG_FIRST_PAGE FIRST_WRITABLE_FLASH_PAGE
+
+/// Simulate a reset of the device and load the settings
+/// @param isFlashErased Flag to erase all pages before the reset
+static void Reset(bool isFlashErased);
+
+/// Change the logging interval; the change is written as delta record.
+/// @param loggingInterval The new logging interval
+static void UpdateInterval(uint32_t loggingInterval);
+
+/// Change all bytes of the settings
+/// @param pattern Value of the first byte; the following bytes count up
+static void UpdateAll(uint8_t pattern);
+
+/// Fill settings with a pattern
+/// @param settings The settings to be filled
+/// @param pattern Value of the first byte; the following bytes count up
+static void FillSettings(ItemStore_SystemConfig_t* settings, uint8_t pattern);
+
+/// Write the settings as a firmware before version 1.1 did
+/// @param settings The settings to be written
+static void WriteLegacySettings(const ItemStore_SystemConfig_t* settings);
+
+/// Compare the persisted bytes of two settings
+/// @param settings The settings to be compared
+/// @param expected The expected settings
+/// @return true if the persisted bytes are equal; false otherwise
+static bool IsEqual(const ItemStore_SystemConfig_t* settings,
+                    const ItemStore_SystemConfig_t* expected);
+
+/// Callback of the settings store when the settings are loaded
+static void LoadedCb();
+
+/// A snapshot that is cut by a power loss leaves the previous snapshot and
+/// its deltas valid
+static void TestPowerLossDuringSnapshot();
+
+/// A migration that is cut by a power loss is repeated at the next start
+static void TestPowerLossDuringMigration();
+
+/// Settings that are used if nothing is stored
+static ItemStore_SystemConfig_t _defaults;
+
+/// Number of loaded callbacks
+static uint32_t _nrOfLoadedCbs;
+
+int main() {
+  FillSettings(&_defaults, 0x10);
+  HOST_TEST_RUN(TestPowerLossDuringSnapshot);
+  HOST_TEST_RUN(TestPowerLossDuringMigration);
+  return 0;
+}
+
+static void TestPowerLossDuringSnapshot() {
+  for (uint8_t nrOfSnapshots = 1; nrOfSnapshots <= MAX_NR_OF_SNAPSHOTS;
+       nrOfSnapshots++) {
+    // the settings are old until the commit record of the snapshot is
+    // written and new afterwards
+    bool isNew = false;
+    bool isPowerCut = true;
+    for (uint32_t nrOfDoubleWords = 0; isPowerCut; nrOfDoubleWords++) {
+      Reset(true);
+      for (uint8_t i = 0; i < nrOfSnapshots; i++) {
+        // the first update of an empty store writes a snapshot
+        UpdateAll(0x20 + i);
+        // the deltas after the last snapshot do not yet start a compaction
+        uint32_t nrOfDeltas =
+            i + 1u < nrOfSnapshots ? COMPACTION_THRESHOLD : NR_OF_DELTAS;
+        for (uint32_t j = 0; j < nrOfDeltas; j++) {
+          UpdateInterval(j);
+        }
+      }
+      ItemStore_SystemConfig_t old = *SettingsStore_Settings();
+      RamBackend_CutPowerAfter(nrOfDoubleWords);
+      UpdateAll(0x80);
+      isPowerCut = RamBackend_IsPowerCut();
+      ItemStore_SystemConfig_t updated = *SettingsStore_Settings();
+      RamBackend_RestorePower();
+      Reset(false);
+      if (IsEqual(SettingsStore_Settings(), &updated)) {
+        isNew = true;
+      } else {
+        HOST_TEST_ASSERT(!isNew);
+        HOST_TEST_ASSERT(IsEqual(SettingsStore_Settings(), &old));
+      }
+      // the settings are still persisted after the reset
+      UpdateInterval(1000);
+      updated = *SettingsStore_Settings();
+      Reset(false);
+      HOST_TEST_ASSERT(IsEqual(SettingsStore_Settings(), &updated));
+    }
+    HOST_TEST_ASSERT(isNew);
+  }
+}
+
+static void TestPowerLossDuringMigration() {
+  ItemStore_SystemConfig_t legacy;
+  FillSettings(&legacy, 0x40);
+  legacy.crc = Crc_ComputeCrc((uint8_t*)&legacy, SETTINGS_SIZE);
+  bool isPowerCut = true;
+  for (uint32_t nrOfDoubleWords = 0; isPowerCut; nrOfDoubleWords++) {
+    RamBackend_Reset();
+    WriteLegacySettings(&legacy);
+    ItemStore_Init();
+    HostTest_DispatchMessages(ItemStore_ListenerInstance());
+    RamBackend_CutPowerAfter(nrOfDoubleWords);
+    uint32_t nrOfLoadedCbs = _nrOfLoadedCbs;
+    SettingsStore_Load(&_defaults, LoadedCb);
+    HostTest_DispatchMessages(ItemStore_ListenerInstance());
+    HOST_TEST_ASSERT(_nrOfLoadedCbs == nrOfLoadedCbs + 1);
+    isPowerCut = RamBackend_IsPowerCut();
+    RamBackend_RestorePower();
+    // the migration is completed at the next start
+    Reset(false);
+    HOST_TEST_ASSERT(IsEqual(SettingsStore_Settings(), &legacy));
+    Reset(false);
+    HOST_TEST_ASSERT(IsEqual(SettingsStore_Settings(), &legacy));
+    ItemStore_SystemConfig_t settings;
+    HOST_TEST_ASSERT(!ItemStore_ReadLegacyItem(ITEM_DEF_SYSTEM_CONFIG,
+                                               &settings, sizeof settings));
+  }
+}
+
+static void Reset(bool isFlashErased) {
+  if (isFlashErased) {
+    RamBackend_Reset();
+  }
+  ItemStore_Init();
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  uint32_t nrOfLoadedCbs = _nrOfLoadedCbs;
+  SettingsStore_Load(&_defaults, LoadedCb);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+  HOST_TEST_ASSERT(_nrOfLoadedCbs == nrOfLoadedCbs + 1);
+}
+
+static void UpdateInterval(uint32_t loggingInterval) {
+  SettingsStore_Update(offsetof(ItemStore_SystemConfig_t, loggingInterval),
+                       &loggingInterval, sizeof loggingInterval);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+}
+
+static void UpdateAll(uint8_t pattern) {
+  ItemStore_SystemConfig_t settings;
+  FillSettings(&settings, pattern);
+  SettingsStore_Update(0, &settings, SETTINGS_SIZE);
+  HostTest_DispatchMessages(ItemStore_ListenerInstance());
+}
+
+static void FillSettings(ItemStore_SystemConfig_t* settings, uint8_t pattern) {
+  uint8_t* bytes = (uint8_t*)settings;
+  for (uint8_t i = 0; i < sizeof *settings; i++) {
+    bytes[i] = pattern + i;
+  }
+}
+
+static void WriteLegacySettings(const ItemStore_SystemConfig_t* settings) {
+  uint8_t* page = RamBackend_Page(CONFIG_FIRST_PAGE);
+  const uint8_t header[PAGE_HEADER_SIZE / 2] = {
+      0x5A,
+      0xC3,
+      LEGACY_ERASE_COUNT & 0xFF,
+      LEGACY_ERASE_COUNT >> 8,
+      CONFIG_FIRST_PAGE,
+      0,
+      ITEM_DEF_SYSTEM_CONFIG,
+      sizeof(ItemStore_SystemConfig_t)};
+  memcpy(page, header, sizeof header);
+  memcpy(page + PAGE_HEADER_SIZE, settings, sizeof *settings);
+}
+
+static bool IsEqual(const ItemStore_SystemConfig_t* settings,
+                    const ItemStore_SystemConfig_t* expected) {
+  return memcmp(settings, expected, SETTINGS_SIZE) == 0;
+}
+
+static void LoadedCb() {
+  _nrOfLoadedCbs++;
+}
@@ -0,0 +1,387 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file W25q80Simulator.c
+///
+/// Implementation of W25q80Simulator.h and of the functions of the QSPI
+/// driver, the clock and the timer server that the external flash uses.
+
+#include "W25q80Simulator.h"
+
+#include "HostTest.h"
+#include "app_service/nvm/ExternalFlash.h"
+#include "app_service/timer_server/TimerServer.h"
+#include "hal/Clock.h"
+#include "hal/Qspi.h"
+
+#include <string.h>
+
+/// Size of the memory of the flash
+#define MEMORY_SIZE \
+  (EXTERNAL_FLASH_NR_OF_PAGES * (uint32_t)EXTERNAL_FLASH_PAGE_SIZE)
+
+/// Size of a program page
+#define PROGRAM_PAGE_SIZE 256
+
+/// Duration of a page program
+#define PROGRAM_US 400
+
+/// Duration of a write of the status registers
+#define STATUS_WRITE_US 1000
+
+/// Minimal time between the resume and the next suspend of an erase (tSUS)
+#define RESUME_TO_SUSPEND_US 20
+
+/// Time to enter or to leave the power down mode (tDP and tRES1)
+#define POWER_DOWN_TRANSITION_US 3
+
+/// Core clock cycles per microsecond
+#define CYCLES_PER_US 32
+
+/// Busy flag of the status register 1
+#define STATUS_1_BUSY 0x01
+
+/// Write enable latch of the status register 1
+#define STATUS_1_WRITE_ENABLE_LATCH 0x02
+
+/// Quad enable flag of the status register 2
+#define STATUS_2_QUAD_ENABLE 0x02
+
+/// Suspend status flag of the status register 2
+#define STATUS_2_SUSPENDED 0x80
+
+/// Instructions of the W25Q80 that are simulated
+typedef enum {
+  INSTRUCTION_WRITE_STATUS = 0x01,
+  INSTRUCTION_READ_STATUS_1 = 0x05,
+  INSTRUCTION_WRITE_ENABLE = 0x06,
+  INSTRUCTION_QUAD_PAGE_PROGRAM = 0x32,
+  INSTRUCTION_READ_STATUS_2 = 0x35,
+  INSTRUCTION_BLOCK_ERASE_32K = 0x52,
+  INSTRUCTION_FAST_READ_QUAD_OUTPUT = 0x6B,
+  INSTRUCTION_ERASE_SUSPEND = 0x75,
+  INSTRUCTION_ERASE_RESUME = 0x7A,
+  INSTRUCTION_RELEASE_POWER_DOWN = 0xAB,
+  INSTRUCTION_POWER_DOWN = 0xB9,
+} Instruction_t;
+
+/// Get the current time
+/// @return Time in microseconds since the start of the test
+static uint32_t NowUs();
+
+/// Check that the flash accepts an instruction and update the time based
+/// state of the flash.
+/// @param instruction The instruction that is sent
+static void AcceptInstruction(uint8_t instruction);
+
+/// Update the progress of the running erase and complete it if it is done.
+static void UpdateErase();
+
+/// Check if a program, a status write or an unsuspended erase is running
+/// @return true if the flash is busy; false otherwise
+static bool IsBusy();
+
+/// Get the value of a status register
+/// @param instruction Instruction that reads the status register
+/// @return The value of the register
+static uint8_t StatusRegister(uint8_t instruction);
+
+/// Execute an instruction that is sent without data transfer.
+/// @param instruction The instruction
+/// @param instructionData The parameters of the instruction; the first byte
+///                        that is sent is the least significant byte
+static void ExecuteInstruction(uint8_t instruction, uint32_t instructionData);
+
+/// The memory of the flash
+static uint8_t _memory[MEMORY_SIZE];
+
+/// State and statistics
+static W25q80Simulator_State_t _state;
+
+/// Value of the cycle counter
+static uint32_t _cycleCount;
+
+/// Status register 2; the quad enable flag is non volatile
+static uint8_t _status2;
+
+/// Write enable latch
+static bool _isWriteEnabled;
+
+/// Time at which the running program or status write is complete
+static uint32_t _busyUntilUs;
+
+/// Time at which the power mode was changed the last time
+static uint32_t _powerModeUs;
+
+/// Address of the block that is erased
+static uint32_t _eraseAddress;
+
+/// Time the running erase already made progress
+static uint32_t _eraseProgressUs;
+
+/// Time up to which the progress of the erase is accounted for
+static uint32_t _eraseProgressUpdateUs;
+
+/// Time at which the erase was started or resumed the last time
+static uint32_t _eraseResumeUs;
+
+/// Result of the last instruction that returns data
+static uint8_t _instructionResult;
+
+/// Callback of the started timer; 0 if the timer is not running
+static TimerServer_ElapsedCallback_t _timerCb;
+
+/// Timeout of the started timer
+static uint32_t _timerTimeoutMs;
+
+/// Callback of the timer that was created
+static TimerServer_ElapsedCallback_t _createdTimerCb;
+
+void W25q80Simulator_Reset() {
+  memset(_memory, 0xFF, sizeof _memory);
+  memset(&_state, 0, sizeof _state);
+  _state.isPoweredDown = true;
+  _status2 = 0;
+  _isWriteEnabled = false;
+  _busyUntilUs = 0;
+  _powerModeUs = NowUs();
+  _timerCb = 0;
+}
+
+uint8_t* W25q80Simulator_Memory(uint32_t address) {
+  HOST_TEST_ASSERT(address < MEMORY_SIZE);
+  return &_memory[address];
+}
+
+void W25q80Simulator_AdvanceUs(uint32_t durationUs) {
+  _cycleCount += durationUs * CYCLES_PER_US;
+}
+
+bool W25q80Simulator_ElapseTimer() {
+  if (_timerCb == 0) {
+    return false;
+  }
+  TimerServer_ElapsedCallback_t callback = _timerCb;
+  _timerCb = 0;
+  W25q80Simulator_AdvanceUs(_timerTimeoutMs * 1000);
+  callback();
+  return true;
+}
+
+const W25q80Simulator_State_t* W25q80Simulator_State() {
+  UpdateErase();
+  return &_state;
+}
+
+uint32_t Clock_GetCycleCount() {
+  // the driver waits by polling the counter
+  _cycleCount += CYCLES_PER_US;
+  return _cycleCount;
+}
+
+uint8_t TimerServer_CreateTimer(TimerServer_Mode_t mode,
+                                TimerServer_ElapsedCallback_t callback) {
+  // the driver of the external flash uses a single timer
+  HOST_TEST_ASSERT(_createdTimerCb == 0);
+  _createdTimerCb = callback;
+  return 1;
+}
+
+void TimerServer_Start(uint8_t timerId, uint32_t timeoutMs) {
+  // like the timer server, a running timer is restarted
+  HOST_TEST_ASSERT(timerId == 1);
+  _timerCb = _createdTimerCb;
+  _timerTimeoutMs = timeoutMs;
+}
+
+void Qspi_WriteInstruction(uint8_t instruction,
+                           uint32_t instructionData,
+                           Qspi_InstructionDataSize_t dataSize,
+                           uint8_t instructionResultSize,
+                           Qspi_OperationCompleteCb_t operationCompleteCb) {
+  AcceptInstruction(instruction);
+  if (instructionResultSize > 0) {
+    HOST_TEST_ASSERT(instructionResultSize == 1);
+    _instructionResult = StatusRegister(instruction);
+  } else {
+    ExecuteInstruction(instruction, instructionData);
+  }
+  operationCompleteCb();
+}
+
+void Qspi_ReadInstructionData(uint8_t* buffer,
+                              Qspi_OperationCompleteCb_t operationCompleteCb) {
+  buffer[0] = _instructionResult;
+  operationCompleteCb();
+}
+
+void Qspi_QuadInitiateBulkTransfer(
+    uint8_t instruction,
+    uint8_t* address,
+    uint8_t nrOfAddressBytes,
+    uint8_t* buffer,
+    uint16_t nrOfBytes,
+    uint8_t waitCycles,
+    Qspi_TransferDirection_t direction,
+    Qspi_OperationCompleteCb_t operationCompleteCb) {
+  AcceptInstruction(instruction);
+  HOST_TEST_ASSERT((_status2 & STATUS_2_QUAD_ENABLE) != 0);
+  HOST_TEST_ASSERT(nrOfAddressBytes == 3);
+  // the QSPI peripheral sends the address bytes in the order of the memory
+  uint32_t start = address[0] | (address[1] << 8) | (address[2] << 16);
+  HOST_TEST_ASSERT(start + nrOfBytes <= MEMORY_SIZE);
+  HOST_TEST_ASSERT(!IsBusy());
+  if (instruction == INSTRUCTION_FAST_READ_QUAD_OUTPUT) {
+    HOST_TEST_ASSERT(direction == QSPI_TRANSFER_DIRECTION_READ);
+    HOST_TEST_ASSERT(waitCycles == 8);
+    // the content of a block is undefined while its erase is suspended
+    HOST_TEST_ASSERT(!_state.isErasing ||
+                     start + nrOfBytes <= _eraseAddress ||
+                     start >= _eraseAddress + EXTERNAL_FLASH_PAGE_SIZE);
+    memcpy(buffer, &_memory[start], nrOfBytes);
+  } else {
+    HOST_TEST_ASSERT(instruction == INSTRUCTION_QUAD_PAGE_PROGRAM);
+    HOST_TEST_ASSERT(direction == QSPI_TRANSFER_DIRECTION_WRITE);
+    HOST_TEST_ASSERT(_isWriteEnabled);
+    HOST_TEST_ASSERT(start % PROGRAM_PAGE_SIZE + nrOfBytes <=
+                     PROGRAM_PAGE_SIZE);
+    for (uint16_t i = 0; i < nrOfBytes; i++) {
+      _memory[start + i] &= buffer[i];
+    }
+    _isWriteEnabled = false;
+    _busyUntilUs = NowUs() + PROGRAM_US;
+    _state.nrOfPrograms++;
+  }
+  operationCompleteCb();
+}
+
+static uint32_t NowUs() {
+  return _cycleCount / CYCLES_PER_US;
+}
+
+static void AcceptInstruction(uint8_t instruction) {
+  // sending an instruction takes time as well
+  W25q80Simulator_AdvanceUs(1);
+  // the flash does not accept instructions during the mode transition
+  HOST_TEST_ASSERT(NowUs() - _powerModeUs >= POWER_DOWN_TRANSITION_US);
+  // in power down mode, only the release instruction is executed
+  HOST_TEST_ASSERT(!_state.isPoweredDown ||
+                   instruction == INSTRUCTION_RELEASE_POWER_DOWN);
+  UpdateErase();
+}
+
+static void UpdateErase() {
+  if (!_state.isErasing || _state.isEraseSuspended) {
+    return;
+  }
+  uint32_t now = NowUs();
+  _eraseProgressUs += now - _eraseProgressUpdateUs;
+  _eraseProgressUpdateUs = now;
+  if (_eraseProgressUs >= W25Q80_SIMULATOR_ERASE_US) {
+    memset(&_memory[_eraseAddress], 0xFF, EXTERNAL_FLASH_PAGE_SIZE);
+    _state.isErasing = false;
+    _state.nrOfErases++;
+  }
+}
+
+static bool IsBusy() {
+  return NowUs() < _busyUntilUs ||
+         (_state.isErasing && !_state.isEraseSuspended);
+}
+
+static uint8_t StatusRegister(uint8_t instruction) {
+  if (instruction == INSTRUCTION_READ_STATUS_1) {
+    return (IsBusy() ? STATUS_1_BUSY : 0) |
+           (_isWriteEnabled ? STATUS_1_WRITE_ENABLE_LATCH : 0);
+  }
+  HOST_TEST_ASSERT(instruction == INSTRUCTION_READ_STATUS_2);
+  return _status2 | (_state.isEraseSuspended ? STATUS_2_SUSPENDED : 0);
+}
+
+static void ExecuteInstruction(uint8_t instruction, uint32_t instructionData) {
+  switch (instruction) {
+    case INSTRUCTION_WRITE_ENABLE:
+      HOST_TEST_ASSERT(!IsBusy());
+      _isWriteEnabled = true;
+      break;
+    case INSTRUCTION_WRITE_STATUS:
+      HOST_TEST_ASSERT(!IsBusy() && _isWriteEnabled);
+      // the second byte is written to the status register 2
+      _status2 = (instructionData >> 8) & STATUS_2_QUAD_ENABLE;
+      _isWriteEnabled = false;
+      _busyUntilUs = NowUs() + STATUS_WRITE_US;
+      _state.nrOfStatusWrites++;
+      break;
+    case INSTRUCTION_BLOCK_ERASE_32K:
+      HOST_TEST_ASSERT(!IsBusy() && _isWriteEnabled);
+      HOST_TEST_ASSERT(!_state.isErasing);
+      // the address is sent with the most significant byte first
+      _eraseAddress = ((instructionData & 0xFF) << 16) |
+                      (instructionData & 0xFF00) |
+                      ((instructionData >> 16) & 0xFF);
+      HOST_TEST_ASSERT(_eraseAddress % EXTERNAL_FLASH_PAGE_SIZE == 0);
+      HOST_TEST_ASSERT(_eraseAddress < MEMORY_SIZE);
+      _isWriteEnabled = false;
+      _state.isErasing = true;
+      _eraseProgressUs = 0;
+      _eraseResumeUs = NowUs();
+      _eraseProgressUpdateUs = _eraseResumeUs;
+      break;
+    case INSTRUCTION_ERASE_SUSPEND:
+      // the erase does not make progress if it is suspended too early
+      HOST_TEST_ASSERT(_state.isErasing && !_state.isEraseSuspended);
+      HOST_TEST_ASSERT(NowUs() - _eraseResumeUs >= RESUME_TO_SUSPEND_US);
+      _state.isEraseSuspended = true;
+      _state.nrOfSuspends++;
+      break;
+    case INSTRUCTION_ERASE_RESUME:
+      HOST_TEST_ASSERT(_state.isErasing && _state.isEraseSuspended);
+      _state.isEraseSuspended = false;
+      _eraseResumeUs = NowUs();
+      _eraseProgressUpdateUs = _eraseResumeUs;
+      _state.nrOfResumes++;
+      break;
+    case INSTRUCTION_POWER_DOWN:
+      // the instruction is ignored while the flash is busy
+      HOST_TEST_ASSERT(!IsBusy() && !_state.isErasing);
+      _state.isPoweredDown = true;
+      _powerModeUs = NowUs();
+      _state.nrOfPowerDowns++;
+      break;
+    case INSTRUCTION_RELEASE_POWER_DOWN:
+      _state.isPoweredDown = false;
+      _powerModeUs = NowUs();
+      break;
+    default:
+      HOST_TEST_ASSERT(false);
+  }
+}
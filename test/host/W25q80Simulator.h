@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////
+//  S E N S I R I O N   AG,  Laubisruetistr. 50, CH-8712 Staefa, Switzerland
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023, Sensirion AG
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS”
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+////////////////////////////////////////////////////////////////////////////////
+/// @file W25q80Simulator.h
+///
+/// Simulation of the W25Q80 NOR flash behind the QSPI driver.
+///
+/// The simulator replaces the QSPI driver, the cycle counter and the timer
+/// server that are used by the driver of the external flash. It executes the
+/// instructions of the flash and aborts the test if the driver violates the
+/// protocol of the flash: accessing the flash in power down mode or before
+/// the power mode transition time elapsed, reading or programming while the
+/// flash is busy, suspending an erase too early after it was resumed, or
+/// programming across a program page.
+///
+/// Time only advances when the cycle counter is read or a timer elapses.
+/// Every read of the cycle counter advances the time by one microsecond.
+
+#ifndef W25Q80_SIMULATOR_H
+#define W25Q80_SIMULATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Duration of a block erase that is not suspended
+#define W25Q80_SIMULATOR_ERASE_US 45000
+
+/// State and statistics of the simulated flash
+typedef struct {
+  bool isPoweredDown;         ///< The flash is in power down mode
+  bool isErasing;             ///< A block erase is started and not complete
+  bool isEraseSuspended;      ///< The running erase is suspended
+  uint32_t nrOfSuspends;      ///< Number of erase suspend instructions
+  uint32_t nrOfResumes;       ///< Number of erase resume instructions
+  uint32_t nrOfPrograms;      ///< Number of page program instructions
+  uint32_t nrOfErases;        ///< Number of completed block erases
+  uint32_t nrOfPowerDowns;    ///< Number of power down instructions
+  uint32_t nrOfStatusWrites;  ///< Number of status register writes
+} W25q80Simulator_State_t;
+
+/// Erase the memory and clear the non volatile quad enable bit.
+///
+/// As after a reset of the MCU, the flash may still be in power down mode.
+void W25q80Simulator_Reset();
+
+/// Get a pointer to the simulated memory
+/// @param address Address within the flash
+/// @return Pointer to the byte at the address
+uint8_t* W25q80Simulator_Memory(uint32_t address);
+
+/// Let time pass without accessing the flash.
+/// @param durationUs Time that elapses in microseconds
+void W25q80Simulator_AdvanceUs(uint32_t durationUs);
+
+/// Let the started timer elapse and call its callback.
+/// @return true if a timer was started; false otherwise
+bool W25q80Simulator_ElapseTimer();
+
+/// Get the state of the simulated flash
+/// @return Pointer to the state
+const W25q80Simulator_State_t* W25q80Simulator_State();
+
+#endif  // W25Q80_SIMULATOR_H